@@ -0,0 +1,208 @@
+#include <algorithm>
+#include <cmath>
+#include "AffineTransform.h"
+
+
+static const int64_t ONE = (int64_t) 1 << AffineTransform::FRACTION_BITS;
+static const int64_t HALF = ONE / 2;
+static const int64_t MAX_COEFFICIENT = ONE << 15; // 2^15 in fixed point.
+static const int64_t MAX_OFFSET = ONE << 31; // 2^31 in fixed point.
+
+// Returns the given fixed-point value rounded half up to an integer.
+static int64_t roundFixed(int64_t value)
+{
+    return (value + HALF) >> AffineTransform::FRACTION_BITS;
+}
+
+// Returns the given fixed-point value rounded half up to an int.
+// Throws TransformRangeException if it doesn't fit in an int.
+static int toInt(int64_t value)
+{
+    int64_t rounded = roundFixed(value);
+    if (rounded < INT32_MIN || rounded > INT32_MAX)
+    {
+        throw TransformRangeException();
+    }
+    return (int) rounded;
+}
+
+// Returns the given coefficient in fixed point.
+// Throws TransformRangeException if it isn't smaller than 2^15 in absolute value.
+static int64_t toFixed(double coefficient)
+{
+    double fixed = std::round(coefficient * ONE);
+    if (!(std::fabs(fixed) < MAX_COEFFICIENT))
+    {
+        throw TransformRangeException();
+    }
+    return (int64_t) fixed;
+}
+
+// throws TransformRangeException if the given fixed-point coefficient isn't smaller than 2^15 in absolute value.
+static int64_t checkFixed(int64_t coefficient)
+{
+    if (coefficient <= -MAX_COEFFICIENT || coefficient >= MAX_COEFFICIENT)
+    {
+        throw TransformRangeException();
+    }
+    return coefficient;
+}
+
+// Returns the fixed-point offset (x, y) moved by the row (a, b) of a transform's coefficients and then by the given
+// offset. The offsets are at most 2^31 in absolute value, so they are split into whole and fraction parts, and no
+// product is more than 2^62 in absolute value.
+// Throws TransformRangeException if the result is more than 2^31 in absolute value.
+static int64_t transformOffset(int64_t a, int64_t b, int64_t x, int64_t y, int64_t offset)
+{
+    // Checked in floating point first, as the whole parts' products can add up past 2^63 only for far larger offsets.
+    if (!(std::fabs(((double) a * x + (double) b * y) / ONE + (double) offset) <= 2.0 * MAX_OFFSET))
+    {
+        throw TransformRangeException();
+    }
+    int64_t wholeX = x / ONE, wholeY = y / ONE;
+    int64_t result = a * wholeX + b * wholeY + roundFixed(a * (x - wholeX * ONE) + b * (y - wholeY * ONE)) + offset;
+    if (result < -MAX_OFFSET || result > MAX_OFFSET)
+    {
+        throw TransformRangeException();
+    }
+    return result;
+}
+
+// Creates the transform of the given fixed-point coefficients.
+AffineTransform::AffineTransform(int64_t a, int64_t b, int64_t c, int64_t d, int64_t tx, int64_t ty) : _a(a), _b(b),
+                                                                                                       _c(c), _d(d),
+                                                                                                       _tx(tx), _ty(ty)
+{
+    // The determinant is worked out in floating point once here, so applying the scale stays integer only.
+    double determinant = ((double) _a * _d - (double) _b * _c) / ((double) ONE * ONE);
+    _radiusScale = toFixed(std::sqrt(std::fabs(determinant)));
+}
+
+/**
+ * Creates the identity transform.
+ */
+AffineTransform::AffineTransform() : AffineTransform(ONE, 0, 0, ONE, 0, 0)
+{}
+
+/**
+ * Returns a transform that moves points by the given offset.
+ *
+ * @param dx The offset on the x axis.
+ * @param dy The offset on the y axis.
+ * @return A transform that moves points by the given offset.
+ */
+AffineTransform AffineTransform::translation(int dx, int dy)
+{
+    return AffineTransform(ONE, 0, 0, ONE, dx * ONE, dy * ONE);
+}
+
+/**
+ * Returns a transform that scales points about the origin by the given factors.
+ * Throws TransformRangeException if a factor isn't smaller than 2^15 in absolute value.
+ *
+ * @param sx The scale factor on the x axis.
+ * @param sy The scale factor on the y axis.
+ * @return A transform that scales points about the origin by the given factors.
+ */
+AffineTransform AffineTransform::scaling(double sx, double sy)
+{
+    return AffineTransform(toFixed(sx), 0, 0, toFixed(sy), 0, 0);
+}
+
+/**
+ * Returns a transform that rotates points about the origin by the given angle (clockwise on the screen).
+ *
+ * @param radians The angle in radians.
+ * @return A transform that rotates points about the origin by the given angle.
+ */
+AffineTransform AffineTransform::rotation(double radians)
+{
+    int64_t cosine = toFixed(std::cos(radians)), sine = toFixed(std::sin(radians));
+    return AffineTransform(cosine, -sine, sine, cosine, 0, 0);
+}
+
+/**
+ * Returns the transform that applies this transform and then the given one.
+ * Throws TransformRangeException if a coefficient of the result isn't smaller than 2^15 in absolute value, or if its
+ * offset is more than 2^31 in absolute value.
+ *
+ * @param next The transform to apply after this one.
+ * @return The transform that applies this transform and then the given one.
+ */
+AffineTransform AffineTransform::then(const AffineTransform &next) const
+{
+    return AffineTransform(checkFixed(roundFixed(next._a * _a + next._b * _c)),
+                           checkFixed(roundFixed(next._a * _b + next._b * _d)),
+                           checkFixed(roundFixed(next._c * _a + next._d * _c)),
+                           checkFixed(roundFixed(next._c * _b + next._d * _d)),
+                           transformOffset(next._a, next._b, _tx, _ty, next._tx),
+                           transformOffset(next._c, next._d, _tx, _ty, next._ty));
+}
+
+/**
+ * Returns the given point transformed.
+ * Throws TransformRangeException if a coordinate of the result doesn't fit in an int.
+ *
+ * @param point The point to transform.
+ * @return The given point transformed.
+ */
+Vector2 AffineTransform::apply(const Vector2 &point) const
+{
+    return Vector2(toInt(_a * point.x + _b * point.y + _tx), toInt(_c * point.x + _d * point.y + _ty));
+}
+
+/**
+ * Transforms the given points, given as separate arrays of x and y coordinates (which can be the output arrays).
+ * Runs as one vectorizable pass over the arrays.
+ * Throws TransformRangeException if a coordinate of a result doesn't fit in an int (the output arrays are partly
+ * written then).
+ *
+ * @param xs The x coordinates of the points.
+ * @param ys The y coordinates of the points.
+ * @param outXs This will be set to the transformed x coordinates.
+ * @param outYs This will be set to the transformed y coordinates.
+ * @param size The number of points.
+ */
+void AffineTransform::apply(const int32_t *xs, const int32_t *ys, int32_t *outXs, int32_t *outYs, int size) const
+{
+    // Copies of the coefficients in locals, so the compiler knows the stores can't change them.
+    // The range of the results is kept on the way (branch free, so the loop still vectorizes) and checked at the end.
+    const int64_t a = _a, b = _b, c = _c, d = _d, tx = _tx + HALF, ty = _ty + HALF;
+    int64_t minResult = 0, maxResult = 0;
+    for (int i = 0; i < size; ++i)
+    {
+        int64_t x = xs[i], y = ys[i];
+        int64_t outX = (a * x + b * y + tx) >> FRACTION_BITS, outY = (c * x + d * y + ty) >> FRACTION_BITS;
+        minResult = std::min(minResult, std::min(outX, outY));
+        maxResult = std::max(maxResult, std::max(outX, outY));
+        outXs[i] = (int32_t) outX;
+        outYs[i] = (int32_t) outY;
+    }
+    if (minResult < INT32_MIN || maxResult > INT32_MAX)
+    {
+        throw TransformRangeException();
+    }
+}
+
+/**
+ * Returns the given circle radius scaled by the square root of the transform's area scale (exact for rotations
+ * and uniform scales, the radius of the circle of the same area otherwise).
+ * Throws TransformRangeException if the result doesn't fit in an int.
+ *
+ * @param radius The radius to scale.
+ * @return The scaled radius.
+ */
+int AffineTransform::applyToRadius(int radius) const
+{
+    return toInt(_radiusScale * radius);
+}
+
+/**
+ * Returns true if the transform mirrors (turns clockwise vertices counter-clockwise). Otherwise, returns false.
+ *
+ * @return true if the transform mirrors. Otherwise, returns false.
+ */
+bool AffineTransform::isMirroring() const
+{
+    return _a * _d - _b * _c < 0;
+}
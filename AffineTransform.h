@@ -0,0 +1,133 @@
+//
+// Created by jacko on 30/10/2020.
+//
+
+#ifndef POLYTEST_AFFINETRANSFORM_H
+#define POLYTEST_AFFINETRANSFORM_H
+
+
+#include <cstdint>
+#include <exception>
+#include "Image.h"
+
+
+#define ERROR_TRANSFORM_RANGE "ERROR: Affine transform coefficient is out of the fixed-point range."
+
+
+/**
+ * Exception for affine transforms whose coefficients can't be represented in fixed point.
+ */
+class TransformRangeException : public std::exception
+{
+public:
+    const char *what() const noexcept override
+    {
+        return ERROR_TRANSFORM_RANGE;
+    }
+};
+
+/**
+ * 2d affine transform of pixel coordinates: x' = a * x + b * y + tx and y' = c * x + d * y + ty.
+ * The coefficients are kept in fixed point (FRACTION_BITS fraction bits) and the results are rounded half up, so the
+ * same transform of the same points gives the same pixels on every platform (no floating point in the hot path).
+ * Rotations are clockwise on the screen (y goes down).
+ */
+class AffineTransform
+{
+    int64_t _a, _b, _c, _d, _tx, _ty;
+    int64_t _radiusScale; // The square root of the area scale, for circles.
+
+    // Creates the transform of the given fixed-point coefficients.
+    AffineTransform(int64_t a, int64_t b, int64_t c, int64_t d, int64_t tx, int64_t ty);
+
+public:
+    /**
+     * Number of fraction bits of the fixed-point coefficients.
+     */
+    static const int FRACTION_BITS = 16;
+
+    /**
+     * Creates the identity transform.
+     */
+    AffineTransform();
+
+    /**
+     * Returns a transform that moves points by the given offset.
+     *
+     * @param dx The offset on the x axis.
+     * @param dy The offset on the y axis.
+     * @return A transform that moves points by the given offset.
+     */
+    static AffineTransform translation(int dx, int dy);
+
+    /**
+     * Returns a transform that scales points about the origin by the given factors.
+     * Throws TransformRangeException if a factor isn't smaller than 2^15 in absolute value.
+     *
+     * @param sx The scale factor on the x axis.
+     * @param sy The scale factor on the y axis.
+     * @return A transform that scales points about the origin by the given factors.
+     */
+    static AffineTransform scaling(double sx, double sy);
+
+    /**
+     * Returns a transform that rotates points about the origin by the given angle (clockwise on the screen).
+     *
+     * @param radians The angle in radians.
+     * @return A transform that rotates points about the origin by the given angle.
+     */
+    static AffineTransform rotation(double radians);
+
+    /**
+     * Returns the transform that applies this transform and then the given one.
+     * Throws TransformRangeException if a coefficient of the result isn't smaller than 2^15 in absolute value, or if
+     * its offset is more than 2^31 in absolute value.
+     *
+     * @param next The transform to apply after this one.
+     * @return The transform that applies this transform and then the given one.
+     */
+    AffineTransform then(const AffineTransform &next) const;
+
+    /**
+     * Returns the given point transformed.
+     * Throws TransformRangeException if a coordinate of the result doesn't fit in an int.
+     *
+     * @param point The point to transform.
+     * @return The given point transformed.
+     */
+    Vector2 apply(const Vector2 &point) const;
+
+    /**
+     * Transforms the given points, given as separate arrays of x and y coordinates (which can be the output arrays).
+     * Runs as one vectorizable pass over the arrays.
+     * Throws TransformRangeException if a coordinate of a result doesn't fit in an int (the output arrays are partly
+     * written then).
+     *
+     * @param xs The x coordinates of the points.
+     * @param ys The y coordinates of the points.
+     * @param outXs This will be set to the transformed x coordinates.
+     * @param outYs This will be set to the transformed y coordinates.
+     * @param size The number of points.
+     */
+    void apply(const int32_t *xs, const int32_t *ys, int32_t *outXs, int32_t *outYs, int size) const;
+
+    /**
+     * Returns the given circle radius scaled by the square root of the transform's area scale (exact for rotations
+     * and uniform scales, the radius of the circle of the same area otherwise).
+     * Throws TransformRangeException if the result doesn't fit in an int.
+     *
+     * @param radius The radius to scale.
+     * @return The scaled radius.
+     */
+    int applyToRadius(int radius) const;
+
+    /**
+     * Returns true if the transform mirrors (turns clockwise vertices counter-clockwise). Otherwise, returns false.
+     *
+     * @return true if the transform mirrors. Otherwise, returns false.
+     */
+    bool isMirroring() const;
+};
+
+
+#endif //POLYTEST_AFFINETRANSFORM_H
@@ -0,0 +1,291 @@
+#include <algorithm>
+#include <cstdint>
+#include "DisplayList.h"
+#include "ShapeList.h"
+#include "SpanCompositor.h"
+
+
+static const unsigned char MAGIC[4] = {'D', 'S', 'P', 'L'};
+static const size_t HEADER_SIZE = 16;
+static const size_t COMMAND_SIZE = 16;
+
+// Reads a little-endian 16 bit unsigned integer.
+static uint16_t readUint16(const unsigned char *data)
+{
+    return (uint16_t) (data[0] | (data[1] << 8));
+}
+
+// Reads a little-endian 32 bit signed integer.
+static int32_t readInt32(const unsigned char *data)
+{
+    return (int32_t) ((uint32_t) data[0] | ((uint32_t) data[1] << 8) | ((uint32_t) data[2] << 16) |
+                      ((uint32_t) data[3] << 24));
+}
+
+// Appends a little-endian 16 bit unsigned integer.
+static void writeUint16(std::vector<unsigned char> &buffer, uint16_t value)
+{
+    buffer.push_back((unsigned char) value);
+    buffer.push_back((unsigned char) (value >> 8));
+}
+
+// Appends a little-endian 32 bit signed integer.
+static void writeInt32(std::vector<unsigned char> &buffer, int32_t value)
+{
+    uint32_t bits = (uint32_t) value;
+    buffer.push_back((unsigned char) bits);
+    buffer.push_back((unsigned char) (bits >> 8));
+    buffer.push_back((unsigned char) (bits >> 16));
+    buffer.push_back((unsigned char) (bits >> 24));
+}
+
+
+// extends the bounding box to contain the given command.
+void DisplayList::_addToBounds(const Command &command)
+{
+    if (_commands.empty())
+    {
+        _topLeft = Vector2(command.xStart, command.y);
+        _bottomRight = Vector2(command.xEnd, command.y);
+        return;
+    }
+    _topLeft.x = std::min(_topLeft.x, command.xStart);
+    _topLeft.y = std::min(_topLeft.y, command.y);
+    _bottomRight.x = std::max(_bottomRight.x, command.xEnd);
+    _bottomRight.y = std::max(_bottomRight.y, command.y);
+}
+
+// replays the commands into the given image, translated by the given offset (bounds were checked).
+void DisplayList::_replay(Image &img, const Vector2 &offset) const
+{
+    for (const Command &command : _commands)
+    {
+        img.drawHorizontalLine(Vector2(command.xStart + offset.x, command.y + offset.y), command.xEnd + offset.x,
+                               command.color);
+    }
+}
+
+// returns true if the given command is a non-empty span of pixels in the range of a valid shape list (so it can't
+// overflow when it is optimized or moved by a view's offset). Otherwise, returns false.
+bool DisplayList::_isInRange(const Command &command)
+{
+    return command.y >= 0 && command.y <= ShapeListView::MAX_COORDINATE && command.xStart >= 0 &&
+           command.xStart <= command.xEnd && command.xEnd <= ShapeListView::MAX_COORDINATE;
+}
+
+/**
+ * Creates an empty display list.
+ */
+DisplayList::DisplayList() = default;
+
+/**
+ * Records drawing the given shape (in front of everything recorded so far).
+ *
+ * @param shape The shape to record.
+ */
+void DisplayList::record(const Shape &shape)
+{
+    _shapeSpans.clear();
+    shape.getSpans(_shapeSpans);
+    for (const Span &span : _shapeSpans)
+    {
+        Command command = {span.y, span.xStart, span.xEnd, shape.getColor()};
+        _addToBounds(command);
+        _commands.push_back(command);
+    }
+}
+
+/**
+ * Records drawing the given shapes in order.
+ *
+ * @param shapes An array of shape pointers.
+ * @param size The size of the shapes array.
+ */
+void DisplayList::record(const Shape **shapes, int size)
+{
+    for (int i = 0; i < size; ++i)
+    {
+        record(*shapes[i]);
+    }
+}
+
+/**
+ * Compiles the recorded commands for replay: sorts them by row (for locality), drops the parts that later
+ * commands draw over and joins neighbouring commands of the same color. Replaying then writes every covered
+ * pixel once, top to bottom. Recording after optimizing is allowed.
+ */
+void DisplayList::optimize()
+{
+    // Commands of different rows never overlap, so only the order within each row matters.
+    std::stable_sort(_commands.begin(), _commands.end(), [](const Command &a, const Command &b)
+    {
+        return a.y < b.y;
+    });
+
+    std::vector<Command> optimized;
+    optimized.reserve(_commands.size());
+    CoveredRanges covered;
+    for (size_t rowStart = 0; rowStart < _commands.size();)
+    {
+        size_t rowEnd = rowStart;
+        while (rowEnd < _commands.size() && _commands[rowEnd].y == _commands[rowStart].y)
+        {
+            rowEnd++;
+        }
+
+        // Keep only the visible parts, front (last recorded) to back.
+        size_t visibleStart = optimized.size();
+        covered.clear();
+        for (size_t i = rowEnd; i > rowStart; --i)
+        {
+            const Command &command = _commands[i - 1];
+            covered.cover(command.xStart, command.xEnd, [&](int xStart, int xEnd)
+            {
+                optimized.push_back(Command{command.y, xStart, xEnd, command.color});
+            });
+        }
+
+        // The visible parts don't overlap, so they can be written left to right and joined where possible.
+        auto visible = optimized.begin() + visibleStart;
+        std::sort(visible, optimized.end(), [](const Command &a, const Command &b)
+        {
+            return a.xStart < b.xStart;
+        });
+        auto joined = visible;
+        for (auto part = visible + 1; part < optimized.end(); ++part)
+        {
+            if (part->xStart == joined->xEnd + 1 && part->color == joined->color)
+            {
+                joined->xEnd = part->xEnd;
+            }
+            else
+            {
+                *++joined = *part;
+            }
+        }
+        if (visible != optimized.end())
+        {
+            optimized.erase(joined + 1, optimized.end());
+        }
+        rowStart = rowEnd;
+    }
+    _commands.swap(optimized);
+}
+
+/**
+ * Replays the recorded commands into the given image.
+ * Throws exception if the commands are out of image bounds (nothing is drawn then).
+ *
+ * @param img The image to draw to.
+ */
+void DisplayList::replay(Image &img) const
+{
+    if (_commands.empty())
+    {
+        return;
+    }
+    if (!img.isPixelValid(_topLeft) || !img.isPixelValid(_bottomRight))
+    {
+        throw ImageDimException();
+    }
+    _replay(img, Vector2(0, 0));
+}
+
+/**
+ * Replays the recorded commands into the given view, in view coordinates.
+ * Throws exception if the commands are out of view bounds (nothing is drawn then).
+ *
+ * @param view The view to draw to.
+ */
+void DisplayList::replay(ImageView &view) const
+{
+    if (_commands.empty())
+    {
+        return;
+    }
+    if (!view.isPixelValid(_topLeft) || !view.isPixelValid(_bottomRight))
+    {
+        throw ImageDimException();
+    }
+    _replay(view.getImage(), view.getOffset());
+}
+
+/**
+ * Returns the number of compiled commands (row spans).
+ *
+ * @return The number of compiled commands.
+ */
+int DisplayList::getCommandCount() const
+{
+    return (int) _commands.size();
+}
+
+/**
+ * Removes all recorded commands.
+ */
+void DisplayList::clear()
+{
+    _commands.clear();
+}
+
+/**
+ * Serializes the display list to the given buffer (replacing its content).
+ *
+ * @param buffer The buffer to serialize into.
+ */
+void DisplayList::serialize(std::vector<unsigned char> &buffer) const
+{
+    buffer.clear();
+    buffer.reserve(HEADER_SIZE + _commands.size() * COMMAND_SIZE);
+    buffer.insert(buffer.end(), MAGIC, MAGIC + 4);
+    writeUint16(buffer, VERSION);
+    writeUint16(buffer, 0);
+    writeInt32(buffer, (int32_t) _commands.size());
+    writeInt32(buffer, 0);
+
+    for (const Command &command : _commands)
+    {
+        writeInt32(buffer, command.y);
+        writeInt32(buffer, command.xStart);
+        writeInt32(buffer, command.xEnd);
+        buffer.push_back(command.color);
+        buffer.insert(buffer.end(), 3, 0);
+    }
+}
+
+/**
+ * Returns the display list that is serialized in the given buffer.
+ * Throws DisplayListFormatException if the buffer doesn't hold a valid display list (also if a coordinate is negative
+ * or more than ShapeListView::MAX_COORDINATE).
+ *
+ * @param data The buffer.
+ * @param size The size of the buffer in bytes.
+ * @return The display list that is serialized in the given buffer.
+ */
+DisplayList DisplayList::deserialize(const void *data, size_t size)
+{
+    auto bytes = (const unsigned char *) data;
+    if (size < HEADER_SIZE || !std::equal(MAGIC, MAGIC + 4, bytes) || readUint16(bytes + 4) != VERSION)
+    {
+        throw DisplayListFormatException();
+    }
+    int32_t count = readInt32(bytes + 8);
+    if (count < 0 || (size - HEADER_SIZE) / COMMAND_SIZE != (size_t) count || (size - HEADER_SIZE) % COMMAND_SIZE)
+    {
+        throw DisplayListFormatException();
+    }
+
+    DisplayList list;
+    list._commands.reserve(count);
+    for (const unsigned char *record = bytes + HEADER_SIZE; record < bytes + size; record += COMMAND_SIZE)
+    {
+        Command command = {readInt32(record), readInt32(record + 4), readInt32(record + 8), record[12]};
+        if (!_isInRange(command))
+        {
+            throw DisplayListFormatException();
+        }
+        list._addToBounds(command);
+        list._commands.push_back(command);
+    }
+    return list;
+}
@@ -0,0 +1,142 @@
+//
+// Created by jacko on 30/10/2020.
+//
+
+#ifndef POLYTEST_DISPLAYLIST_H
+#define POLYTEST_DISPLAYLIST_H
+
+
+#include <vector>
+#include "Shapes.h"
+
+
+#define ERROR_DISPLAY_LIST_FORMAT "ERROR: Display list data is malformed or has an unsupported version."
+
+
+/**
+ * Exception for malformed or unsupported serialized display lists.
+ */
+class DisplayListFormatException : public std::exception
+{
+public:
+    const char *what() const noexcept override
+    {
+        return ERROR_DISPLAY_LIST_FORMAT;
+    }
+};
+
+/**
+ * Recorded draw calls, compiled into a flat buffer of colored row spans that can be replayed into any image
+ * (or view) without redoing the shapes' setup. Replaying gives the same result as drawing the recorded shapes
+ * in the order they were recorded.
+ *
+ * Serialized layout (little-endian): magic "DSPL", version (2 bytes), reserved (2 bytes), commands count (4 bytes),
+ * reserved (4 bytes), followed by one command per span: y, first x and last x (4 bytes each), color (1 byte)
+ * and 3 reserved bytes.
+ * The coordinates of a valid serialized list are pixels within ShapeListView::MAX_COORDINATE.
+ */
+class DisplayList
+{
+    // Fills a span of a row with a color.
+    struct Command
+    {
+        int y, xStart, xEnd;
+        unsigned char color;
+    };
+
+    std::vector<Command> _commands;
+    std::vector<Span> _shapeSpans; // Spans of the shape that is being recorded.
+    Vector2 _topLeft, _bottomRight; // Bounding box of all commands (only meaningful if there are any).
+
+    // extends the bounding box to contain the given command.
+    void _addToBounds(const Command &command);
+
+    // replays the commands into the given image, translated by the given offset (bounds were checked).
+    void _replay(Image &img, const Vector2 &offset) const;
+
+    // returns true if the given command is a non-empty span of pixels in the range of a valid shape list (so it can't
+    // overflow when it is optimized or moved by a view's offset). Otherwise, returns false.
+    static bool _isInRange(const Command &command);
+
+public:
+    /**
+     * Current version of the serialized format.
+     */
+    static const int VERSION = 1;
+
+    /**
+     * Creates an empty display list.
+     */
+    DisplayList();
+
+    /**
+     * Records drawing the given shape (in front of everything recorded so far).
+     *
+     * @param shape The shape to record.
+     */
+    void record(const Shape &shape);
+
+    /**
+     * Records drawing the given shapes in order.
+     *
+     * @param shapes An array of shape pointers.
+     * @param size The size of the shapes array.
+     */
+    void record(const Shape **shapes, int size);
+
+    /**
+     * Compiles the recorded commands for replay: sorts them by row (for locality), drops the parts that later
+     * commands draw over and joins neighbouring commands of the same color. Replaying then writes every covered
+     * pixel once, top to bottom. Recording after optimizing is allowed.
+     */
+    void optimize();
+
+    /**
+     * Replays the recorded commands into the given image.
+     * Throws exception if the commands are out of image bounds (nothing is drawn then).
+     *
+     * @param img The image to draw to.
+     */
+    void replay(Image &img) const;
+
+    /**
+     * Replays the recorded commands into the given view, in view coordinates.
+     * Throws exception if the commands are out of view bounds (nothing is drawn then).
+     *
+     * @param view The view to draw to.
+     */
+    void replay(ImageView &view) const;
+
+    /**
+     * Returns the number of compiled commands (row spans).
+     *
+     * @return The number of compiled commands.
+     */
+    int getCommandCount() const;
+
+    /**
+     * Removes all recorded commands.
+     */
+    void clear();
+
+    /**
+     * Serializes the display list to the given buffer (replacing its content).
+     *
+     * @param buffer The buffer to serialize into.
+     */
+    void serialize(std::vector<unsigned char> &buffer) const;
+
+    /**
+     * Returns the display list that is serialized in the given buffer.
+     * Throws DisplayListFormatException if the buffer doesn't hold a valid display list (also if a coordinate is
+     * negative or more than ShapeListView::MAX_COORDINATE).
+     *
+     * @param data The buffer.
+     * @param size The size of the buffer in bytes.
+     * @return The display list that is serialized in the given buffer.
+     */
+    static DisplayList deserialize(const void *data, size_t size);
+};
+
+
+#endif //POLYTEST_DISPLAYLIST_H
@@ -1,34 +1,205 @@
 #include <algorithm>
+#include <cstring>
 #include <iomanip>
 #include "Image.h"
+#include "ImagePool.h"
 
 
-// frees the memory taken by the image data.
-void Image::_freeMatrix()
+static const int CHUNK_SHIFT = 6;
+static const int CHUNK_SIZE = 1 << CHUNK_SHIFT;
+static const int BITS_PER_WORD = 64;
+static const int TILE_PIXELS = Image::TILE_SIZE * Image::TILE_SIZE;
+
+static const uint64_t HASH_PRIME_1 = 11400714785074694791ULL;
+static const uint64_t HASH_PRIME_2 = 14029467366897019727ULL;
+static const uint64_t HASH_PRIME_3 = 1609587929392839161ULL;
+static const uint64_t HASH_PRIME_4 = 9650029242287828579ULL;
+static const uint64_t HASH_PRIME_5 = 2870177450012600261ULL;
+static const int HASH_LANES = 4;
+static const int HASH_STRIPE_SIZE = HASH_LANES * 8;
+
+// Returns the given word rotated left by the given number of bits.
+static uint64_t rotateLeft(uint64_t word, int bits)
 {
-    for (int i = 0; i < _height; ++i)
+    return (word << bits) | (word >> (64 - bits));
+}
+
+// Mixes 8 bytes of input into a hash lane.
+static uint64_t hashRound(uint64_t lane, uint64_t input)
+{
+    lane += input * HASH_PRIME_2;
+    return rotateLeft(lane, 31) * HASH_PRIME_1;
+}
+
+/**
+ * Streaming 64 bit hash (xxHash64 style) with 4 independent lanes, so 32 bytes are mixed per step
+ * without the lanes waiting on each other.
+ */
+class PixelHasher
+{
+    uint64_t _lanes[HASH_LANES];
+    unsigned char _stripe[HASH_STRIPE_SIZE];
+    int _stripeSize;
+    uint64_t _totalSize;
+
+    // Mixes a full 32 bytes stripe into the lanes.
+    void _consumeStripe(const unsigned char *stripe)
+    {
+        for (int i = 0; i < HASH_LANES; ++i)
+        {
+            uint64_t input;
+            std::memcpy(&input, stripe + 8 * i, sizeof(input));
+            _lanes[i] = hashRound(_lanes[i], input);
+        }
+    }
+
+public:
+    explicit PixelHasher(uint64_t seed) : _lanes{seed + HASH_PRIME_1 + HASH_PRIME_2, seed + HASH_PRIME_2, seed,
+                                                 seed - HASH_PRIME_1}, _stripe(), _stripeSize(0), _totalSize(0)
+    {}
+
+    // Mixes the given bytes into the hash.
+    void update(const unsigned char *data, int length)
     {
-        delete[] _matrix[i];
+        _totalSize += length;
+        if (_stripeSize > 0)
+        {
+            int needed = std::min(HASH_STRIPE_SIZE - _stripeSize, length);
+            std::memcpy(_stripe + _stripeSize, data, needed);
+            _stripeSize += needed;
+            data += needed;
+            length -= needed;
+            if (_stripeSize < HASH_STRIPE_SIZE)
+            {
+                return;
+            }
+            _consumeStripe(_stripe);
+            _stripeSize = 0;
+        }
+
+        for (; length >= HASH_STRIPE_SIZE; data += HASH_STRIPE_SIZE, length -= HASH_STRIPE_SIZE)
+        {
+            _consumeStripe(data);
+        }
+        std::memcpy(_stripe, data, length);
+        _stripeSize = length;
+    }
+
+    // Returns the hash of all the bytes given so far.
+    uint64_t finish() const
+    {
+        uint64_t hash = rotateLeft(_lanes[0], 1) + rotateLeft(_lanes[1], 7) + rotateLeft(_lanes[2], 12) +
+                        rotateLeft(_lanes[3], 18);
+        for (uint64_t lane : _lanes)
+        {
+            hash = (hash ^ hashRound(0, lane)) * HASH_PRIME_1 + HASH_PRIME_4;
+        }
+        hash += _totalSize;
+
+        for (int i = 0; i < _stripeSize; ++i)
+        {
+            hash ^= _stripe[i] * HASH_PRIME_5;
+            hash = rotateLeft(hash, 11) * HASH_PRIME_1;
+        }
+
+        hash ^= hash >> 33;
+        hash *= HASH_PRIME_2;
+        hash ^= hash >> 29;
+        hash *= HASH_PRIME_3;
+        return hash ^ (hash >> 32);
     }
-    delete[] _matrix;
+};
+
+// Returns the size of the tile buffer of an image with the given height and number of tiles per row.
+static size_t tileBufferSize(int height, int tilesPerRow)
+{
+    int tileRows = (height + Image::TILE_SIZE - 1) / Image::TILE_SIZE;
+    return (size_t) tileRows * tilesPerRow * TILE_PIXELS;
 }
 
-// copies the given image data to this object.
-void Image::_copyMatrix(int height, int width, const unsigned char *const *otherMatrix)
+// Returns the index of the lowest set bit in the given (non-zero) word.
+static int lowestSetBit(uint64_t word)
 {
-    _height = height;
-    _width = width;
-    _matrix = new unsigned char *[_height];
-    for (int i = 0; i < _height; ++i)
+#if defined(__GNUC__)
+    return __builtin_ctzll(word);
+#else
+    int index = 0;
+    while ((word & 1) == 0)
+    {
+        word >>= 1;
+        index++;
+    }
+    return index;
+#endif
+}
+
+// Kernels of the pixels of this image type.
+typedef PixelKernels<unsigned char> Kernels;
+
+// allocates the (uninitialized) pixel buffer, from the pool if the image has one.
+void Image::_allocatePixels()
+{
+    _pixels = _pool ? _pool->acquireBuffer() : new unsigned char[getBufferSize(_height, _width, _layout)];
+}
+
+// frees the memory taken by the image data (returns it to the pool if the image has one).
+void Image::_freePixels()
+{
+    if (_pixelsOwner)
+    {
+        _pixelsOwner.reset();
+    }
+    else if (_pool)
     {
-        _matrix[i] = new unsigned char[_width];
-        unsigned char *row = _matrix[i];
-        const unsigned char *otherRow = otherMatrix[i];
-        for (int j = 0; j < _width; ++j)
+        if (_pixels != nullptr)
         {
-            row[j] = otherRow[j];
+            _pool->releaseBuffer(_pixels);
         }
+        _pool.reset();
+    }
+    else
+    {
+        delete[] _pixels;
+    }
+    _pixels = nullptr;
+}
+
+// copies the pixels, layout and occupancy index of the given image to this object.
+void Image::_copyImage(const Image &otherImage)
+{
+    _height = otherImage._height;
+    _width = otherImage._width;
+    _layout = otherImage._layout;
+    _tilesPerRow = otherImage._tilesPerRow;
+    _pool = otherImage._pool;
+    _allocatePixels();
+    std::copy(otherImage._pixels, otherImage._pixels + getBufferSize(_height, _width, _layout), _pixels);
+
+    _hasOccupancyIndex = otherImage._hasOccupancyIndex;
+    _occupancyWordsPerRow = otherImage._occupancyWordsPerRow;
+    _occupancy = otherImage._occupancy;
+}
+
+// returns the address of the given pixel (location must be in image bounds).
+unsigned char *Image::_pixelAddress(int x, int y) const
+{
+    if (_layout == ImageLayout::ROW_MAJOR)
+    {
+        return _pixels + (size_t) y * _width + x;
+    }
+
+    size_t tile = (size_t) (y / TILE_SIZE) * _tilesPerRow + (x / TILE_SIZE);
+    return _pixels + tile * TILE_PIXELS + (y % TILE_SIZE) * TILE_SIZE + (x % TILE_SIZE);
+}
+
+// returns the number of pixels stored contiguously from the given pixel (location must be in image bounds).
+int Image::_contiguousLength(int x) const
+{
+    if (_layout == ImageLayout::ROW_MAJOR)
+    {
+        return _width - x;
     }
+    return std::min(TILE_SIZE - (x % TILE_SIZE), _width - x);
 }
 
 
@@ -38,18 +209,36 @@ void Image::_copyMatrix(int height, int width, const unsigned char *const *other
  * @param height The image height in pixels.
  * @param width The image width in pixels.
  * @param color The color to set all pixels to - defaults to 0 (black).
+ * @param layout The memory layout of the pixels - defaults to ROW_MAJOR.
  */
-Image::Image(int height, int width, unsigned char color) noexcept: _height(height), _width(width)
+Image::PixelImage(int height, int width, unsigned char color, ImageLayout layout) : Image(height, width, color, layout,
+                                                                                         nullptr)
+{}
+
+// creates a new image whose pixel buffer comes from the given pool (or is allocated directly if it's null).
+Image::PixelImage(int height, int width, unsigned char color, ImageLayout layout,
+                  std::shared_ptr<ImagePoolStorage> pool) : _height(height), _width(width), _layout(layout),
+                                                           _pixels(nullptr), _tilesPerRow(0), _pool(std::move(pool)),
+                                                           _hasOccupancyIndex(false), _occupancyWordsPerRow(0)
 {
-    _matrix = new unsigned char *[_height];
-    for (int i = 0; i < _height; ++i)
+    if (_layout == ImageLayout::TILED)
     {
-        _matrix[i] = new unsigned char[_width];
-        unsigned char *row = _matrix[i];
-        for (int j = 0; j < _width; ++j)
-        {
-            row[j] = color;
-        }
+        _tilesPerRow = (_width + TILE_SIZE - 1) / TILE_SIZE;
+    }
+    _allocatePixels();
+    std::fill(_pixels, _pixels + getBufferSize(_height, _width, _layout), color);
+}
+
+// creates a new image over the given borrowed pixel buffer, that the given owner keeps alive.
+Image::PixelImage(int height, int width, ImageLayout layout, unsigned char *pixels,
+                  std::shared_ptr<void> pixelsOwner) noexcept: _height(height), _width(width), _layout(layout),
+                                                               _pixels(pixels), _tilesPerRow(0),
+                                                               _pixelsOwner(std::move(pixelsOwner)),
+                                                               _hasOccupancyIndex(false), _occupancyWordsPerRow(0)
+{
+    if (_layout == ImageLayout::TILED)
+    {
+        _tilesPerRow = (_width + TILE_SIZE - 1) / TILE_SIZE;
     }
 }
 
@@ -60,17 +249,25 @@ Image::Image(int height, int width, unsigned char color) noexcept: _height(heigh
  * @param width The image width in pixels.
  * @param otherMatrix The matrix to copy the image data from.
  */
-Image::Image(int height, int width, const unsigned char **otherMatrix) noexcept
+Image::PixelImage(int height, int width, const unsigned char **otherMatrix) : _height(height), _width(width),
+                                                                             _layout(ImageLayout::ROW_MAJOR),
+                                                                             _pixels(nullptr), _tilesPerRow(0),
+                                                                             _hasOccupancyIndex(false),
+                                                                             _occupancyWordsPerRow(0)
 {
-    _copyMatrix(height, width, otherMatrix);
+    _allocatePixels();
+    for (int i = 0; i < _height; ++i)
+    {
+        std::copy(otherMatrix[i], otherMatrix[i] + _width, _pixels + (size_t) i * _width);
+    }
 }
 
 /**
  * Destructs the image.
  */
-Image::~Image() noexcept
+Image::~PixelImage() noexcept
 {
-    _freeMatrix();
+    _freePixels();
 }
 
 /**
@@ -87,7 +284,11 @@ void Image::drawPixel(const Vector2 &location, unsigned char color)
         throw ImageDimException();
     }
 
-    _matrix[location.y][location.x] = color;
+    *_pixelAddress(location.x, location.y) = color;
+    if (_hasOccupancyIndex)
+    {
+        _updateOccupancy(location.y, location.x, location.x, color);
+    }
 }
 
 /**
@@ -104,10 +305,70 @@ void Image::drawHorizontalLine(const Vector2 &start, int xFinish, unsigned char
         throw ImageDimException();
     }
 
-    unsigned char *row = _matrix[start.y];
-    for (int x = start.x; x <= xFinish; ++x)
+    for (int x = start.x; x <= xFinish;)
+    {
+        int length = std::min(_contiguousLength(x), xFinish - x + 1);
+        unsigned char *pixels = _pixelAddress(x, start.y);
+        Kernels::fill(pixels, length, color);
+        x += length;
+    }
+    if (_hasOccupancyIndex)
+    {
+        _updateOccupancy(start.y, start.x, xFinish, color);
+    }
+}
+
+/**
+ * Draws a horizontal line of the given color from the start location to the given x coordinate, blending it
+ * with the pixels it is drawn over in the given mode.
+ * Throws exception if the line is out of image bounds.
+ *
+ * @param start 2d vector representing start location.
+ * @param xFinish The last x coordinate of the line.
+ * @param color The color to draw (1 byte grayscale).
+ * @param mode How the color is combined with the pixels (OVERWRITE is the same as not blending).
+ * @param alpha The opacity of the color in ALPHA mode (0 keeps the pixels, 255 replaces them). Ignored otherwise.
+ */
+void Image::drawHorizontalLine(const Vector2 &start, int xFinish, unsigned char color, BlendMode mode,
+                               unsigned char alpha)
+{
+    if (mode == BlendMode::OVERWRITE)
+    {
+        drawHorizontalLine(start, xFinish, color);
+        return;
+    }
+    if (start.x < 0 || start.y < 0 || start.y >= _height || xFinish >= _width || start.x > xFinish)
+    {
+        throw ImageDimException();
+    }
+
+    for (int x = start.x; x <= xFinish;)
+    {
+        int length = std::min(_contiguousLength(x), xFinish - x + 1);
+        unsigned char *pixels = _pixelAddress(x, start.y);
+        switch (mode)
+        {
+            case BlendMode::MAX:
+                Kernels::blendMax(pixels, length, color);
+                break;
+            case BlendMode::ADD:
+                Kernels::blendAdd(pixels, length, color);
+                break;
+            default:
+                Kernels::blendAlpha(pixels, length, color, alpha);
+                break;
+        }
+        x += length;
+    }
+    if (_hasOccupancyIndex && mode == BlendMode::ALPHA)
     {
-        row[x] = color;
+        // Mixing can turn pixels to zero or away from it.
+        _refreshOccupancy(start.y, start.x, xFinish);
+    }
+    else if (_hasOccupancyIndex && color != 0)
+    {
+        // The larger or added pixels are all non-zero (a zero color changes nothing).
+        _updateOccupancy(start.y, start.x, xFinish, color);
     }
 }
 
@@ -150,7 +411,7 @@ unsigned char Image::getPixel(int x, int y) const
         throw ImageDimException();
     }
 
-    return _matrix[y][x];
+    return *_pixelAddress(x, y);
 }
 
 /**
@@ -166,6 +427,340 @@ unsigned char Image::getPixel(const Vector2 &location) const
     return getPixel(location.x, location.y);
 }
 
+/**
+ * Returns a pointer to the pixels of the given row, starting at the given location.
+ * Throws exception if location is out of image bounds.
+ *
+ * @param x The x coordinate of the first pixel.
+ * @param y The y coordinate of the row.
+ * @param length This will be set to the number of contiguous pixels available from the returned pointer.
+ * @return A pointer to the pixels of the given row, starting at the given location.
+ */
+const unsigned char *Image::getRowPixels(int x, int y, int &length) const
+{
+    if (x < 0 || x >= _width || y < 0 || y >= _height)
+    {
+        throw ImageDimException();
+    }
+
+    length = _contiguousLength(x);
+    return _pixelAddress(x, y);
+}
+
+// updates the occupancy bits of the chunks that were just drawn over in the given row.
+void Image::_updateOccupancy(int y, int xStart, int xFinish, unsigned char color)
+{
+    // Chunks are aligned to tiles, so each chunk is contiguous in both layouts.
+    uint64_t *words = &_occupancy[y * _occupancyWordsPerRow];
+    for (int chunk = xStart >> CHUNK_SHIFT; chunk <= (xFinish >> CHUNK_SHIFT); ++chunk)
+    {
+        uint64_t bit = (uint64_t) 1 << (chunk % BITS_PER_WORD);
+        uint64_t &word = words[chunk / BITS_PER_WORD];
+        int chunkStart = chunk << CHUNK_SHIFT;
+        int chunkLength = std::min(CHUNK_SIZE, _width - chunkStart);
+
+        if (color != 0)
+        {
+            word |= bit;
+        }
+        else if ((word & bit) != 0 && (xStart > chunkStart || xFinish < chunkStart + chunkLength - 1))
+        {
+            // Chunk was only partly erased, so check what is left in it.
+            if (Kernels::findNonBackground(_pixelAddress(chunkStart, y), chunkLength) == chunkLength)
+            {
+                word &= ~bit;
+            }
+        }
+        else
+        {
+            word &= ~bit;
+        }
+    }
+}
+
+// sets the occupancy bits of the chunks of the given row that have pixels in the given range from their pixels.
+void Image::_refreshOccupancy(int y, int xStart, int xFinish)
+{
+    uint64_t *words = &_occupancy[y * _occupancyWordsPerRow];
+    for (int chunk = xStart >> CHUNK_SHIFT; chunk <= (xFinish >> CHUNK_SHIFT); ++chunk)
+    {
+        uint64_t bit = (uint64_t) 1 << (chunk % BITS_PER_WORD);
+        uint64_t &word = words[chunk / BITS_PER_WORD];
+        int chunkStart = chunk << CHUNK_SHIFT;
+        int chunkLength = std::min(CHUNK_SIZE, _width - chunkStart);
+        if (Kernels::findNonBackground(_pixelAddress(chunkStart, y), chunkLength) == chunkLength)
+        {
+            word &= ~bit;
+        }
+        else
+        {
+            word |= bit;
+        }
+    }
+}
+
+/**
+ * Turns on or off the row-occupancy index of this image.
+ * While on, every write keeps a bit per 64 pixels chunk of each row that tells if the chunk has a non-zero
+ * pixel, so findNextNonBackgroundPixel can skip empty chunks and rows.
+ *
+ * @param enabled true to build and maintain the index, false to drop it.
+ */
+void Image::setOccupancyIndex(bool enabled)
+{
+    if (enabled == _hasOccupancyIndex)
+    {
+        return;
+    }
+
+    _hasOccupancyIndex = enabled;
+    if (!enabled)
+    {
+        _occupancyWordsPerRow = 0;
+        std::vector<uint64_t>().swap(_occupancy);
+        return;
+    }
+
+    int chunksPerRow = (_width + CHUNK_SIZE - 1) >> CHUNK_SHIFT;
+    _occupancyWordsPerRow = (chunksPerRow + BITS_PER_WORD - 1) / BITS_PER_WORD;
+    _occupancy.assign((size_t) _occupancyWordsPerRow * _height, 0);
+    for (int y = 0; y < _height; ++y)
+    {
+        uint64_t *words = &_occupancy[y * _occupancyWordsPerRow];
+        for (int chunk = 0; chunk < chunksPerRow; ++chunk)
+        {
+            int chunkStart = chunk << CHUNK_SHIFT;
+            int chunkLength = std::min(CHUNK_SIZE, _width - chunkStart);
+            if (Kernels::findNonBackground(_pixelAddress(chunkStart, y), chunkLength) != chunkLength)
+            {
+                words[chunk / BITS_PER_WORD] |= (uint64_t) 1 << (chunk % BITS_PER_WORD);
+            }
+        }
+    }
+}
+
+/**
+ * Returns true if this image maintains a row-occupancy index. Otherwise, returns false.
+ *
+ * @return true if this image maintains a row-occupancy index. Otherwise, returns false.
+ */
+bool Image::hasOccupancyIndex() const
+{
+    return _hasOccupancyIndex;
+}
+
+/**
+ * Returns the x coordinate of the first non-zero (non-background) pixel in row y at or after x,
+ * or the image width if there is no such pixel.
+ * Throws exception if location is out of image bounds (x may be equal to the width).
+ *
+ * @param x The x coordinate to start from.
+ * @param y The y coordinate of the row.
+ * @return The x coordinate of the first non-zero pixel in row y at or after x, or the image width.
+ */
+int Image::findNextNonBackgroundPixel(int x, int y) const
+{
+    if (x < 0 || x > _width || y < 0 || y >= _height)
+    {
+        throw ImageDimException();
+    }
+
+    if (!_hasOccupancyIndex)
+    {
+        while (x < _width)
+        {
+            int length = _contiguousLength(x);
+            int found = Kernels::findNonBackground(_pixelAddress(x, y), length);
+            if (found < length)
+            {
+                return x + found;
+            }
+            x += length;
+        }
+        return _width;
+    }
+
+    const uint64_t *words = &_occupancy[y * _occupancyWordsPerRow];
+    while (x < _width)
+    {
+        // Jump to the next occupied chunk.
+        int chunk = x >> CHUNK_SHIFT;
+        int wordIndex = chunk / BITS_PER_WORD;
+        uint64_t bits = words[wordIndex] & (~(uint64_t) 0 << (chunk % BITS_PER_WORD));
+        while (bits == 0)
+        {
+            if (++wordIndex >= _occupancyWordsPerRow)
+            {
+                return _width;
+            }
+            bits = words[wordIndex];
+        }
+        chunk = wordIndex * BITS_PER_WORD + lowestSetBit(bits);
+
+        int chunkStart = chunk << CHUNK_SHIFT;
+        int chunkEnd = std::min(_width, chunkStart + CHUNK_SIZE);
+        x = std::max(x, chunkStart);
+        int found = Kernels::findNonBackground(_pixelAddress(x, y), chunkEnd - x);
+        if (found < chunkEnd - x)
+        {
+            return x + found;
+        }
+        x = chunkEnd;
+    }
+    return _width;
+}
+
+/**
+ * Returns a 64 bit hash of the image's size and pixels.
+ * Images with the same pixels have the same hash regardless of their layout.
+ *
+ * @return A 64 bit hash of the image's size and pixels.
+ */
+uint64_t Image::getHash() const
+{
+    PixelHasher hasher(((uint64_t) _height << 32) | (uint32_t) _width);
+    for (int y = 0; y < _height; ++y)
+    {
+        for (int x = 0; x < _width;)
+        {
+            int length = _contiguousLength(x);
+            hasher.update(_pixelAddress(x, y), length);
+            x += length;
+        }
+    }
+    return hasher.finish();
+}
+
+/**
+ * Returns true if the given image has the same size and pixels as this one (regardless of layout).
+ * Stops at the first difference.
+ *
+ * @param otherImage The image to compare with.
+ * @return true if the given image has the same size and pixels as this one. Otherwise, returns false.
+ */
+bool Image::operator==(const Image &otherImage) const
+{
+    if (_width != otherImage._width || _height != otherImage._height)
+    {
+        return false;
+    }
+
+    for (int y = 0; y < _height; ++y)
+    {
+        for (int x = 0; x < _width;)
+        {
+            int length = std::min(_contiguousLength(x), otherImage._contiguousLength(x));
+            if (!Kernels::equal(_pixelAddress(x, y), otherImage._pixelAddress(x, y), length))
+            {
+                return false;
+            }
+            x += length;
+        }
+    }
+    return true;
+}
+
+/**
+ * Returns true if the given image differs from this one in size or pixels. Otherwise, returns false.
+ *
+ * @param otherImage The image to compare with.
+ * @return true if the given image differs from this one in size or pixels. Otherwise, returns false.
+ */
+bool Image::operator!=(const Image &otherImage) const
+{
+    return !(*this == otherImage);
+}
+
+/**
+ * Compares this image with the given image of the same size, pixel by pixel.
+ * Throws exception if the images are not of the same size.
+ *
+ * @param otherImage The image to compare with.
+ * @return The number of differing pixels, their bounding box and the tiles they are in.
+ */
+ImageDiff Image::compare(const Image &otherImage) const
+{
+    if (_width != otherImage._width || _height != otherImage._height)
+    {
+        throw ImageDimException();
+    }
+
+    ImageDiff diff;
+    diff.differentPixels = 0;
+    diff.tilesPerRow = (_width + TILE_SIZE - 1) / TILE_SIZE;
+    diff.tileRows = (_height + TILE_SIZE - 1) / TILE_SIZE;
+    diff.differentTiles.assign((size_t) diff.tilesPerRow * diff.tileRows, false);
+    int minX = _width, minY = _height, maxX = -1, maxY = -1;
+
+    for (int y = 0; y < _height; ++y)
+    {
+        // Tile-aligned chunks are contiguous in both layouts.
+        for (int chunkStart = 0; chunkStart < _width; chunkStart += TILE_SIZE)
+        {
+            int length = std::min((int) TILE_SIZE, _width - chunkStart);
+            const unsigned char *pixels = _pixelAddress(chunkStart, y);
+            const unsigned char *otherPixels = otherImage._pixelAddress(chunkStart, y);
+            if (Kernels::equal(pixels, otherPixels, length))
+            {
+                continue;
+            }
+
+            diff.differentPixels += Kernels::countDifferent(pixels, otherPixels, length);
+            diff.differentTiles[(y / TILE_SIZE) * diff.tilesPerRow + chunkStart / TILE_SIZE] = true;
+
+            int first = 0;
+            while (pixels[first] == otherPixels[first])
+            {
+                first++;
+            }
+            int last = length - 1;
+            while (pixels[last] == otherPixels[last])
+            {
+                last--;
+            }
+            minX = std::min(minX, chunkStart + first);
+            maxX = std::max(maxX, chunkStart + last);
+            minY = std::min(minY, y);
+            maxY = y;
+        }
+    }
+
+    diff.topLeft = Vector2(minX, minY);
+    diff.bottomRight = Vector2(maxX, maxY);
+    return diff;
+}
+
+/**
+ * Returns a new image (of the same layout as this one) that is a copy of the given region of this image.
+ * Throws exception if the region is not inside the image.
+ *
+ * @param topLeft The top-left corner of the region.
+ * @param height The region height in pixels.
+ * @param width The region width in pixels.
+ * @return A new image that is a copy of the region's pixels.
+ */
+Image Image::copyRegion(const Vector2 &topLeft, int height, int width) const
+{
+    if (topLeft.x < 0 || topLeft.y < 0 || height < 0 || width < 0 || topLeft.x + width > _width ||
+        topLeft.y + height > _height)
+    {
+        throw ImageDimException();
+    }
+
+    Image copy(height, width, 0, _layout);
+    for (int y = 0; y < height; ++y)
+    {
+        // Copy the row one contiguous segment of both images at a time.
+        for (int x = 0; x < width;)
+        {
+            int length = std::min(std::min(copy._contiguousLength(x), _contiguousLength(topLeft.x + x)), width - x);
+            std::memcpy(copy._pixelAddress(x, y), _pixelAddress(topLeft.x + x, topLeft.y + y), length);
+            x += length;
+        }
+    }
+    return copy;
+}
+
 /**
  * Prints the image to the output stream (as integer matrix).
  *
@@ -178,12 +773,11 @@ std::ostream &operator<<(std::ostream &os, const Image &img) noexcept
     int lastColumn = img._width - 1;
     for (int i = 0; i < img._height; i++)
     {
-        unsigned char *row = img._matrix[i];
         for (int j = 0; j < lastColumn; j++)
         {
-            os << std::setfill('0') << std::setw(3) << (int) row[j] << " ";
+            os << std::setfill('0') << std::setw(3) << (int) *img._pixelAddress(j, i) << " ";
         }
-        os << std::setfill('0') << std::setw(3) << (int) row[lastColumn] << std::endl;
+        os << std::setfill('0') << std::setw(3) << (int) *img._pixelAddress(lastColumn, i) << std::endl;
     }
     return os;
 }
@@ -193,9 +787,9 @@ std::ostream &operator<<(std::ostream &os, const Image &img) noexcept
  *
  * @param otherImage The image to copy.
  */
-Image::Image(const Image &otherImage)
+Image::PixelImage(const Image &otherImage)
 {
-    _copyMatrix(otherImage._height, otherImage._width, otherImage._matrix);
+    _copyImage(otherImage);
 }
 
 /**
@@ -205,11 +799,72 @@ Image::Image(const Image &otherImage)
  * @return This image after the copy procedure.
  */
 Image &Image::operator=(const Image &otherImage)
+{
+    if (this == &otherImage)
+    {
+        return *this;
+    }
+    if (_pixels == nullptr || _height != otherImage._height || _width != otherImage._width ||
+        _layout != otherImage._layout)
+    {
+        _freePixels();
+        _copyImage(otherImage);
+        return *this;
+    }
+
+    std::copy(otherImage._pixels, otherImage._pixels + getBufferSize(_height, _width, _layout), _pixels);
+    _hasOccupancyIndex = otherImage._hasOccupancyIndex;
+    _occupancyWordsPerRow = otherImage._occupancyWordsPerRow;
+    _occupancy = otherImage._occupancy;
+    return *this;
+}
+
+/**
+ * Move ctor for image, takes over the pixels of the given image (which is left empty).
+ *
+ * @param otherImage The image to move.
+ */
+Image::PixelImage(Image &&otherImage) noexcept: _height(otherImage._height), _width(otherImage._width),
+                                                _layout(otherImage._layout), _pixels(otherImage._pixels),
+                                                _tilesPerRow(otherImage._tilesPerRow),
+                                                _pool(std::move(otherImage._pool)),
+                                                _pixelsOwner(std::move(otherImage._pixelsOwner)),
+                                                _hasOccupancyIndex(otherImage._hasOccupancyIndex),
+                                                _occupancyWordsPerRow(otherImage._occupancyWordsPerRow),
+                                                _occupancy(std::move(otherImage._occupancy))
+{
+    otherImage._height = 0;
+    otherImage._width = 0;
+    otherImage._pixels = nullptr;
+    otherImage._hasOccupancyIndex = false;
+}
+
+/**
+ * Assign this image to take over the pixels of the given image (which is left empty).
+ *
+ * @param otherImage The image to move.
+ * @return This image after the move.
+ */
+Image &Image::operator=(Image &&otherImage) noexcept
 {
     if (this != &otherImage)
     {
-        _freeMatrix();
-        _copyMatrix(otherImage._height, otherImage._width, otherImage._matrix);
+        _freePixels();
+        _height = otherImage._height;
+        _width = otherImage._width;
+        _layout = otherImage._layout;
+        _pixels = otherImage._pixels;
+        _tilesPerRow = otherImage._tilesPerRow;
+        _pool = std::move(otherImage._pool);
+        _pixelsOwner = std::move(otherImage._pixelsOwner);
+        _hasOccupancyIndex = otherImage._hasOccupancyIndex;
+        _occupancyWordsPerRow = otherImage._occupancyWordsPerRow;
+        _occupancy = std::move(otherImage._occupancy);
+
+        otherImage._height = 0;
+        otherImage._width = 0;
+        otherImage._pixels = nullptr;
+        otherImage._hasOccupancyIndex = false;
     }
     return *this;
 }
@@ -233,3 +888,49 @@ int Image::getHeight() const
 {
     return _height;
 }
+
+
+/**
+ * Returns the size in bytes of the pixel buffer of an image with the given parameters.
+ *
+ * @param height The image height in pixels.
+ * @param width The image width in pixels.
+ * @param layout The memory layout of the pixels.
+ * @return The size in bytes of the pixel buffer of an image with the given parameters.
+ */
+size_t Image::getBufferSize(int height, int width, ImageLayout layout)
+{
+    if (layout == ImageLayout::TILED)
+    {
+        return tileBufferSize(height, (width + TILE_SIZE - 1) / TILE_SIZE);
+    }
+    return (size_t) height * width;
+}
+
+/**
+ * Returns an image over the given borrowed pixel buffer (of getBufferSize bytes, in the given layout, e.g. shared
+ * memory or a received message) instead of a buffer of its own. The image neither copies nor frees the pixels, the
+ * given owner keeps them alive for as long as the image (or one it was moved to) is.
+ *
+ * @param height The image height in pixels.
+ * @param width The image width in pixels.
+ * @param layout The memory layout of the pixels.
+ * @param pixels The pixel buffer.
+ * @param pixelsOwner Keeps the pixels alive (one with a no-op deleter if the caller keeps them alive itself).
+ * @return An image over the given pixel buffer.
+ */
+Image Image::adoptBuffer(int height, int width, ImageLayout layout, unsigned char *pixels,
+                         std::shared_ptr<void> pixelsOwner) noexcept
+{
+    return Image(height, width, layout, pixels, std::move(pixelsOwner));
+}
+
+/**
+ * Returns the memory layout of the image's pixels.
+ *
+ * @return The memory layout of the image's pixels.
+ */
+ImageLayout Image::getLayout() const
+{
+    return _layout;
+}
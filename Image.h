@@ -6,7 +6,11 @@
 #define POLYTEST_IMAGE_H
 
 
+#include <cstdint>
+#include <memory>
 #include <ostream>
+#include <vector>
+#include "PixelKernels.h"
 
 
 #define ERROR_IMAGE_DIM "ERROR: Location vectors given to image don't fit the image requirements."
@@ -43,28 +47,139 @@ struct Vector2
 };
 
 /**
- * Class representing a 2d grayscale image.
+ * Result of comparing two images of the same size.
  */
-class Image
+struct ImageDiff
+{
+    long differentPixels; // Number of pixels that differ.
+    Vector2 topLeft, bottomRight; // Bounding box of the differing pixels (only meaningful if there are any).
+    int tilesPerRow, tileRows; // Size of the tile grid (tiles are Image::TILE_SIZE pixels square).
+    std::vector<bool> differentTiles; // Row-major tile grid, true for tiles that have a differing pixel.
+
+    /**
+     * Returns true if the compared images are identical. Otherwise, returns false.
+     *
+     * @return true if the compared images are identical. Otherwise, returns false.
+     */
+    bool isEqual() const
+    {
+        return differentPixels == 0;
+    }
+
+    /**
+     * Returns true if the given tile has a differing pixel. Otherwise, returns false.
+     *
+     * @param tileX The column of the tile.
+     * @param tileY The row of the tile.
+     * @return true if the given tile has a differing pixel. Otherwise, returns false.
+     */
+    bool isTileDifferent(int tileX, int tileY) const
+    {
+        return differentTiles[tileY * tilesPerRow + tileX];
+    }
+};
+
+/**
+ * Memory layout of the pixels of an image.
+ */
+enum class ImageLayout
+{
+    ROW_MAJOR, // Each row is stored contiguously.
+    TILED // Square tiles of TILE_SIZE x TILE_SIZE pixels, each stored contiguously row by row.
+};
+
+/**
+ * How drawn pixels are combined with the pixels they are drawn over.
+ */
+enum class BlendMode
+{
+    OVERWRITE, // The drawn color replaces the pixel.
+    MAX, // The pixel becomes the larger of the two.
+    ADD, // The drawn color is added to the pixel, saturating at 255.
+    ALPHA // The drawn color is mixed over the pixel by an opacity (0 to 255).
+};
+
+class ImagePool;
+
+class ImagePoolStorage;
+
+/**
+ * 2d image of the given pixel type (see PixelImage.h).
+ * The unsigned char specialization is Image.
+ */
+template<class Pixel>
+class PixelImage;
+
+/**
+ * 2d 8-bit grayscale image.
+ */
+typedef PixelImage<unsigned char> Image;
+
+/**
+ * Class representing a 2d 8-bit grayscale image, with a choice of memory layouts, pooled or borrowed pixel buffers
+ * and an optional occupancy index.
+ */
+template<>
+class PixelImage<unsigned char>
 {
     int _height, _width;
-    unsigned char **_matrix;
+    ImageLayout _layout;
+    unsigned char *_pixels; // Single pixel buffer, row by row (ROW_MAJOR) or tile by tile (TILED).
+    int _tilesPerRow;
+    std::shared_ptr<ImagePoolStorage> _pool; // Pool the pixel buffer came from, null if it was allocated directly.
+    std::shared_ptr<void> _pixelsOwner; // Keeps borrowed pixels (e.g. shared memory) alive, null if they are ours.
+
+    // Optional bitmap with one bit per 64 pixels chunk of each row, set if the chunk has a non-zero pixel.
+    bool _hasOccupancyIndex;
+    int _occupancyWordsPerRow;
+    std::vector<uint64_t> _occupancy;
+
+    // allocates the (uninitialized) pixel buffer, from the pool if the image has one.
+    void _allocatePixels();
+
+    // frees the memory taken by the image data (returns it to the pool if the image has one).
+    void _freePixels();
+
+    // copies the pixels, layout and occupancy index of the given image to this object.
+    void _copyImage(const Image &otherImage);
+
+    // returns the address of the given pixel (location must be in image bounds).
+    unsigned char *_pixelAddress(int x, int y) const;
+
+    // returns the number of pixels stored contiguously from the given pixel (location must be in image bounds).
+    int _contiguousLength(int x) const;
+
+    // updates the occupancy bits of the chunks that were just drawn over in the given row.
+    void _updateOccupancy(int y, int xStart, int xFinish, unsigned char color);
+
+    // sets the occupancy bits of the chunks of the given row that have pixels in the given range from their pixels.
+    void _refreshOccupancy(int y, int xStart, int xFinish);
+
+    // creates a new image whose pixel buffer comes from the given pool (or is allocated directly if it's null).
+    PixelImage(int height, int width, unsigned char color, ImageLayout layout,
+               std::shared_ptr<ImagePoolStorage> pool);
 
-    // frees the memory taken by the image data.
-    void _freeMatrix();
+    // creates a new image over the given borrowed pixel buffer, that the given owner keeps alive.
+    PixelImage(int height, int width, ImageLayout layout, unsigned char *pixels,
+               std::shared_ptr<void> pixelsOwner) noexcept;
 
-    // copies the given image data to this object.
-    void _copyMatrix(int height, int width, const unsigned char *const *otherMatrix);
+    friend class ImagePool;
 
 public:
+    /**
+     * Width and height in pixels of a tile in the TILED layout.
+     */
+    static const int TILE_SIZE = 64;
+
     /**
      * Creates a new grayscale image of the given parameters.
      *
      * @param height The image height in pixels.
      * @param width The image width in pixels.
      * @param color The color to set all pixels to - defaults to 0 (black).
+     * @param layout The memory layout of the pixels - defaults to ROW_MAJOR.
      */
-    Image(int height, int width, unsigned char color = 0) noexcept;
+    PixelImage(int height, int width, unsigned char color = 0, ImageLayout layout = ImageLayout::ROW_MAJOR);
 
     /**
      * Creates a new grayscale image this is a copy of the given matrix..
@@ -73,27 +188,44 @@ public:
      * @param width The image width in pixels.
      * @param otherMatrix The matrix to copy the image data from.
      */
-    Image(int height, int width, const unsigned char **otherMatrix) noexcept;
+    PixelImage(int height, int width, const unsigned char **otherMatrix);
 
     /**
      * Copy ctor for image.
+     * A copy of a pooled image takes its pixel buffer from the same pool.
      *
      * @param otherImage The image to copy.
      */
-    Image(const Image &otherImage);
+    PixelImage(const Image &otherImage);
+
+    /**
+     * Move ctor for image, takes over the pixels of the given image (which is left empty).
+     *
+     * @param otherImage The image to move.
+     */
+    PixelImage(Image &&otherImage) noexcept;
 
     /**
      * Assign this image to be a copy of the given one.
+     * Reuses the pixel buffer of this image if both images have the same size and layout.
      *
      * @param otherImage  The image to copy.
      * @return This image after the copy procedure.
      */
     Image &operator=(const Image &otherImage);
 
+    /**
+     * Assign this image to take over the pixels of the given image (which is left empty).
+     *
+     * @param otherImage The image to move.
+     * @return This image after the move.
+     */
+    Image &operator=(Image &&otherImage) noexcept;
+
     /**
      * Destructs the image.
      */
-    ~Image() noexcept;
+    ~PixelImage() noexcept;
 
     /**
      * Returns the image's width.
@@ -109,6 +241,38 @@ public:
      */
     int getHeight() const;
 
+    /**
+     * Returns the memory layout of the image's pixels.
+     *
+     * @return The memory layout of the image's pixels.
+     */
+    ImageLayout getLayout() const;
+
+    /**
+     * Returns the size in bytes of the pixel buffer of an image with the given parameters.
+     *
+     * @param height The image height in pixels.
+     * @param width The image width in pixels.
+     * @param layout The memory layout of the pixels.
+     * @return The size in bytes of the pixel buffer of an image with the given parameters.
+     */
+    static size_t getBufferSize(int height, int width, ImageLayout layout);
+
+    /**
+     * Returns an image over the given borrowed pixel buffer (of getBufferSize bytes, in the given layout, e.g. shared
+     * memory or a received message) instead of a buffer of its own. The image neither copies nor frees the pixels, the
+     * given owner keeps them alive for as long as the image (or one it was moved to) is.
+     *
+     * @param height The image height in pixels.
+     * @param width The image width in pixels.
+     * @param layout The memory layout of the pixels.
+     * @param pixels The pixel buffer.
+     * @param pixelsOwner Keeps the pixels alive (one with a no-op deleter if the caller keeps them alive itself).
+     * @return An image over the given pixel buffer.
+     */
+    static Image adoptBuffer(int height, int width, ImageLayout layout, unsigned char *pixels,
+                             std::shared_ptr<void> pixelsOwner) noexcept;
+
     /**
      * Draws a pixel of the given color at the given location.
      * Throws exception if location is out of image bounds.
@@ -127,6 +291,20 @@ public:
      */
     void drawHorizontalLine(const Vector2 &start, int xFinish, unsigned char color);
 
+    /**
+     * Draws a horizontal line of the given color from the start location to the given x coordinate, blending it
+     * with the pixels it is drawn over in the given mode.
+     * Throws exception if the line is out of image bounds.
+     *
+     * @param start 2d vector representing start location.
+     * @param xFinish The last x coordinate of the line.
+     * @param color The color to draw (1 byte grayscale).
+     * @param mode How the color is combined with the pixels (OVERWRITE is the same as not blending).
+     * @param alpha The opacity of the color in ALPHA mode (0 keeps the pixels, 255 replaces them). Ignored otherwise.
+     */
+    void drawHorizontalLine(const Vector2 &start, int xFinish, unsigned char color, BlendMode mode,
+                            unsigned char alpha = 255);
+
     /**
      * Return true if the given pixel is in the image bounds. Otherwise, returns false.
      *
@@ -165,6 +343,90 @@ public:
      */
     unsigned char getPixel(const Vector2 &location) const;
 
+    /**
+     * Returns a pointer to the pixels of the given row, starting at the given location.
+     * In the ROW_MAJOR layout the rest of the row is available, in the TILED layout only the rest of the tile row.
+     * Throws exception if location is out of image bounds.
+     *
+     * @param x The x coordinate of the first pixel.
+     * @param y The y coordinate of the row.
+     * @param length This will be set to the number of contiguous pixels available from the returned pointer.
+     * @return A pointer to the pixels of the given row, starting at the given location.
+     */
+    const unsigned char *getRowPixels(int x, int y, int &length) const;
+
+    /**
+     * Turns on or off the row-occupancy index of this image.
+     * While on, every write keeps a bit per 64 pixels chunk of each row that tells if the chunk has a non-zero
+     * pixel, so findNextNonBackgroundPixel can skip empty chunks and rows.
+     *
+     * @param enabled true to build and maintain the index, false to drop it.
+     */
+    void setOccupancyIndex(bool enabled);
+
+    /**
+     * Returns true if this image maintains a row-occupancy index. Otherwise, returns false.
+     *
+     * @return true if this image maintains a row-occupancy index. Otherwise, returns false.
+     */
+    bool hasOccupancyIndex() const;
+
+    /**
+     * Returns the x coordinate of the first non-zero (non-background) pixel in row y at or after x,
+     * or the image width if there is no such pixel.
+     * Throws exception if location is out of image bounds (x may be equal to the width).
+     *
+     * @param x The x coordinate to start from.
+     * @param y The y coordinate of the row.
+     * @return The x coordinate of the first non-zero pixel in row y at or after x, or the image width.
+     */
+    int findNextNonBackgroundPixel(int x, int y) const;
+
+    /**
+     * Returns a 64 bit hash of the image's size and pixels.
+     * Images with the same pixels have the same hash regardless of their layout.
+     *
+     * @return A 64 bit hash of the image's size and pixels.
+     */
+    uint64_t getHash() const;
+
+    /**
+     * Returns true if the given image has the same size and pixels as this one (regardless of layout).
+     * Stops at the first difference.
+     *
+     * @param otherImage The image to compare with.
+     * @return true if the given image has the same size and pixels as this one. Otherwise, returns false.
+     */
+    bool operator==(const Image &otherImage) const;
+
+    /**
+     * Returns true if the given image differs from this one in size or pixels. Otherwise, returns false.
+     *
+     * @param otherImage The image to compare with.
+     * @return true if the given image differs from this one in size or pixels. Otherwise, returns false.
+     */
+    bool operator!=(const Image &otherImage) const;
+
+    /**
+     * Compares this image with the given image of the same size, pixel by pixel.
+     * Throws exception if the images are not of the same size.
+     *
+     * @param otherImage The image to compare with.
+     * @return The number of differing pixels, their bounding box and the tiles they are in.
+     */
+    ImageDiff compare(const Image &otherImage) const;
+
+    /**
+     * Returns a new image (of the same layout as this one) that is a copy of the given region of this image.
+     * Throws exception if the region is not inside the image.
+     *
+     * @param topLeft The top-left corner of the region.
+     * @param height The region height in pixels.
+     * @param width The region width in pixels.
+     * @return A new image that is a copy of the region's pixels.
+     */
+    Image copyRegion(const Vector2 &topLeft, int height, int width) const;
+
     /**
      * Prints the image to the output stream (as integer matrix).
      *
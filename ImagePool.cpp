@@ -0,0 +1,370 @@
+#include <algorithm>
+#include <new>
+#include <sys/mman.h>
+#include "ImagePool.h"
+
+
+static const size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+static const size_t THREAD_CACHE_CAPACITY = 8;
+
+class ThreadBufferCache;
+
+// The caches of all threads, so a closed pool can take its buffers back from them.
+static std::mutex cachesMutex;
+static std::vector<ThreadBufferCache *> caches;
+
+/**
+ * Buffers that were released on the current thread, kept for reuse by it (its lock is only contended while a pool
+ * is closing). When the thread exits the buffers go back to the free lists of their pools, and when a pool is closed
+ * its buffers are freed.
+ */
+class ThreadBufferCache
+{
+    // A cached buffer and the pool it belongs to.
+    struct Entry
+    {
+        std::shared_ptr<ImagePoolStorage> storage;
+        unsigned char *buffer;
+    };
+
+    std::mutex _mutex;
+    std::vector<Entry> _entries;
+
+    // removes the entry at the given index (order isn't kept).
+    void _remove(size_t index)
+    {
+        _entries[index] = std::move(_entries.back());
+        _entries.pop_back();
+    }
+
+public:
+    ThreadBufferCache()
+    {
+        _entries.reserve(THREAD_CACHE_CAPACITY);
+        std::lock_guard<std::mutex> lock(cachesMutex);
+        caches.push_back(this);
+    }
+
+    ~ThreadBufferCache()
+    {
+        {
+            std::lock_guard<std::mutex> lock(cachesMutex);
+            caches.erase(std::find(caches.begin(), caches.end(), this));
+        }
+        for (Entry &entry : _entries)
+        {
+            entry.storage->_pushFreeBuffer(entry.buffer);
+        }
+    }
+
+    // Returns a cached buffer of the given pool (or null if there is none).
+    unsigned char *take(const ImagePoolStorage *storage)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        for (size_t i = 0; i < _entries.size(); ++i)
+        {
+            if (_entries[i].storage.get() == storage)
+            {
+                unsigned char *buffer = _entries[i].buffer;
+                _remove(i);
+                return buffer;
+            }
+        }
+        return nullptr;
+    }
+
+    // Caches the given buffer of the given pool. Returns false if the cache is full or the pool was closed.
+    bool put(std::shared_ptr<ImagePoolStorage> storage, unsigned char *buffer)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        // Checked under the lock, so a pool that closes after it flushes this buffer with the rest.
+        if (_entries.size() >= THREAD_CACHE_CAPACITY || storage->_closed)
+        {
+            return false;
+        }
+        _entries.push_back(Entry{std::move(storage), buffer});
+        return true;
+    }
+
+    // Frees the cached buffers of the given (closed) pool, moving its entries to removed (so they let go of the pool
+    // after the lock is released).
+    void flush(ImagePoolStorage *storage, std::vector<Entry> &removed)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        for (size_t i = 0; i < _entries.size();)
+        {
+            if (_entries[i].storage.get() == storage)
+            {
+                storage->_deallocate(_entries[i].buffer);
+                removed.push_back(std::move(_entries[i]));
+                _remove(i);
+                continue;
+            }
+            ++i;
+        }
+    }
+
+    // Frees the cached buffers of the given (closed) pool in the caches of all threads.
+    static void flushAll(ImagePoolStorage *storage)
+    {
+        std::vector<Entry> removed;
+        std::lock_guard<std::mutex> lock(cachesMutex);
+        for (ThreadBufferCache *cache : caches)
+        {
+            cache->flush(storage, removed);
+        }
+    }
+};
+
+static thread_local ThreadBufferCache threadCache;
+
+
+// allocates a new pixel buffer.
+unsigned char *ImagePoolStorage::_allocate()
+{
+    _allocatedCount++;
+#ifdef MADV_HUGEPAGE
+    if (_useHugePages)
+    {
+        // Map an extra huge page so the buffer can start on a huge page boundary, then unmap the unused ends.
+        size_t mappedSize = _allocationSize + HUGE_PAGE_SIZE;
+        void *mapping = mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (mapping == MAP_FAILED)
+        {
+            _allocatedCount--;
+            throw std::bad_alloc();
+        }
+        uintptr_t start = (uintptr_t) mapping;
+        uintptr_t buffer = (start + HUGE_PAGE_SIZE - 1) & ~(uintptr_t) (HUGE_PAGE_SIZE - 1);
+        uintptr_t end = buffer + _allocationSize;
+        if (buffer > start)
+        {
+            munmap(mapping, buffer - start);
+        }
+        if (start + mappedSize > end)
+        {
+            munmap((void *) end, start + mappedSize - end);
+        }
+        madvise((void *) buffer, _allocationSize, MADV_HUGEPAGE);
+        return (unsigned char *) buffer;
+    }
+#endif
+    return new unsigned char[_bufferSize];
+}
+
+// frees the given pixel buffer.
+void ImagePoolStorage::_deallocate(unsigned char *buffer)
+{
+    if (_useHugePages)
+    {
+        munmap(buffer, _allocationSize);
+        return;
+    }
+    delete[] buffer;
+}
+
+// adds the given buffer to the free list (or frees it if the pool was destroyed).
+void ImagePoolStorage::_pushFreeBuffer(unsigned char *buffer)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_closed)
+    {
+        _deallocate(buffer);
+        return;
+    }
+    _freeBuffers.push_back(buffer);
+}
+
+/**
+ * Creates an empty storage for buffers of the given size.
+ *
+ * @param bufferSize The size of a pixel buffer in bytes.
+ * @param useHugePages true to back the buffers with huge pages (if they are large enough and it's supported).
+ */
+ImagePoolStorage::ImagePoolStorage(size_t bufferSize, bool useHugePages) : _bufferSize(bufferSize),
+                                                                           _allocationSize(bufferSize),
+                                                                           _useHugePages(false), _closed(false),
+                                                                           _allocatedCount(0)
+{
+#ifdef MADV_HUGEPAGE
+    if (useHugePages && bufferSize >= HUGE_PAGE_SIZE)
+    {
+        _useHugePages = true;
+        _allocationSize = (bufferSize + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+    }
+#else
+    (void) useHugePages;
+#endif
+}
+
+/**
+ * Frees all buffers in the free list.
+ */
+ImagePoolStorage::~ImagePoolStorage()
+{
+    close();
+}
+
+/**
+ * Returns a recycled pixel buffer (from this thread's cache first) or a newly allocated one.
+ *
+ * @return A pixel buffer (content unspecified).
+ */
+unsigned char *ImagePoolStorage::acquireBuffer()
+{
+    unsigned char *buffer = threadCache.take(this);
+    if (buffer != nullptr)
+    {
+        return buffer;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (!_freeBuffers.empty())
+        {
+            buffer = _freeBuffers.back();
+            _freeBuffers.pop_back();
+            return buffer;
+        }
+    }
+    return _allocate();
+}
+
+/**
+ * Takes back a buffer that was returned by acquireBuffer, keeping it for reuse (unless the pool was destroyed).
+ *
+ * @param buffer The buffer to take back.
+ */
+void ImagePoolStorage::releaseBuffer(unsigned char *buffer)
+{
+    if (_closed)
+    {
+        _deallocate(buffer);
+        return;
+    }
+    if (!threadCache.put(shared_from_this(), buffer))
+    {
+        _pushFreeBuffer(buffer);
+    }
+}
+
+/**
+ * Frees all buffers in the free list and in the caches of all threads, and stops keeping released buffers.
+ */
+void ImagePoolStorage::close()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _closed = true;
+        for (unsigned char *buffer : _freeBuffers)
+        {
+            _deallocate(buffer);
+        }
+        _freeBuffers.clear();
+    }
+    ThreadBufferCache::flushAll(this);
+}
+
+/**
+ * Returns true if the buffers are backed by huge pages. Otherwise, returns false.
+ *
+ * @return true if the buffers are backed by huge pages. Otherwise, returns false.
+ */
+bool ImagePoolStorage::usesHugePages() const
+{
+    return _useHugePages;
+}
+
+/**
+ * Returns the number of buffers that were allocated so far.
+ *
+ * @return The number of buffers that were allocated so far.
+ */
+size_t ImagePoolStorage::getAllocatedCount() const
+{
+    return _allocatedCount;
+}
+
+
+/**
+ * Creates an empty pool of images of the given parameters.
+ *
+ * @param height The image height in pixels.
+ * @param width The image width in pixels.
+ * @param layout The memory layout of the pixels - defaults to ROW_MAJOR.
+ * @param useHugePages true to back large frames (2MB and up) with huge pages where supported - defaults to false.
+ */
+ImagePool::ImagePool(int height, int width, ImageLayout layout, bool useHugePages) : _height(height), _width(width),
+                                                                                     _layout(layout)
+{
+    _storage = std::make_shared<ImagePoolStorage>(Image::getBufferSize(height, width, layout), useHugePages);
+}
+
+/**
+ * Destructs the pool. Images that are still out stay valid and free their buffers when they are destructed.
+ */
+ImagePool::~ImagePool()
+{
+    _storage->close();
+}
+
+/**
+ * Returns an image of the pool's size and layout with all pixels set to the given color.
+ *
+ * @param color The color to set all pixels to - defaults to 0 (black).
+ * @return An image of the pool's size and layout with all pixels set to the given color.
+ */
+Image ImagePool::acquire(unsigned char color) const
+{
+    return Image(_height, _width, color, _layout, _storage);
+}
+
+/**
+ * Returns the height of the pool's images.
+ *
+ * @return The height of the pool's images.
+ */
+int ImagePool::getHeight() const
+{
+    return _height;
+}
+
+/**
+ * Returns the width of the pool's images.
+ *
+ * @return The width of the pool's images.
+ */
+int ImagePool::getWidth() const
+{
+    return _width;
+}
+
+/**
+ * Returns the memory layout of the pool's images.
+ *
+ * @return The memory layout of the pool's images.
+ */
+ImageLayout ImagePool::getLayout() const
+{
+    return _layout;
+}
+
+/**
+ * Returns true if the pixel buffers are backed by huge pages. Otherwise, returns false.
+ *
+ * @return true if the pixel buffers are backed by huge pages. Otherwise, returns false.
+ */
+bool ImagePool::usesHugePages() const
+{
+    return _storage->usesHugePages();
+}
+
+/**
+ * Returns the number of pixel buffers that were allocated so far (the rest of the acquires were recycled).
+ *
+ * @return The number of pixel buffers that were allocated so far.
+ */
+size_t ImagePool::getAllocatedCount() const
+{
+    return _storage->getAllocatedCount();
+}
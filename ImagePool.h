@@ -0,0 +1,171 @@
+//
+// Created by jacko on 30/10/2020.
+//
+
+#ifndef POLYTEST_IMAGEPOOL_H
+#define POLYTEST_IMAGEPOOL_H
+
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "Image.h"
+
+
+/**
+ * Shared state of an ImagePool: the free list of pixel buffers that every thread can take from.
+ * Images and per-thread caches keep it alive, so it may outlive its ImagePool. Used through ImagePool.
+ */
+class ImagePoolStorage : public std::enable_shared_from_this<ImagePoolStorage>
+{
+    size_t _bufferSize;
+    size_t _allocationSize;
+    bool _useHugePages;
+    std::atomic<bool> _closed;
+    std::atomic<size_t> _allocatedCount;
+    std::mutex _mutex;
+    std::vector<unsigned char *> _freeBuffers;
+
+    // allocates a new pixel buffer.
+    unsigned char *_allocate();
+
+    // frees the given pixel buffer.
+    void _deallocate(unsigned char *buffer);
+
+    // adds the given buffer to the free list (or frees it if the pool was destroyed).
+    void _pushFreeBuffer(unsigned char *buffer);
+
+    friend class ThreadBufferCache;
+
+public:
+    /**
+     * Creates an empty storage for buffers of the given size.
+     *
+     * @param bufferSize The size of a pixel buffer in bytes.
+     * @param useHugePages true to back the buffers with huge pages (if they are large enough and it's supported).
+     */
+    ImagePoolStorage(size_t bufferSize, bool useHugePages);
+
+    ImagePoolStorage(const ImagePoolStorage &) = delete;
+
+    ImagePoolStorage &operator=(const ImagePoolStorage &) = delete;
+
+    /**
+     * Frees all buffers in the free list.
+     */
+    ~ImagePoolStorage();
+
+    /**
+     * Returns a recycled pixel buffer (from this thread's cache first) or a newly allocated one.
+     *
+     * @return A pixel buffer (content unspecified).
+     */
+    unsigned char *acquireBuffer();
+
+    /**
+     * Takes back a buffer that was returned by acquireBuffer, keeping it for reuse (unless the pool was destroyed).
+     *
+     * @param buffer The buffer to take back.
+     */
+    void releaseBuffer(unsigned char *buffer);
+
+    /**
+     * Frees all buffers in the free list and in the caches of all threads, and stops keeping released buffers.
+     */
+    void close();
+
+    /**
+     * Returns true if the buffers are backed by huge pages. Otherwise, returns false.
+     *
+     * @return true if the buffers are backed by huge pages. Otherwise, returns false.
+     */
+    bool usesHugePages() const;
+
+    /**
+     * Returns the number of buffers that were allocated so far.
+     *
+     * @return The number of buffers that were allocated so far.
+     */
+    size_t getAllocatedCount() const;
+};
+
+/**
+ * Hands out images of a fixed size and layout whose pixel buffers are recycled:
+ * when a pooled image (or a copy of it) is destructed its buffer goes back to the pool instead of being freed.
+ * Released buffers are first kept in a small cache of the releasing thread, so acquiring and releasing on the
+ * same thread doesn't contend for the pool's lock. Destroying the pool frees the cached buffers of all threads.
+ * Thread-safe.
+ */
+class ImagePool
+{
+    int _height, _width;
+    ImageLayout _layout;
+    std::shared_ptr<ImagePoolStorage> _storage;
+
+public:
+    /**
+     * Creates an empty pool of images of the given parameters.
+     *
+     * @param height The image height in pixels.
+     * @param width The image width in pixels.
+     * @param layout The memory layout of the pixels - defaults to ROW_MAJOR.
+     * @param useHugePages true to back large frames (2MB and up) with huge pages where supported - defaults to false.
+     */
+    ImagePool(int height, int width, ImageLayout layout = ImageLayout::ROW_MAJOR, bool useHugePages = false);
+
+    ImagePool(const ImagePool &) = delete;
+
+    ImagePool &operator=(const ImagePool &) = delete;
+
+    /**
+     * Destructs the pool. Images that are still out stay valid and free their buffers when they are destructed.
+     */
+    ~ImagePool();
+
+    /**
+     * Returns an image of the pool's size and layout with all pixels set to the given color.
+     *
+     * @param color The color to set all pixels to - defaults to 0 (black).
+     * @return An image of the pool's size and layout with all pixels set to the given color.
+     */
+    Image acquire(unsigned char color = 0) const;
+
+    /**
+     * Returns the height of the pool's images.
+     *
+     * @return The height of the pool's images.
+     */
+    int getHeight() const;
+
+    /**
+     * Returns the width of the pool's images.
+     *
+     * @return The width of the pool's images.
+     */
+    int getWidth() const;
+
+    /**
+     * Returns the memory layout of the pool's images.
+     *
+     * @return The memory layout of the pool's images.
+     */
+    ImageLayout getLayout() const;
+
+    /**
+     * Returns true if the pixel buffers are backed by huge pages. Otherwise, returns false.
+     *
+     * @return true if the pixel buffers are backed by huge pages. Otherwise, returns false.
+     */
+    bool usesHugePages() const;
+
+    /**
+     * Returns the number of pixel buffers that were allocated so far (the rest of the acquires were recycled).
+     *
+     * @return The number of pixel buffers that were allocated so far.
+     */
+    size_t getAllocatedCount() const;
+};
+
+
+#endif //POLYTEST_IMAGEPOOL_H
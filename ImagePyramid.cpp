@@ -0,0 +1,320 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include "ImagePyramid.h"
+
+
+// Level whose cells are grouped into shape regions: fine enough to keep the regions tight (16 x 16 pixel cells), coarse
+// enough that grouping them is cheap.
+static const int REGION_LEVEL = 1;
+
+// Returns true if the two given regions overlap. Otherwise, returns false.
+static bool isOverlapping(const ImageRegion &region, const ImageRegion &otherRegion)
+{
+    return region.topLeft.x <= otherRegion.bottomRight.x && otherRegion.topLeft.x <= region.bottomRight.x &&
+           region.topLeft.y <= otherRegion.bottomRight.y && otherRegion.topLeft.y <= region.bottomRight.y;
+}
+
+// returns the cell of the given level (that is in bounds).
+unsigned char ImagePyramid::_cell(int level, int x, int y) const
+{
+    return _levels[level][(size_t) y * _levelWidths[level] + x];
+}
+
+// adds a level that is the reduction of the given rows (each getting its pixels as contiguous segments).
+template<class RowPixels>
+void ImagePyramid::_addLevel(int height, int width, RowPixels rowPixels)
+{
+    int levelHeight = (height + REDUCTION - 1) / REDUCTION;
+    int levelWidth = (width + REDUCTION - 1) / REDUCTION;
+    std::vector<unsigned char> cells((size_t) levelHeight * levelWidth);
+    std::vector<unsigned char> rowBits((size_t) levelWidth * REDUCTION);
+    for (int cellY = 0; cellY < levelHeight; ++cellY)
+    {
+        // OR the block's rows together a machine word at a time first (segments start at multiples of the word size,
+        // as tiles do), then each cell's columns.
+        std::fill(rowBits.begin(), rowBits.end(), 0);
+        int lastY = std::min(height, (cellY + 1) * REDUCTION);
+        for (int y = cellY * REDUCTION; y < lastY; ++y)
+        {
+            int length;
+            for (int x = 0; x < width; x += length)
+            {
+                const unsigned char *pixels = rowPixels(x, y, length);
+                unsigned char *bits = rowBits.data() + x;
+                int i = 0;
+                for (; i + (int) sizeof(uint64_t) <= length; i += sizeof(uint64_t))
+                {
+                    uint64_t word, rowWord;
+                    std::memcpy(&word, pixels + i, sizeof(word));
+                    std::memcpy(&rowWord, bits + i, sizeof(rowWord));
+                    rowWord |= word;
+                    std::memcpy(bits + i, &rowWord, sizeof(rowWord));
+                }
+                for (; i < length; ++i)
+                {
+                    bits[i] |= pixels[i];
+                }
+            }
+        }
+
+        unsigned char *row = cells.data() + (size_t) cellY * levelWidth;
+        for (int cellX = 0; cellX < levelWidth; ++cellX)
+        {
+            const unsigned char *blockBits = rowBits.data() + cellX * REDUCTION;
+            unsigned char cell = 0;
+            for (int i = 0; i < REDUCTION; ++i)
+            {
+                cell |= blockBits[i];
+            }
+            row[cellX] = cell;
+        }
+    }
+
+    _levels.push_back(std::move(cells));
+    _levelHeights.push_back(levelHeight);
+    _levelWidths.push_back(levelWidth);
+}
+
+// finds the non-empty cells of the given level by descending from the top level, skipping empty blocks.
+std::vector<Vector2> ImagePyramid::_findCells(int level) const
+{
+    std::vector<Vector2> cells, children;
+    int top = getLevelCount() - 1;
+    for (int y = 0; y < _levelHeights[top]; ++y)
+    {
+        for (int x = 0; x < _levelWidths[top]; ++x)
+        {
+            if (_cell(top, x, y) != 0)
+            {
+                cells.push_back(Vector2(x, y));
+            }
+        }
+    }
+
+    for (int childLevel = top - 1; childLevel >= level; --childLevel)
+    {
+        children.clear();
+        for (const Vector2 &cell : cells)
+        {
+            int lastY = std::min(_levelHeights[childLevel], (cell.y + 1) * REDUCTION);
+            int lastX = std::min(_levelWidths[childLevel], (cell.x + 1) * REDUCTION);
+            for (int y = cell.y * REDUCTION; y < lastY; ++y)
+            {
+                for (int x = cell.x * REDUCTION; x < lastX; ++x)
+                {
+                    if (_cell(childLevel, x, y) != 0)
+                    {
+                        children.push_back(Vector2(x, y));
+                    }
+                }
+            }
+        }
+        cells.swap(children);
+    }
+    return cells;
+}
+
+// groups the non-empty cells of the given level into regions that no two touching pixels are split between.
+void ImagePyramid::_findShapeRegions(int level)
+{
+    // Touching pixels are in the same or neighboring cells, so each group of cells that are connected (also
+    // diagonally) is a region. Then overlapping regions are merged, as a region must have all pixels in its bounds.
+    int levelHeight = _levelHeights[level], levelWidth = _levelWidths[level], cellSize = getCellSize(level);
+    std::vector<bool> visited((size_t) levelHeight * levelWidth, false);
+    std::vector<Vector2> stack;
+    for (const Vector2 &seed : _findCells(level))
+    {
+        if (visited[(size_t) seed.y * levelWidth + seed.x])
+        {
+            continue;
+        }
+
+        visited[(size_t) seed.y * levelWidth + seed.x] = true;
+        stack.push_back(seed);
+        Vector2 minCell = seed, maxCell = seed;
+        while (!stack.empty())
+        {
+            Vector2 cell = stack.back();
+            stack.pop_back();
+            minCell = Vector2(std::min(minCell.x, cell.x), std::min(minCell.y, cell.y));
+            maxCell = Vector2(std::max(maxCell.x, cell.x), std::max(maxCell.y, cell.y));
+            for (int y = std::max(0, cell.y - 1); y <= std::min(levelHeight - 1, cell.y + 1); ++y)
+            {
+                for (int x = std::max(0, cell.x - 1); x <= std::min(levelWidth - 1, cell.x + 1); ++x)
+                {
+                    if (!visited[(size_t) y * levelWidth + x] && _cell(level, x, y) != 0)
+                    {
+                        visited[(size_t) y * levelWidth + x] = true;
+                        stack.push_back(Vector2(x, y));
+                    }
+                }
+            }
+        }
+
+        ImageRegion region{Vector2(minCell.x * cellSize, minCell.y * cellSize),
+                           Vector2(std::min(_width, (maxCell.x + 1) * cellSize) - 1,
+                                   std::min(_height, (maxCell.y + 1) * cellSize) - 1)};
+        for (size_t i = 0; i < _shapeRegions.size();)
+        {
+            if (!isOverlapping(region, _shapeRegions[i]))
+            {
+                ++i;
+                continue;
+            }
+            // The merged region can overlap regions that were already checked, so start over.
+            region.topLeft = Vector2(std::min(region.topLeft.x, _shapeRegions[i].topLeft.x),
+                                     std::min(region.topLeft.y, _shapeRegions[i].topLeft.y));
+            region.bottomRight = Vector2(std::max(region.bottomRight.x, _shapeRegions[i].bottomRight.x),
+                                         std::max(region.bottomRight.y, _shapeRegions[i].bottomRight.y));
+            _shapeRegions[i] = _shapeRegions.back();
+            _shapeRegions.pop_back();
+            i = 0;
+        }
+        _shapeRegions.push_back(region);
+    }
+
+    std::sort(_shapeRegions.begin(), _shapeRegions.end(), [](const ImageRegion &region, const ImageRegion &other)
+    {
+        return region.topLeft.y != other.topLeft.y ? region.topLeft.y < other.topLeft.y :
+               region.topLeft.x < other.topLeft.x;
+    });
+}
+
+// throws ImageDimException if the given level doesn't exist.
+void ImagePyramid::_checkLevel(int level) const
+{
+    if (level < 0 || level >= getLevelCount())
+    {
+        throw ImageDimException();
+    }
+}
+
+/**
+ * Builds the pyramid of the given image in a single pass over its pixels, then finds its shape regions.
+ *
+ * @param img The image to build the pyramid of.
+ */
+ImagePyramid::ImagePyramid(const Image &img) : _height(img.getHeight()), _width(img.getWidth())
+{
+    _addLevel(_height, _width, [&](int x, int y, int &length)
+    {
+        return img.getRowPixels(x, y, length);
+    });
+    while (_levelHeights.back() > 1 || _levelWidths.back() > 1)
+    {
+        const std::vector<unsigned char> &below = _levels.back();
+        int belowWidth = _levelWidths.back();
+        _addLevel(_levelHeights.back(), belowWidth, [&](int x, int y, int &length)
+        {
+            length = belowWidth - x;
+            return below.data() + (size_t) y * belowWidth + x;
+        });
+    }
+    _findShapeRegions(std::min(REGION_LEVEL, getLevelCount() - 1));
+}
+
+/**
+ * Returns the image's height.
+ *
+ * @return The image's height.
+ */
+int ImagePyramid::getHeight() const
+{
+    return _height;
+}
+
+/**
+ * Returns the image's width.
+ *
+ * @return The image's width.
+ */
+int ImagePyramid::getWidth() const
+{
+    return _width;
+}
+
+/**
+ * Returns the number of levels (level 0 is the finest, the last one is a single cell).
+ *
+ * @return The number of levels.
+ */
+int ImagePyramid::getLevelCount() const
+{
+    return (int) _levels.size();
+}
+
+/**
+ * Returns the height in cells of the given level.
+ * Throws exception if the level doesn't exist.
+ *
+ * @param level The level.
+ * @return The height in cells of the given level.
+ */
+int ImagePyramid::getLevelHeight(int level) const
+{
+    _checkLevel(level);
+    return _levelHeights[level];
+}
+
+/**
+ * Returns the width in cells of the given level.
+ * Throws exception if the level doesn't exist.
+ *
+ * @param level The level.
+ * @return The width in cells of the given level.
+ */
+int ImagePyramid::getLevelWidth(int level) const
+{
+    _checkLevel(level);
+    return _levelWidths[level];
+}
+
+/**
+ * Returns the width and height in pixels of the block a cell of the given level covers.
+ * Throws exception if the level doesn't exist.
+ *
+ * @param level The level.
+ * @return The width and height in pixels of the block a cell of the given level covers.
+ */
+int ImagePyramid::getCellSize(int level) const
+{
+    _checkLevel(level);
+    int size = REDUCTION;
+    for (int i = 0; i < level; ++i)
+    {
+        size *= REDUCTION;
+    }
+    return size;
+}
+
+/**
+ * Returns the bitwise OR of the pixels of the block the given cell covers (0 only if the block is empty).
+ * Throws exception if the level or the cell doesn't exist.
+ *
+ * @param level The level of the cell.
+ * @param x The x coordinate of the cell.
+ * @param y The y coordinate of the cell.
+ * @return The bitwise OR of the pixels of the block the given cell covers.
+ */
+unsigned char ImagePyramid::getCell(int level, int x, int y) const
+{
+    _checkLevel(level);
+    if (x < 0 || y < 0 || x >= _levelWidths[level] || y >= _levelHeights[level])
+    {
+        throw ImageDimException();
+    }
+    return _cell(level, x, y);
+}
+
+/**
+ * Returns disjoint regions (in raster order of their top-left corners) that together hold every non-zero pixel
+ * of the image, where any two non-zero pixels that touch (also diagonally) are in the same region.
+ * So the shapes of each region can be recognized on their own.
+ *
+ * @return The regions of the image that have shapes in them.
+ */
+const std::vector<ImageRegion> &ImagePyramid::getShapeRegions() const
+{
+    return _shapeRegions;
+}
@@ -0,0 +1,137 @@
+//
+// Created by jacko on 30/10/2020.
+//
+
+#ifndef POLYTEST_IMAGEPYRAMID_H
+#define POLYTEST_IMAGEPYRAMID_H
+
+
+#include <vector>
+#include "Image.h"
+
+
+/**
+ * Rectangular region of an image (corners inclusive).
+ */
+struct ImageRegion
+{
+    Vector2 topLeft, bottomRight;
+};
+
+/**
+ * Occupancy pyramid of an image: each level is REDUCTION times smaller than the one below it in both dimensions, and
+ * each of its cells holds the bitwise OR of the pixels of the square block of the image it covers, so a zero cell is
+ * an empty block.
+ * Also finds, coarse to fine, the regions of the image that have shapes in them, so recognition can skip the rest.
+ * Is a snapshot - changes to the image after it was built aren't seen. Build it once and reuse it for all queries on
+ * the same frame.
+ */
+class ImagePyramid
+{
+    int _height, _width;
+    // Level 0 has a cell per REDUCTION x REDUCTION pixels, each next level a cell per REDUCTION x REDUCTION cells of
+    // the one below. The top level is a single cell.
+    std::vector<std::vector<unsigned char>> _levels;
+    std::vector<int> _levelHeights, _levelWidths;
+    std::vector<ImageRegion> _shapeRegions;
+
+    // returns the cell of the given level (that is in bounds).
+    unsigned char _cell(int level, int x, int y) const;
+
+    // adds a level that is the reduction of the given rows (each getting its pixels as contiguous segments).
+    template<class RowPixels>
+    void _addLevel(int height, int width, RowPixels rowPixels);
+
+    // finds the non-empty cells of the given level by descending from the top level, skipping empty blocks.
+    std::vector<Vector2> _findCells(int level) const;
+
+    // groups the non-empty cells of the given level into regions that no two touching pixels are split between.
+    void _findShapeRegions(int level);
+
+    // throws ImageDimException if the given level doesn't exist.
+    void _checkLevel(int level) const;
+
+public:
+    /**
+     * Width and height in cells of the block of the level below that each cell covers.
+     */
+    static const int REDUCTION = 4;
+
+    /**
+     * Builds the pyramid of the given image in a single pass over its pixels, then finds its shape regions.
+     *
+     * @param img The image to build the pyramid of.
+     */
+    explicit ImagePyramid(const Image &img);
+
+    /**
+     * Returns the image's height.
+     *
+     * @return The image's height.
+     */
+    int getHeight() const;
+
+    /**
+     * Returns the image's width.
+     *
+     * @return The image's width.
+     */
+    int getWidth() const;
+
+    /**
+     * Returns the number of levels (level 0 is the finest, the last one is a single cell).
+     *
+     * @return The number of levels.
+     */
+    int getLevelCount() const;
+
+    /**
+     * Returns the height in cells of the given level.
+     * Throws exception if the level doesn't exist.
+     *
+     * @param level The level.
+     * @return The height in cells of the given level.
+     */
+    int getLevelHeight(int level) const;
+
+    /**
+     * Returns the width in cells of the given level.
+     * Throws exception if the level doesn't exist.
+     *
+     * @param level The level.
+     * @return The width in cells of the given level.
+     */
+    int getLevelWidth(int level) const;
+
+    /**
+     * Returns the width and height in pixels of the block a cell of the given level covers.
+     * Throws exception if the level doesn't exist.
+     *
+     * @param level The level.
+     * @return The width and height in pixels of the block a cell of the given level covers.
+     */
+    int getCellSize(int level) const;
+
+    /**
+     * Returns the bitwise OR of the pixels of the block the given cell covers (0 only if the block is empty).
+     * Throws exception if the level or the cell doesn't exist.
+     *
+     * @param level The level of the cell.
+     * @param x The x coordinate of the cell.
+     * @param y The y coordinate of the cell.
+     * @return The bitwise OR of the pixels of the block the given cell covers.
+     */
+    unsigned char getCell(int level, int x, int y) const;
+
+    /**
+     * Returns disjoint regions (in raster order of their top-left corners) that together hold every non-zero pixel
+     * of the image, where any two non-zero pixels that touch (also diagonally) are in the same region.
+     * So the shapes of each region can be recognized on their own.
+     *
+     * @return The regions of the image that have shapes in them.
+     */
+    const std::vector<ImageRegion> &getShapeRegions() const;
+};
+
+
+#endif //POLYTEST_IMAGEPYRAMID_H
@@ -0,0 +1,261 @@
+#include <algorithm>
+#include "ImageView.h"
+
+
+/**
+ * Creates a view of the given region of the given image.
+ * Throws exception if the region is not inside the image.
+ *
+ * @param image The image to view.
+ * @param offset The top-left corner of the region in image coordinates.
+ * @param height The region height in pixels.
+ * @param width The region width in pixels.
+ */
+ImageView::ImageView(Image &image, const Vector2 &offset, int height, int width) : _image(&image), _offset(offset),
+                                                                                    _height(height), _width(width)
+{
+    if (offset.x < 0 || offset.y < 0 || height < 0 || width < 0 || offset.x + width > image.getWidth() ||
+        offset.y + height > image.getHeight())
+    {
+        throw ImageDimException();
+    }
+}
+
+/**
+ * Creates a view of the whole given image.
+ *
+ * @param image The image to view.
+ */
+ImageView::ImageView(Image &image) : _image(&image), _offset(0, 0), _height(image.getHeight()),
+                                     _width(image.getWidth())
+{}
+
+/**
+ * Creates a view of the given region of the given view (sharing its image).
+ * Throws exception if the region is not inside the view.
+ *
+ * @param view The view to take the region of.
+ * @param offset The top-left corner of the region in the given view's coordinates.
+ * @param height The region height in pixels.
+ * @param width The region width in pixels.
+ */
+ImageView::ImageView(const ImageView &view, const Vector2 &offset, int height, int width) :
+        _image(view._image), _offset(view._offset.x + offset.x, view._offset.y + offset.y), _height(height),
+        _width(width)
+{
+    if (offset.x < 0 || offset.y < 0 || height < 0 || width < 0 || offset.x + width > view._width ||
+        offset.y + height > view._height)
+    {
+        throw ImageDimException();
+    }
+}
+
+/**
+ * Returns the image the view is of.
+ *
+ * @return The image the view is of.
+ */
+Image &ImageView::getImage() const
+{
+    return *_image;
+}
+
+/**
+ * Returns the top-left corner of the view in image coordinates.
+ *
+ * @return The top-left corner of the view in image coordinates.
+ */
+const Vector2 &ImageView::getOffset() const
+{
+    return _offset;
+}
+
+/**
+ * Returns the view's width.
+ *
+ * @return The view's width.
+ */
+int ImageView::getWidth() const
+{
+    return _width;
+}
+
+/**
+ * Returns the view's height.
+ *
+ * @return The view's height.
+ */
+int ImageView::getHeight() const
+{
+    return _height;
+}
+
+/**
+ * Returns the memory layout of the image's pixels.
+ *
+ * @return The memory layout of the image's pixels.
+ */
+ImageLayout ImageView::getLayout() const
+{
+    return _image->getLayout();
+}
+
+/**
+ * Draws a pixel of the given color at the given location.
+ * Throws exception if location is out of view bounds.
+ *
+ * @param location 2d vector representing view location.
+ * @param color The color to draw (1 byte grayscale).
+ */
+void ImageView::drawPixel(const Vector2 &location, unsigned char color)
+{
+    if (!isPixelValid(location))
+    {
+        throw ImageDimException();
+    }
+
+    _image->drawPixel(Vector2(location.x + _offset.x, location.y + _offset.y), color);
+}
+
+/**
+ * Draws a horizontal line of the given color from the start location to the given x coordinate.
+ * Throws exception if the line is out of view bounds.
+ *
+ * @param start 2d vector representing start location.
+ * @param xFinish The last x coordinate of the line.
+ * @param color The color to draw (1 byte grayscale).
+ */
+void ImageView::drawHorizontalLine(const Vector2 &start, int xFinish, unsigned char color)
+{
+    if (start.x < 0 || start.y < 0 || start.y >= _height || xFinish >= _width || start.x > xFinish)
+    {
+        throw ImageDimException();
+    }
+
+    _image->drawHorizontalLine(Vector2(start.x + _offset.x, start.y + _offset.y), xFinish + _offset.x, color);
+}
+
+/**
+ * Return true if the given pixel is in the view bounds. Otherwise, returns false.
+ *
+ * @param x The x coordinate of the pixel.
+ * @param y The y coordinate of the pixel.
+ * @return true if the given pixel is in the view bounds. Otherwise, returns false.
+ */
+bool ImageView::isPixelValid(int x, int y) const
+{
+    return x >= 0 && x < _width && y >= 0 && y < _height;
+}
+
+/**
+ * Return true if the given pixel is in the view bounds. Otherwise, returns false.
+ *
+ * @param location 2d vector representing view location.
+ * @return true if the given pixel is in the view bounds. Otherwise, returns false.
+ */
+bool ImageView::isPixelValid(const Vector2 &location) const
+{
+    return isPixelValid(location.x, location.y);
+}
+
+/**
+ * Returns the intensity value of the given pixel.
+ * Throws exception if location is out of view bounds.
+ *
+ * @param x The x coordinate of the pixel.
+ * @param y The y coordinate of the pixel.
+ * @return The intensity value of the given pixel.
+ */
+unsigned char ImageView::getPixel(int x, int y) const
+{
+    if (!isPixelValid(x, y))
+    {
+        throw ImageDimException();
+    }
+
+    return _image->getPixel(x + _offset.x, y + _offset.y);
+}
+
+/**
+ * Returns the intensity value of the given pixel.
+ * Throws exception if location is out of view bounds.
+ *
+ * @param location 2d vector representing view location.
+ * @return The intensity value of the given pixel.
+ */
+unsigned char ImageView::getPixel(const Vector2 &location) const
+{
+    return getPixel(location.x, location.y);
+}
+
+/**
+ * Returns a pointer to the pixels of the given row, starting at the given location.
+ * The returned length never goes past the view's right edge (see Image::getRowPixels).
+ * Throws exception if location is out of view bounds.
+ *
+ * @param x The x coordinate of the first pixel.
+ * @param y The y coordinate of the row.
+ * @param length This will be set to the number of contiguous pixels available from the returned pointer.
+ * @return A pointer to the pixels of the given row, starting at the given location.
+ */
+const unsigned char *ImageView::getRowPixels(int x, int y, int &length) const
+{
+    if (!isPixelValid(x, y))
+    {
+        throw ImageDimException();
+    }
+
+    const unsigned char *pixels = _image->getRowPixels(x + _offset.x, y + _offset.y, length);
+    length = std::min(length, _width - x);
+    return pixels;
+}
+
+/**
+ * Returns the x coordinate of the first non-zero (non-background) pixel in row y at or after x,
+ * or the view width if there is no such pixel (uses the image's row-occupancy index if it has one).
+ * Throws exception if location is out of view bounds (x may be equal to the width).
+ *
+ * @param x The x coordinate to start from.
+ * @param y The y coordinate of the row.
+ * @return The x coordinate of the first non-zero pixel in row y at or after x, or the view width.
+ */
+int ImageView::findNextNonBackgroundPixel(int x, int y) const
+{
+    if (x < 0 || x > _width || y < 0 || y >= _height)
+    {
+        throw ImageDimException();
+    }
+
+    if (_image->hasOccupancyIndex())
+    {
+        int found = _image->findNextNonBackgroundPixel(x + _offset.x, y + _offset.y) - _offset.x;
+        return std::min(found, _width);
+    }
+
+    // Scan only the view's part of the row, one contiguous segment at a time.
+    while (x < _width)
+    {
+        int length;
+        const unsigned char *pixels = getRowPixels(x, y, length);
+        const unsigned char *found = std::find_if(pixels, pixels + length, [](unsigned char pixel)
+        {
+            return pixel != 0;
+        });
+        if (found != pixels + length)
+        {
+            return x + (int) (found - pixels);
+        }
+        x += length;
+    }
+    return _width;
+}
+
+/**
+ * Returns a new image (of the same layout as the viewed one) that is a copy of the view's pixels.
+ *
+ * @return A new image that is a copy of the view's pixels.
+ */
+Image ImageView::toImage() const
+{
+    return _image->copyRegion(_offset, _height, _width);
+}
@@ -0,0 +1,175 @@
+//
+// Created by jacko on 30/10/2020.
+//
+
+#ifndef POLYTEST_IMAGEVIEW_H
+#define POLYTEST_IMAGEVIEW_H
+
+
+#include "Image.h"
+
+
+/**
+ * Rectangular region of an image (or of another view) that shares its pixels.
+ * Coordinates are relative to the region's top-left corner and are translated to the image without copying;
+ * writes go straight to the image. The image must outlive the view.
+ */
+class ImageView
+{
+    Image *_image;
+    Vector2 _offset; // Top-left corner of the region in image coordinates.
+    int _height, _width;
+
+public:
+    /**
+     * Creates a view of the given region of the given image.
+     * Throws exception if the region is not inside the image.
+     *
+     * @param image The image to view.
+     * @param offset The top-left corner of the region in image coordinates.
+     * @param height The region height in pixels.
+     * @param width The region width in pixels.
+     */
+    ImageView(Image &image, const Vector2 &offset, int height, int width);
+
+    /**
+     * Creates a view of the whole given image.
+     *
+     * @param image The image to view.
+     */
+    explicit ImageView(Image &image);
+
+    /**
+     * Creates a view of the given region of the given view (sharing its image).
+     * Throws exception if the region is not inside the view.
+     *
+     * @param view The view to take the region of.
+     * @param offset The top-left corner of the region in the given view's coordinates.
+     * @param height The region height in pixels.
+     * @param width The region width in pixels.
+     */
+    ImageView(const ImageView &view, const Vector2 &offset, int height, int width);
+
+    /**
+     * Returns the image the view is of.
+     *
+     * @return The image the view is of.
+     */
+    Image &getImage() const;
+
+    /**
+     * Returns the top-left corner of the view in image coordinates.
+     *
+     * @return The top-left corner of the view in image coordinates.
+     */
+    const Vector2 &getOffset() const;
+
+    /**
+     * Returns the view's width.
+     *
+     * @return The view's width.
+     */
+    int getWidth() const;
+
+    /**
+     * Returns the view's height.
+     *
+     * @return The view's height.
+     */
+    int getHeight() const;
+
+    /**
+     * Returns the memory layout of the image's pixels.
+     *
+     * @return The memory layout of the image's pixels.
+     */
+    ImageLayout getLayout() const;
+
+    /**
+     * Draws a pixel of the given color at the given location.
+     * Throws exception if location is out of view bounds.
+     *
+     * @param location 2d vector representing view location.
+     * @param color The color to draw (1 byte grayscale).
+     */
+    void drawPixel(const Vector2 &location, unsigned char color);
+
+    /**
+     * Draws a horizontal line of the given color from the start location to the given x coordinate.
+     * Throws exception if the line is out of view bounds.
+     *
+     * @param start 2d vector representing start location.
+     * @param xFinish The last x coordinate of the line.
+     * @param color The color to draw (1 byte grayscale).
+     */
+    void drawHorizontalLine(const Vector2 &start, int xFinish, unsigned char color);
+
+    /**
+     * Return true if the given pixel is in the view bounds. Otherwise, returns false.
+     *
+     * @param x The x coordinate of the pixel.
+     * @param y The y coordinate of the pixel.
+     * @return true if the given pixel is in the view bounds. Otherwise, returns false.
+     */
+    bool isPixelValid(int x, int y) const;
+
+    /**
+     * Return true if the given pixel is in the view bounds. Otherwise, returns false.
+     *
+     * @param location 2d vector representing view location.
+     * @return true if the given pixel is in the view bounds. Otherwise, returns false.
+     */
+    bool isPixelValid(const Vector2 &location) const;
+
+    /**
+     * Returns the intensity value of the given pixel.
+     * Throws exception if location is out of view bounds.
+     *
+     * @param x The x coordinate of the pixel.
+     * @param y The y coordinate of the pixel.
+     * @return The intensity value of the given pixel.
+     */
+    unsigned char getPixel(int x, int y) const;
+
+    /**
+     * Returns the intensity value of the given pixel.
+     * Throws exception if location is out of view bounds.
+     *
+     * @param location 2d vector representing view location.
+     * @return The intensity value of the given pixel.
+     */
+    unsigned char getPixel(const Vector2 &location) const;
+
+    /**
+     * Returns a pointer to the pixels of the given row, starting at the given location.
+     * The returned length never goes past the view's right edge (see Image::getRowPixels).
+     * Throws exception if location is out of view bounds.
+     *
+     * @param x The x coordinate of the first pixel.
+     * @param y The y coordinate of the row.
+     * @param length This will be set to the number of contiguous pixels available from the returned pointer.
+     * @return A pointer to the pixels of the given row, starting at the given location.
+     */
+    const unsigned char *getRowPixels(int x, int y, int &length) const;
+
+    /**
+     * Returns the x coordinate of the first non-zero (non-background) pixel in row y at or after x,
+     * or the view width if there is no such pixel (uses the image's row-occupancy index if it has one).
+     * Throws exception if location is out of view bounds (x may be equal to the width).
+     *
+     * @param x The x coordinate to start from.
+     * @param y The y coordinate of the row.
+     * @return The x coordinate of the first non-zero pixel in row y at or after x, or the view width.
+     */
+    int findNextNonBackgroundPixel(int x, int y) const;
+
+    /**
+     * Returns a new image (of the same layout as the viewed one) that is a copy of the view's pixels.
+     *
+     * @return A new image that is a copy of the view's pixels.
+     */
+    Image toImage() const;
+};
+
+
+#endif //POLYTEST_IMAGEVIEW_H
@@ -0,0 +1,215 @@
+#include <algorithm>
+#include "IntegralImage.h"
+
+
+// returns the sums of the given region (that is in bounds).
+IntegralImage::Entry IntegralImage::_regionSums(int left, int top, int right, int bottom) const
+{
+    size_t stride = (size_t) _width + 1;
+    const Entry *topRow = &_entries[top * stride], *bottomRow = &_entries[(bottom + 1) * stride];
+    return Entry{bottomRow[right + 1].sum - bottomRow[left].sum - topRow[right + 1].sum + topRow[left].sum,
+                 bottomRow[right + 1].squareSum - bottomRow[left].squareSum - topRow[right + 1].squareSum +
+                 topRow[left].squareSum};
+}
+
+// returns true if all pixels of the given region (that is in bounds) are of the given color.
+bool IntegralImage::_isUniform(int left, int top, int right, int bottom, unsigned char color) const
+{
+    // The squared differences from the color add up to squareSum - 2 * color * sum + color^2 * area, which is 0 only
+    // if every pixel is of the color.
+    uint64_t area = (uint64_t) (right - left + 1) * (bottom - top + 1);
+    Entry sums = _regionSums(left, top, right, bottom);
+    return sums.sum == color * area && sums.squareSum == (uint64_t) color * color * area;
+}
+
+// throws ImageDimException if the region between the two corners isn't a non-empty region of the image.
+void IntegralImage::_checkRegion(const Vector2 &topLeft, const Vector2 &bottomRight) const
+{
+    if (topLeft.x < 0 || topLeft.y < 0 || bottomRight.x >= _width || bottomRight.y >= _height ||
+        topLeft.x > bottomRight.x || topLeft.y > bottomRight.y)
+    {
+        throw ImageDimException();
+    }
+}
+
+/**
+ * Builds the tables of the given image in a single pass over its pixels.
+ *
+ * @param img The image to build the tables of.
+ */
+IntegralImage::IntegralImage(const Image &img) : _height(img.getHeight()), _width(img.getWidth()),
+                                                 _entries(new Entry[((size_t) _height + 1) * (_width + 1)])
+{
+    // Every entry is written once, so only the zero row and column need clearing.
+    size_t stride = (size_t) _width + 1;
+    std::fill(&_entries[0], &_entries[stride], Entry{0, 0});
+    for (int y = 0; y < _height; ++y)
+    {
+        const Entry *above = &_entries[y * stride];
+        Entry *row = &_entries[(y + 1) * stride];
+        row[0] = Entry{0, 0};
+        uint64_t rowSum = 0, rowSquareSum = 0;
+
+        // Go over the row one contiguous segment at a time, so tiled images are read in place too.
+        int length;
+        for (int x = 0; x < _width; x += length)
+        {
+            const unsigned char *pixels = img.getRowPixels(x, y, length);
+            for (int i = 0; i < length; ++i)
+            {
+                uint64_t pixel = pixels[i];
+                rowSum += pixel;
+                rowSquareSum += pixel * pixel;
+                row[x + i + 1] = Entry{above[x + i + 1].sum + rowSum, above[x + i + 1].squareSum + rowSquareSum};
+            }
+        }
+    }
+}
+
+/**
+ * Returns the image's height.
+ *
+ * @return The image's height.
+ */
+int IntegralImage::getHeight() const
+{
+    return _height;
+}
+
+/**
+ * Returns the image's width.
+ *
+ * @return The image's width.
+ */
+int IntegralImage::getWidth() const
+{
+    return _width;
+}
+
+/**
+ * Returns the sum of the pixels between the two given corners (inclusive).
+ * Throws exception if the region is not inside the image.
+ *
+ * @param topLeft The top-left corner of the region.
+ * @param bottomRight The bottom-right corner of the region.
+ * @return The sum of the pixels in the region.
+ */
+uint64_t IntegralImage::getSum(const Vector2 &topLeft, const Vector2 &bottomRight) const
+{
+    _checkRegion(topLeft, bottomRight);
+    return _regionSums(topLeft.x, topLeft.y, bottomRight.x, bottomRight.y).sum;
+}
+
+/**
+ * Returns the sum of the squares of the pixels between the two given corners (inclusive).
+ * Throws exception if the region is not inside the image.
+ *
+ * @param topLeft The top-left corner of the region.
+ * @param bottomRight The bottom-right corner of the region.
+ * @return The sum of the squares of the pixels in the region.
+ */
+uint64_t IntegralImage::getSquareSum(const Vector2 &topLeft, const Vector2 &bottomRight) const
+{
+    _checkRegion(topLeft, bottomRight);
+    return _regionSums(topLeft.x, topLeft.y, bottomRight.x, bottomRight.y).squareSum;
+}
+
+/**
+ * Returns the mean of the pixels between the two given corners (inclusive).
+ * Throws exception if the region is not inside the image.
+ *
+ * @param topLeft The top-left corner of the region.
+ * @param bottomRight The bottom-right corner of the region.
+ * @return The mean of the pixels in the region.
+ */
+double IntegralImage::getMean(const Vector2 &topLeft, const Vector2 &bottomRight) const
+{
+    double area = (double) (bottomRight.x - topLeft.x + 1) * (bottomRight.y - topLeft.y + 1);
+    return (double) getSum(topLeft, bottomRight) / area;
+}
+
+/**
+ * Returns the variance of the pixels between the two given corners (inclusive).
+ * Throws exception if the region is not inside the image.
+ *
+ * @param topLeft The top-left corner of the region.
+ * @param bottomRight The bottom-right corner of the region.
+ * @return The variance of the pixels in the region.
+ */
+double IntegralImage::getVariance(const Vector2 &topLeft, const Vector2 &bottomRight) const
+{
+    double area = (double) (bottomRight.x - topLeft.x + 1) * (bottomRight.y - topLeft.y + 1);
+    double mean = getMean(topLeft, bottomRight);
+    double variance = (double) getSquareSum(topLeft, bottomRight) / area - mean * mean;
+    return variance > 0 ? variance : 0;
+}
+
+/**
+ * Returns true if all pixels between the two given corners (inclusive) are of the given color.
+ * Otherwise, returns false.
+ * Throws exception if the region is not inside the image.
+ *
+ * @param topLeft The top-left corner of the region.
+ * @param bottomRight The bottom-right corner of the region.
+ * @param color The color to check for.
+ * @return true if all pixels in the region are of the given color. Otherwise, returns false.
+ */
+bool IntegralImage::isUniform(const Vector2 &topLeft, const Vector2 &bottomRight, unsigned char color) const
+{
+    _checkRegion(topLeft, bottomRight);
+    return _isUniform(topLeft.x, topLeft.y, bottomRight.x, bottomRight.y, color);
+}
+
+/**
+ * Sets found to the first pixel (in raster order) between the two given corners that isn't of the given color,
+ * binary searching for its row and then for its column in O(log(height) + log(width)).
+ * Returns true if such a pixel was found. Otherwise, returns false.
+ * Throws exception if the region is not inside the image.
+ *
+ * @param topLeft The top-left corner of the region.
+ * @param bottomRight The bottom-right corner of the region.
+ * @param color The color to look past.
+ * @param found This will be set to the found pixel.
+ * @return true if such a pixel was found. Otherwise, returns false.
+ */
+bool IntegralImage::findPixelNotOfColor(const Vector2 &topLeft, const Vector2 &bottomRight, unsigned char color,
+                                        Vector2 &found) const
+{
+    _checkRegion(topLeft, bottomRight);
+    if (_isUniform(topLeft.x, topLeft.y, bottomRight.x, bottomRight.y, color))
+    {
+        return false;
+    }
+
+    // The first row whose rows up to it aren't uniform has the pixel.
+    int top = topLeft.y, bottom = bottomRight.y;
+    while (top < bottom)
+    {
+        int middle = top + (bottom - top) / 2;
+        if (_isUniform(topLeft.x, topLeft.y, bottomRight.x, middle, color))
+        {
+            top = middle + 1;
+        }
+        else
+        {
+            bottom = middle;
+        }
+    }
+
+    // Same for the columns of that row.
+    int left = topLeft.x, right = bottomRight.x;
+    while (left < right)
+    {
+        int middle = left + (right - left) / 2;
+        if (_isUniform(topLeft.x, top, middle, top, color))
+        {
+            left = middle + 1;
+        }
+        else
+        {
+            right = middle;
+        }
+    }
+    found = Vector2(left, top);
+    return true;
+}
@@ -0,0 +1,132 @@
+//
+// Created by jacko on 30/10/2020.
+//
+
+#ifndef POLYTEST_INTEGRALIMAGE_H
+#define POLYTEST_INTEGRALIMAGE_H
+
+
+#include <cstdint>
+#include <memory>
+#include "Image.h"
+
+
+/**
+ * Summed-area tables of an image: the sum and the sum of squares of the pixels in any rectangular region are
+ * answered in O(1), so are the region's mean, variance and whether it is all of one color.
+ * Takes 16 bytes per pixel and is a snapshot - changes to the image after it was built aren't seen.
+ * Can be moved but not copied.
+ */
+class IntegralImage
+{
+    // Sums of the pixels above and left of a pixel (both kept together, as they are always read together).
+    struct Entry
+    {
+        uint64_t sum, squareSum;
+    };
+
+    int _height, _width;
+    // (height + 1) x (width + 1), entry (x, y) is of the pixels above and left of pixel (x, y). Row and column 0 are 0.
+    std::unique_ptr<Entry[]> _entries;
+
+    // returns the sums of the given region (that is in bounds).
+    Entry _regionSums(int left, int top, int right, int bottom) const;
+
+    // returns true if all pixels of the given region (that is in bounds) are of the given color.
+    bool _isUniform(int left, int top, int right, int bottom, unsigned char color) const;
+
+    // throws ImageDimException if the region between the two corners isn't a non-empty region of the image.
+    void _checkRegion(const Vector2 &topLeft, const Vector2 &bottomRight) const;
+
+public:
+    /**
+     * Builds the tables of the given image in a single pass over its pixels.
+     *
+     * @param img The image to build the tables of.
+     */
+    explicit IntegralImage(const Image &img);
+
+    /**
+     * Returns the image's height.
+     *
+     * @return The image's height.
+     */
+    int getHeight() const;
+
+    /**
+     * Returns the image's width.
+     *
+     * @return The image's width.
+     */
+    int getWidth() const;
+
+    /**
+     * Returns the sum of the pixels between the two given corners (inclusive).
+     * Throws exception if the region is not inside the image.
+     *
+     * @param topLeft The top-left corner of the region.
+     * @param bottomRight The bottom-right corner of the region.
+     * @return The sum of the pixels in the region.
+     */
+    uint64_t getSum(const Vector2 &topLeft, const Vector2 &bottomRight) const;
+
+    /**
+     * Returns the sum of the squares of the pixels between the two given corners (inclusive).
+     * Throws exception if the region is not inside the image.
+     *
+     * @param topLeft The top-left corner of the region.
+     * @param bottomRight The bottom-right corner of the region.
+     * @return The sum of the squares of the pixels in the region.
+     */
+    uint64_t getSquareSum(const Vector2 &topLeft, const Vector2 &bottomRight) const;
+
+    /**
+     * Returns the mean of the pixels between the two given corners (inclusive).
+     * Throws exception if the region is not inside the image.
+     *
+     * @param topLeft The top-left corner of the region.
+     * @param bottomRight The bottom-right corner of the region.
+     * @return The mean of the pixels in the region.
+     */
+    double getMean(const Vector2 &topLeft, const Vector2 &bottomRight) const;
+
+    /**
+     * Returns the variance of the pixels between the two given corners (inclusive).
+     * Throws exception if the region is not inside the image.
+     *
+     * @param topLeft The top-left corner of the region.
+     * @param bottomRight The bottom-right corner of the region.
+     * @return The variance of the pixels in the region.
+     */
+    double getVariance(const Vector2 &topLeft, const Vector2 &bottomRight) const;
+
+    /**
+     * Returns true if all pixels between the two given corners (inclusive) are of the given color.
+     * Otherwise, returns false.
+     * Throws exception if the region is not inside the image.
+     *
+     * @param topLeft The top-left corner of the region.
+     * @param bottomRight The bottom-right corner of the region.
+     * @param color The color to check for.
+     * @return true if all pixels in the region are of the given color. Otherwise, returns false.
+     */
+    bool isUniform(const Vector2 &topLeft, const Vector2 &bottomRight, unsigned char color) const;
+
+    /**
+     * Sets found to the first pixel (in raster order) between the two given corners that isn't of the given color,
+     * binary searching for its row and then for its column in O(log(height) + log(width)).
+     * Returns true if such a pixel was found. Otherwise, returns false.
+     * Throws exception if the region is not inside the image.
+     *
+     * @param topLeft The top-left corner of the region.
+     * @param bottomRight The bottom-right corner of the region.
+     * @param color The color to look past.
+     * @param found This will be set to the found pixel.
+     * @return true if such a pixel was found. Otherwise, returns false.
+     */
+    bool findPixelNotOfColor(const Vector2 &topLeft, const Vector2 &bottomRight, unsigned char color,
+                             Vector2 &found) const;
+};
+
+
+#endif //POLYTEST_INTEGRALIMAGE_H
@@ -0,0 +1,181 @@
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <random>
+#include <thread>
+#include "LoadGenerator.h"
+
+
+static const int CELL_SIZE = 32;
+
+// Kinds of requests the clients send, in turns.
+enum class LoadRequest
+{
+    RECOGNIZE_RECTANGLES,
+    RECOGNIZE_RECTANGLES_AND_TRIANGLES,
+    RENDER
+};
+
+// A request that waits for its response.
+struct PendingRequest
+{
+    int frame;
+    LoadRequest kind;
+    std::chrono::steady_clock::time_point sendTime;
+};
+
+
+/**
+ * Returns the average number of answered requests per second.
+ *
+ * @return The average number of answered requests per second.
+ */
+double LoadReport::getThroughput() const
+{
+    return seconds == 0 ? 0 : (double) requests / seconds;
+}
+
+// sends the given client's requests and checks the answers, adding the results to the given report.
+void LoadGenerator::_runClient(int client, LoadReport &report) const
+{
+    std::vector<PendingRequest> pending(_requestsPerClient);
+    int sent = 0, received = 0;
+    try
+    {
+        RecognitionClient connection(_socketPath.c_str());
+        while (received < _requestsPerClient)
+        {
+            while (sent < _requestsPerClient && sent - received < _pipelineDepth)
+            {
+                // Clients go over the frames in different orders, so the same frame is often in flight twice.
+                int frameIndex = (client * 7 + sent) % (int) _frames.size();
+                const Frame &frame = _frames[frameIndex];
+                auto kind = (LoadRequest) (sent % 3);
+                uint32_t id;
+                if (kind == LoadRequest::RENDER)
+                {
+                    id = connection.sendRender(frame.image.getHeight(), frame.image.getWidth(), 0,
+                                               frame.shapes, frame.shapesSize);
+                }
+                else
+                {
+                    id = connection.sendRecognize(frame.image, kind == LoadRequest::RECOGNIZE_RECTANGLES_AND_TRIANGLES);
+                }
+                pending[id] = PendingRequest{frameIndex, kind, std::chrono::steady_clock::now()};
+                sent++;
+            }
+
+            RecognitionClient::Response response = connection.receive();
+            const PendingRequest &request = pending.at(response.getId());
+            auto latency = std::chrono::steady_clock::now() - request.sendTime;
+            report.latency.record((uint64_t) std::chrono::duration_cast<std::chrono::microseconds>(latency).count());
+            report.requests++;
+            received++;
+
+            bool isCorrect = response.getStatus() == ResponseStatus::OK;
+            if (isCorrect && request.kind == LoadRequest::RENDER)
+            {
+                isCorrect = response.getImage() == _frames[request.frame].image;
+            }
+            else if (isCorrect)
+            {
+                int arrSize;
+                Shape **shapes = response.getShapes(arrSize);
+                isCorrect = arrSize == _frames[request.frame].shapesSize;
+                Shape::freeShapesArray(shapes, arrSize);
+            }
+            if (!isCorrect)
+            {
+                report.failedRequests++;
+            }
+        }
+    }
+    catch (const std::exception &)
+    {
+        // Whatever wasn't answered is lost.
+        report.requests += _requestsPerClient - received;
+        report.failedRequests += _requestsPerClient - received;
+    }
+}
+
+/**
+ * Creates a load generator with random test frames.
+ *
+ * @param socketPath The path of the server's socket file.
+ * @param clientCount The number of concurrent clients.
+ * @param requestsPerClient The number of requests each client sends.
+ * @param frameSize The frames height and width in pixels.
+ * @param pipelineDepth The number of requests each client keeps in flight.
+ * @param frameCount The number of distinct frames (repeats let the server's caches hit).
+ */
+LoadGenerator::LoadGenerator(const char *socketPath, int clientCount, int requestsPerClient, int frameSize,
+                             int pipelineDepth, int frameCount) : _socketPath(socketPath), _clientCount(clientCount),
+                                                                  _requestsPerClient(requestsPerClient),
+                                                                  _pipelineDepth(std::max(1, pipelineDepth))
+{
+    // Each frame has rectangles in some of the cells of a grid, apart from each other so they are recognized back.
+    std::mt19937 random(42);
+    for (int i = 0; i < std::max(1, frameCount); ++i)
+    {
+        Image image(frameSize, frameSize);
+        for (int cellY = 0; cellY + CELL_SIZE <= frameSize; cellY += CELL_SIZE)
+        {
+            for (int cellX = 0; cellX + CELL_SIZE <= frameSize; cellX += CELL_SIZE)
+            {
+                if (random() % 4 == 0)
+                {
+                    continue;
+                }
+                int left = cellX + (int) (random() % (CELL_SIZE / 2));
+                int top = cellY + (int) (random() % (CELL_SIZE / 2));
+                int right = left + 1 + (int) (random() % (CELL_SIZE / 2 - 2));
+                int bottom = top + 1 + (int) (random() % (CELL_SIZE / 2 - 2));
+                Rectangle(Vector2(left, top), Vector2(right, bottom), (unsigned char) (1 + random() % 255)).draw(image);
+            }
+        }
+        int shapesSize;
+        Shape **shapes = Shape::getRectanglesFromImage(image, shapesSize);
+        _frames.push_back(Frame{std::move(image), shapes, shapesSize});
+    }
+}
+
+/**
+ * Frees the test frames' shapes.
+ */
+LoadGenerator::~LoadGenerator()
+{
+    for (Frame &frame : _frames)
+    {
+        Shape::freeShapesArray(frame.shapes, frame.shapesSize);
+    }
+}
+
+/**
+ * Runs all clients to completion and returns their combined results.
+ *
+ * @return The combined results of all clients.
+ */
+LoadReport LoadGenerator::run() const
+{
+    std::vector<LoadReport> reports(_clientCount, LoadReport());
+    std::vector<std::thread> clients;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < _clientCount; ++i)
+    {
+        clients.emplace_back(&LoadGenerator::_runClient, this, i, std::ref(reports[i]));
+    }
+    for (std::thread &client : clients)
+    {
+        client.join();
+    }
+
+    LoadReport total = LoadReport();
+    total.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    for (const LoadReport &report : reports)
+    {
+        total.requests += report.requests;
+        total.failedRequests += report.failedRequests;
+        total.latency.merge(report.latency);
+    }
+    return total;
+}
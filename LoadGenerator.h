@@ -0,0 +1,86 @@
+//
+// Created by jacko on 30/10/2020.
+//
+
+#ifndef POLYTEST_LOADGENERATOR_H
+#define POLYTEST_LOADGENERATOR_H
+
+
+#include <string>
+#include <vector>
+#include "RecognitionClient.h"
+
+
+/**
+ * Results of a LoadGenerator run.
+ */
+struct LoadReport
+{
+    uint64_t requests;
+    uint64_t failedRequests; // Failed by the server, answered wrongly or lost with a broken connection.
+    double seconds;
+    LatencyHistogram latency; // Round trip, as the clients saw it.
+
+    /**
+     * Returns the average number of answered requests per second.
+     *
+     * @return The average number of answered requests per second.
+     */
+    double getThroughput() const;
+};
+
+/**
+ * Load generator for a RecognitionServer: concurrent clients, each on its own connection, send a mix of
+ * recognition and render requests of a fixed set of frames, keeping several requests in flight, and check
+ * every answer against the result of doing the same locally.
+ */
+class LoadGenerator
+{
+    // A test frame and its shapes, as recognized locally.
+    struct Frame
+    {
+        Image image;
+        Shape **shapes;
+        int shapesSize;
+    };
+
+    std::string _socketPath;
+    int _clientCount, _requestsPerClient, _pipelineDepth;
+    std::vector<Frame> _frames;
+
+    // sends the given client's requests and checks the answers, adding the results to the given report.
+    void _runClient(int client, LoadReport &report) const;
+
+public:
+    /**
+     * Creates a load generator with random test frames.
+     *
+     * @param socketPath The path of the server's socket file.
+     * @param clientCount The number of concurrent clients.
+     * @param requestsPerClient The number of requests each client sends.
+     * @param frameSize The frames height and width in pixels.
+     * @param pipelineDepth The number of requests each client keeps in flight.
+     * @param frameCount The number of distinct frames (repeats let the server's caches hit).
+     */
+    LoadGenerator(const char *socketPath, int clientCount, int requestsPerClient, int frameSize = 256,
+                  int pipelineDepth = 4, int frameCount = 16);
+
+    LoadGenerator(const LoadGenerator &) = delete;
+
+    LoadGenerator &operator=(const LoadGenerator &) = delete;
+
+    /**
+     * Frees the test frames' shapes.
+     */
+    ~LoadGenerator();
+
+    /**
+     * Runs all clients to completion and returns their combined results.
+     *
+     * @return The combined results of all clients.
+     */
+    LoadReport run() const;
+};
+
+
+#endif //POLYTEST_LOADGENERATOR_H
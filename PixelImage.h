@@ -0,0 +1,242 @@
+//
+// Created by jacko on 30/10/2020.
+//
+
+#ifndef POLYTEST_PIXELIMAGE_H
+#define POLYTEST_PIXELIMAGE_H
+
+
+#include <vector>
+#include "Image.h"
+#include "PixelKernels.h"
+
+
+/**
+ * 2d image of any supported pixel type (uint16_t grayscale, Rgba8; unsigned char is the Image specialization).
+ * Pixels are stored row by row, and the pixel type's kernels (see PixelKernels) are picked at compile time,
+ * so every pixel type gets the same word-at-a-time fills, compares and scans.
+ * Pixels that are all bits zero are background.
+ */
+template<class Pixel>
+class PixelImage
+{
+    typedef PixelKernels<Pixel> Kernels;
+
+    int _height, _width;
+    std::vector<Pixel> _pixels;
+
+public:
+    /**
+     * Creates a new image of the given parameters.
+     *
+     * @param height The image height in pixels.
+     * @param width The image width in pixels.
+     * @param color The color to set all pixels to - defaults to background.
+     */
+    PixelImage(int height, int width, const Pixel &color = Pixel()) : _height(height), _width(width),
+                                                                       _pixels((size_t) height * width)
+    {
+        Kernels::fill(_pixels.data(), (int) _pixels.size(), color);
+    }
+
+    /**
+     * Returns the image's width.
+     *
+     * @return The image's width.
+     */
+    int getWidth() const
+    {
+        return _width;
+    }
+
+    /**
+     * Returns the image's height.
+     *
+     * @return The image's height.
+     */
+    int getHeight() const
+    {
+        return _height;
+    }
+
+    /**
+     * Draws a pixel of the given color at the given location.
+     * Throws exception if location is out of image bounds.
+     *
+     * @param location 2d vector representing image location.
+     * @param color The color to draw.
+     */
+    void drawPixel(const Vector2 &location, const Pixel &color)
+    {
+        if (!isPixelValid(location))
+        {
+            throw ImageDimException();
+        }
+        _pixels[(size_t) location.y * _width + location.x] = color;
+    }
+
+    /**
+     * Draws a horizontal line of the given color from the start location to the given x coordinate.
+     * Throws exception if the line is out of image bounds.
+     *
+     * @param start 2d vector representing start location.
+     * @param xFinish The last x coordinate of the line.
+     * @param color The color to draw.
+     */
+    void drawHorizontalLine(const Vector2 &start, int xFinish, const Pixel &color)
+    {
+        if (start.x < 0 || start.y < 0 || start.y >= _height || xFinish >= _width || start.x > xFinish)
+        {
+            throw ImageDimException();
+        }
+        Kernels::fill(&_pixels[(size_t) start.y * _width + start.x], xFinish - start.x + 1, color);
+    }
+
+    /**
+     * Return true if the given pixel is in the image bounds. Otherwise, returns false.
+     *
+     * @param x The x coordinate of the pixel.
+     * @param y The y coordinate of the pixel.
+     * @return true if the given pixel is in the image bounds. Otherwise, returns false.
+     */
+    bool isPixelValid(int x, int y) const
+    {
+        return x >= 0 && y >= 0 && x < _width && y < _height;
+    }
+
+    /**
+     * Return true if the given pixel is in the image bounds. Otherwise, returns false.
+     *
+     * @param location 2d vector representing image location.
+     * @return true if the given pixel is in the image bounds. Otherwise, returns false.
+     */
+    bool isPixelValid(const Vector2 &location) const
+    {
+        return isPixelValid(location.x, location.y);
+    }
+
+    /**
+     * Returns the value of the given pixel.
+     * Throws exception if location is out of image bounds.
+     *
+     * @param x The x coordinate of the pixel.
+     * @param y The y coordinate of the pixel.
+     * @return The value of the given pixel.
+     */
+    Pixel getPixel(int x, int y) const
+    {
+        if (!isPixelValid(x, y))
+        {
+            throw ImageDimException();
+        }
+        return _pixels[(size_t) y * _width + x];
+    }
+
+    /**
+     * Returns the value of the given pixel.
+     * Throws exception if location is out of image bounds.
+     *
+     * @param location 2d vector representing image location.
+     * @return The value of the given pixel.
+     */
+    Pixel getPixel(const Vector2 &location) const
+    {
+        return getPixel(location.x, location.y);
+    }
+
+    /**
+     * Returns a pointer to the pixels of the given row, starting at the given location (the rest of the row is
+     * available).
+     * Throws exception if location is out of image bounds.
+     *
+     * @param x The x coordinate of the first pixel.
+     * @param y The y coordinate of the row.
+     * @param length This will be set to the number of contiguous pixels available from the returned pointer.
+     * @return A pointer to the pixels of the given row, starting at the given location.
+     */
+    const Pixel *getRowPixels(int x, int y, int &length) const
+    {
+        if (!isPixelValid(x, y))
+        {
+            throw ImageDimException();
+        }
+        length = _width - x;
+        return &_pixels[(size_t) y * _width + x];
+    }
+
+    /**
+     * Returns the x coordinate of the first non-background pixel in row y at or after x,
+     * or the image width if there is no such pixel.
+     * Throws exception if location is out of image bounds (x may be equal to the width).
+     *
+     * @param x The x coordinate to start from.
+     * @param y The y coordinate of the row.
+     * @return The x coordinate of the first non-background pixel in row y at or after x, or the image width.
+     */
+    int findNextNonBackgroundPixel(int x, int y) const
+    {
+        if (x < 0 || x > _width || y < 0 || y >= _height)
+        {
+            throw ImageDimException();
+        }
+        return x + Kernels::findNonBackground(&_pixels[(size_t) y * _width + x], _width - x);
+    }
+
+    /**
+     * Returns the number of pixels that differ between this image and the given image of the same size.
+     * Throws exception if the images are not of the same size.
+     *
+     * @param otherImage The image to compare with.
+     * @return The number of differing pixels.
+     */
+    long countDifferentPixels(const PixelImage &otherImage) const
+    {
+        if (_width != otherImage._width || _height != otherImage._height)
+        {
+            throw ImageDimException();
+        }
+        long count = 0;
+        for (int y = 0; y < _height; ++y)
+        {
+            size_t row = (size_t) y * _width;
+            count += Kernels::countDifferent(&_pixels[row], &otherImage._pixels[row], _width);
+        }
+        return count;
+    }
+
+    /**
+     * Returns true if the given image has the same size and pixels as this one. Otherwise, returns false.
+     *
+     * @param otherImage The image to compare with.
+     * @return true if the given image has the same size and pixels as this one. Otherwise, returns false.
+     */
+    bool operator==(const PixelImage &otherImage) const
+    {
+        return _width == otherImage._width && _height == otherImage._height &&
+               Kernels::equal(_pixels.data(), otherImage._pixels.data(), (int) _pixels.size());
+    }
+
+    /**
+     * Returns true if the given image differs from this one in size or pixels. Otherwise, returns false.
+     *
+     * @param otherImage The image to compare with.
+     * @return true if the given image differs from this one in size or pixels. Otherwise, returns false.
+     */
+    bool operator!=(const PixelImage &otherImage) const
+    {
+        return !(*this == otherImage);
+    }
+};
+
+/**
+ * 2d 16-bit grayscale image (e.g. a depth map).
+ */
+typedef PixelImage<uint16_t> Gray16Image;
+
+/**
+ * 2d RGBA image.
+ */
+typedef PixelImage<Rgba8> RgbaImage;
+
+
+#endif //POLYTEST_PIXELIMAGE_H
@@ -0,0 +1,386 @@
+//
+// Created by jacko on 30/10/2020.
+//
+
+#ifndef POLYTEST_PIXELKERNELS_H
+#define POLYTEST_PIXELKERNELS_H
+
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+
+/**
+ * 8 bits per channel color pixel.
+ */
+struct Rgba8
+{
+    unsigned char r, g, b, a;
+};
+
+/**
+ * Returns true if both pixels have the same channels. Otherwise, returns false.
+ *
+ * @param pixel The first pixel.
+ * @param otherPixel The second pixel.
+ * @return true if both pixels have the same channels. Otherwise, returns false.
+ */
+inline bool operator==(const Rgba8 &pixel, const Rgba8 &otherPixel)
+{
+    return pixel.r == otherPixel.r && pixel.g == otherPixel.g && pixel.b == otherPixel.b && pixel.a == otherPixel.a;
+}
+
+/**
+ * Returns true if the pixels differ in any channel. Otherwise, returns false.
+ *
+ * @param pixel The first pixel.
+ * @param otherPixel The second pixel.
+ * @return true if the pixels differ in any channel. Otherwise, returns false.
+ */
+inline bool operator!=(const Rgba8 &pixel, const Rgba8 &otherPixel)
+{
+    return !(pixel == otherPixel);
+}
+
+/**
+ * Kernels over runs of pixels that are equal exactly when their bytes are (1, 2 or 4 bytes each).
+ * They go over 8 bytes at a time, however many pixels that is.
+ */
+template<class Pixel>
+struct WordPixelKernels
+{
+    /**
+     * Number of pixels in an 8 bytes word.
+     */
+    static const int PIXELS_PER_WORD = 8 / sizeof(Pixel);
+
+    /**
+     * Returns an 8 bytes word of copies of the given pixel.
+     *
+     * @param pixel The pixel to copy.
+     * @return An 8 bytes word of copies of the given pixel.
+     */
+    static uint64_t broadcast(const Pixel &pixel)
+    {
+        unsigned char bytes[8];
+        for (int i = 0; i < PIXELS_PER_WORD; ++i)
+        {
+            std::memcpy(bytes + i * sizeof(Pixel), &pixel, sizeof(Pixel));
+        }
+        uint64_t word;
+        std::memcpy(&word, bytes, sizeof(word));
+        return word;
+    }
+
+    /**
+     * Sets the given pixels to the given value.
+     *
+     * @param pixels The pixels to set.
+     * @param length The number of pixels.
+     * @param value The value to set.
+     */
+    static void fill(Pixel *pixels, int length, const Pixel &value)
+    {
+        uint64_t word = broadcast(value);
+        int i = 0;
+        for (; i + PIXELS_PER_WORD <= length; i += PIXELS_PER_WORD)
+        {
+            std::memcpy(pixels + i, &word, sizeof(word));
+        }
+        std::fill(pixels + i, pixels + length, value);
+    }
+
+    /**
+     * Returns true if the two given runs of pixels are equal. Otherwise, returns false.
+     *
+     * @param pixels The first run of pixels.
+     * @param otherPixels The second run of pixels.
+     * @param length The number of pixels in each run.
+     * @return true if the two given runs of pixels are equal. Otherwise, returns false.
+     */
+    static bool equal(const Pixel *pixels, const Pixel *otherPixels, int length)
+    {
+        return length == 0 || std::memcmp(pixels, otherPixels, length * sizeof(Pixel)) == 0;
+    }
+
+    /**
+     * Returns the number of pixels that differ between the two given runs of pixels.
+     *
+     * @param pixels The first run of pixels.
+     * @param otherPixels The second run of pixels.
+     * @param length The number of pixels in each run.
+     * @return The number of pixels that differ between the two given runs of pixels.
+     */
+    static int countDifferent(const Pixel *pixels, const Pixel *otherPixels, int length)
+    {
+        int count = 0;
+        for (int i = 0; i < length; ++i)
+        {
+            count += pixels[i] != otherPixels[i];
+        }
+        return count;
+    }
+
+    /**
+     * Returns the index of the first of the given pixels that isn't of the given value, or length if there is none.
+     *
+     * @param pixels The pixels to look in.
+     * @param length The number of pixels.
+     * @param value The value to look past.
+     * @return The index of the first pixel that isn't of the given value, or length.
+     */
+    static int findNotEqual(const Pixel *pixels, int length, const Pixel &value)
+    {
+        uint64_t pattern = broadcast(value);
+        int i = 0;
+        // Check a word at a time until a word with another pixel shows up.
+        for (; i + PIXELS_PER_WORD <= length; i += PIXELS_PER_WORD)
+        {
+            uint64_t word;
+            std::memcpy(&word, pixels + i, sizeof(word));
+            if (word != pattern)
+            {
+                break;
+            }
+        }
+        for (; i < length; ++i)
+        {
+            if (pixels[i] != value)
+            {
+                return i;
+            }
+        }
+        return length;
+    }
+
+    /**
+     * Returns the index of the first of the given pixels that isn't background (all bits zero), or length if there
+     * is none.
+     *
+     * @param pixels The pixels to look in.
+     * @param length The number of pixels.
+     * @return The index of the first non-background pixel, or length.
+     */
+    static int findNonBackground(const Pixel *pixels, int length)
+    {
+        return findNotEqual(pixels, length, Pixel());
+    }
+};
+
+/**
+ * Fill, compare and scan kernels of a pixel type, chosen at compile time.
+ * There is a specialization for each supported pixel type.
+ */
+template<class Pixel>
+struct PixelKernels;
+
+/**
+ * Kernels of 8-bit grayscale pixels.
+ */
+template<>
+struct PixelKernels<unsigned char> : WordPixelKernels<unsigned char>
+{
+    /**
+     * Sets the given pixels to the given value.
+     *
+     * @param pixels The pixels to set.
+     * @param length The number of pixels.
+     * @param value The value to set.
+     */
+    static void fill(unsigned char *pixels, int length, unsigned char value)
+    {
+        if (length > 0)
+        {
+            std::memset(pixels, value, length);
+        }
+    }
+
+    /**
+     * Returns the number of pixels that differ between the two given runs of pixels.
+     *
+     * @param pixels The first run of pixels.
+     * @param otherPixels The second run of pixels.
+     * @param length The number of pixels in each run.
+     * @return The number of pixels that differ between the two given runs of pixels.
+     */
+    static int countDifferent(const unsigned char *pixels, const unsigned char *otherPixels, int length)
+    {
+        static const uint64_t LOW_BITS = 0x7F7F7F7F7F7F7F7FULL;
+        static const uint64_t HIGH_BITS = 0x8080808080808080ULL;
+
+        int count = 0;
+        int i = 0;
+        // Compare 8 pixels at a time: the high bit of every differing byte is set, then counted.
+        for (; i + 8 <= length; i += 8)
+        {
+            uint64_t word, otherWord;
+            std::memcpy(&word, pixels + i, sizeof(word));
+            std::memcpy(&otherWord, otherPixels + i, sizeof(otherWord));
+            uint64_t difference = word ^ otherWord;
+            uint64_t highBits = (((difference & LOW_BITS) + LOW_BITS) | difference) & HIGH_BITS;
+#if defined(__GNUC__)
+            count += __builtin_popcountll(highBits);
+#else
+            for (; highBits != 0; highBits &= highBits - 1)
+            {
+                count++;
+            }
+#endif
+        }
+        for (; i < length; ++i)
+        {
+            count += pixels[i] != otherPixels[i];
+        }
+        return count;
+    }
+
+    /**
+     * Adds the given value to each of the given pixels, saturating at 255.
+     *
+     * @param pixels The pixels to blend into.
+     * @param length The number of pixels.
+     * @param value The value to add.
+     */
+    static void blendAdd(unsigned char *pixels, int length, unsigned char value)
+    {
+        static const uint64_t LOW_BITS = 0x7F7F7F7F7F7F7F7FULL;
+        static const uint64_t HIGH_BITS = 0x8080808080808080ULL;
+
+        uint64_t pattern = broadcast(value);
+        int i = 0;
+        // Add 8 pixels at a time: the low 7 bits of each byte can't carry into the next byte, then the carries out of
+        // the high bits turn their bytes to 255.
+        for (; i + 8 <= length; i += 8)
+        {
+            uint64_t word;
+            std::memcpy(&word, pixels + i, sizeof(word));
+            uint64_t lowSum = (word & LOW_BITS) + (pattern & LOW_BITS);
+            uint64_t sum = lowSum ^ ((word ^ pattern) & HIGH_BITS);
+            uint64_t carries = ((word & pattern) | ((word ^ pattern) & lowSum)) & HIGH_BITS;
+            word = sum | ((carries >> 7) * 0xFF);
+            std::memcpy(pixels + i, &word, sizeof(word));
+        }
+        for (; i < length; ++i)
+        {
+            pixels[i] = (unsigned char) std::min(255, pixels[i] + value);
+        }
+    }
+
+    /**
+     * Sets each of the given pixels to the larger of itself and the given value.
+     *
+     * @param pixels The pixels to blend into.
+     * @param length The number of pixels.
+     * @param value The value to blend.
+     */
+    static void blendMax(unsigned char *pixels, int length, unsigned char value)
+    {
+        static const uint64_t LOW_BITS = 0x7F7F7F7F7F7F7F7FULL;
+        static const uint64_t HIGH_BITS = 0x8080808080808080ULL;
+
+        uint64_t pattern = broadcast(value);
+        int i = 0;
+        // Subtract the value from 8 pixels at a time: the bytes that borrow are the smaller ones, and take the value.
+        for (; i + 8 <= length; i += 8)
+        {
+            uint64_t word;
+            std::memcpy(&word, pixels + i, sizeof(word));
+            uint64_t difference = ((word | HIGH_BITS) - (pattern & LOW_BITS)) ^ ((word ^ ~pattern) & HIGH_BITS);
+            uint64_t borrows = ((~word & pattern) | (~(word ^ pattern) & difference)) & HIGH_BITS;
+            uint64_t smaller = (borrows >> 7) * 0xFF;
+            word = (pattern & smaller) | (word & ~smaller);
+            std::memcpy(pixels + i, &word, sizeof(word));
+        }
+        for (; i < length; ++i)
+        {
+            pixels[i] = std::max(pixels[i], value);
+        }
+    }
+
+    /**
+     * Blends the given value over each of the given pixels with the given opacity, in 8-bit fixed point:
+     * pixel + (value - pixel) * alpha / 255, off by at most 1. Opacity 0 keeps the pixels and 255 sets them to the
+     * value.
+     *
+     * @param pixels The pixels to blend into.
+     * @param length The number of pixels.
+     * @param value The value to blend.
+     * @param alpha The opacity of the value (0 to 255).
+     */
+    static void blendAlpha(unsigned char *pixels, int length, unsigned char value, unsigned char alpha)
+    {
+        static const uint64_t EVEN_BYTES = 0x00FF00FF00FF00FFULL;
+
+        // Weights out of 256 (alpha 255 is weight 256), so the blend is a shift, and the two weights add up to 256.
+        uint32_t weight = alpha + (alpha >> 7);
+        uint32_t keptWeight = 256 - weight;
+        uint32_t addend = value * weight + 128;
+        uint64_t addends = addend * 0x0001000100010001ULL;
+        int i = 0;
+        // Blend 8 pixels at a time, as 4 even and 4 odd ones in 16-bit lanes (the lanes sum to at most 255 * 256).
+        for (; i + 8 <= length; i += 8)
+        {
+            uint64_t word;
+            std::memcpy(&word, pixels + i, sizeof(word));
+            uint64_t even = (((word & EVEN_BYTES) * keptWeight + addends) >> 8) & EVEN_BYTES;
+            uint64_t odd = (((word >> 8) & EVEN_BYTES) * keptWeight + addends) & ~EVEN_BYTES;
+            word = even | odd;
+            std::memcpy(pixels + i, &word, sizeof(word));
+        }
+        for (; i < length; ++i)
+        {
+            pixels[i] = (unsigned char) ((pixels[i] * keptWeight + addend) >> 8);
+        }
+    }
+
+    /**
+     * Returns the 8-bit gray level of the given pixel.
+     *
+     * @param pixel The pixel.
+     * @return The 8-bit gray level of the given pixel.
+     */
+    static unsigned char toGray(unsigned char pixel)
+    {
+        return pixel;
+    }
+};
+
+/**
+ * Kernels of 16-bit grayscale pixels (e.g. depth maps).
+ */
+template<>
+struct PixelKernels<uint16_t> : WordPixelKernels<uint16_t>
+{
+    /**
+     * Returns the 8-bit gray level of the given pixel (its high byte).
+     *
+     * @param pixel The pixel.
+     * @return The 8-bit gray level of the given pixel.
+     */
+    static unsigned char toGray(uint16_t pixel)
+    {
+        return (unsigned char) (pixel >> 8);
+    }
+};
+
+/**
+ * Kernels of RGBA pixels.
+ */
+template<>
+struct PixelKernels<Rgba8> : WordPixelKernels<Rgba8>
+{
+    /**
+     * Returns the 8-bit gray level (luma) of the given pixel, ignoring its alpha.
+     *
+     * @param pixel The pixel.
+     * @return The 8-bit gray level of the given pixel.
+     */
+    static unsigned char toGray(const Rgba8 &pixel)
+    {
+        return (unsigned char) ((77 * pixel.r + 150 * pixel.g + 29 * pixel.b) >> 8);
+    }
+};
+
+
+#endif //POLYTEST_PIXELKERNELS_H
@@ -0,0 +1,148 @@
+#include "RecognitionCache.h"
+#include "ShapeList.h"
+
+
+// Approximate bookkeeping cost of a cached result on top of its shape list.
+static const size_t ENTRY_OVERHEAD = 64;
+
+/**
+ * Creates an empty cache.
+ *
+ * @param memoryBudget The maximal number of bytes the cached results may take.
+ */
+RecognitionCache::RecognitionCache(size_t memoryBudget) : _memoryBudget(memoryBudget), _memoryUsage(0), _hits(0),
+                                                          _misses(0)
+{}
+
+// Returns the cached result for the given image and recognizer, recognizing (and caching) it on a miss.
+Shape **RecognitionCache::_recognize(const Image &img, Recognizer recognizer, int &arrSize)
+{
+    // The image hash already covers its size, so only the recognizer has to be mixed in.
+    uint64_t key = img.getHash() ^ ((uint64_t) recognizer * 0x9E3779B97F4A7C15ULL);
+
+    auto found = _index.find(key);
+    if (found != _index.end())
+    {
+        _hits++;
+        _entries.splice(_entries.begin(), _entries, found->second);
+        const std::vector<unsigned char> &shapeList = found->second->shapeList;
+        return ShapeListView(shapeList.data(), shapeList.size()).load(arrSize);
+    }
+
+    _misses++;
+    Shape **shapes = recognizer == Recognizer::RECTANGLES ? Shape::getRectanglesFromImage(img, arrSize)
+                                                          : Shape::getRectanglesAndTrianglesFromImage(img, arrSize);
+
+    Entry entry;
+    entry.key = key;
+    ShapeListView::serialize(shapes, arrSize, entry.shapeList);
+    size_t entrySize = entry.shapeList.size() + ENTRY_OVERHEAD;
+    if (entrySize <= _memoryBudget)
+    {
+        _entries.push_front(std::move(entry));
+        _index[key] = _entries.begin();
+        _memoryUsage += entrySize;
+        _evict();
+    }
+    return shapes;
+}
+
+// Evicts least recently used results until the memory usage fits the budget.
+void RecognitionCache::_evict()
+{
+    while (_memoryUsage > _memoryBudget)
+    {
+        Entry &last = _entries.back();
+        _memoryUsage -= last.shapeList.size() + ENTRY_OVERHEAD;
+        _index.erase(last.key);
+        _entries.pop_back();
+    }
+}
+
+/**
+ * Same as Shape::getRectanglesFromImage, but returns the cached result if the same image was scanned before.
+ * The output array (and all pointers in it) needs to be freed (either manually or with freeShapesArray).
+ *
+ * @param img The image to scan in.
+ * @param arrSize This will be set to the size of the output array.
+ * @return an array of pointers to Shapes that contains all rectangles that are parallel to the x and y axis.
+ */
+Shape **RecognitionCache::getRectanglesFromImage(const Image &img, int &arrSize)
+{
+    return _recognize(img, Recognizer::RECTANGLES, arrSize);
+}
+
+/**
+ * Same as Shape::getRectanglesAndTrianglesFromImage, but returns the cached result if the same image was
+ * scanned before.
+ * The output array (and all pointers in it) needs to be freed (either manually or with freeShapesArray).
+ *
+ * @param img The image to scan in.
+ * @param arrSize This will be set to the size of the output array.
+ * @return an array of pointers to Shapes that contains all rectangles and triangles.
+ */
+Shape **RecognitionCache::getRectanglesAndTrianglesFromImage(const Image &img, int &arrSize)
+{
+    return _recognize(img, Recognizer::RECTANGLES_AND_TRIANGLES, arrSize);
+}
+
+/**
+ * Returns the number of lookups that were answered from the cache.
+ *
+ * @return The number of lookups that were answered from the cache.
+ */
+size_t RecognitionCache::getHits() const
+{
+    return _hits;
+}
+
+/**
+ * Returns the number of lookups that needed a full recognition.
+ *
+ * @return The number of lookups that needed a full recognition.
+ */
+size_t RecognitionCache::getMisses() const
+{
+    return _misses;
+}
+
+/**
+ * Returns the fraction of lookups that were answered from the cache (0 if there were none).
+ *
+ * @return The fraction of lookups that were answered from the cache.
+ */
+double RecognitionCache::getHitRate() const
+{
+    size_t lookups = _hits + _misses;
+    return lookups == 0 ? 0 : (double) _hits / lookups;
+}
+
+/**
+ * Returns the number of bytes the cached results take.
+ *
+ * @return The number of bytes the cached results take.
+ */
+size_t RecognitionCache::getMemoryUsage() const
+{
+    return _memoryUsage;
+}
+
+/**
+ * Returns the number of cached results.
+ *
+ * @return The number of cached results.
+ */
+size_t RecognitionCache::getSize() const
+{
+    return _entries.size();
+}
+
+/**
+ * Removes all cached results (statistics are kept).
+ */
+void RecognitionCache::clear()
+{
+    _entries.clear();
+    _index.clear();
+    _memoryUsage = 0;
+}
@@ -0,0 +1,121 @@
+//
+// Created by jacko on 30/10/2020.
+//
+
+#ifndef POLYTEST_RECOGNITIONCACHE_H
+#define POLYTEST_RECOGNITIONCACHE_H
+
+
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+#include <vector>
+#include "Shapes.h"
+
+
+/**
+ * Memoizes recognition results by the content hash of the scanned image.
+ * Results are kept as serialized shape lists and the least recently used ones are evicted
+ * once the configured memory budget is exceeded.
+ * Not thread-safe.
+ */
+class RecognitionCache
+{
+    // Kind of recognition a result was produced by.
+    enum class Recognizer : unsigned char
+    {
+        RECTANGLES,
+        RECTANGLES_AND_TRIANGLES
+    };
+
+    // A cached recognition result.
+    struct Entry
+    {
+        uint64_t key;
+        std::vector<unsigned char> shapeList;
+    };
+
+    size_t _memoryBudget;
+    size_t _memoryUsage;
+    size_t _hits, _misses;
+    std::list<Entry> _entries; // Most recently used first.
+    std::unordered_map<uint64_t, std::list<Entry>::iterator> _index;
+
+    // Returns the cached result for the given image and recognizer, recognizing (and caching) it on a miss.
+    Shape **_recognize(const Image &img, Recognizer recognizer, int &arrSize);
+
+    // Evicts least recently used results until the memory usage fits the budget.
+    void _evict();
+
+public:
+    /**
+     * Creates an empty cache.
+     *
+     * @param memoryBudget The maximal number of bytes the cached results may take.
+     */
+    explicit RecognitionCache(size_t memoryBudget);
+
+    /**
+     * Same as Shape::getRectanglesFromImage, but returns the cached result if the same image was scanned before.
+     * The output array (and all pointers in it) needs to be freed (either manually or with freeShapesArray).
+     *
+     * @param img The image to scan in.
+     * @param arrSize This will be set to the size of the output array.
+     * @return an array of pointers to Shapes that contains all rectangles that are parallel to the x and y axis.
+     */
+    Shape **getRectanglesFromImage(const Image &img, int &arrSize);
+
+    /**
+     * Same as Shape::getRectanglesAndTrianglesFromImage, but returns the cached result if the same image was
+     * scanned before.
+     * The output array (and all pointers in it) needs to be freed (either manually or with freeShapesArray).
+     *
+     * @param img The image to scan in.
+     * @param arrSize This will be set to the size of the output array.
+     * @return an array of pointers to Shapes that contains all rectangles and triangles.
+     */
+    Shape **getRectanglesAndTrianglesFromImage(const Image &img, int &arrSize);
+
+    /**
+     * Returns the number of lookups that were answered from the cache.
+     *
+     * @return The number of lookups that were answered from the cache.
+     */
+    size_t getHits() const;
+
+    /**
+     * Returns the number of lookups that needed a full recognition.
+     *
+     * @return The number of lookups that needed a full recognition.
+     */
+    size_t getMisses() const;
+
+    /**
+     * Returns the fraction of lookups that were answered from the cache (0 if there were none).
+     *
+     * @return The fraction of lookups that were answered from the cache.
+     */
+    double getHitRate() const;
+
+    /**
+     * Returns the number of bytes the cached results take.
+     *
+     * @return The number of bytes the cached results take.
+     */
+    size_t getMemoryUsage() const;
+
+    /**
+     * Returns the number of cached results.
+     *
+     * @return The number of cached results.
+     */
+    size_t getSize() const;
+
+    /**
+     * Removes all cached results (statistics are kept).
+     */
+    void clear();
+};
+
+
+#endif //POLYTEST_RECOGNITIONCACHE_H
@@ -0,0 +1,326 @@
+#include <algorithm>
+#include <cerrno>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "RecognitionClient.h"
+#include "ShapeList.h"
+
+
+// Reads a little-endian 32 bit signed integer.
+static int32_t readInt32(const unsigned char *data)
+{
+    return (int32_t) ((uint32_t) data[0] | ((uint32_t) data[1] << 8) | ((uint32_t) data[2] << 16) |
+                      ((uint32_t) data[3] << 24));
+}
+
+// Appends a little-endian 32 bit signed integer.
+static void writeInt32(std::vector<unsigned char> &buffer, int32_t value)
+{
+    uint32_t bits = (uint32_t) value;
+    buffer.push_back((unsigned char) bits);
+    buffer.push_back((unsigned char) (bits >> 8));
+    buffer.push_back((unsigned char) (bits >> 16));
+    buffer.push_back((unsigned char) (bits >> 24));
+}
+
+
+// throws RequestException if the request failed.
+void RecognitionClient::Response::_checkStatus() const
+{
+    if (_status != ResponseStatus::OK)
+    {
+        throw RequestException();
+    }
+}
+
+/**
+ * Creates a response with the given id, status and payload.
+ *
+ * @param id The id of the request.
+ * @param status The status of the response.
+ * @param payload The payload of the response.
+ */
+RecognitionClient::Response::Response(uint32_t id, ResponseStatus status, std::vector<unsigned char> payload) :
+        _id(id), _status(status), _payload(std::make_shared<std::vector<unsigned char>>(std::move(payload)))
+{}
+
+/**
+ * Returns the id of the request this response answers.
+ *
+ * @return The id of the request this response answers.
+ */
+uint32_t RecognitionClient::Response::getId() const
+{
+    return _id;
+}
+
+/**
+ * Returns the status of the response.
+ *
+ * @return The status of the response.
+ */
+ResponseStatus RecognitionClient::Response::getStatus() const
+{
+    return _status;
+}
+
+/**
+ * Returns the shapes of a recognition response.
+ * Throws RequestException if the request failed, and ShapeFormatException if the payload is malformed.
+ * The output array (and all pointers in it) needs to be freed (either manually or with freeShapesArray).
+ *
+ * @param arrSize The output array size.
+ * @return An array of shape pointers.
+ */
+Shape **RecognitionClient::Response::getShapes(int &arrSize) const
+{
+    _checkStatus();
+    return ShapeListView(_payload->data(), _payload->size()).load(arrSize);
+}
+
+/**
+ * Returns the image of a render response (its pixels stay in the response's buffer, without a copy).
+ * Throws RequestException if the request failed, and ProtocolException if the payload is malformed.
+ *
+ * @return The image of a render response.
+ */
+Image RecognitionClient::Response::getImage() const
+{
+    _checkStatus();
+    if (_payload->size() < 8)
+    {
+        throw ProtocolException();
+    }
+    int height = readInt32(_payload->data());
+    int width = readInt32(_payload->data() + 4);
+    if (height < 0 || width < 0 || _payload->size() - 8 != (size_t) height * width)
+    {
+        throw ProtocolException();
+    }
+    return Image::adoptBuffer(height, width, ImageLayout::ROW_MAJOR, _payload->data() + 8, _payload);
+}
+
+/**
+ * Returns the stats of a stats response.
+ * Throws RequestException if the request failed, and ProtocolException if the payload is malformed.
+ *
+ * @return The stats of a stats response.
+ */
+ServerStats RecognitionClient::Response::getStats() const
+{
+    _checkStatus();
+    return ServerStats::deserialize(_payload->data(), _payload->size());
+}
+
+// starts a request message of the given type with the given payload size, returns its id.
+uint32_t RecognitionClient::_beginRequest(RequestType type, size_t payloadSize)
+{
+    _message.clear();
+    uint32_t id = _nextId++;
+    MessageHeader{(unsigned char) type, id, (uint32_t) payloadSize}.serialize(_message);
+    return id;
+}
+
+// sends the request message.
+void RecognitionClient::_sendRequest()
+{
+    size_t sent = 0;
+    while (sent < _message.size())
+    {
+        ssize_t count = send(_fd, _message.data() + sent, _message.size() - sent, MSG_NOSIGNAL);
+        if (count < 0 && errno != EINTR)
+        {
+            throw ConnectionException();
+        }
+        sent += count > 0 ? count : 0;
+    }
+}
+
+// reads exactly the given number of bytes.
+void RecognitionClient::_receiveBytes(unsigned char *data, size_t size)
+{
+    size_t received = 0;
+    while (received < size)
+    {
+        ssize_t count = recv(_fd, data + received, size - received, 0);
+        if (count == 0 || (count < 0 && errno != EINTR))
+        {
+            throw ConnectionException();
+        }
+        received += count > 0 ? count : 0;
+    }
+}
+
+// receives the response of the given request, expecting no other ones.
+RecognitionClient::Response RecognitionClient::_receive(uint32_t id)
+{
+    Response response = receive();
+    if (response.getId() != id)
+    {
+        throw ProtocolException();
+    }
+    return response;
+}
+
+/**
+ * Connects to the server listening on the given socket path.
+ * Throws ConnectionException if it can't connect.
+ *
+ * @param socketPath The path of the server's socket file.
+ */
+RecognitionClient::RecognitionClient(const char *socketPath) : _fd(-1), _nextId(0)
+{
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    std::string path(socketPath);
+    if (path.empty() || path.size() >= sizeof(address.sun_path))
+    {
+        throw ConnectionException();
+    }
+    std::copy(path.begin(), path.end(), address.sun_path);
+
+    _fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (_fd < 0)
+    {
+        throw ConnectionException();
+    }
+    if (connect(_fd, (const sockaddr *) &address, sizeof(address)) != 0)
+    {
+        close(_fd);
+        throw ConnectionException();
+    }
+}
+
+/**
+ * Closes the connection.
+ */
+RecognitionClient::~RecognitionClient()
+{
+    close(_fd);
+}
+
+/**
+ * Sends a request to recognize the shapes in the given image, without waiting for the response.
+ * Throws ConnectionException if the connection broke.
+ *
+ * @param img The image to recognize.
+ * @param withTriangles true to recognize rectangles and triangles, false for rectangles only.
+ * @return The id of the request.
+ */
+uint32_t RecognitionClient::sendRecognize(const Image &img, bool withTriangles)
+{
+    RequestType type = withTriangles ? RequestType::RECOGNIZE_RECTANGLES_AND_TRIANGLES :
+                       RequestType::RECOGNIZE_RECTANGLES;
+    uint32_t id = _beginRequest(type, 8 + (size_t) img.getHeight() * img.getWidth());
+    writeInt32(_message, img.getHeight());
+    writeInt32(_message, img.getWidth());
+    for (int y = 0; y < img.getHeight(); ++y)
+    {
+        int length;
+        for (int x = 0; x < img.getWidth(); x += length)
+        {
+            const unsigned char *pixels = img.getRowPixels(x, y, length);
+            _message.insert(_message.end(), pixels, pixels + length);
+        }
+    }
+    _sendRequest();
+    return id;
+}
+
+/**
+ * Sends a request to render the given shapes, without waiting for the response.
+ * Throws ConnectionException if the connection broke.
+ *
+ * @param height The image height in pixels.
+ * @param width The image width in pixels.
+ * @param color The background color.
+ * @param shapes An array of shape pointers.
+ * @param size The size of the shapes array.
+ * @return The id of the request.
+ */
+uint32_t RecognitionClient::sendRender(int height, int width, unsigned char color, const Shape *const *shapes,
+                                       int size)
+{
+    std::vector<unsigned char> shapeList;
+    ShapeListView::serialize(shapes, size, shapeList);
+    uint32_t id = _beginRequest(RequestType::RENDER, 12 + shapeList.size());
+    writeInt32(_message, height);
+    writeInt32(_message, width);
+    _message.push_back(color);
+    _message.insert(_message.end(), 3, 0);
+    _message.insert(_message.end(), shapeList.begin(), shapeList.end());
+    _sendRequest();
+    return id;
+}
+
+/**
+ * Sends a request for the server's stats, without waiting for the response.
+ * Throws ConnectionException if the connection broke.
+ *
+ * @return The id of the request.
+ */
+uint32_t RecognitionClient::sendStatsRequest()
+{
+    uint32_t id = _beginRequest(RequestType::STATS, 0);
+    _sendRequest();
+    return id;
+}
+
+/**
+ * Waits for the next response.
+ * Throws ConnectionException if the connection broke, and ProtocolException if the response is malformed.
+ *
+ * @return The next response.
+ */
+RecognitionClient::Response RecognitionClient::receive()
+{
+    unsigned char headerData[MessageHeader::SIZE];
+    _receiveBytes(headerData, MessageHeader::SIZE);
+    MessageHeader header = MessageHeader::deserialize(headerData);
+    std::vector<unsigned char> payload(header.payloadSize);
+    _receiveBytes(payload.data(), payload.size());
+    return Response(header.id, (ResponseStatus) header.kind, std::move(payload));
+}
+
+/**
+ * Same as Shape::getRectanglesFromImage or Shape::getRectanglesAndTrianglesFromImage, done by the server.
+ * Throws RequestException if the server failed the request.
+ * The output array (and all pointers in it) needs to be freed (either manually or with freeShapesArray).
+ *
+ * @param img The image to recognize.
+ * @param withTriangles true to recognize rectangles and triangles, false for rectangles only.
+ * @param arrSize The output array size.
+ * @return An array of shape pointers.
+ */
+Shape **RecognitionClient::recognize(const Image &img, bool withTriangles, int &arrSize)
+{
+    return _receive(sendRecognize(img, withTriangles)).getShapes(arrSize);
+}
+
+/**
+ * Returns a new image of the given size and background color, with the given shapes drawn by the server.
+ * Throws RequestException if the server failed the request (e.g. a shape is out of image bounds).
+ *
+ * @param height The image height in pixels.
+ * @param width The image width in pixels.
+ * @param color The background color.
+ * @param shapes An array of shape pointers.
+ * @param size The size of the shapes array.
+ * @return The rendered image.
+ */
+Image RecognitionClient::render(int height, int width, unsigned char color, const Shape *const *shapes, int size)
+{
+    return _receive(sendRender(height, width, color, shapes, size)).getImage();
+}
+
+/**
+ * Returns the server's stats.
+ *
+ * @return The server's stats.
+ */
+ServerStats RecognitionClient::getStats()
+{
+    return _receive(sendStatsRequest()).getStats();
+}
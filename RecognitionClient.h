@@ -0,0 +1,196 @@
+//
+// Created by jacko on 30/10/2020.
+//
+
+#ifndef POLYTEST_RECOGNITIONCLIENT_H
+#define POLYTEST_RECOGNITIONCLIENT_H
+
+
+#include <memory>
+#include <vector>
+#include "Image.h"
+#include "RecognitionProtocol.h"
+#include "Shapes.h"
+
+
+/**
+ * Blocking client of a RecognitionServer.
+ * Requests can be pipelined: send several, then receive their responses (in any order) and match them by id.
+ * The simple calls (recognize, render and getStats) expect no other requests to be waiting for a response.
+ * Not thread-safe.
+ */
+class RecognitionClient
+{
+public:
+    /**
+     * A received response.
+     */
+    class Response
+    {
+        uint32_t _id;
+        ResponseStatus _status;
+        std::shared_ptr<std::vector<unsigned char>> _payload;
+
+        // throws RequestException if the request failed.
+        void _checkStatus() const;
+
+    public:
+        /**
+         * Creates a response with the given id, status and payload.
+         *
+         * @param id The id of the request.
+         * @param status The status of the response.
+         * @param payload The payload of the response.
+         */
+        Response(uint32_t id, ResponseStatus status, std::vector<unsigned char> payload);
+
+        /**
+         * Returns the id of the request this response answers.
+         *
+         * @return The id of the request this response answers.
+         */
+        uint32_t getId() const;
+
+        /**
+         * Returns the status of the response.
+         *
+         * @return The status of the response.
+         */
+        ResponseStatus getStatus() const;
+
+        /**
+         * Returns the shapes of a recognition response.
+         * Throws RequestException if the request failed, and ShapeFormatException if the payload is malformed.
+         * The output array (and all pointers in it) needs to be freed (either manually or with freeShapesArray).
+         *
+         * @param arrSize The output array size.
+         * @return An array of shape pointers.
+         */
+        Shape **getShapes(int &arrSize) const;
+
+        /**
+         * Returns the image of a render response (its pixels stay in the response's buffer, without a copy).
+         * Throws RequestException if the request failed, and ProtocolException if the payload is malformed.
+         *
+         * @return The image of a render response.
+         */
+        Image getImage() const;
+
+        /**
+         * Returns the stats of a stats response.
+         * Throws RequestException if the request failed, and ProtocolException if the payload is malformed.
+         *
+         * @return The stats of a stats response.
+         */
+        ServerStats getStats() const;
+    };
+
+private:
+    int _fd;
+    uint32_t _nextId;
+    std::vector<unsigned char> _message; // The request that is being sent.
+
+    // starts a request message of the given type with the given payload size, returns its id.
+    uint32_t _beginRequest(RequestType type, size_t payloadSize);
+
+    // sends the request message.
+    void _sendRequest();
+
+    // reads exactly the given number of bytes.
+    void _receiveBytes(unsigned char *data, size_t size);
+
+    // receives the response of the given request, expecting no other ones.
+    Response _receive(uint32_t id);
+
+public:
+    /**
+     * Connects to the server listening on the given socket path.
+     * Throws ConnectionException if it can't connect.
+     *
+     * @param socketPath The path of the server's socket file.
+     */
+    explicit RecognitionClient(const char *socketPath);
+
+    RecognitionClient(const RecognitionClient &) = delete;
+
+    RecognitionClient &operator=(const RecognitionClient &) = delete;
+
+    /**
+     * Closes the connection.
+     */
+    ~RecognitionClient();
+
+    /**
+     * Sends a request to recognize the shapes in the given image, without waiting for the response.
+     * Throws ConnectionException if the connection broke.
+     *
+     * @param img The image to recognize.
+     * @param withTriangles true to recognize rectangles and triangles, false for rectangles only.
+     * @return The id of the request.
+     */
+    uint32_t sendRecognize(const Image &img, bool withTriangles);
+
+    /**
+     * Sends a request to render the given shapes, without waiting for the response.
+     * Throws ConnectionException if the connection broke.
+     *
+     * @param height The image height in pixels.
+     * @param width The image width in pixels.
+     * @param color The background color.
+     * @param shapes An array of shape pointers.
+     * @param size The size of the shapes array.
+     * @return The id of the request.
+     */
+    uint32_t sendRender(int height, int width, unsigned char color, const Shape *const *shapes, int size);
+
+    /**
+     * Sends a request for the server's stats, without waiting for the response.
+     * Throws ConnectionException if the connection broke.
+     *
+     * @return The id of the request.
+     */
+    uint32_t sendStatsRequest();
+
+    /**
+     * Waits for the next response.
+     * Throws ConnectionException if the connection broke, and ProtocolException if the response is malformed.
+     *
+     * @return The next response.
+     */
+    Response receive();
+
+    /**
+     * Same as Shape::getRectanglesFromImage or Shape::getRectanglesAndTrianglesFromImage, done by the server.
+     * Throws RequestException if the server failed the request.
+     * The output array (and all pointers in it) needs to be freed (either manually or with freeShapesArray).
+     *
+     * @param img The image to recognize.
+     * @param withTriangles true to recognize rectangles and triangles, false for rectangles only.
+     * @param arrSize The output array size.
+     * @return An array of shape pointers.
+     */
+    Shape **recognize(const Image &img, bool withTriangles, int &arrSize);
+
+    /**
+     * Returns a new image of the given size and background color, with the given shapes drawn by the server.
+     * Throws RequestException if the server failed the request (e.g. a shape is out of image bounds).
+     *
+     * @param height The image height in pixels.
+     * @param width The image width in pixels.
+     * @param color The background color.
+     * @param shapes An array of shape pointers.
+     * @param size The size of the shapes array.
+     * @return The rendered image.
+     */
+    Image render(int height, int width, unsigned char color, const Shape *const *shapes, int size);
+
+    /**
+     * Returns the server's stats.
+     *
+     * @return The server's stats.
+     */
+    ServerStats getStats();
+};
+
+
+#endif //POLYTEST_RECOGNITIONCLIENT_H
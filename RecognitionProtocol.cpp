@@ -0,0 +1,232 @@
+#include <algorithm>
+#include "RecognitionProtocol.h"
+
+
+static const unsigned char MAGIC[4] = {'P', 'L', 'Y', 'R'};
+static const int STATS_COUNTERS = 7;
+static const size_t STATS_SIZE = (STATS_COUNTERS + LatencyHistogram::BUCKETS) * 8;
+
+// Reads a little-endian 16 bit unsigned integer.
+static uint16_t readUint16(const unsigned char *data)
+{
+    return (uint16_t) (data[0] | (data[1] << 8));
+}
+
+// Reads a little-endian 32 bit unsigned integer.
+static uint32_t readUint32(const unsigned char *data)
+{
+    return (uint32_t) data[0] | ((uint32_t) data[1] << 8) | ((uint32_t) data[2] << 16) | ((uint32_t) data[3] << 24);
+}
+
+// Reads a little-endian 64 bit unsigned integer.
+static uint64_t readUint64(const unsigned char *data)
+{
+    return (uint64_t) readUint32(data) | ((uint64_t) readUint32(data + 4) << 32);
+}
+
+// Appends a little-endian 16 bit unsigned integer.
+static void writeUint16(std::vector<unsigned char> &buffer, uint16_t value)
+{
+    buffer.push_back((unsigned char) value);
+    buffer.push_back((unsigned char) (value >> 8));
+}
+
+// Appends a little-endian 32 bit unsigned integer.
+static void writeUint32(std::vector<unsigned char> &buffer, uint32_t value)
+{
+    buffer.push_back((unsigned char) value);
+    buffer.push_back((unsigned char) (value >> 8));
+    buffer.push_back((unsigned char) (value >> 16));
+    buffer.push_back((unsigned char) (value >> 24));
+}
+
+// Appends a little-endian 64 bit unsigned integer.
+static void writeUint64(std::vector<unsigned char> &buffer, uint64_t value)
+{
+    writeUint32(buffer, (uint32_t) value);
+    writeUint32(buffer, (uint32_t) (value >> 32));
+}
+
+
+/**
+ * Appends the serialized header to the given buffer.
+ *
+ * @param buffer The buffer to append to.
+ */
+void MessageHeader::serialize(std::vector<unsigned char> &buffer) const
+{
+    buffer.insert(buffer.end(), MAGIC, MAGIC + 4);
+    writeUint16(buffer, VERSION);
+    buffer.push_back(kind);
+    buffer.push_back(0);
+    writeUint32(buffer, id);
+    writeUint32(buffer, payloadSize);
+}
+
+/**
+ * Returns the header that is serialized at the given address (SIZE bytes are read).
+ * Throws ProtocolException if it isn't a valid header.
+ *
+ * @param data The first byte of the header.
+ * @return The header that is serialized at the given address.
+ */
+MessageHeader MessageHeader::deserialize(const unsigned char *data)
+{
+    if (!std::equal(MAGIC, MAGIC + 4, data) || readUint16(data + 4) != VERSION)
+    {
+        throw ProtocolException();
+    }
+    return MessageHeader{data[6], readUint32(data + 8), readUint32(data + 12)};
+}
+
+/**
+ * Creates an empty histogram.
+ */
+LatencyHistogram::LatencyHistogram() : _buckets()
+{}
+
+/**
+ * Counts the given latency.
+ *
+ * @param microseconds The latency in microseconds.
+ */
+void LatencyHistogram::record(uint64_t microseconds)
+{
+    int bucket = 0;
+    while (microseconds > 0 && bucket < BUCKETS - 1)
+    {
+        microseconds >>= 1;
+        bucket++;
+    }
+    _buckets[bucket]++;
+}
+
+/**
+ * Adds the counts of the given histogram to this one.
+ *
+ * @param other The histogram to add.
+ */
+void LatencyHistogram::merge(const LatencyHistogram &other)
+{
+    for (int i = 0; i < BUCKETS; ++i)
+    {
+        _buckets[i] += other._buckets[i];
+    }
+}
+
+/**
+ * Returns the number of counted latencies.
+ *
+ * @return The number of counted latencies.
+ */
+uint64_t LatencyHistogram::getCount() const
+{
+    uint64_t count = 0;
+    for (uint64_t bucketCount : _buckets)
+    {
+        count += bucketCount;
+    }
+    return count;
+}
+
+/**
+ * Returns the number of latencies in the given bucket.
+ *
+ * @param index The index of the bucket.
+ * @return The number of latencies in the given bucket.
+ */
+uint64_t LatencyHistogram::getBucket(int index) const
+{
+    return _buckets[index];
+}
+
+/**
+ * Returns an upper bound of the given percentile of the counted latencies (the end of its bucket), or 0 if
+ * nothing was counted.
+ *
+ * @param percentile The percentile, between 0 and 100.
+ * @return An upper bound of the given percentile in microseconds.
+ */
+uint64_t LatencyHistogram::getPercentile(double percentile) const
+{
+    uint64_t count = getCount();
+    if (count == 0)
+    {
+        return 0;
+    }
+
+    // The rank of the percentile, at least the first latency.
+    auto rank = std::max((uint64_t) 1, (uint64_t) (percentile / 100 * (double) count + 0.5));
+    uint64_t seen = 0;
+    for (int i = 0; i < BUCKETS; ++i)
+    {
+        seen += _buckets[i];
+        if (seen >= rank)
+        {
+            return (uint64_t) 1 << i;
+        }
+    }
+    return (uint64_t) 1 << (BUCKETS - 1);
+}
+
+/**
+ * Returns the average number of answered requests per second.
+ *
+ * @return The average number of answered requests per second.
+ */
+double ServerStats::getThroughput() const
+{
+    return uptimeMicroseconds == 0 ? 0 : (double) requests * 1e6 / (double) uptimeMicroseconds;
+}
+
+/**
+ * Appends the serialized stats to the given buffer.
+ *
+ * @param buffer The buffer to append to.
+ */
+void ServerStats::serialize(std::vector<unsigned char> &buffer) const
+{
+    const uint64_t counters[STATS_COUNTERS] = {uptimeMicroseconds, connections, requests, failedRequests, batches,
+                                               bytesReceived, bytesSent};
+    for (uint64_t counter : counters)
+    {
+        writeUint64(buffer, counter);
+    }
+    for (uint64_t bucketCount : latency._buckets)
+    {
+        writeUint64(buffer, bucketCount);
+    }
+}
+
+/**
+ * Returns the stats that are serialized in the given buffer.
+ * Throws ProtocolException if the buffer doesn't hold valid stats.
+ *
+ * @param data The buffer.
+ * @param size The size of the buffer in bytes.
+ * @return The stats that are serialized in the given buffer.
+ */
+ServerStats ServerStats::deserialize(const void *data, size_t size)
+{
+    if (size != STATS_SIZE)
+    {
+        throw ProtocolException();
+    }
+
+    auto bytes = (const unsigned char *) data;
+    ServerStats stats;
+    uint64_t *counters[STATS_COUNTERS] = {&stats.uptimeMicroseconds, &stats.connections, &stats.requests,
+                                          &stats.failedRequests, &stats.batches, &stats.bytesReceived,
+                                          &stats.bytesSent};
+    for (uint64_t *counter : counters)
+    {
+        *counter = readUint64(bytes);
+        bytes += 8;
+    }
+    for (uint64_t &bucketCount : stats.latency._buckets)
+    {
+        bucketCount = readUint64(bytes);
+        bytes += 8;
+    }
+    return stats;
+}
@@ -0,0 +1,225 @@
+//
+// Created by jacko on 30/10/2020.
+//
+
+#ifndef POLYTEST_RECOGNITIONPROTOCOL_H
+#define POLYTEST_RECOGNITIONPROTOCOL_H
+
+
+#include <cstdint>
+#include <exception>
+#include <vector>
+
+
+#define ERROR_PROTOCOL "ERROR: Recognition server message is malformed or has an unsupported version."
+#define ERROR_CONNECTION "ERROR: Couldn't create, connect to or use the recognition server socket."
+#define ERROR_REQUEST "ERROR: The recognition server rejected or failed the request."
+
+
+/**
+ * Exception for malformed or unsupported recognition server messages.
+ */
+class ProtocolException : public std::exception
+{
+public:
+    const char *what() const noexcept override
+    {
+        return ERROR_PROTOCOL;
+    }
+};
+
+/**
+ * Exception for problems creating, connecting to or using recognition server sockets.
+ */
+class ConnectionException : public std::exception
+{
+public:
+    const char *what() const noexcept override
+    {
+        return ERROR_CONNECTION;
+    }
+};
+
+/**
+ * Exception for requests that the recognition server answered with an error status.
+ */
+class RequestException : public std::exception
+{
+public:
+    const char *what() const noexcept override
+    {
+        return ERROR_REQUEST;
+    }
+};
+
+/**
+ * Kinds of recognition server requests and their payloads (little-endian):
+ * RECOGNIZE_* - height and width (4 bytes each), followed by the pixels row by row.
+ * RENDER - height and width (4 bytes each), background color (1 byte), 3 reserved bytes and a shape list
+ * (see ShapeListView).
+ * STATS - no payload.
+ */
+enum class RequestType : unsigned char
+{
+    RECOGNIZE_RECTANGLES = 1,
+    RECOGNIZE_RECTANGLES_AND_TRIANGLES = 2,
+    RENDER = 3,
+    STATS = 4
+};
+
+/**
+ * Statuses of recognition server responses. Successful responses' payloads (little-endian):
+ * RECOGNIZE_* - a shape list (see ShapeListView).
+ * RENDER - height and width (4 bytes each), followed by the pixels row by row.
+ * STATS - serialized ServerStats.
+ * Failed responses have no payload.
+ */
+enum class ResponseStatus : unsigned char
+{
+    OK = 0,
+    BAD_REQUEST = 1,
+    FAILED = 2
+};
+
+/**
+ * Header that starts every request and response.
+ *
+ * Layout (little-endian): magic "PLYR", version (2 bytes), kind (1 byte - the request type or the response
+ * status), reserved (1 byte), request id (4 bytes) and payload size (4 bytes). A response has the id of its
+ * request; responses to pipelined requests may arrive out of order.
+ */
+struct MessageHeader
+{
+    /**
+     * Current version of the protocol.
+     */
+    static const int VERSION = 1;
+
+    /**
+     * Size of a serialized header in bytes.
+     */
+    static const size_t SIZE = 16;
+
+    unsigned char kind;
+    uint32_t id;
+    uint32_t payloadSize;
+
+    /**
+     * Appends the serialized header to the given buffer.
+     *
+     * @param buffer The buffer to append to.
+     */
+    void serialize(std::vector<unsigned char> &buffer) const;
+
+    /**
+     * Returns the header that is serialized at the given address (SIZE bytes are read).
+     * Throws ProtocolException if it isn't a valid header.
+     *
+     * @param data The first byte of the header.
+     * @return The header that is serialized at the given address.
+     */
+    static MessageHeader deserialize(const unsigned char *data);
+};
+
+/**
+ * Histogram of latencies in power of two microsecond buckets: bucket 0 counts latencies under 1us and bucket i
+ * counts latencies from 2^(i-1)us up to 2^i us. Not thread-safe.
+ */
+class LatencyHistogram
+{
+public:
+    /**
+     * Number of buckets (the last one also counts everything longer).
+     */
+    static const int BUCKETS = 32;
+
+private:
+    uint64_t _buckets[BUCKETS];
+
+    friend struct ServerStats;
+
+public:
+    /**
+     * Creates an empty histogram.
+     */
+    LatencyHistogram();
+
+    /**
+     * Counts the given latency.
+     *
+     * @param microseconds The latency in microseconds.
+     */
+    void record(uint64_t microseconds);
+
+    /**
+     * Adds the counts of the given histogram to this one.
+     *
+     * @param other The histogram to add.
+     */
+    void merge(const LatencyHistogram &other);
+
+    /**
+     * Returns the number of counted latencies.
+     *
+     * @return The number of counted latencies.
+     */
+    uint64_t getCount() const;
+
+    /**
+     * Returns the number of latencies in the given bucket.
+     *
+     * @param index The index of the bucket.
+     * @return The number of latencies in the given bucket.
+     */
+    uint64_t getBucket(int index) const;
+
+    /**
+     * Returns an upper bound of the given percentile of the counted latencies (the end of its bucket), or 0 if
+     * nothing was counted.
+     *
+     * @param percentile The percentile, between 0 and 100.
+     * @return An upper bound of the given percentile in microseconds.
+     */
+    uint64_t getPercentile(double percentile) const;
+};
+
+/**
+ * Counters of a recognition server since it started.
+ */
+struct ServerStats
+{
+    uint64_t uptimeMicroseconds;
+    uint64_t connections; // Accepted so far.
+    uint64_t requests; // Answered, including failed ones.
+    uint64_t failedRequests;
+    uint64_t batches; // Groups of requests a worker took from the queue at once.
+    uint64_t bytesReceived, bytesSent;
+    LatencyHistogram latency; // From receiving a whole request to queueing its response.
+
+    /**
+     * Returns the average number of answered requests per second.
+     *
+     * @return The average number of answered requests per second.
+     */
+    double getThroughput() const;
+
+    /**
+     * Appends the serialized stats to the given buffer.
+     *
+     * @param buffer The buffer to append to.
+     */
+    void serialize(std::vector<unsigned char> &buffer) const;
+
+    /**
+     * Returns the stats that are serialized in the given buffer.
+     * Throws ProtocolException if the buffer doesn't hold valid stats.
+     *
+     * @param data The buffer.
+     * @param size The size of the buffer in bytes.
+     * @return The stats that are serialized in the given buffer.
+     */
+    static ServerStats deserialize(const void *data, size_t size);
+};
+
+
+#endif //POLYTEST_RECOGNITIONPROTOCOL_H
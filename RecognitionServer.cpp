@@ -0,0 +1,551 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <iterator>
+#include <new>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "RecognitionServer.h"
+#include "ShapeList.h"
+
+
+static const size_t READ_SIZE = 64 * 1024;
+
+// Reads a little-endian 32 bit signed integer.
+static int32_t readInt32(const unsigned char *data)
+{
+    return (int32_t) ((uint32_t) data[0] | ((uint32_t) data[1] << 8) | ((uint32_t) data[2] << 16) |
+                      ((uint32_t) data[3] << 24));
+}
+
+// Appends a little-endian 32 bit signed integer.
+static void writeInt32(std::vector<unsigned char> &buffer, int32_t value)
+{
+    uint32_t bits = (uint32_t) value;
+    buffer.push_back((unsigned char) bits);
+    buffer.push_back((unsigned char) (bits >> 8));
+    buffer.push_back((unsigned char) (bits >> 16));
+    buffer.push_back((unsigned char) (bits >> 24));
+}
+
+// Returns the microseconds from the given time until now.
+static uint64_t microsecondsSince(std::chrono::steady_clock::time_point time)
+{
+    auto elapsed = std::chrono::steady_clock::now() - time;
+    return (uint64_t) std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+}
+
+// Returns an owner for borrowed pixels that the caller keeps alive itself.
+static std::shared_ptr<void> unownedPixels(void *pixels)
+{
+    return std::shared_ptr<void>(pixels, [](void *)
+    {});
+}
+
+
+// creates, binds and starts listening on the socket and creates the wake pipe.
+void RecognitionServer::_open()
+{
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (_socketPath.empty() || _socketPath.size() >= sizeof(address.sun_path))
+    {
+        throw ConnectionException();
+    }
+    std::copy(_socketPath.begin(), _socketPath.end(), address.sun_path);
+
+    // Replace a socket that a previous server left behind, but never any other kind of file.
+    struct stat fileStat = {};
+    if (lstat(_socketPath.c_str(), &fileStat) == 0 && S_ISSOCK(fileStat.st_mode))
+    {
+        unlink(_socketPath.c_str());
+    }
+
+    _listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (_listenFd < 0 || bind(_listenFd, (const sockaddr *) &address, sizeof(address)) != 0 ||
+        listen(_listenFd, SOMAXCONN) != 0 || pipe2(_wakeFds, O_NONBLOCK | O_CLOEXEC) != 0)
+    {
+        throw ConnectionException();
+    }
+}
+
+// closes the sockets and the wake pipe and removes the socket file.
+void RecognitionServer::_close()
+{
+    for (auto &entry : _connections)
+    {
+        close(entry.second.fd);
+    }
+    _connections.clear();
+    if (_listenFd >= 0)
+    {
+        close(_listenFd);
+        unlink(_socketPath.c_str());
+        _listenFd = -1;
+    }
+    for (int &fd : _wakeFds)
+    {
+        if (fd >= 0)
+        {
+            close(fd);
+            fd = -1;
+        }
+    }
+}
+
+// takes batches of requests and answers them until the server closes.
+void RecognitionServer::_runWorker()
+{
+    RecognitionCache cache(_cacheBudget / _workerCount);
+    std::vector<Request> batch;
+    std::vector<Response> responses;
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(_requestsMutex);
+            _requestsCondition.wait(lock, [this]()
+            {
+                return _isClosing || !_requests.empty();
+            });
+            if (_isClosing)
+            {
+                return;
+            }
+
+            // Take a fair share of the queue, so a burst is spread over all workers.
+            size_t count = std::min((size_t) MAX_BATCH_SIZE, (_requests.size() + _workerCount - 1) / _workerCount);
+            for (size_t i = 0; i < count; ++i)
+            {
+                batch.push_back(std::move(_requests.front()));
+                _requests.pop_front();
+            }
+        }
+
+        for (const Request &request : batch)
+        {
+            responses.push_back(Response{request.connectionId, _answer(request, cache)});
+        }
+
+        std::lock_guard<std::mutex> lock(_responsesMutex);
+        _stats.batches++;
+        for (size_t i = 0; i < batch.size(); ++i)
+        {
+            _stats.requests++;
+            if (responses[i].message[6] != (unsigned char) ResponseStatus::OK)
+            {
+                _stats.failedRequests++;
+            }
+            _stats.latency.record(microsecondsSince(batch[i].receiveTime));
+            _responses.push_back(std::move(responses[i]));
+        }
+        if (!_isWakePending)
+        {
+            _isWakePending = true;
+            char wake = 0;
+            ssize_t written = write(_wakeFds[1], &wake, 1);
+            (void) written;
+        }
+        batch.clear();
+        responses.clear();
+    }
+}
+
+// returns the serialized response to the given request, using the given cache for recognition.
+std::vector<unsigned char> RecognitionServer::_answer(const Request &request, RecognitionCache &cache)
+{
+    const std::vector<unsigned char> &payload = request.payload;
+    auto type = (RequestType) request.header.kind;
+    std::vector<unsigned char> message(MessageHeader::SIZE);
+    ResponseStatus status = ResponseStatus::OK;
+    try
+    {
+        if (payload.size() < 8)
+        {
+            throw ShapeFormatException();
+        }
+        int height = readInt32(payload.data());
+        int width = readInt32(payload.data() + 4);
+        if (height < 0 || width < 0 || (uint64_t) height * width > MAX_PAYLOAD_SIZE)
+        {
+            throw ImageDimException();
+        }
+
+        if (type == RequestType::RECOGNIZE_RECTANGLES || type == RequestType::RECOGNIZE_RECTANGLES_AND_TRIANGLES)
+        {
+            if (payload.size() - 8 != (size_t) height * width)
+            {
+                throw ImageDimException();
+            }
+            // Recognize straight from the request's pixels.
+            auto pixels = const_cast<unsigned char *>(payload.data()) + 8;
+            Image img = Image::adoptBuffer(height, width, ImageLayout::ROW_MAJOR, pixels, unownedPixels(pixels));
+            int arrSize;
+            Shape **shapes = type == RequestType::RECOGNIZE_RECTANGLES ?
+                             cache.getRectanglesFromImage(img, arrSize) :
+                             cache.getRectanglesAndTrianglesFromImage(img, arrSize);
+            std::vector<unsigned char> shapeList;
+            ShapeListView::serialize(shapes, arrSize, shapeList);
+            Shape::freeShapesArray(shapes, arrSize);
+            message.insert(message.end(), shapeList.begin(), shapeList.end());
+        }
+        else if (type == RequestType::RENDER)
+        {
+            if (payload.size() < 12)
+            {
+                throw ShapeFormatException();
+            }
+            ShapeListView list(payload.data() + 12, payload.size() - 12);
+            ShapeBatch shapes(list);
+
+            // Draw straight into the response.
+            writeInt32(message, height);
+            writeInt32(message, width);
+            message.resize(message.size() + (size_t) height * width, payload[8]);
+            unsigned char *pixels = message.data() + MessageHeader::SIZE + 8;
+            Image img = Image::adoptBuffer(height, width, ImageLayout::ROW_MAJOR, pixels, unownedPixels(pixels));
+            Shape::compositeShapesToImage(img, shapes.getShapes(), shapes.getSize());
+        }
+        else
+        {
+            throw ShapeFormatException();
+        }
+    }
+    catch (const ShapeFormatException &)
+    {
+        status = ResponseStatus::BAD_REQUEST;
+    }
+    catch (const ImageDimException &)
+    {
+        status = ResponseStatus::BAD_REQUEST;
+    }
+    catch (const std::bad_alloc &)
+    {
+        status = ResponseStatus::FAILED;
+    }
+    catch (const std::exception &)
+    {
+        // Whatever else goes wrong fails this request only, the server keeps going.
+        status = ResponseStatus::FAILED;
+    }
+
+    if (status != ResponseStatus::OK)
+    {
+        message.resize(MessageHeader::SIZE);
+    }
+    _writeHeader(message, status, request.header.id);
+    return message;
+}
+
+// accepts all pending connections.
+void RecognitionServer::_accept()
+{
+    int fd;
+    while ((fd = accept4(_listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0)
+    {
+        _connections.emplace(_nextConnectionId++, Connection{fd, std::vector<unsigned char>(), 0,
+                                                             std::deque<std::vector<unsigned char>>(), 0});
+        std::lock_guard<std::mutex> lock(_responsesMutex);
+        _stats.connections++;
+    }
+}
+
+// reads from the given connection and moves its whole requests to the given batch. Returns false on close.
+bool RecognitionServer::_read(uint64_t connectionId, Connection &connection, std::vector<Request> &batch)
+{
+    // Make room for the whole message that is being received, if its header has arrived.
+    size_t wanted = READ_SIZE;
+    if (connection.inputSize >= MessageHeader::SIZE)
+    {
+        MessageHeader header = MessageHeader::deserialize(connection.input.data());
+        wanted = std::max(wanted, MessageHeader::SIZE + header.payloadSize - connection.inputSize);
+    }
+    if (connection.input.size() < connection.inputSize + wanted)
+    {
+        connection.input.resize(connection.inputSize + wanted);
+    }
+
+    ssize_t count = recv(connection.fd, connection.input.data() + connection.inputSize,
+                         connection.input.size() - connection.inputSize, 0);
+    if (count <= 0)
+    {
+        return count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR);
+    }
+    connection.inputSize += count;
+    {
+        std::lock_guard<std::mutex> lock(_responsesMutex);
+        _stats.bytesReceived += count;
+    }
+
+    size_t offset = 0;
+    auto now = std::chrono::steady_clock::now();
+    while (connection.inputSize - offset >= MessageHeader::SIZE)
+    {
+        MessageHeader header;
+        try
+        {
+            header = MessageHeader::deserialize(connection.input.data() + offset);
+        }
+        catch (const ProtocolException &)
+        {
+            return false;
+        }
+        if (header.payloadSize > MAX_PAYLOAD_SIZE)
+        {
+            return false;
+        }
+        if (connection.inputSize - offset - MessageHeader::SIZE < header.payloadSize)
+        {
+            break;
+        }
+
+        const unsigned char *payload = connection.input.data() + offset + MessageHeader::SIZE;
+        if ((RequestType) header.kind == RequestType::STATS)
+        {
+            // Cheap enough to answer right away.
+            std::vector<unsigned char> message(MessageHeader::SIZE);
+            getStats().serialize(message);
+            _writeHeader(message, ResponseStatus::OK, header.id);
+            connection.output.push_back(std::move(message));
+        }
+        else
+        {
+            batch.push_back(Request{connectionId, header,
+                                    std::vector<unsigned char>(payload, payload + header.payloadSize), now});
+        }
+        offset += MessageHeader::SIZE + header.payloadSize;
+    }
+
+    // Keep the start of the next message at the front.
+    std::copy(connection.input.begin() + offset, connection.input.begin() + connection.inputSize,
+              connection.input.begin());
+    connection.inputSize -= offset;
+    return true;
+}
+
+// sends as much of the given connection's output as possible. Returns false if the connection broke.
+bool RecognitionServer::_write(Connection &connection)
+{
+    size_t sent = 0;
+    bool isOpen = true;
+    while (!connection.output.empty())
+    {
+        const std::vector<unsigned char> &message = connection.output.front();
+        ssize_t count = send(connection.fd, message.data() + connection.outputOffset,
+                             message.size() - connection.outputOffset, MSG_NOSIGNAL);
+        if (count < 0)
+        {
+            isOpen = errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+            break;
+        }
+        sent += count;
+        connection.outputOffset += count;
+        if (connection.outputOffset == message.size())
+        {
+            connection.output.pop_front();
+            connection.outputOffset = 0;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(_responsesMutex);
+    _stats.bytesSent += sent;
+    return isOpen;
+}
+
+// moves the responses that workers queued to their connections' output.
+void RecognitionServer::_collectResponses()
+{
+    std::vector<Response> responses;
+    {
+        std::lock_guard<std::mutex> lock(_responsesMutex);
+        responses.swap(_responses);
+        _isWakePending = false;
+    }
+    for (Response &response : responses)
+    {
+        // The connection may have closed while its request was answered.
+        auto connection = _connections.find(response.connectionId);
+        if (connection != _connections.end())
+        {
+            connection->second.output.push_back(std::move(response.message));
+        }
+    }
+}
+
+// writes the header of the given response, whose payload follows the room that was left for the header.
+void RecognitionServer::_writeHeader(std::vector<unsigned char> &message, ResponseStatus status, uint32_t id)
+{
+    std::vector<unsigned char> header;
+    MessageHeader{(unsigned char) status, id, (uint32_t) (message.size() - MessageHeader::SIZE)}.serialize(header);
+    std::copy(header.begin(), header.end(), message.begin());
+}
+
+/**
+ * Creates a server listening on a Unix domain socket at the given path (an existing socket file there is
+ * replaced). Requests are only answered while run is running.
+ * Throws ConnectionException if the socket can't be created.
+ *
+ * @param socketPath The path of the socket file.
+ * @param workerCount The number of worker threads - 0 for one per hardware thread.
+ * @param cacheBudget The memory budget of the recognition caches of all workers together, in bytes.
+ */
+RecognitionServer::RecognitionServer(const char *socketPath, int workerCount, size_t cacheBudget) :
+        _socketPath(socketPath), _listenFd(-1), _wakeFds{-1, -1}, _workerCount(workerCount),
+        _cacheBudget(cacheBudget), _startTime(std::chrono::steady_clock::now()), _isStopping(false),
+        _isClosing(false), _isWakePending(false), _stats(), _nextConnectionId(0)
+{
+    if (_workerCount <= 0)
+    {
+        _workerCount = std::max(1, (int) std::thread::hardware_concurrency());
+    }
+
+    try
+    {
+        _open();
+    }
+    catch (const ConnectionException &)
+    {
+        _close();
+        throw;
+    }
+}
+
+/**
+ * Closes the socket and removes its file.
+ */
+RecognitionServer::~RecognitionServer()
+{
+    _close();
+}
+
+/**
+ * Starts the workers and serves requests on the calling thread until stop is called.
+ * Requests that weren't answered by then are dropped.
+ */
+void RecognitionServer::run()
+{
+    _isClosing = false;
+    for (int i = 0; i < _workerCount; ++i)
+    {
+        _workers.emplace_back(&RecognitionServer::_runWorker, this);
+    }
+
+    std::vector<pollfd> pollFds;
+    std::vector<uint64_t> pollIds;
+    std::vector<Request> batch;
+    while (!_isStopping.load())
+    {
+        pollFds.clear();
+        pollIds.clear();
+        pollFds.push_back(pollfd{_wakeFds[0], POLLIN, 0});
+        pollFds.push_back(pollfd{_listenFd, POLLIN, 0});
+        for (const auto &entry : _connections)
+        {
+            auto events = (short) (entry.second.output.empty() ? POLLIN : POLLIN | POLLOUT);
+            pollFds.push_back(pollfd{entry.second.fd, events, 0});
+            pollIds.push_back(entry.first);
+        }
+        if (poll(pollFds.data(), pollFds.size(), -1) < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            break;
+        }
+
+        if (pollFds[0].revents != 0)
+        {
+            char wakes[64];
+            while (read(_wakeFds[0], wakes, sizeof(wakes)) > 0)
+            {}
+            _collectResponses();
+        }
+        if (pollFds[1].revents != 0)
+        {
+            _accept();
+        }
+        for (size_t i = 0; i < pollIds.size(); ++i)
+        {
+            Connection &connection = _connections[pollIds[i]];
+            bool isOpen = true;
+            if (pollFds[i + 2].revents & (POLLIN | POLLHUP | POLLERR))
+            {
+                isOpen = _read(pollIds[i], connection, batch);
+            }
+            if (isOpen && !connection.output.empty())
+            {
+                isOpen = _write(connection);
+            }
+            if (!isOpen)
+            {
+                close(connection.fd);
+                _connections.erase(pollIds[i]);
+            }
+        }
+
+        if (!batch.empty())
+        {
+            {
+                std::lock_guard<std::mutex> lock(_requestsMutex);
+                std::move(batch.begin(), batch.end(), std::back_inserter(_requests));
+            }
+            if (batch.size() == 1)
+            {
+                _requestsCondition.notify_one();
+            }
+            else
+            {
+                _requestsCondition.notify_all();
+            }
+            batch.clear();
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(_requestsMutex);
+        _isClosing = true;
+        _requests.clear();
+    }
+    _requestsCondition.notify_all();
+    for (std::thread &worker : _workers)
+    {
+        worker.join();
+    }
+    _workers.clear();
+    for (auto &entry : _connections)
+    {
+        close(entry.second.fd);
+    }
+    _connections.clear();
+    std::lock_guard<std::mutex> lock(_responsesMutex);
+    _responses.clear();
+    _isWakePending = false;
+}
+
+/**
+ * Makes run return. Can be called from any thread and from signal handlers.
+ */
+void RecognitionServer::stop()
+{
+    _isStopping = true;
+    char wake = 0;
+    ssize_t written = write(_wakeFds[1], &wake, 1);
+    (void) written;
+}
+
+/**
+ * Returns the server's counters.
+ *
+ * @return The server's counters.
+ */
+ServerStats RecognitionServer::getStats() const
+{
+    std::lock_guard<std::mutex> lock(_responsesMutex);
+    ServerStats stats = _stats;
+    stats.uptimeMicroseconds = microsecondsSince(_startTime);
+    return stats;
+}
@@ -0,0 +1,158 @@
+//
+// Created by jacko on 30/10/2020.
+//
+
+#ifndef POLYTEST_RECOGNITIONSERVER_H
+#define POLYTEST_RECOGNITIONSERVER_H
+
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "RecognitionCache.h"
+#include "RecognitionProtocol.h"
+
+
+/**
+ * Long-running recognition and render server on a Unix domain socket (see RecognitionProtocol.h).
+ * A single I/O thread accepts connections and reads requests, and a pool of worker threads answers them,
+ * each with its own recognition cache, so the threads, caches and allocations stay warm between requests.
+ *
+ * Requests that arrive together are queued together, and each worker takes a batch of them at once and
+ * queues all their responses at once, so busy periods cost few lock and wake-up round trips.
+ */
+class RecognitionServer
+{
+    // A whole request, waiting for a worker.
+    struct Request
+    {
+        uint64_t connectionId;
+        MessageHeader header;
+        std::vector<unsigned char> payload;
+        std::chrono::steady_clock::time_point receiveTime;
+    };
+
+    // A serialized response, waiting to be sent.
+    struct Response
+    {
+        uint64_t connectionId;
+        std::vector<unsigned char> message;
+    };
+
+    // A client connection and its unparsed input and unsent output.
+    struct Connection
+    {
+        int fd;
+        std::vector<unsigned char> input;
+        size_t inputSize;
+        std::deque<std::vector<unsigned char>> output;
+        size_t outputOffset; // Bytes of the first output message that were sent already.
+    };
+
+    std::string _socketPath;
+    int _listenFd;
+    int _wakeFds[2]; // Pipe that wakes the I/O thread for ready responses or stopping.
+    int _workerCount;
+    size_t _cacheBudget;
+    std::chrono::steady_clock::time_point _startTime;
+    std::atomic<bool> _isStopping;
+    std::vector<std::thread> _workers;
+
+    std::mutex _requestsMutex;
+    std::condition_variable _requestsCondition;
+    std::deque<Request> _requests;
+    bool _isClosing; // Tells the workers to exit.
+
+    mutable std::mutex _responsesMutex; // Guards the responses and the stats.
+    std::vector<Response> _responses;
+    bool _isWakePending;
+    ServerStats _stats;
+
+    std::unordered_map<uint64_t, Connection> _connections; // Used by the I/O thread only.
+    uint64_t _nextConnectionId;
+
+    // creates, binds and starts listening on the socket and creates the wake pipe.
+    void _open();
+
+    // closes the sockets and the wake pipe and removes the socket file.
+    void _close();
+
+    // takes batches of requests and answers them until the server closes.
+    void _runWorker();
+
+    // returns the serialized response to the given request, using the given cache for recognition.
+    std::vector<unsigned char> _answer(const Request &request, RecognitionCache &cache);
+
+    // accepts all pending connections.
+    void _accept();
+
+    // reads from the given connection and moves its whole requests to the given batch. Returns false on close.
+    bool _read(uint64_t connectionId, Connection &connection, std::vector<Request> &batch);
+
+    // sends as much of the given connection's output as possible. Returns false if the connection broke.
+    bool _write(Connection &connection);
+
+    // moves the responses that workers queued to their connections' output.
+    void _collectResponses();
+
+    // writes the header of the given response, whose payload follows the room that was left for the header.
+    static void _writeHeader(std::vector<unsigned char> &message, ResponseStatus status, uint32_t id);
+
+public:
+    /**
+     * Maximal number of requests a worker takes from the queue at once.
+     */
+    static const int MAX_BATCH_SIZE = 32;
+
+    /**
+     * Maximal payload size of a request; connections that send bigger ones are closed.
+     */
+    static const uint32_t MAX_PAYLOAD_SIZE = 1u << 28;
+
+    /**
+     * Creates a server listening on a Unix domain socket at the given path (an existing socket file there is
+     * replaced). Requests are only answered while run is running.
+     * Throws ConnectionException if the socket can't be created.
+     *
+     * @param socketPath The path of the socket file.
+     * @param workerCount The number of worker threads - 0 for one per hardware thread.
+     * @param cacheBudget The memory budget of the recognition caches of all workers together, in bytes.
+     */
+    RecognitionServer(const char *socketPath, int workerCount = 0, size_t cacheBudget = 64 * 1024 * 1024);
+
+    RecognitionServer(const RecognitionServer &) = delete;
+
+    RecognitionServer &operator=(const RecognitionServer &) = delete;
+
+    /**
+     * Closes the socket and removes its file.
+     */
+    ~RecognitionServer();
+
+    /**
+     * Starts the workers and serves requests on the calling thread until stop is called.
+     * Requests that weren't answered by then are dropped.
+     */
+    void run();
+
+    /**
+     * Makes run return. Can be called from any thread and from signal handlers.
+     */
+    void stop();
+
+    /**
+     * Returns the server's counters.
+     *
+     * @return The server's counters.
+     */
+    ServerStats getStats() const;
+};
+
+
+#endif //POLYTEST_RECOGNITIONSERVER_H
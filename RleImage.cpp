@@ -0,0 +1,353 @@
+#include <algorithm>
+#include <iomanip>
+#include "RleImage.h"
+
+
+static const unsigned char BACKGROUND = 0;
+
+// Returns the index of the first run in the row that ends at or after the given x coordinate.
+static size_t firstRunEndingFrom(const std::vector<RleRun> &row, int x)
+{
+    size_t low = 0;
+    size_t high = row.size();
+    while (low < high)
+    {
+        size_t middle = (low + high) / 2;
+        if (row[middle].end() < x)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+/**
+ * Creates a new run-length-encoded grayscale image of the given parameters.
+ *
+ * @param height The image height in pixels.
+ * @param width The image width in pixels.
+ * @param color The color to set all pixels to - defaults to 0 (black).
+ */
+RleImage::RleImage(int height, int width, unsigned char color) : _height(height), _width(width), _rows(height)
+{
+    if (color != BACKGROUND && width > 0)
+    {
+        for (std::vector<RleRun> &row : _rows)
+        {
+            row.push_back(RleRun(0, width, color));
+        }
+    }
+}
+
+/**
+ * Creates a new run-length-encoded image that has the same pixels as the given image.
+ *
+ * @param img The image to encode.
+ */
+RleImage::RleImage(const Image &img) : _height(img.getHeight()), _width(img.getWidth()), _rows(img.getHeight())
+{
+    for (int y = 0; y < _height; ++y)
+    {
+        std::vector<RleRun> &runs = _rows[y];
+        int x = 0;
+        while (x < _width)
+        {
+            int length;
+            const unsigned char *pixels = img.getRowPixels(x, y, length);
+            unsigned char color = pixels[0];
+            int runLength = 1;
+            while (runLength < length && pixels[runLength] == color)
+            {
+                runLength++;
+            }
+
+            if (color != BACKGROUND)
+            {
+                if (!runs.empty() && runs.back().color == color && runs.back().end() == x - 1)
+                {
+                    runs.back().length += runLength;
+                }
+                else
+                {
+                    runs.push_back(RleRun(x, runLength, color));
+                }
+            }
+            x += runLength;
+        }
+    }
+}
+
+/**
+ * Returns a regular image that has the same pixels as this image.
+ *
+ * @return a regular image that has the same pixels as this image.
+ */
+Image RleImage::toImage() const
+{
+    Image img(_height, _width, BACKGROUND);
+    for (int y = 0; y < _height; ++y)
+    {
+        for (const RleRun &run : _rows[y])
+        {
+            img.drawHorizontalLine(Vector2(run.start, y), run.end(), run.color);
+        }
+    }
+    return img;
+}
+
+/**
+ * Returns the image's width.
+ *
+ * @return The image's width.
+ */
+int RleImage::getWidth() const
+{
+    return _width;
+}
+
+/**
+ * Returns the image's height.
+ *
+ * @return The image's height.
+ */
+int RleImage::getHeight() const
+{
+    return _height;
+}
+
+/**
+ * Returns the total number of runs stored in this image.
+ *
+ * @return The total number of runs stored in this image.
+ */
+size_t RleImage::getRunCount() const
+{
+    size_t count = 0;
+    for (const std::vector<RleRun> &row : _rows)
+    {
+        count += row.size();
+    }
+    return count;
+}
+
+/**
+ * Returns the runs of the given row, sorted by their x coordinate.
+ * Throws exception if row is out of image bounds.
+ *
+ * @param y The y coordinate of the row.
+ * @return The runs of the given row, sorted by their x coordinate.
+ */
+const std::vector<RleRun> &RleImage::getRow(int y) const
+{
+    if (y < 0 || y >= _height)
+    {
+        throw ImageDimException();
+    }
+
+    return _rows[y];
+}
+
+/**
+ * Returns the run that contains the given pixel, or nullptr if the pixel is background.
+ * Throws exception if location is out of image bounds.
+ *
+ * @param x The x coordinate of the pixel.
+ * @param y The y coordinate of the pixel.
+ * @return The run that contains the given pixel, or nullptr if the pixel is background.
+ */
+const RleRun *RleImage::findRun(int x, int y) const
+{
+    if (x < 0 || x >= _width || y < 0 || y >= _height)
+    {
+        throw ImageDimException();
+    }
+
+    const std::vector<RleRun> &row = _rows[y];
+    size_t index = firstRunEndingFrom(row, x);
+    if (index < row.size() && row[index].start <= x)
+    {
+        return &row[index];
+    }
+    return nullptr;
+}
+
+/**
+ * Draws a pixel of the given color at the given location.
+ * Throws exception if location is out of image bounds.
+ *
+ * @param location 2d vector representing image location.
+ * @param color The color to draw (1 byte grayscale).
+ */
+void RleImage::drawPixel(const Vector2 &location, unsigned char color)
+{
+    if (location.x < 0 || location.x >= _width || location.y < 0 || location.y >= _height)
+    {
+        throw ImageDimException();
+    }
+
+    drawHorizontalLine(location, location.x, color);
+}
+
+/**
+ * Draws a horizontal line of the given color from the start location to the given x coordinate.
+ * The line is merged into the runs of its row.
+ *
+ * @param start 2d vector representing start location.
+ * @param xFinish The last x coordinate of the line.
+ * @param color The color to draw (1 byte grayscale).
+ */
+void RleImage::drawHorizontalLine(const Vector2 &start, int xFinish, unsigned char color)
+{
+    if (start.x < 0 || start.y < 0 || start.y >= _height || xFinish >= _width || start.x > xFinish)
+    {
+        throw ImageDimException();
+    }
+
+    std::vector<RleRun> &row = _rows[start.y];
+
+    // Runs in [first, last) overlap the new line.
+    size_t first = firstRunEndingFrom(row, start.x);
+    size_t last = first;
+    while (last < row.size() && row[last].start <= xFinish)
+    {
+        last++;
+    }
+
+    // Parts of the overlapped runs that stick out of the new line survive it.
+    bool hasLeft = first < last && row[first].start < start.x;
+    bool hasRight = first < last && row[last - 1].end() > xFinish;
+    RleRun left = hasLeft ? RleRun(row[first].start, start.x - row[first].start, row[first].color) : RleRun();
+    RleRun right = hasRight ? RleRun(xFinish + 1, row[last - 1].end() - xFinish, row[last - 1].color) : RleRun();
+
+    // Merge the new line with same-colored neighbours.
+    RleRun line(start.x, xFinish - start.x + 1, color);
+    if (color != BACKGROUND)
+    {
+        if (hasLeft && left.color == color)
+        {
+            line.length += line.start - left.start;
+            line.start = left.start;
+            hasLeft = false;
+        }
+        else if (!hasLeft && first > 0 && row[first - 1].end() == start.x - 1 && row[first - 1].color == color)
+        {
+            first--;
+            line.length += line.start - row[first].start;
+            line.start = row[first].start;
+        }
+
+        if (hasRight && right.color == color)
+        {
+            line.length = right.end() - line.start + 1;
+            hasRight = false;
+        }
+        else if (!hasRight && last < row.size() && row[last].start == xFinish + 1 && row[last].color == color)
+        {
+            line.length = row[last].end() - line.start + 1;
+            last++;
+        }
+    }
+
+    RleRun replacement[3];
+    size_t replacementSize = 0;
+    if (hasLeft)
+    {
+        replacement[replacementSize++] = left;
+    }
+    if (color != BACKGROUND)
+    {
+        // Background is never stored.
+        replacement[replacementSize++] = line;
+    }
+    if (hasRight)
+    {
+        replacement[replacementSize++] = right;
+    }
+
+    // Overwrite the overlapped runs in place, then erase or insert what is left.
+    size_t overlapSize = last - first;
+    size_t common = std::min(replacementSize, overlapSize);
+    std::copy(replacement, replacement + common, row.begin() + first);
+    if (overlapSize > replacementSize)
+    {
+        row.erase(row.begin() + first + common, row.begin() + last);
+    }
+    else
+    {
+        row.insert(row.begin() + first + common, replacement + common, replacement + replacementSize);
+    }
+}
+
+/**
+ * Return true if the given pixel is in the image bounds. Otherwise, returns false.
+ *
+ * @param x The x coordinate of the pixel.
+ * @param y The y coordinate of the pixel.
+ * @return true if the given pixel is in the image bounds. Otherwise, returns false.
+ */
+bool RleImage::isPixelValid(int x, int y) const
+{
+    return x >= 0 && x < _width && y >= 0 && y < _height;
+}
+
+/**
+* Return true if the given pixel is in the image bounds. Otherwise, returns false.
+*
+* @param location 2d vector representing image location.
+* @return true if the given pixel is in the image bounds. Otherwise, returns false.
+*/
+bool RleImage::isPixelValid(const Vector2 &location) const
+{
+    return isPixelValid(location.x, location.y);
+}
+
+/**
+ * Returns the intensity value of the given pixel.
+ * Throws exception if location is out of image bounds.
+ *
+ * @param x The x coordinate of the pixel.
+ * @param y The y coordinate of the pixel.
+ * @return The intensity value of the given pixel.
+ */
+unsigned char RleImage::getPixel(int x, int y) const
+{
+    const RleRun *run = findRun(x, y);
+    return run == nullptr ? BACKGROUND : run->color;
+}
+
+/**
+ * Returns the intensity value of the given pixel.
+ * Throws exception if location is out of image bounds.
+ *
+ * @param location 2d vector representing image location.
+ * @return The intensity value of the given pixel.
+ */
+unsigned char RleImage::getPixel(const Vector2 &location) const
+{
+    return getPixel(location.x, location.y);
+}
+
+/**
+ * Prints the image to the output stream (as integer matrix).
+ *
+ * @param os The output stream to send to.
+ * @param img The image to print.
+ * @return The output stream.
+ */
+std::ostream &operator<<(std::ostream &os, const RleImage &img) noexcept
+{
+    int lastColumn = img._width - 1;
+    for (int i = 0; i < img._height; i++)
+    {
+        for (int j = 0; j < lastColumn; j++)
+        {
+            os << std::setfill('0') << std::setw(3) << (int) img.getPixel(j, i) << " ";
+        }
+        os << std::setfill('0') << std::setw(3) << (int) img.getPixel(lastColumn, i) << std::endl;
+    }
+    return os;
+}
@@ -0,0 +1,184 @@
+//
+// Created by jacko on 30/10/2020.
+//
+
+#ifndef POLYTEST_RLEIMAGE_H
+#define POLYTEST_RLEIMAGE_H
+
+
+#include <ostream>
+#include <vector>
+#include "Image.h"
+
+
+/**
+ * Horizontal run of same-colored pixels in a single row of a run-length-encoded image.
+ */
+struct RleRun
+{
+    int start, length;
+    unsigned char color;
+
+    /**
+     * Creates a new run with the given parameters.
+     *
+     * @param s The x coordinate of the first pixel in the run - defaults to 0.
+     * @param l The number of pixels in the run - defaults to 0.
+     * @param c The color of the run (1 byte grayscale) - defaults to 0.
+     */
+    explicit RleRun(int s = 0, int l = 0, unsigned char c = 0) : start(s), length(l), color(c)
+    {}
+
+    /**
+     * Returns the x coordinate of the last pixel in the run.
+     *
+     * @return The x coordinate of the last pixel in the run.
+     */
+    int end() const
+    {
+        return start + length - 1;
+    }
+};
+
+/**
+ * Class representing a 2d grayscale image as per-row runs of same-colored pixels.
+ * Only non-zero (non-background) pixels are stored, so mostly empty images and
+ * images made of large flat-colored shapes take very little memory.
+ * Adjacent runs of the same color in a row are always merged.
+ */
+class RleImage
+{
+    int _height, _width;
+    std::vector<std::vector<RleRun>> _rows;
+
+public:
+    /**
+     * Creates a new run-length-encoded grayscale image of the given parameters.
+     *
+     * @param height The image height in pixels.
+     * @param width The image width in pixels.
+     * @param color The color to set all pixels to - defaults to 0 (black).
+     */
+    RleImage(int height, int width, unsigned char color = 0);
+
+    /**
+     * Creates a new run-length-encoded image that has the same pixels as the given image.
+     *
+     * @param img The image to encode.
+     */
+    explicit RleImage(const Image &img);
+
+    /**
+     * Returns a regular image that has the same pixels as this image.
+     *
+     * @return a regular image that has the same pixels as this image.
+     */
+    Image toImage() const;
+
+    /**
+     * Returns the image's width.
+     *
+     * @return The image's width.
+     */
+    int getWidth() const;
+
+    /**
+     * Returns the image's height.
+     *
+     * @return The image's height.
+     */
+    int getHeight() const;
+
+    /**
+     * Returns the total number of runs stored in this image.
+     *
+     * @return The total number of runs stored in this image.
+     */
+    size_t getRunCount() const;
+
+    /**
+     * Returns the runs of the given row, sorted by their x coordinate.
+     * Throws exception if row is out of image bounds.
+     *
+     * @param y The y coordinate of the row.
+     * @return The runs of the given row, sorted by their x coordinate.
+     */
+    const std::vector<RleRun> &getRow(int y) const;
+
+    /**
+     * Returns the run that contains the given pixel, or nullptr if the pixel is background.
+     * Throws exception if location is out of image bounds.
+     *
+     * @param x The x coordinate of the pixel.
+     * @param y The y coordinate of the pixel.
+     * @return The run that contains the given pixel, or nullptr if the pixel is background.
+     */
+    const RleRun *findRun(int x, int y) const;
+
+    /**
+     * Draws a pixel of the given color at the given location.
+     * Throws exception if location is out of image bounds.
+     *
+     * @param location 2d vector representing image location.
+     * @param color The color to draw (1 byte grayscale).
+     */
+    void drawPixel(const Vector2 &location, unsigned char color);
+
+    /**
+     * Draws a horizontal line of the given color from the start location to the given x coordinate.
+     * The line is merged into the runs of its row.
+     *
+     * @param start 2d vector representing start location.
+     * @param xFinish The last x coordinate of the line.
+     * @param color The color to draw (1 byte grayscale).
+     */
+    void drawHorizontalLine(const Vector2 &start, int xFinish, unsigned char color);
+
+    /**
+     * Return true if the given pixel is in the image bounds. Otherwise, returns false.
+     *
+     * @param x The x coordinate of the pixel.
+     * @param y The y coordinate of the pixel.
+     * @return true if the given pixel is in the image bounds. Otherwise, returns false.
+     */
+    bool isPixelValid(int x, int y) const;
+
+    /**
+    * Return true if the given pixel is in the image bounds. Otherwise, returns false.
+    *
+    * @param location 2d vector representing image location.
+    * @return true if the given pixel is in the image bounds. Otherwise, returns false.
+    */
+    bool isPixelValid(const Vector2 &location) const;
+
+    /**
+     * Returns the intensity value of the given pixel.
+     * Throws exception if location is out of image bounds.
+     *
+     * @param x The x coordinate of the pixel.
+     * @param y The y coordinate of the pixel.
+     * @return The intensity value of the given pixel.
+     */
+    unsigned char getPixel(int x, int y) const;
+
+    /**
+     * Returns the intensity value of the given pixel.
+     * Throws exception if location is out of image bounds.
+     *
+     * @param location 2d vector representing image location.
+     * @return The intensity value of the given pixel.
+     */
+    unsigned char getPixel(const Vector2 &location) const;
+
+    /**
+     * Prints the image to the output stream (as integer matrix).
+     *
+     * @param os The output stream to send to.
+     * @param img The image to print.
+     * @return The output stream.
+     */
+    friend std::ostream &operator<<(std::ostream &os, const RleImage &img) noexcept;
+};
+
+
+#endif //POLYTEST_RLEIMAGE_H
@@ -0,0 +1,653 @@
+#include <algorithm>
+#include <cstdio>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <new>
+#include <unistd.h>
+#include "ShapeList.h"
+
+
+static const unsigned char MAGIC[4] = {'S', 'H', 'P', 'L'};
+static const size_t HEADER_SIZE = 16;
+static const size_t RECORD_HEADER_SIZE = 4;
+static const size_t COORDINATE_SIZE = 4;
+
+// Returns the bigger of the two sizes.
+static constexpr size_t maxSize(size_t a, size_t b)
+{
+    return a > b ? a : b;
+}
+
+// Size and alignment of a ShapeBatch slot (enough for every kind of shape a list can hold).
+static const size_t SLOT_ALIGNMENT = maxSize(maxSize(maxSize(alignof(Triangle), alignof(Rectangle)), alignof(Circle)),
+                                            alignof(Polygon));
+static const size_t SLOT_SIZE = (maxSize(maxSize(maxSize(sizeof(Triangle), sizeof(Rectangle)), sizeof(Circle)),
+                                         sizeof(Polygon)) + SLOT_ALIGNMENT - 1) / SLOT_ALIGNMENT * SLOT_ALIGNMENT;
+
+// Reads a little-endian 16 bit unsigned integer.
+static uint16_t readUint16(const unsigned char *data)
+{
+    return (uint16_t) (data[0] | (data[1] << 8));
+}
+
+// Reads a little-endian 32 bit signed integer.
+static int32_t readInt32(const unsigned char *data)
+{
+    return (int32_t) ((uint32_t) data[0] | ((uint32_t) data[1] << 8) | ((uint32_t) data[2] << 16) |
+                      ((uint32_t) data[3] << 24));
+}
+
+// Appends a little-endian 16 bit unsigned integer.
+static void writeUint16(std::vector<unsigned char> &buffer, uint16_t value)
+{
+    buffer.push_back((unsigned char) value);
+    buffer.push_back((unsigned char) (value >> 8));
+}
+
+// Appends a little-endian 32 bit signed integer.
+static void writeInt32(std::vector<unsigned char> &buffer, int32_t value)
+{
+    uint32_t bits = (uint32_t) value;
+    buffer.push_back((unsigned char) bits);
+    buffer.push_back((unsigned char) (bits >> 8));
+    buffer.push_back((unsigned char) (bits >> 16));
+    buffer.push_back((unsigned char) (bits >> 24));
+}
+
+// Returns true if shapes of the given kind can have the given number of vertices (polygons have at least 3, the
+// other kinds a fixed number). Otherwise (also if the kind can't be serialized), returns false.
+static bool isValidVerticesSize(ShapeType type, int verticesSize)
+{
+    switch (type)
+    {
+        case ShapeType::POLYGON:
+            return verticesSize >= 3 && verticesSize <= UINT16_MAX;
+        case ShapeType::TRIANGLE:
+            return verticesSize == 3;
+        case ShapeType::RECTANGLE:
+            return verticesSize == 4;
+        case ShapeType::CIRCLE:
+            return verticesSize == 1;
+        default:
+            return false;
+    }
+}
+
+// Returns the size in bytes of a record of the given kind and number of vertices.
+static size_t getRecordSize(ShapeType type, int verticesSize)
+{
+    size_t size = RECORD_HEADER_SIZE + 2 * COORDINATE_SIZE * verticesSize;
+    return type == ShapeType::CIRCLE ? size + COORDINATE_SIZE : size;
+}
+
+/**
+ * Creates a view of the record that starts at the given address.
+ *
+ * @param data The first byte of the record.
+ */
+ShapeRecord::ShapeRecord(const unsigned char *data) : _data(data)
+{}
+
+/**
+ * Returns the kind of the shape.
+ *
+ * @return The kind of the shape.
+ */
+ShapeType ShapeRecord::getType() const
+{
+    return (ShapeType) _data[0];
+}
+
+/**
+ * Returns the color of the shape.
+ *
+ * @return The color of the shape.
+ */
+unsigned char ShapeRecord::getColor() const
+{
+    return _data[1];
+}
+
+/**
+ * Returns the number of vertices of the shape.
+ *
+ * @return The number of vertices of the shape.
+ */
+int ShapeRecord::getVerticesSize() const
+{
+    return readUint16(_data + 2);
+}
+
+/**
+ * Returns the vertex of the shape at the given index.
+ *
+ * @param index The index of the vertex (must be smaller than getVerticesSize()).
+ * @return The vertex of the shape at the given index.
+ */
+Vector2 ShapeRecord::getVertex(int index) const
+{
+    const unsigned char *vertex = _data + RECORD_HEADER_SIZE + 2 * COORDINATE_SIZE * index;
+    return Vector2(readInt32(vertex), readInt32(vertex + COORDINATE_SIZE));
+}
+
+/**
+ * Returns all vertices of the shape.
+ *
+ * @return All vertices of the shape.
+ */
+std::vector<Vector2> ShapeRecord::getVertices() const
+{
+    std::vector<Vector2> vertices;
+    for (int i = 0; i < getVerticesSize(); ++i)
+    {
+        vertices.push_back(getVertex(i));
+    }
+    return vertices;
+}
+
+/**
+ * Returns the radius of the shape (circles only).
+ *
+ * @return The radius of the shape.
+ */
+int ShapeRecord::getRadius() const
+{
+    return readInt32(_data + RECORD_HEADER_SIZE + 2 * COORDINATE_SIZE * getVerticesSize());
+}
+
+/**
+ * Returns the size of the record in bytes.
+ *
+ * @return The size of the record in bytes.
+ */
+size_t ShapeRecord::getSize() const
+{
+    return getRecordSize(getType(), getVerticesSize());
+}
+
+/**
+ * Returns a new shape object that is described by this record. (dynamic alloc)
+ *
+ * @return A new shape object that is described by this record.
+ */
+Shape *ShapeRecord::createShape() const
+{
+    switch (getType())
+    {
+        case ShapeType::TRIANGLE:
+            return new Triangle(getVertex(0), getVertex(1), getVertex(2), getColor());
+        case ShapeType::RECTANGLE:
+            return new Rectangle(getVertex(0), getVertex(1), getVertex(2), getVertex(3), getColor());
+        case ShapeType::CIRCLE:
+            return new Circle(getVertex(0), getRadius(), getColor());
+        case ShapeType::POLYGON:
+            return new Polygon(getVertices(), getColor());
+        default:
+            throw ShapeFormatException();
+    }
+}
+
+/**
+ * Constructs the shape that is described by this record at the given location.
+ *
+ * @param location Memory for the shape, big and aligned enough for any shape kind a list can hold.
+ * @return The new shape object (at the given location).
+ */
+Shape *ShapeRecord::createShape(void *location) const
+{
+    switch (getType())
+    {
+        case ShapeType::TRIANGLE:
+            return new(location) Triangle(getVertex(0), getVertex(1), getVertex(2), getColor());
+        case ShapeType::RECTANGLE:
+            return new(location) Rectangle(getVertex(0), getVertex(1), getVertex(2), getVertex(3), getColor());
+        case ShapeType::CIRCLE:
+            return new(location) Circle(getVertex(0), getRadius(), getColor());
+        case ShapeType::POLYGON:
+            return new(location) Polygon(getVertices(), getColor());
+        default:
+            throw ShapeFormatException();
+    }
+}
+
+/**
+ * Creates an iterator that points to the record at the given address.
+ *
+ * @param current The first byte of the record.
+ */
+ShapeListView::Iterator::Iterator(const unsigned char *current) : _current(current)
+{}
+
+/**
+ * Returns the record the iterator points to.
+ *
+ * @return The record the iterator points to.
+ */
+ShapeRecord ShapeListView::Iterator::operator*() const
+{
+    return ShapeRecord(_current);
+}
+
+/**
+ * Moves the iterator to the next record.
+ *
+ * @return This iterator.
+ */
+ShapeListView::Iterator &ShapeListView::Iterator::operator++()
+{
+    _current += ShapeRecord(_current).getSize();
+    return *this;
+}
+
+/**
+ * Returns true if the iterators point to different records. Otherwise, returns false.
+ *
+ * @param other The iterator to compare with.
+ * @return true if the iterators point to different records. Otherwise, returns false.
+ */
+bool ShapeListView::Iterator::operator!=(const Iterator &other) const
+{
+    return _current != other._current;
+}
+
+// Returns true if the given coordinate is within ShapeListView::MAX_COORDINATE. Otherwise, returns false.
+static bool isCoordinateInRange(int32_t value)
+{
+    return value >= -ShapeListView::MAX_COORDINATE && value <= ShapeListView::MAX_COORDINATE;
+}
+
+// Returns true if the given record's coordinates (and radius) are within MAX_COORDINATE and its radius isn't negative.
+// Otherwise, returns false.
+static bool isRecordInRange(const ShapeRecord &record)
+{
+    for (int i = 0; i < record.getVerticesSize(); ++i)
+    {
+        Vector2 vertex = record.getVertex(i);
+        if (!isCoordinateInRange(vertex.x) || !isCoordinateInRange(vertex.y))
+        {
+            return false;
+        }
+    }
+    return record.getType() != ShapeType::CIRCLE ||
+           (record.getRadius() >= 0 && record.getRadius() <= ShapeListView::MAX_COORDINATE);
+}
+
+/**
+ * Creates a view of the serialized shape list in the given buffer.
+ * The whole buffer is validated once, so reading the records afterwards can't go out of bounds.
+ * Throws ShapeFormatException if the buffer doesn't hold a valid shape list (also if a coordinate or radius is
+ * out of range, see MAX_COORDINATE).
+ *
+ * @param data The buffer (must outlive this view).
+ * @param size The size of the buffer in bytes.
+ */
+ShapeListView::ShapeListView(const void *data, size_t size) : _data((const unsigned char *) data), _size(size),
+                                                              _count(0)
+{
+    if (_size < HEADER_SIZE || !std::equal(MAGIC, MAGIC + 4, _data) || readUint16(_data + 4) != VERSION)
+    {
+        throw ShapeFormatException();
+    }
+
+    int32_t count = readInt32(_data + 8);
+    if (count < 0)
+    {
+        throw ShapeFormatException();
+    }
+
+    size_t offset = HEADER_SIZE;
+    for (int32_t i = 0; i < count; ++i)
+    {
+        if (_size - offset < RECORD_HEADER_SIZE)
+        {
+            throw ShapeFormatException();
+        }
+
+        ShapeRecord record(_data + offset);
+        if (!isValidVerticesSize(record.getType(), record.getVerticesSize()) ||
+            _size - offset < record.getSize() || !isRecordInRange(record))
+        {
+            throw ShapeFormatException();
+        }
+        offset += record.getSize();
+    }
+
+    if (offset != _size)
+    {
+        throw ShapeFormatException();
+    }
+    _count = count;
+}
+
+/**
+ * Returns the number of shapes in the list.
+ *
+ * @return The number of shapes in the list.
+ */
+int ShapeListView::getCount() const
+{
+    return _count;
+}
+
+/**
+ * Returns an iterator to the first record.
+ *
+ * @return An iterator to the first record.
+ */
+ShapeListView::Iterator ShapeListView::begin() const
+{
+    return Iterator(_data + HEADER_SIZE);
+}
+
+/**
+ * Returns an iterator past the last record.
+ *
+ * @return An iterator past the last record.
+ */
+ShapeListView::Iterator ShapeListView::end() const
+{
+    return Iterator(_data + _size);
+}
+
+/**
+ * Returns an array of pointers to new Shapes described by the list (in list order).
+ * The output array (and all pointers in it) needs to be freed (either manually or with freeShapesArray).
+ *
+ * @param arrSize This will be set to the size of the output array.
+ * @return An array of pointers to new Shapes described by the list.
+ */
+Shape **ShapeListView::load(int &arrSize) const
+{
+    arrSize = _count;
+    auto **shapesArray = new Shape *[arrSize];
+    int i = 0;
+    for (ShapeRecord record : *this)
+    {
+        shapesArray[i++] = record.createShape();
+    }
+    return shapesArray;
+}
+
+/**
+ * Serializes the given shapes to the given buffer (replacing its content).
+ * Throws ShapeFormatException if a shape can't be serialized (default constructed or of unknown kind).
+ *
+ * @param shapes An array of shape pointers.
+ * @param size The size of the shapes array.
+ * @param buffer The buffer to serialize into.
+ */
+void ShapeListView::serialize(const Shape *const *shapes, int size, std::vector<unsigned char> &buffer)
+{
+    size_t totalSize = HEADER_SIZE;
+    for (int i = 0; i < size; ++i)
+    {
+        ShapeType type = shapes[i]->getType();
+        if (!isValidVerticesSize(type, shapes[i]->getVerticesSize()))
+        {
+            throw ShapeFormatException();
+        }
+        totalSize += getRecordSize(type, shapes[i]->getVerticesSize());
+    }
+
+    buffer.clear();
+    buffer.reserve(totalSize);
+    buffer.insert(buffer.end(), MAGIC, MAGIC + 4);
+    writeUint16(buffer, VERSION);
+    writeUint16(buffer, 0);
+    writeInt32(buffer, size);
+    writeInt32(buffer, 0);
+
+    for (int i = 0; i < size; ++i)
+    {
+        const Shape *shape = shapes[i];
+        ShapeType type = shape->getType();
+        buffer.push_back((unsigned char) type);
+        buffer.push_back(shape->getColor());
+        writeUint16(buffer, (uint16_t) shape->getVerticesSize());
+
+        const Vector2 *vertices = shape->getVertices();
+        for (int j = 0; j < shape->getVerticesSize(); ++j)
+        {
+            writeInt32(buffer, vertices[j].x);
+            writeInt32(buffer, vertices[j].y);
+        }
+        if (type == ShapeType::CIRCLE)
+        {
+            writeInt32(buffer, static_cast<const Circle *>(shape)->getRadius());
+        }
+    }
+}
+
+/**
+ * Loads all shapes of the given list (in list order).
+ *
+ * @param list The shape list to load.
+ */
+ShapeBatch::ShapeBatch(const ShapeListView &list) : _storage(nullptr), _shapes(nullptr), _size(0)
+{
+    // Over-allocate by one slot so the first slot can be aligned.
+    _storage = new unsigned char[(list.getCount() + 1) * SLOT_SIZE];
+    _shapes = new const Shape *[list.getCount()];
+    unsigned char *slot = _storage + (SLOT_ALIGNMENT - (uintptr_t) _storage % SLOT_ALIGNMENT) % SLOT_ALIGNMENT;
+    for (ShapeRecord record : list)
+    {
+        _shapes[_size++] = record.createShape(slot);
+        slot += SLOT_SIZE;
+    }
+}
+
+/**
+ * Destructs all shapes of the batch.
+ */
+ShapeBatch::~ShapeBatch()
+{
+    for (int i = 0; i < _size; ++i)
+    {
+        _shapes[i]->~Shape();
+    }
+    delete[] _shapes;
+    delete[] _storage;
+}
+
+/**
+ * Returns the number of shapes in the batch.
+ *
+ * @return The number of shapes in the batch.
+ */
+int ShapeBatch::getSize() const
+{
+    return _size;
+}
+
+/**
+ * Returns an array of pointers to the shapes of the batch (owned by the batch).
+ * Can be passed directly to Shape::drawShapesToImage.
+ *
+ * @return An array of pointers to the shapes of the batch.
+ */
+const Shape **ShapeBatch::getShapes() const
+{
+    return _shapes;
+}
+
+/**
+ * Applies the given transform to all shapes of the batch, in place and ready to draw.
+ * All vertices are transformed together in one pass, then each shape is rebuilt in its own slot, so nothing is
+ * allocated per shape (except for polygons of more than 4 vertices). Rectangles become general quads (still of
+ * type RECTANGLE) and circle radii are scaled (see AffineTransform::applyToRadius). Mirroring transforms keep
+ * the vertices clockwise.
+ * Pointers from getShapes stay valid.
+ * Throws TransformRangeException (leaving the batch as it was) if a transformed coordinate or radius isn't within
+ * ShapeListView::MAX_COORDINATE.
+ * If a polygon's vertices can't be allocated, std::bad_alloc is thrown and that polygon is left empty (draws nothing),
+ * with the shapes after it not transformed.
+ *
+ * @param transform The transform to apply.
+ */
+void ShapeBatch::transform(const AffineTransform &transform)
+{
+    std::vector<int32_t> xs, ys;
+    for (int i = 0; i < _size; ++i)
+    {
+        const Vector2 *vertices = _shapes[i]->getVertices();
+        for (int j = 0; j < _shapes[i]->getVerticesSize(); ++j)
+        {
+            xs.push_back(vertices[j].x);
+            ys.push_back(vertices[j].y);
+        }
+    }
+    transform.apply(xs.data(), ys.data(), xs.data(), ys.data(), (int) xs.size());
+
+    // The shapes are only rebuilt once all of their coordinates and radii are known to be in range, so a transform
+    // that takes them out of it leaves the batch as it was.
+    std::vector<int> radii;
+    for (int i = 0; i < _size; ++i)
+    {
+        if (_shapes[i]->getType() == ShapeType::CIRCLE)
+        {
+            radii.push_back(transform.applyToRadius(static_cast<const Circle *>(_shapes[i])->getRadius()));
+        }
+    }
+    if (!std::all_of(xs.begin(), xs.end(), isCoordinateInRange) ||
+        !std::all_of(ys.begin(), ys.end(), isCoordinateInRange) ||
+        !std::all_of(radii.begin(), radii.end(), isCoordinateInRange))
+    {
+        throw TransformRangeException();
+    }
+
+    // A mirrored shape's vertices are taken backwards from the first one, to keep them clockwise.
+    bool isMirroring = transform.isMirroring();
+    size_t first = 0, circle = 0;
+    std::vector<Vector2> vertices;
+    for (int i = 0; i < _size; ++i)
+    {
+        const Shape *shape = _shapes[i];
+        ShapeType type = shape->getType();
+        unsigned char color = shape->getColor();
+        int verticesSize = shape->getVerticesSize();
+        vertices.clear();
+        for (int j = 0; j < verticesSize; ++j)
+        {
+            size_t index = first + (isMirroring ? (verticesSize - j) % verticesSize : j);
+            vertices.push_back(Vector2(xs[index], ys[index]));
+        }
+        first += verticesSize;
+
+        void *slot = const_cast<Shape *>(shape);
+        shape->~Shape();
+        try
+        {
+            switch (type)
+            {
+                case ShapeType::TRIANGLE:
+                    _shapes[i] = new(slot) Triangle(vertices[0], vertices[1], vertices[2], color);
+                    break;
+                case ShapeType::RECTANGLE:
+                    _shapes[i] = new(slot) Rectangle(vertices[0], vertices[1], vertices[2], vertices[3], color);
+                    break;
+                case ShapeType::CIRCLE:
+                    _shapes[i] = new(slot) Circle(vertices[0], radii[circle++], color);
+                    break;
+                default:
+                    _shapes[i] = new(slot) Polygon(vertices, color);
+                    break;
+            }
+        }
+        catch (...)
+        {
+            // The old shape is gone, so the slot gets an empty polygon (that allocates nothing) for the destructor.
+            _shapes[i] = new(slot) Polygon();
+            throw;
+        }
+    }
+}
+
+/**
+ * Maps the given shape list file.
+ * Throws ShapeFileException if the file can't be mapped and ShapeFormatException if it isn't a valid list.
+ *
+ * @param path The path of the file.
+ */
+ShapeListFile::ShapeListFile(const char *path) : _mapping(nullptr), _size(0), _view(nullptr)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd == -1)
+    {
+        throw ShapeFileException();
+    }
+
+    struct stat fileStat{};
+    if (fstat(fd, &fileStat) == -1)
+    {
+        close(fd);
+        throw ShapeFileException();
+    }
+    if ((size_t) fileStat.st_size < HEADER_SIZE)
+    {
+        close(fd);
+        throw ShapeFormatException();
+    }
+
+    _size = (size_t) fileStat.st_size;
+    _mapping = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (_mapping == MAP_FAILED)
+    {
+        throw ShapeFileException();
+    }
+
+    try
+    {
+        _view = new ShapeListView(_mapping, _size);
+    }
+    catch (...)
+    {
+        munmap(_mapping, _size);
+        throw;
+    }
+}
+
+/**
+ * Unmaps the file.
+ */
+ShapeListFile::~ShapeListFile()
+{
+    delete _view;
+    munmap(_mapping, _size);
+}
+
+/**
+ * Returns a view of the mapped shape list.
+ *
+ * @return A view of the mapped shape list.
+ */
+const ShapeListView &ShapeListFile::getView() const
+{
+    return *_view;
+}
+
+/**
+ * Serializes the given shapes to the given file (replacing it).
+ * Throws ShapeFileException if the file can't be written.
+ *
+ * @param path The path of the file.
+ * @param shapes An array of shape pointers.
+ * @param size The size of the shapes array.
+ */
+void ShapeListFile::write(const char *path, const Shape *const *shapes, int size)
+{
+    std::vector<unsigned char> buffer;
+    ShapeListView::serialize(shapes, size, buffer);
+
+    FILE *file = std::fopen(path, "wb");
+    if (file == nullptr)
+    {
+        throw ShapeFileException();
+    }
+    bool written = std::fwrite(buffer.data(), 1, buffer.size(), file) == buffer.size();
+    if (std::fclose(file) != 0 || !written)
+    {
+        throw ShapeFileException();
+    }
+}
@@ -0,0 +1,348 @@
+//
+// Created by jacko on 30/10/2020.
+//
+
+#ifndef POLYTEST_SHAPELIST_H
+#define POLYTEST_SHAPELIST_H
+
+
+#include <cstdint>
+#include <vector>
+#include "AffineTransform.h"
+#include "Shapes.h"
+
+
+#define ERROR_SHAPE_FORMAT "ERROR: Shape list data is malformed or has an unsupported version."
+#define ERROR_SHAPE_FILE "ERROR: Couldn't read or write the shape list file."
+
+
+/**
+ * Exception for malformed or unsupported serialized shape lists.
+ */
+class ShapeFormatException : public std::exception
+{
+public:
+    const char *what() const noexcept override
+    {
+        return ERROR_SHAPE_FORMAT;
+    }
+};
+
+/**
+ * Exception for problems opening, mapping or writing shape list files.
+ */
+class ShapeFileException : public std::exception
+{
+public:
+    const char *what() const noexcept override
+    {
+        return ERROR_SHAPE_FILE;
+    }
+};
+
+/**
+ * Read-only view of a single serialized shape, read in place from its shape list.
+ *
+ * Record layout (little-endian): type (1 byte), color (1 byte), vertices size (2 bytes),
+ * vertices (4 bytes x and 4 bytes y each), and for circles the radius (4 bytes).
+ */
+class ShapeRecord
+{
+    const unsigned char *_data;
+
+public:
+    /**
+     * Creates a view of the record that starts at the given address.
+     *
+     * @param data The first byte of the record.
+     */
+    explicit ShapeRecord(const unsigned char *data);
+
+    /**
+     * Returns the kind of the shape.
+     *
+     * @return The kind of the shape.
+     */
+    ShapeType getType() const;
+
+    /**
+     * Returns the color of the shape.
+     *
+     * @return The color of the shape.
+     */
+    unsigned char getColor() const;
+
+    /**
+     * Returns the number of vertices of the shape.
+     *
+     * @return The number of vertices of the shape.
+     */
+    int getVerticesSize() const;
+
+    /**
+     * Returns the vertex of the shape at the given index.
+     *
+     * @param index The index of the vertex (must be smaller than getVerticesSize()).
+     * @return The vertex of the shape at the given index.
+     */
+    Vector2 getVertex(int index) const;
+
+    /**
+     * Returns all vertices of the shape.
+     *
+     * @return All vertices of the shape.
+     */
+    std::vector<Vector2> getVertices() const;
+
+    /**
+     * Returns the radius of the shape (circles only).
+     *
+     * @return The radius of the shape.
+     */
+    int getRadius() const;
+
+    /**
+     * Returns the size of the record in bytes.
+     *
+     * @return The size of the record in bytes.
+     */
+    size_t getSize() const;
+
+    /**
+     * Returns a new shape object that is described by this record. (dynamic alloc)
+     *
+     * @return A new shape object that is described by this record.
+     */
+    Shape *createShape() const;
+
+    /**
+     * Constructs the shape that is described by this record at the given location.
+     *
+     * @param location Memory for the shape, big and aligned enough for any shape kind a list can hold.
+     * @return The new shape object (at the given location).
+     */
+    Shape *createShape(void *location) const;
+};
+
+/**
+ * Read-only view of a serialized shape list that lives in a caller owned buffer (for example a memory-mapped file).
+ * Shapes are read in place; nothing is deserialized until load is called.
+ *
+ * Layout (little-endian): magic "SHPL", version (2 bytes), reserved (2 bytes), shapes count (4 bytes),
+ * reserved (4 bytes), followed by one ShapeRecord per shape.
+ * Coordinates and radii of a valid list are within MAX_COORDINATE (radii aren't negative), so any valid list can be
+ * rendered without overflow.
+ */
+class ShapeListView
+{
+    const unsigned char *_data;
+    size_t _size;
+    int _count;
+
+public:
+    /**
+     * Current version of the format.
+     */
+    static const int VERSION = 1;
+
+    /**
+     * Largest absolute value of a coordinate (and largest radius) in a valid list.
+     */
+    static const int32_t MAX_COORDINATE = 1 << 20;
+
+    /**
+     * Iterates over the records of a shape list.
+     */
+    class Iterator
+    {
+        const unsigned char *_current;
+
+    public:
+        /**
+         * Creates an iterator that points to the record at the given address.
+         *
+         * @param current The first byte of the record.
+         */
+        explicit Iterator(const unsigned char *current);
+
+        /**
+         * Returns the record the iterator points to.
+         *
+         * @return The record the iterator points to.
+         */
+        ShapeRecord operator*() const;
+
+        /**
+         * Moves the iterator to the next record.
+         *
+         * @return This iterator.
+         */
+        Iterator &operator++();
+
+        /**
+         * Returns true if the iterators point to different records. Otherwise, returns false.
+         *
+         * @param other The iterator to compare with.
+         * @return true if the iterators point to different records. Otherwise, returns false.
+         */
+        bool operator!=(const Iterator &other) const;
+    };
+
+    /**
+     * Creates a view of the serialized shape list in the given buffer.
+     * The whole buffer is validated once, so reading the records afterwards can't go out of bounds.
+     * Throws ShapeFormatException if the buffer doesn't hold a valid shape list (also if a coordinate or radius is
+     * out of range, see MAX_COORDINATE).
+     *
+     * @param data The buffer (must outlive this view).
+     * @param size The size of the buffer in bytes.
+     */
+    ShapeListView(const void *data, size_t size);
+
+    /**
+     * Returns the number of shapes in the list.
+     *
+     * @return The number of shapes in the list.
+     */
+    int getCount() const;
+
+    /**
+     * Returns an iterator to the first record.
+     *
+     * @return An iterator to the first record.
+     */
+    Iterator begin() const;
+
+    /**
+     * Returns an iterator past the last record.
+     *
+     * @return An iterator past the last record.
+     */
+    Iterator end() const;
+
+    /**
+     * Returns an array of pointers to new Shapes described by the list (in list order).
+     * The output array (and all pointers in it) needs to be freed (either manually or with freeShapesArray).
+     *
+     * @param arrSize This will be set to the size of the output array.
+     * @return An array of pointers to new Shapes described by the list.
+     */
+    Shape **load(int &arrSize) const;
+
+    /**
+     * Serializes the given shapes to the given buffer (replacing its content).
+     * Throws ShapeFormatException if a shape can't be serialized (default constructed or of unknown kind).
+     *
+     * @param shapes An array of shape pointers.
+     * @param size The size of the shapes array.
+     * @param buffer The buffer to serialize into.
+     */
+    static void serialize(const Shape *const *shapes, int size, std::vector<unsigned char> &buffer);
+};
+
+/**
+ * Shapes that were bulk-loaded from a shape list into a single block of memory.
+ * Much faster to load (and free) than a list of separately allocated shapes.
+ */
+class ShapeBatch
+{
+    unsigned char *_storage;
+    const Shape **_shapes;
+    int _size;
+
+public:
+    /**
+     * Loads all shapes of the given list (in list order).
+     *
+     * @param list The shape list to load.
+     */
+    explicit ShapeBatch(const ShapeListView &list);
+
+    ShapeBatch(const ShapeBatch &) = delete;
+
+    ShapeBatch &operator=(const ShapeBatch &) = delete;
+
+    /**
+     * Destructs all shapes of the batch.
+     */
+    ~ShapeBatch();
+
+    /**
+     * Returns the number of shapes in the batch.
+     *
+     * @return The number of shapes in the batch.
+     */
+    int getSize() const;
+
+    /**
+     * Returns an array of pointers to the shapes of the batch (owned by the batch).
+     * Can be passed directly to Shape::drawShapesToImage.
+     *
+     * @return An array of pointers to the shapes of the batch.
+     */
+    const Shape **getShapes() const;
+
+    /**
+     * Applies the given transform to all shapes of the batch, in place and ready to draw.
+     * All vertices are transformed together in one pass, then each shape is rebuilt in its own slot, so nothing is
+     * allocated per shape (except for polygons of more than 4 vertices). Rectangles become general quads (still of
+     * type RECTANGLE) and circle radii are scaled (see AffineTransform::applyToRadius). Mirroring transforms keep
+     * the vertices clockwise.
+     * Pointers from getShapes stay valid.
+     * Throws TransformRangeException (leaving the batch as it was) if a transformed coordinate or radius isn't within
+     * ShapeListView::MAX_COORDINATE.
+     * If a polygon's vertices can't be allocated, std::bad_alloc is thrown and that polygon is left empty (draws
+     * nothing), with the shapes after it not transformed.
+     *
+     * @param transform The transform to apply.
+     */
+    void transform(const AffineTransform &transform);
+};
+
+/**
+ * Serialized shape list file that is memory-mapped (read-only) for as long as this object lives.
+ */
+class ShapeListFile
+{
+    void *_mapping;
+    size_t _size;
+    ShapeListView *_view;
+
+public:
+    /**
+     * Maps the given shape list file.
+     * Throws ShapeFileException if the file can't be mapped and ShapeFormatException if it isn't a valid list.
+     *
+     * @param path The path of the file.
+     */
+    explicit ShapeListFile(const char *path);
+
+    ShapeListFile(const ShapeListFile &) = delete;
+
+    ShapeListFile &operator=(const ShapeListFile &) = delete;
+
+    /**
+     * Unmaps the file.
+     */
+    ~ShapeListFile();
+
+    /**
+     * Returns a view of the mapped shape list.
+     *
+     * @return A view of the mapped shape list.
+     */
+    const ShapeListView &getView() const;
+
+    /**
+     * Serializes the given shapes to the given file (replacing it).
+     * Throws ShapeFileException if the file can't be written.
+     *
+     * @param path The path of the file.
+     * @param shapes An array of shape pointers.
+     * @param size The size of the shapes array.
+     */
+    static void write(const char *path, const Shape *const *shapes, int size);
+};
+
+
+#endif //POLYTEST_SHAPELIST_H
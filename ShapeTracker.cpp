@@ -0,0 +1,533 @@
+#include <algorithm>
+#include <map>
+#include <unordered_map>
+#include "ShapeTracker.h"
+
+
+static const unsigned char BACKGROUND = 0;
+
+// Most removed and found shapes of the same key that are matched by distance (more are matched in found order).
+static const size_t MAX_MATCH_PAIRS = 1 << 16;
+
+// Returns the bounding box of the pixels of the given shape.
+static ImageRegion getShapeBounds(const Shape &shape, std::vector<Span> &spans)
+{
+    spans.clear();
+    shape.getSpans(spans);
+    ImageRegion bounds{Vector2(spans[0].xStart, spans[0].y), Vector2(spans[0].xEnd, spans.back().y)};
+    for (const Span &span : spans)
+    {
+        bounds.topLeft.x = std::min(bounds.topLeft.x, span.xStart);
+        bounds.bottomRight.x = std::max(bounds.bottomRight.x, span.xEnd);
+    }
+    return bounds;
+}
+
+// Returns true if the given region is inside the other given region. Otherwise, returns false.
+static bool isInside(const ImageRegion &region, const ImageRegion &otherRegion)
+{
+    return region.topLeft.x >= otherRegion.topLeft.x && region.topLeft.y >= otherRegion.topLeft.y &&
+           region.bottomRight.x <= otherRegion.bottomRight.x && region.bottomRight.y <= otherRegion.bottomRight.y;
+}
+
+// Returns the key that the same shape has wherever it is: its kind, color and size.
+static std::vector<int> getShapeKey(const Shape &shape)
+{
+    const Vector2 *vertices = shape.getVertices();
+    std::vector<int> key{(int) shape.getType(), shape.getColor()};
+    if (shape.getType() == ShapeType::CIRCLE)
+    {
+        key.push_back(static_cast<const Circle &>(shape).getRadius());
+    }
+    for (int i = 1; i < shape.getVerticesSize(); ++i)
+    {
+        key.push_back(vertices[i].x - vertices[0].x);
+        key.push_back(vertices[i].y - vertices[0].y);
+    }
+    return key;
+}
+
+// Returns true if the two given shapes are the same (kind, color and vertices). Otherwise, returns false.
+static bool isSameShape(const Shape &shape, const Shape &otherShape)
+{
+    if (shape.getType() != otherShape.getType() || shape.getColor() != otherShape.getColor() ||
+        shape.getVerticesSize() != otherShape.getVerticesSize())
+    {
+        return false;
+    }
+    if (shape.getType() == ShapeType::CIRCLE &&
+        static_cast<const Circle &>(shape).getRadius() != static_cast<const Circle &>(otherShape).getRadius())
+    {
+        return false;
+    }
+    const Vector2 *vertices = shape.getVertices(), *otherVertices = otherShape.getVertices();
+    for (int i = 0; i < shape.getVerticesSize(); ++i)
+    {
+        if (vertices[i].x != otherVertices[i].x || vertices[i].y != otherVertices[i].y)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Returns a key of the given location.
+static uint64_t getPlaceKey(const Vector2 &location)
+{
+    return (uint64_t) (uint32_t) location.x << 32 | (uint32_t) location.y;
+}
+
+// Tile grid of a frame, where each tile is marked if it has to be scanned.
+class DirtyTiles
+{
+    int _height, _width, _tilesPerRow, _tileRows;
+    std::vector<bool> _tiles;
+
+public:
+    // Creates the grid of the given frame size with the given marked tiles (row-major, as in ImageDiff).
+    DirtyTiles(int height, int width, std::vector<bool> tiles) : _height(height), _width(width),
+                                                                _tilesPerRow((width + Image::TILE_SIZE - 1) /
+                                                                             Image::TILE_SIZE),
+                                                                _tileRows((height + Image::TILE_SIZE - 1) /
+                                                                          Image::TILE_SIZE),
+                                                                _tiles(std::move(tiles))
+    {}
+
+    // Returns true if a marked tile has a pixel of the given region or touches it. Otherwise, returns false.
+    bool isTouching(const ImageRegion &region) const
+    {
+        int firstX = std::max(0, region.topLeft.x - 1) / Image::TILE_SIZE;
+        int firstY = std::max(0, region.topLeft.y - 1) / Image::TILE_SIZE;
+        int lastX = std::min(_width - 1, region.bottomRight.x + 1) / Image::TILE_SIZE;
+        int lastY = std::min(_height - 1, region.bottomRight.y + 1) / Image::TILE_SIZE;
+        for (int tileY = firstY; tileY <= lastY; ++tileY)
+        {
+            for (int tileX = firstX; tileX <= lastX; ++tileX)
+            {
+                if (_tiles[(size_t) tileY * _tilesPerRow + tileX])
+                {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    // Marks the tiles that have a pixel of the given region (in tiles, not pixels). Returns true if any of them
+    // wasn't marked. Otherwise, returns false.
+    bool markTiles(const ImageRegion &tileRegion)
+    {
+        bool isMarking = false;
+        for (int tileY = tileRegion.topLeft.y; tileY <= tileRegion.bottomRight.y; ++tileY)
+        {
+            for (int tileX = tileRegion.topLeft.x; tileX <= tileRegion.bottomRight.x; ++tileX)
+            {
+                std::vector<bool>::reference tile = _tiles[(size_t) tileY * _tilesPerRow + tileX];
+                isMarking = isMarking || !tile;
+                tile = true;
+            }
+        }
+        return isMarking;
+    }
+
+    // Marks the tiles that have a pixel of the given region. Returns true if any of them wasn't marked. Otherwise,
+    // returns false.
+    bool mark(const ImageRegion &region)
+    {
+        return markTiles(ImageRegion{Vector2(region.topLeft.x / Image::TILE_SIZE, region.topLeft.y / Image::TILE_SIZE),
+                                     Vector2(region.bottomRight.x / Image::TILE_SIZE,
+                                             region.bottomRight.y / Image::TILE_SIZE)});
+    }
+
+    // Sets regions to the bounding boxes of the groups of marked tiles that are connected (also diagonally), and
+    // marks all tiles of each bounding box. Returns true if any tile wasn't marked. Otherwise, returns false.
+    bool findRegions(std::vector<ImageRegion> &regions)
+    {
+        std::vector<ImageRegion> tileRegions;
+        std::vector<bool> visited(_tiles.size(), false);
+        std::vector<Vector2> stack;
+        for (int seedY = 0; seedY < _tileRows; ++seedY)
+        {
+            for (int seedX = 0; seedX < _tilesPerRow; ++seedX)
+            {
+                size_t seed = (size_t) seedY * _tilesPerRow + seedX;
+                if (!_tiles[seed] || visited[seed])
+                {
+                    continue;
+                }
+
+                visited[seed] = true;
+                stack.push_back(Vector2(seedX, seedY));
+                ImageRegion tileRegion{stack.back(), stack.back()};
+                while (!stack.empty())
+                {
+                    Vector2 tile = stack.back();
+                    stack.pop_back();
+                    tileRegion.topLeft = Vector2(std::min(tileRegion.topLeft.x, tile.x),
+                                                 std::min(tileRegion.topLeft.y, tile.y));
+                    tileRegion.bottomRight = Vector2(std::max(tileRegion.bottomRight.x, tile.x),
+                                                     std::max(tileRegion.bottomRight.y, tile.y));
+                    for (int y = std::max(0, tile.y - 1); y <= std::min(_tileRows - 1, tile.y + 1); ++y)
+                    {
+                        for (int x = std::max(0, tile.x - 1); x <= std::min(_tilesPerRow - 1, tile.x + 1); ++x)
+                        {
+                            size_t index = (size_t) y * _tilesPerRow + x;
+                            if (_tiles[index] && !visited[index])
+                            {
+                                visited[index] = true;
+                                stack.push_back(Vector2(x, y));
+                            }
+                        }
+                    }
+                }
+                tileRegions.push_back(tileRegion);
+            }
+        }
+
+        bool isMarking = false;
+        regions.clear();
+        for (const ImageRegion &tileRegion : tileRegions)
+        {
+            isMarking = markTiles(tileRegion) || isMarking;
+            int right = std::min(_width, (tileRegion.bottomRight.x + 1) * Image::TILE_SIZE) - 1;
+            int bottom = std::min(_height, (tileRegion.bottomRight.y + 1) * Image::TILE_SIZE) - 1;
+            regions.push_back(ImageRegion{Vector2(tileRegion.topLeft.x * Image::TILE_SIZE,
+                                                  tileRegion.topLeft.y * Image::TILE_SIZE), Vector2(right, bottom)});
+        }
+        return isMarking;
+    }
+};
+
+// scans the given regions of the current frame, adding their shapes to found. Returns false (and frees found) if
+// a shape reaches out of its region or a region smaller than the frame has a hole (a background colored triangle), so
+// the regions don't hold whole shapes.
+bool ShapeTracker::_scanRegions(const std::vector<ImageRegion> &regions, std::vector<TrackedShape> &found,
+                                TrackStats &stats) const
+{
+    const ImageRegion frameRegion{Vector2(0, 0), Vector2(_frame.getWidth() - 1, _frame.getHeight() - 1)};
+    std::vector<Span> spans;
+    bool isWhole = true;
+    for (const ImageRegion &region : regions)
+    {
+        int arrSize;
+        Shape **shapes = _withTriangles ? Shape::getRectanglesAndTrianglesFromImage(_frame, region, arrSize) :
+                         Shape::getRectanglesFromImage(_frame, region, arrSize);
+        stats.scannedPixels += (long) (region.bottomRight.x - region.topLeft.x + 1) *
+                               (region.bottomRight.y - region.topLeft.y + 1);
+        bool isFrame = isInside(frameRegion, region);
+        for (int i = 0; i < arrSize; ++i)
+        {
+            // A triangle in a rectangle is found from the rectangle's pixels, so a background colored one (a hole)
+            // can reach past them, and its walk stops at the region's border, so it is only whole in the frame.
+            found.push_back(TrackedShape{0, shapes[i], getShapeBounds(*shapes[i], spans)});
+            bool isHole = shapes[i]->getType() == ShapeType::TRIANGLE && shapes[i]->getColor() == BACKGROUND;
+            isWhole = isWhole && isInside(found.back().bounds, region) && (isFrame || !isHole);
+        }
+        delete[] shapes;
+        if (!isWhole)
+        {
+            break;
+        }
+    }
+
+    if (!isWhole)
+    {
+        for (const TrackedShape &tracked : found)
+        {
+            delete tracked.shape;
+        }
+        found.clear();
+    }
+    return isWhole;
+}
+
+// gives the found shapes the ids of the same removed shapes (or new ids) and adds them, freeing the removed ones.
+void ShapeTracker::_matchShapes(std::vector<TrackedShape> &removed, std::vector<TrackedShape> &found,
+                                TrackStats &stats)
+{
+    // Removed and found shapes with the same key, by index.
+    struct MatchGroup
+    {
+        std::vector<size_t> removed, found;
+    };
+
+    // A found shape that is the same as a removed one in the same place is matched to it right away (no match can be
+    // closer). Most scanned shapes are such, as they are scanned only for being near a change.
+    std::vector<long> matches(found.size(), -1);
+    std::unordered_multimap<uint64_t, size_t> removedByPlace;
+    for (size_t i = 0; i < removed.size(); ++i)
+    {
+        removedByPlace.insert({getPlaceKey(removed[i].bounds.topLeft), i});
+    }
+    for (size_t i = 0; i < found.size(); ++i)
+    {
+        auto range = removedByPlace.equal_range(getPlaceKey(found[i].bounds.topLeft));
+        for (auto it = range.first; it != range.second; ++it)
+        {
+            TrackedShape &candidate = removed[it->second];
+            if (candidate.shape != nullptr && isSameShape(*candidate.shape, *found[i].shape))
+            {
+                matches[i] = (long) it->second;
+                delete candidate.shape;
+                candidate.shape = nullptr;
+                break;
+            }
+        }
+    }
+
+    std::map<std::vector<int>, MatchGroup> groups;
+    for (size_t i = 0; i < removed.size(); ++i)
+    {
+        if (removed[i].shape != nullptr)
+        {
+            groups[getShapeKey(*removed[i].shape)].removed.push_back(i);
+        }
+    }
+    for (size_t i = 0; i < found.size(); ++i)
+    {
+        if (matches[i] != -1)
+        {
+            continue;
+        }
+        auto group = groups.find(getShapeKey(*found[i].shape));
+        if (group != groups.end())
+        {
+            group->second.found.push_back(i);
+        }
+    }
+
+    // In each group, the closest removed and found shapes are matched first, so a shape that moved a little isn't
+    // taken over by a far away shape that happens to look the same. Huge groups (many shapes that look the same) are
+    // matched in the order the shapes were found instead.
+    std::vector<std::pair<long long, std::pair<size_t, size_t>>> pairs;
+    auto getDistance = [&](size_t removedIndex, size_t foundIndex)
+    {
+        const Vector2 &first = removed[removedIndex].bounds.topLeft, &second = found[foundIndex].bounds.topLeft;
+        long long dx = first.x - second.x, dy = first.y - second.y;
+        return dx * dx + dy * dy;
+    };
+    for (auto &keyGroup : groups)
+    {
+        MatchGroup &group = keyGroup.second;
+        pairs.clear();
+        if (group.removed.size() * group.found.size() <= MAX_MATCH_PAIRS)
+        {
+            for (size_t removedIndex : group.removed)
+            {
+                for (size_t foundIndex : group.found)
+                {
+                    pairs.push_back({getDistance(removedIndex, foundIndex), {removedIndex, foundIndex}});
+                }
+            }
+        }
+        else
+        {
+            for (size_t i = 0; i < std::min(group.removed.size(), group.found.size()); ++i)
+            {
+                pairs.push_back({0, {group.removed[i], group.found[i]}});
+            }
+        }
+
+        std::stable_sort(pairs.begin(), pairs.end(), [](const std::pair<long long, std::pair<size_t, size_t>> &pair,
+                                                        const std::pair<long long, std::pair<size_t, size_t>> &other)
+        {
+            return pair.first < other.first;
+        });
+        for (const auto &pair : pairs)
+        {
+            size_t removedIndex = pair.second.first, foundIndex = pair.second.second;
+            if (removed[removedIndex].shape != nullptr && matches[foundIndex] == -1)
+            {
+                matches[foundIndex] = (long) removedIndex;
+                delete removed[removedIndex].shape;
+                removed[removedIndex].shape = nullptr;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < found.size(); ++i)
+    {
+        if (matches[i] == -1)
+        {
+            found[i].id = _nextId++;
+            stats.addedShapes++;
+        }
+        else
+        {
+            found[i].id = removed[matches[i]].id;
+            stats.matchedShapes++;
+        }
+        _shapes.push_back(found[i]);
+    }
+
+    for (const TrackedShape &tracked : removed)
+    {
+        if (tracked.shape != nullptr)
+        {
+            delete tracked.shape;
+            stats.removedShapes++;
+        }
+    }
+}
+
+/**
+ * Creates a tracker that has no frames yet.
+ *
+ * @param withTriangles true to recognize the triangles in the rectangles too (as
+ *                      getRectanglesAndTrianglesFromImage does). Otherwise, false.
+ */
+ShapeTracker::ShapeTracker(bool withTriangles) : _withTriangles(withTriangles), _frame(0, 0), _frameCount(0),
+                                                 _nextId(0)
+{}
+
+/**
+ * Frees the shapes of the current frame.
+ */
+ShapeTracker::~ShapeTracker()
+{
+    for (const TrackedShape &tracked : _shapes)
+    {
+        delete tracked.shape;
+    }
+}
+
+/**
+ * Makes the given image the current frame and updates the shapes to it.
+ * The first frame (and a frame of another size than the previous one) is scanned whole and all of its shapes get
+ * new ids.
+ *
+ * @param frame The next frame of the sequence.
+ * @return Statistics of updating the shapes.
+ */
+TrackStats ShapeTracker::update(const Image &frame)
+{
+    TrackStats stats = TrackStats();
+    int tilesPerRow = (frame.getWidth() + Image::TILE_SIZE - 1) / Image::TILE_SIZE;
+    int tileRows = (frame.getHeight() + Image::TILE_SIZE - 1) / Image::TILE_SIZE;
+    bool isNewSize = _frameCount == 0 || frame.getHeight() != _frame.getHeight() ||
+                     frame.getWidth() != _frame.getWidth();
+    _frameCount++;
+    std::vector<bool> changedTiles((size_t) tilesPerRow * tileRows, true);
+    if (isNewSize)
+    {
+        for (const TrackedShape &tracked : _shapes)
+        {
+            delete tracked.shape;
+        }
+        stats.removedShapes = (int) _shapes.size();
+        _shapes.clear();
+    }
+    else
+    {
+        ImageDiff diff = _frame.compare(frame);
+        if (diff.isEqual())
+        {
+            stats.keptShapes = (int) _shapes.size();
+            return stats;
+        }
+        changedTiles = std::move(diff.differentTiles);
+    }
+    stats.changedTiles = (int) std::count(changedTiles.begin(), changedTiles.end(), true);
+    _frame = frame;
+
+    // A shape has to be scanned again if a changed tile has one of its pixels or of the pixels around it (something
+    // may have joined it). Then the scanned regions are grown to the bounding boxes of the groups of tiles to scan,
+    // which can take more shapes in, until all shapes are either away from the regions or inside them.
+    DirtyTiles dirtyTiles(frame.getHeight(), frame.getWidth(), std::move(changedTiles));
+    std::vector<bool> isRemoved(_shapes.size(), false);
+    std::vector<ImageRegion> regions;
+    bool isGrowing = true;
+    while (isGrowing)
+    {
+        isGrowing = false;
+        for (size_t i = 0; i < _shapes.size(); ++i)
+        {
+            if (!isRemoved[i] && dirtyTiles.isTouching(_shapes[i].bounds))
+            {
+                isRemoved[i] = true;
+                isGrowing = dirtyTiles.mark(_shapes[i].bounds) || isGrowing;
+            }
+        }
+        isGrowing = dirtyTiles.findRegions(regions) || isGrowing;
+    }
+
+    std::vector<TrackedShape> removed, kept;
+    for (size_t i = 0; i < _shapes.size(); ++i)
+    {
+        (isRemoved[i] ? removed : kept).push_back(_shapes[i]);
+    }
+
+    std::vector<TrackedShape> found;
+    if (!_scanRegions(regions, found, stats))
+    {
+        // The regions don't hold whole shapes, so scan the whole frame instead.
+        removed.insert(removed.end(), kept.begin(), kept.end());
+        kept.clear();
+        stats.scannedPixels = 0;
+        _scanRegions(std::vector<ImageRegion>{ImageRegion{Vector2(0, 0), Vector2(frame.getWidth() - 1,
+                                                                                  frame.getHeight() - 1)}},
+                     found, stats);
+    }
+
+    stats.keptShapes = (int) kept.size();
+    _shapes.swap(kept);
+    _matchShapes(removed, found, stats);
+    return stats;
+}
+
+/**
+ * Returns the number of frames given to update so far.
+ *
+ * @return The number of frames given to update so far.
+ */
+int ShapeTracker::getFrameCount() const
+{
+    return _frameCount;
+}
+
+/**
+ * Returns the number of shapes in the current frame.
+ *
+ * @return The number of shapes in the current frame.
+ */
+int ShapeTracker::getSize() const
+{
+    return (int) _shapes.size();
+}
+
+/**
+ * Returns the shape of the given index in the current frame (owned by the tracker, valid until the next update).
+ * Throws std::out_of_range if there is no such shape.
+ *
+ * @param index The index of the shape (0 to getSize() - 1).
+ * @return The shape of the given index.
+ */
+const Shape &ShapeTracker::getShape(int index) const
+{
+    return *_shapes.at(index).shape;
+}
+
+/**
+ * Returns the id of the shape of the given index in the current frame.
+ * Throws std::out_of_range if there is no such shape.
+ *
+ * @param index The index of the shape (0 to getSize() - 1).
+ * @return The id of the shape of the given index.
+ */
+uint32_t ShapeTracker::getId(int index) const
+{
+    return _shapes.at(index).id;
+}
+
+/**
+ * Draws all shapes of the current frame to the given image, each triangle after the rectangle it is in.
+ *
+ * @param img The image to draw on.
+ */
+void ShapeTracker::draw(Image &img) const
+{
+    for (const TrackedShape &tracked : _shapes)
+    {
+        tracked.shape->draw(img);
+    }
+}
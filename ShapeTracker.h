@@ -0,0 +1,131 @@
+//
+// Created by jacko on 30/10/2020.
+//
+
+#ifndef POLYTEST_SHAPETRACKER_H
+#define POLYTEST_SHAPETRACKER_H
+
+
+#include <cstdint>
+#include <vector>
+#include "Shapes.h"
+
+
+/**
+ * Statistics of tracking a frame (see ShapeTracker::update).
+ */
+struct TrackStats
+{
+    int changedTiles; // Number of tiles (Image::TILE_SIZE pixels square) that differ from the previous frame.
+    long scannedPixels; // Number of pixels that were scanned for shapes.
+    int keptShapes; // Number of shapes carried over from the previous frame without scanning.
+    int matchedShapes; // Number of scanned shapes that kept the id they had in the previous frame (moved or not).
+    int addedShapes; // Number of scanned shapes that got a new id.
+    int removedShapes; // Number of shapes of the previous frame that are gone.
+};
+
+/**
+ * Recognizes the shapes of a sequence of frames of the same size, where most shapes stay the same from one frame to
+ * the next. Each frame is compared with the previous one tile by tile, the shapes that are away from the changed tiles
+ * are kept and only the regions around the changed tiles are scanned again, so the cost of a frame follows the amount
+ * of change in it.
+ * Every shape has an id that it keeps for as long as it stays in the frames, also when it moves (a scanned shape takes
+ * the id of the closest shape of the same kind, color and size that was in the scanned regions of the previous frame).
+ * The shapes are the same as those that getRectanglesFromImage (or getRectanglesAndTrianglesFromImage) finds in the
+ * whole frame, for frames that draw back from their shapes.
+ */
+class ShapeTracker
+{
+    // A shape of the current frame with its id and the bounding box of its pixels.
+    struct TrackedShape
+    {
+        uint32_t id;
+        Shape *shape;
+        ImageRegion bounds;
+    };
+
+    bool _withTriangles;
+    Image _frame;
+    int _frameCount;
+    std::vector<TrackedShape> _shapes;
+    uint32_t _nextId;
+
+    // scans the given regions of the current frame, adding their shapes to found. Returns false (and frees found) if
+    // a shape reaches out of its region or a region smaller than the frame has a hole (a background colored
+    // triangle), so the regions don't hold whole shapes.
+    bool _scanRegions(const std::vector<ImageRegion> &regions, std::vector<TrackedShape> &found,
+                      TrackStats &stats) const;
+
+    // gives the found shapes the ids of the same removed shapes (or new ids) and adds them, freeing the removed ones.
+    void _matchShapes(std::vector<TrackedShape> &removed, std::vector<TrackedShape> &found, TrackStats &stats);
+
+public:
+    /**
+     * Creates a tracker that has no frames yet.
+     *
+     * @param withTriangles true to recognize the triangles in the rectangles too (as
+     *                      getRectanglesAndTrianglesFromImage does). Otherwise, false.
+     */
+    explicit ShapeTracker(bool withTriangles);
+
+    ShapeTracker(const ShapeTracker &) = delete;
+
+    ShapeTracker &operator=(const ShapeTracker &) = delete;
+
+    /**
+     * Frees the shapes of the current frame.
+     */
+    ~ShapeTracker();
+
+    /**
+     * Makes the given image the current frame and updates the shapes to it.
+     * The first frame (and a frame of another size than the previous one) is scanned whole and all of its shapes get
+     * new ids.
+     *
+     * @param frame The next frame of the sequence.
+     * @return Statistics of updating the shapes.
+     */
+    TrackStats update(const Image &frame);
+
+    /**
+     * Returns the number of frames given to update so far.
+     *
+     * @return The number of frames given to update so far.
+     */
+    int getFrameCount() const;
+
+    /**
+     * Returns the number of shapes in the current frame.
+     *
+     * @return The number of shapes in the current frame.
+     */
+    int getSize() const;
+
+    /**
+     * Returns the shape of the given index in the current frame (owned by the tracker, valid until the next update).
+     * Throws std::out_of_range if there is no such shape.
+     *
+     * @param index The index of the shape (0 to getSize() - 1).
+     * @return The shape of the given index.
+     */
+    const Shape &getShape(int index) const;
+
+    /**
+     * Returns the id of the shape of the given index in the current frame.
+     * Throws std::out_of_range if there is no such shape.
+     *
+     * @param index The index of the shape (0 to getSize() - 1).
+     * @return The id of the shape of the given index.
+     */
+    uint32_t getId(int index) const;
+
+    /**
+     * Draws all shapes of the current frame to the given image, each triangle after the rectangle it is in.
+     *
+     * @param img The image to draw on.
+     */
+    void draw(Image &img) const;
+};
+
+
+#endif //POLYTEST_SHAPETRACKER_H
@@ -0,0 +1,574 @@
+#include <algorithm>
+#include <climits>
+#include "PixelKernels.h"
+#include "ShapeTree.h"
+
+
+static const unsigned char BACKGROUND = 0;
+
+// A run of a row of the image (both ends inclusive).
+struct TreeRun
+{
+    int y, start, end;
+    unsigned char color;
+};
+
+// A connected group of runs of the same color: where its runs and outline are, and its place in the tree.
+struct TreeComponent
+{
+    int firstRun, top, bottom;
+    size_t outline; // Index of the component's top row in the outline of all components.
+    int parent;     // The component it is inside of, or -1.
+    int node;       // The index of its shape in the tree, or -1 if it isn't a recognized shape.
+    int filled;     // The index of its filled rectangle (see findFilledRectangle), or -1 if it isn't one.
+};
+
+// A component that is a rectangle only together with the shapes drawn over it (that touch its border): its index and
+// the rectangle's corners.
+struct FilledRectangle
+{
+    int component, node;
+    unsigned char color;
+    Vector2 topLeft, bottomRight;
+};
+
+// Answers whether pixels are covered by the runs of the components from a given one on in raster order (those that
+// can be drawn over it) that aren't of a given color (its parent's), from the runs of all rows.
+class RunCoverage
+{
+    const std::vector<TreeRun> &_runs;
+    const std::vector<size_t> &_rowStarts; // Index of the first run of each row, and the number of runs at the end.
+    const std::vector<int> &_runComponents;
+    int _firstComponent;
+    int _excludedColor;
+
+    // returns the index of the run that has the given pixel, or -1 if it is background (or out of the image).
+    int _findRun(int x, int y) const
+    {
+        if (y < 0 || y >= (int) _rowStarts.size() - 1)
+        {
+            return -1;
+        }
+        auto rowEnd = _runs.begin() + _rowStarts[y + 1];
+        auto run = std::lower_bound(_runs.begin() + _rowStarts[y], rowEnd, x, [](const TreeRun &current, int x)
+        {
+            return current.end < x;
+        });
+        return run == rowEnd || run->start > x ? -1 : (int) (run - _runs.begin());
+    }
+
+    // returns true if the given run is of a component that covers pixels.
+    bool _isCovering(size_t run) const
+    {
+        return _runComponents[run] >= _firstComponent && _runs[run].color != _excludedColor;
+    }
+
+public:
+    RunCoverage(const std::vector<TreeRun> &runs, const std::vector<size_t> &rowStarts,
+                const std::vector<int> &runComponents) : _runs(runs), _rowStarts(rowStarts),
+                                                         _runComponents(runComponents), _firstComponent(0),
+                                                         _excludedColor(-1)
+    {}
+
+    // sets the first component whose runs cover pixels, and the color whose runs don't (or -1 for none).
+    void setCovering(int firstComponent, int excludedColor)
+    {
+        _firstComponent = firstComponent;
+        _excludedColor = excludedColor;
+    }
+
+    // returns true if the pixels of row y from xStart to xEnd are all covered. Otherwise, returns false.
+    bool isCovered(int y, int xStart, int xEnd) const
+    {
+        int run = _findRun(xStart, y);
+        if (run == -1 || !_isCovering(run))
+        {
+            return false;
+        }
+        // Runs of different colors that touch go on covering the row.
+        while (_runs[run].end < xEnd)
+        {
+            int end = _runs[run].end;
+            if (++run == (int) _rowStarts[y + 1] || _runs[run].start != end + 1 || !_isCovering(run))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // returns the component of the given pixel, or -1 if it is background.
+    int getComponent(const Vector2 &pixel) const
+    {
+        int run = _findRun(pixel.x, pixel.y);
+        return run == -1 ? -1 : _runComponents[run];
+    }
+
+    // returns true if a component other than the given one has a run of the given color in the rectangle of the given
+    // corners. Otherwise, returns false.
+    bool hasOtherRun(const Vector2 &topLeft, const Vector2 &bottomRight, unsigned char color, int component) const
+    {
+        for (int y = topLeft.y; y <= bottomRight.y; ++y)
+        {
+            for (size_t i = _rowStarts[y]; i < _rowStarts[y + 1] && _runs[i].start <= bottomRight.x; ++i)
+            {
+                if (_runs[i].end >= topLeft.x && _runs[i].color == color && _runComponents[i] != component)
+                {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    // returns the color of the runs of the components other than the given one in the rectangle of the given corners
+    // if they are all of one color. Otherwise, returns -1.
+    int getOtherColor(const Vector2 &topLeft, const Vector2 &bottomRight, int component) const
+    {
+        int color = -1;
+        for (int y = topLeft.y; y <= bottomRight.y; ++y)
+        {
+            for (size_t i = _rowStarts[y]; i < _rowStarts[y + 1] && _runs[i].start <= bottomRight.x; ++i)
+            {
+                if (_runs[i].end >= topLeft.x && _runComponents[i] != component)
+                {
+                    if (color != -1 && _runs[i].color != color)
+                    {
+                        return -1;
+                    }
+                    color = _runs[i].color;
+                }
+            }
+        }
+        return color;
+    }
+};
+
+// Returns true if the component of the given outline (one span per row, its top-left pixel first) is a rectangle
+// together with the shapes drawn over it, and sets rectangle to it. Otherwise, returns false.
+// The rectangle is found the way the scan of Shape::getRectanglesFromImage finds it: from the top-left pixel to the
+// corner that the covered pixels reach, and it must hold the outline and be all covered.
+static bool findFilledRectangle(const RunCoverage &coverage, const std::vector<Span> &outline,
+                                FilledRectangle &rectangle)
+{
+    Vector2 topLeft(outline.front().xStart, outline.front().y);
+    for (const Span &span : outline)
+    {
+        if (span.xStart < topLeft.x)
+        {
+            return false;
+        }
+    }
+
+    int x = topLeft.x + 1, y = topLeft.y + 1;
+    while (coverage.isCovered(y, x, x))
+    {
+        // go diagonally right.
+        x++;
+        y++;
+    }
+    if (coverage.isCovered(y, x - 1, x - 1))
+    {
+        for (x--; coverage.isCovered(y + 1, x, x); ++y);
+    }
+    else if (coverage.isCovered(y - 1, x, x))
+    {
+        for (y--; coverage.isCovered(y, x + 1, x + 1); ++x);
+    }
+    else
+    {
+        x--;
+        y--;
+    }
+
+    if (outline.back().y > y)
+    {
+        return false;
+    }
+    for (const Span &span : outline)
+    {
+        if (span.xEnd > x)
+        {
+            return false;
+        }
+    }
+    for (int row = topLeft.y; row <= y; ++row)
+    {
+        if (!coverage.isCovered(row, topLeft.x, x))
+        {
+            return false;
+        }
+    }
+    rectangle.topLeft = topLeft;
+    rectangle.bottomRight = Vector2(x, y);
+    return true;
+}
+
+// Returns true if the component of the given outline and color is in the given filled rectangle and of its color, so it
+// is a piece of it. Otherwise, returns false.
+static bool isInFilledRectangle(const FilledRectangle &rectangle, const std::vector<Span> &outline,
+                                unsigned char color)
+{
+    if (color != rectangle.color || outline.back().y > rectangle.bottomRight.y)
+    {
+        return false;
+    }
+    for (const Span &span : outline)
+    {
+        if (span.xStart < rectangle.topLeft.x || span.xEnd > rectangle.bottomRight.x)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Returns the label of the root of the set the given run is in (halving the path to it on the way).
+static int findRoot(std::vector<int> &labels, int run)
+{
+    while (labels[run] != run)
+    {
+        labels[run] = labels[labels[run]];
+        run = labels[run];
+    }
+    return run;
+}
+
+// Joins the sets of the two given runs, rooting them at the first run of the two.
+static void unite(std::vector<int> &labels, int run, int otherRun)
+{
+    int root = findRoot(labels, run), otherRoot = findRoot(labels, otherRun);
+    if (root < otherRoot)
+    {
+        labels[otherRoot] = root;
+    }
+    else
+    {
+        labels[root] = otherRoot;
+    }
+}
+
+// Sets runs to the non-background runs of row y of the given image, left to right.
+static void getRowRuns(const Image &img, int y, std::vector<RleRun> &runs)
+{
+    runs.clear();
+    for (int x = 0; x < img.getWidth();)
+    {
+        // Go over the row one contiguous segment at a time, merging runs that go on across segments.
+        int length;
+        const unsigned char *pixels = img.getRowPixels(x, y, length);
+        for (int i = 0; i < length;)
+        {
+            unsigned char color = pixels[i];
+            int runLength = PixelKernels<unsigned char>::findNotEqual(pixels + i, length - i, color);
+            if (color != BACKGROUND && !runs.empty() && runs.back().color == color && runs.back().end() == x + i - 1)
+            {
+                runs.back().length += runLength;
+            }
+            else if (color != BACKGROUND)
+            {
+                runs.push_back(RleRun(x + i, runLength, color));
+            }
+            i += runLength;
+        }
+        x += length;
+    }
+}
+
+// builds the tree from the runs of each row, as given by rowRuns (non-background runs, left to right).
+template<class RowRuns>
+void ShapeTree::_build(int height, RowRuns rowRuns)
+{
+    // Label the runs in one pass: a run joins the runs of its color that touch it (also diagonally) in the row above
+    // and right before it, so each set is a connected component, rooted at its first run in raster order.
+    std::vector<TreeRun> runs;
+    std::vector<int> labels;
+    std::vector<size_t> rowStarts;
+    size_t aboveBegin = 0, aboveEnd = 0;
+    for (int y = 0; y < height; ++y)
+    {
+        size_t rowBegin = runs.size();
+        rowStarts.push_back(rowBegin);
+        size_t above = aboveBegin;
+        for (const RleRun &rowRun : rowRuns(y))
+        {
+            int index = (int) runs.size();
+            runs.push_back(TreeRun{y, rowRun.start, rowRun.end(), rowRun.color});
+            labels.push_back(index);
+            const TreeRun &run = runs.back();
+            if ((size_t) index > rowBegin && runs[index - 1].end + 1 == run.start && runs[index - 1].color == run.color)
+            {
+                unite(labels, index - 1, index);
+            }
+            while (above < aboveEnd && runs[above].end < run.start - 1)
+            {
+                above++;
+            }
+            for (size_t i = above; i < aboveEnd && runs[i].start <= run.end + 1; ++i)
+            {
+                if (runs[i].color == run.color)
+                {
+                    unite(labels, (int) i, index);
+                }
+            }
+        }
+        aboveBegin = rowBegin;
+        aboveEnd = runs.size();
+    }
+    rowStarts.push_back(runs.size());
+
+    // Number the components in raster order of their first runs, and lay out their outlines (a span per row).
+    std::vector<TreeComponent> components;
+    std::vector<int> runComponents(runs.size());
+    for (size_t i = 0; i < runs.size(); ++i)
+    {
+        int root = findRoot(labels, (int) i);
+        if (root == (int) i)
+        {
+            runComponents[i] = (int) components.size();
+            components.push_back(TreeComponent{root, runs[i].y, runs[i].y, 0, -1, -1, -1});
+        }
+        else
+        {
+            runComponents[i] = runComponents[root];
+            components[runComponents[i]].bottom = runs[i].y;
+        }
+    }
+    size_t outlineSize = 0;
+    for (TreeComponent &component : components)
+    {
+        component.outline = outlineSize;
+        outlineSize += component.bottom - component.top + 1;
+    }
+    std::vector<Span> outline(outlineSize, Span(0, INT_MAX, INT_MIN));
+    for (size_t i = 0; i < runs.size(); ++i)
+    {
+        const TreeComponent &component = components[runComponents[i]];
+        Span &span = outline[component.outline + runs[i].y - component.top];
+        span = Span(runs[i].y, std::min(span.xStart, runs[i].start), std::max(span.xEnd, runs[i].end));
+    }
+
+    // The parent of a component is the first one, going up from the component of the run right before its first run,
+    // whose outline has its top-left pixel. All of them are earlier in raster order, so they already have parents.
+    // A filled rectangle (see findFilledRectangle) holds the pixels of its whole rectangle instead of its outline, and
+    // it is the parent if it is inside the found one (comes later in raster order), as those touching its border
+    // don't have a run of it right before them.
+    RunCoverage coverage(runs, rowStarts, runComponents);
+    std::vector<FilledRectangle> filledRectangles;
+    std::vector<int> activeFilled; // The filled rectangles that reach the current row.
+    std::vector<Span> spans;
+    for (size_t i = 0; i < components.size(); ++i)
+    {
+        TreeComponent &component = components[i];
+        const TreeRun &firstRun = runs[component.firstRun];
+        int parent = -1;
+        if (component.firstRun > 0 && runs[component.firstRun - 1].y == firstRun.y)
+        {
+            parent = runComponents[component.firstRun - 1];
+        }
+        while (parent != -1)
+        {
+            const TreeComponent &candidate = components[parent];
+            if (firstRun.y <= candidate.bottom)
+            {
+                const Span &span = outline[candidate.outline + firstRun.y - candidate.top];
+                if (span.xStart <= firstRun.start && firstRun.start <= span.xEnd)
+                {
+                    break;
+                }
+            }
+            parent = candidate.parent;
+        }
+        int parentNode = parent;
+        while (parentNode != -1 && components[parentNode].node == -1)
+        {
+            parentNode = components[parentNode].parent;
+        }
+        parentNode = parentNode == -1 ? -1 : components[parentNode].node;
+
+        activeFilled.erase(std::remove_if(activeFilled.begin(), activeFilled.end(), [&](int filled)
+        {
+            return filledRectangles[filled].bottomRight.y < firstRun.y;
+        }), activeFilled.end());
+        const FilledRectangle *parentRectangle = nullptr;
+        for (int filled : activeFilled)
+        {
+            const FilledRectangle &rectangle = filledRectangles[filled];
+            if (rectangle.component > parent && rectangle.topLeft.x <= firstRun.start &&
+                firstRun.start <= rectangle.bottomRight.x)
+            {
+                parent = rectangle.component;
+                parentNode = rectangle.node;
+                parentRectangle = &rectangle;
+            }
+        }
+        if (parentRectangle == nullptr && parent != -1 && components[parent].filled != -1)
+        {
+            parentRectangle = &filledRectangles[components[parent].filled];
+        }
+        component.parent = parent;
+
+        spans.assign(outline.begin() + component.outline,
+                     outline.begin() + component.outline + (component.bottom - component.top + 1));
+        if (parentRectangle != nullptr && isInFilledRectangle(*parentRectangle, spans, firstRun.color))
+        {
+            // A piece of the filled rectangle that the shapes drawn over it cut off.
+            continue;
+        }
+
+        // A component can be in a filled rectangle (a rectangle that the coverage goes on from, below its top-left pixel
+        // or right of its top row, or any other shape). It is the filled rectangle (the plain scan finds it the same
+        // way) if it isn't a shape, is a rectangle itself, has other pieces of its color in it or has one of its bottom
+        // corners. Otherwise it is a shape that covers the rectangle's top-left pixel, and if the rest is of one color
+        // the filled rectangle is of that color, right before it in the tree.
+        coverage.setCovering((int) i, parent == -1 ? -1 : runs[components[parent].firstRun].color);
+        Shape *shape = Shape::createFromSpans(spans, firstRun.color);
+        bool isRectangle = shape != nullptr && shape->getType() == ShapeType::RECTANGLE;
+        FilledRectangle filled;
+        if ((!isRectangle || coverage.isCovered(component.bottom + 1, firstRun.start, firstRun.start) ||
+             coverage.isCovered(component.top, spans.front().xEnd + 1, spans.front().xEnd + 1)) &&
+            findFilledRectangle(coverage, spans, filled))
+        {
+            filled.component = (int) i;
+            if (shape == nullptr || isRectangle ||
+                coverage.hasOtherRun(filled.topLeft, filled.bottomRight, firstRun.color, (int) i) ||
+                coverage.getComponent(Vector2(filled.topLeft.x, filled.bottomRight.y)) == (int) i ||
+                coverage.getComponent(filled.bottomRight) == (int) i)
+            {
+                delete shape;
+                shape = new Rectangle(filled.topLeft, filled.bottomRight, firstRun.color);
+                filled.color = firstRun.color;
+                filled.node = (int) _shapes.size();
+            }
+            else
+            {
+                int color = coverage.getOtherColor(filled.topLeft, filled.bottomRight, (int) i);
+                if (color < 0)
+                {
+                    filled.node = -1;
+                }
+                else
+                {
+                    filled.color = (unsigned char) color;
+                    filled.node = (int) _shapes.size();
+                    _shapes.push_back(new Rectangle(filled.topLeft, filled.bottomRight, filled.color));
+                    _parents.push_back(parentNode);
+                    _depths.push_back(parentNode == -1 ? 0 : _depths[parentNode] + 1);
+                    parentNode = filled.node;
+                }
+            }
+            if (filled.node != -1)
+            {
+                component.filled = (int) filledRectangles.size();
+                activeFilled.push_back(component.filled);
+                filledRectangles.push_back(filled);
+            }
+        }
+        if (shape == nullptr)
+        {
+            continue;
+        }
+        component.node = (int) _shapes.size();
+        _shapes.push_back(shape);
+        _parents.push_back(parentNode);
+        _depths.push_back(parentNode == -1 ? 0 : _depths[parentNode] + 1);
+    }
+}
+
+/**
+ * Builds the containment tree of the shapes of the given image.
+ *
+ * @param img The image to recognize the shapes of.
+ */
+ShapeTree::ShapeTree(const Image &img)
+{
+    std::vector<RleRun> row;
+    _build(img.getHeight(), [&](int y) -> const std::vector<RleRun> &
+    {
+        getRowRuns(img, y, row);
+        return row;
+    });
+}
+
+/**
+ * Builds the containment tree of the shapes of the given run-length-encoded image.
+ *
+ * @param img The run-length-encoded image to recognize the shapes of.
+ */
+ShapeTree::ShapeTree(const RleImage &img)
+{
+    _build(img.getHeight(), [&](int y) -> const std::vector<RleRun> &
+    {
+        return img.getRow(y);
+    });
+}
+
+/**
+ * Frees the shapes of the tree.
+ */
+ShapeTree::~ShapeTree()
+{
+    for (Shape *shape : _shapes)
+    {
+        delete shape;
+    }
+}
+
+/**
+ * Returns the number of shapes in the tree.
+ *
+ * @return The number of shapes in the tree.
+ */
+int ShapeTree::getSize() const
+{
+    return (int) _shapes.size();
+}
+
+/**
+ * Returns the shape of the given index (owned by the tree).
+ * Throws std::out_of_range if there is no such shape.
+ *
+ * @param index The index of the shape (0 to getSize() - 1).
+ * @return The shape of the given index.
+ */
+const Shape &ShapeTree::getShape(int index) const
+{
+    return *_shapes.at(index);
+}
+
+/**
+ * Returns the index of the parent of the given shape (always smaller than its own), or -1 if it has no parent.
+ * Throws std::out_of_range if there is no such shape.
+ *
+ * @param index The index of the shape (0 to getSize() - 1).
+ * @return The index of the parent of the given shape, or -1 if it has no parent.
+ */
+int ShapeTree::getParent(int index) const
+{
+    return _parents.at(index);
+}
+
+/**
+ * Returns the number of ancestors of the given shape (0 for shapes that have no parent).
+ * Throws std::out_of_range if there is no such shape.
+ *
+ * @param index The index of the shape (0 to getSize() - 1).
+ * @return The number of ancestors of the given shape.
+ */
+int ShapeTree::getDepth(int index) const
+{
+    return _depths.at(index);
+}
+
+/**
+ * Draws all shapes of the tree to the given image, each one after its parent.
+ *
+ * @param img The image to draw on.
+ */
+void ShapeTree::draw(Image &img) const
+{
+    for (const Shape *shape : _shapes)
+    {
+        shape->draw(img);
+    }
+}
@@ -0,0 +1,101 @@
+//
+// Created by jacko on 30/10/2020.
+//
+
+#ifndef POLYTEST_SHAPETREE_H
+#define POLYTEST_SHAPETREE_H
+
+
+#include <vector>
+#include "Shapes.h"
+
+
+/**
+ * Containment tree of the shapes of an image, built in a single pass over its rows with no erase-and-rescan.
+ * Each shape is a rectangle (parallel to the x and y axis), a filled circle or a convex polygon, and its parent is the
+ * smallest shape it is drawn inside of. A shape can have any number of children, at any depth.
+ * The shapes are kept in a flat array in raster order of their top-left pixels, so every shape comes after its parent
+ * and drawing them in array order (see draw) draws the image back.
+ * Children of a rectangle can touch its border (the rectangle is found from its top-left pixel the way
+ * Shape::getRectanglesFromImage finds it, and a shape that covers that pixel is put right after it, as its child).
+ * Children of circles and polygons must be strictly inside them, as those are found from their outlines. Pixels of
+ * shapes that aren't of a recognized kind aren't in the tree, but the shapes inside them are (under the closest
+ * recognized ancestor).
+ */
+class ShapeTree
+{
+    std::vector<Shape *> _shapes;
+    std::vector<int> _parents, _depths;
+
+    // builds the tree from the runs of each row, as given by rowRuns (non-background runs, left to right).
+    template<class RowRuns>
+    void _build(int height, RowRuns rowRuns);
+
+public:
+    /**
+     * Builds the containment tree of the shapes of the given image.
+     *
+     * @param img The image to recognize the shapes of.
+     */
+    explicit ShapeTree(const Image &img);
+
+    /**
+     * Builds the containment tree of the shapes of the given run-length-encoded image.
+     *
+     * @param img The run-length-encoded image to recognize the shapes of.
+     */
+    explicit ShapeTree(const RleImage &img);
+
+    ShapeTree(const ShapeTree &) = delete;
+
+    ShapeTree &operator=(const ShapeTree &) = delete;
+
+    /**
+     * Frees the shapes of the tree.
+     */
+    ~ShapeTree();
+
+    /**
+     * Returns the number of shapes in the tree.
+     *
+     * @return The number of shapes in the tree.
+     */
+    int getSize() const;
+
+    /**
+     * Returns the shape of the given index (owned by the tree).
+     * Throws std::out_of_range if there is no such shape.
+     *
+     * @param index The index of the shape (0 to getSize() - 1).
+     * @return The shape of the given index.
+     */
+    const Shape &getShape(int index) const;
+
+    /**
+     * Returns the index of the parent of the given shape (always smaller than its own), or -1 if it has no parent.
+     * Throws std::out_of_range if there is no such shape.
+     *
+     * @param index The index of the shape (0 to getSize() - 1).
+     * @return The index of the parent of the given shape, or -1 if it has no parent.
+     */
+    int getParent(int index) const;
+
+    /**
+     * Returns the number of ancestors of the given shape (0 for shapes that have no parent).
+     * Throws std::out_of_range if there is no such shape.
+     *
+     * @param index The index of the shape (0 to getSize() - 1).
+     * @return The number of ancestors of the given shape.
+     */
+    int getDepth(int index) const;
+
+    /**
+     * Draws all shapes of the tree to the given image, each one after its parent.
+     *
+     * @param img The image to draw on.
+     */
+    void draw(Image &img) const;
+};
+
+
+#endif //POLYTEST_SHAPETREE_H
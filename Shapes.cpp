@@ -2,8 +2,11 @@
 // Created by jacko on 30/10/2020.
 //
 
-#include <list>
+#include <algorithm>
+#include "ImagePyramid.h"
+#include "IntegralImage.h"
 #include "Shapes.h"
+#include "SpanCompositor.h"
 
 
 static const int BACKGROUND = 0;
@@ -14,6 +17,17 @@ static const int BACKGROUND = 0;
 Shape::Shape() : _vertices(nullptr), _verticesSize(0), _color(0)
 {}
 
+// Copies the given vertices to this shape (to the local storage if they fit).
+void Shape::_setVertices(const Vector2 *vertices, int verticesSize)
+{
+    _verticesSize = verticesSize;
+    _vertices = verticesSize <= LOCAL_VERTICES_SIZE ? _localVertices : new Vector2[verticesSize];
+    for (int i = 0; i < _verticesSize; ++i)
+    {
+        _vertices[i] = vertices[i];
+    }
+}
+
 /**
  * Creates a new Shape of the given color that has the given vertices.
  *
@@ -32,13 +46,59 @@ Shape::Shape(Vector2 *vertices, int verticesSize, unsigned char color) : _vertic
  * @param other The shape to copy.
  * @param color The color of this shape.
  */
-Shape::Shape(const Shape &other, unsigned char color) : _vertices(new Vector2[other._verticesSize]),
-                                                        _verticesSize(other._verticesSize), _color(color)
+Shape::Shape(const Shape &other, unsigned char color) : _color(color)
 {
-    for (int i = 0; i < _verticesSize; ++i)
+    _setVertices(other._vertices, other._verticesSize);
+}
+
+/**
+ * Creates a new Shape of the given color that has a copy of the given vertices.
+ *
+ * @param vertices The vertices of the shape.
+ * @param color The color of the shape (1 byte grayscale).
+ */
+Shape::Shape(std::initializer_list<Vector2> vertices, unsigned char color) : _color(color)
+{
+    _setVertices(vertices.begin(), (int) vertices.size());
+}
+
+/**
+ * Creates a new Shape of the given color that has a copy of the given vertices.
+ *
+ * @param vertices The vertices of the shape.
+ * @param color The color of the shape (1 byte grayscale).
+ */
+Shape::Shape(const std::vector<Vector2> &vertices, unsigned char color) : _color(color)
+{
+    _setVertices(vertices.data(), (int) vertices.size());
+}
+
+/**
+ * Copy ctor for shape.
+ *
+ * @param other The shape to copy.
+ */
+Shape::Shape(const Shape &other) : Shape(other, other._color)
+{}
+
+/**
+ * Assign this shape to be a copy of the given one.
+ *
+ * @param other The shape to copy.
+ * @return This shape after the copy procedure.
+ */
+Shape &Shape::operator=(const Shape &other)
+{
+    if (this != &other)
     {
-        _vertices[i] = other._vertices[i];
+        if (_vertices != _localVertices)
+        {
+            delete[] _vertices;
+        }
+        _color = other._color;
+        _setVertices(other._vertices, other._verticesSize);
     }
+    return *this;
 }
 
 /**
@@ -46,7 +106,7 @@ Shape::Shape(const Shape &other, unsigned char color) : _vertices(new Vector2[ot
  */
 Shape::~Shape()
 {
-    if (_verticesSize > 0)
+    if (_vertices != _localVertices)
     {
         delete[] _vertices;
     }
@@ -62,6 +122,16 @@ const Vector2 *Shape::getVertices() const
     return _vertices;
 }
 
+/**
+ * Returns the size of this shape's array of vertices.
+ *
+ * @return The size of this shape's array of vertices.
+ */
+int Shape::getVerticesSize() const
+{
+    return _verticesSize;
+}
+
 /**
  * Return's this shape's color.
  *
@@ -72,6 +142,16 @@ unsigned char Shape::getColor() const
     return _color;
 }
 
+/**
+ * Returns the kind of this shape.
+ *
+ * @return The kind of this shape.
+ */
+ShapeType Shape::getType() const
+{
+    return ShapeType::POLYGON;
+}
+
 // Sets the bounding box that the shape is in.
 static void setBoundingBox(int &minX, int &minY, int &maxX, int &maxY, const Vector2 *vertices, int size)
 {
@@ -103,7 +183,8 @@ static void setBoundingBox(int &minX, int &minY, int &maxX, int &maxY, const Vec
 // Returns true if given point is in half space created by the two other vectors. Otherwise, returns false.
 static bool isPointInHalfSpace(const Vector2 &a, const Vector2 &b, const Vector2 &point)
 {
-    return ((point.x - a.x) * (b.y - a.y) - (point.y - a.y) * (b.x - a.x)) <= 0;
+    // Worked out in 64 bits, as the products of coordinates far apart don't fit in an int.
+    return ((int64_t) (point.x - a.x) * (b.y - a.y) - (int64_t) (point.y - a.y) * (b.x - a.x)) <= 0;
 }
 
 // Returns true if given point is in this shape. Otherwise, returns false.
@@ -119,462 +200,2442 @@ bool Shape::_isPointInShape(const Vector2 &point) const
     return isPointInHalfSpace(_vertices[_verticesSize - 1], _vertices[0], point);
 }
 
-/**
- * Draw's this shape to the given image.
- *
- * @param img The image to draw to.
- */
-void Shape::draw(Image &img) const
+// Draws a horizontal line blended in the given mode, calling the plain (overwriting) line draw for OVERWRITE.
+static void drawLine(Image &img, const Vector2 &start, int xFinish, unsigned char color, BlendMode mode,
+                     unsigned char alpha)
 {
-    int minX, minY, maxX, maxY;
-    setBoundingBox(minX, minY, maxX, maxY, _vertices, _verticesSize);
+    if (mode == BlendMode::OVERWRITE)
+    {
+        img.drawHorizontalLine(start, xFinish, color);
+    }
+    else
+    {
+        img.drawHorizontalLine(start, xFinish, color, mode, alpha);
+    }
+}
 
-    for (Vector2 currentPoint(minX, minY); currentPoint.y <= maxY; ++currentPoint.y)
+// Draws the given spans (sorted by row), translated by the given offset and blended in the given mode, one tile at a
+// time, so each tile of a TILED image is visited once.
+static void drawSpansByTile(Image &img, const std::vector<Span> &spans, unsigned char color, const Vector2 &offset,
+                            BlendMode mode, unsigned char alpha)
+{
+    size_t bandStart = 0;
+    while (bandStart < spans.size())
     {
-        for (; currentPoint.x <= maxX; ++currentPoint.x)
+        // Find the spans in the current band of tile rows and the tile columns they cover.
+        int band = (spans[bandStart].y + offset.y) / Image::TILE_SIZE;
+        size_t bandEnd = bandStart;
+        int minX = spans[bandStart].xStart + offset.x;
+        int maxX = spans[bandStart].xEnd + offset.x;
+        while (bandEnd < spans.size() && (spans[bandEnd].y + offset.y) / Image::TILE_SIZE == band)
+        {
+            minX = std::min(minX, spans[bandEnd].xStart + offset.x);
+            maxX = std::max(maxX, spans[bandEnd].xEnd + offset.x);
+            bandEnd++;
+        }
+
+        for (int tileX = minX - (minX % Image::TILE_SIZE); tileX <= maxX; tileX += Image::TILE_SIZE)
         {
-            if (_isPointInShape(currentPoint))
+            for (size_t i = bandStart; i < bandEnd; ++i)
             {
-                img.drawPixel(currentPoint, _color);
+                int xStart = std::max(spans[i].xStart + offset.x, tileX);
+                int xEnd = std::min(spans[i].xEnd + offset.x, tileX + Image::TILE_SIZE - 1);
+                if (xStart <= xEnd)
+                {
+                    drawLine(img, Vector2(xStart, spans[i].y + offset.y), xEnd, color, mode, alpha);
+                }
             }
         }
-        currentPoint.x = minX;
+        bandStart = bandEnd;
     }
 }
 
-/**
- * Returns an array of pointers to Shapes that contains all rectangles that are parallel to the x and y axis.
- * Shapes can only be in non-zero color.
- * The output array (and all pointers in it) needs to be freed (either manually or with freeShapesArray).
- *
- * @param img The image to scan in.
- * @param arrSize This will be set to the size of the output array.
- * @return an array of pointers to Shapes that contains all rectangles that are parallel to the x and y axis.
- */
-Shape **Shape::getRectanglesFromImage(const Image &img, int &arrSize)
+// Draws the given spans (sorted by row), translated by the given offset and blended in the given mode, in the order
+// that suits the layout of the image.
+static void drawSpans(Image &img, const std::vector<Span> &spans, unsigned char color,
+                      const Vector2 &offset = Vector2(), BlendMode mode = BlendMode::OVERWRITE,
+                      unsigned char alpha = 255)
 {
-    std::list<Shape *> rectangles;
-    Image tempImg(img);
-    int width = img.getWidth();
-    int height = img.getWidth();
+    if (img.getLayout() == ImageLayout::TILED)
+    {
+        drawSpansByTile(img, spans, color, offset, mode, alpha);
+        return;
+    }
 
-    for (int y = 0; y < height; ++y)
+    for (const Span &span : spans)
     {
-        for (int x = 0; x < width; ++x)
-        {
-            if (tempImg.getPixel(x, y) != BACKGROUND)
-            {
-                Rectangle *newRect;
-                Rectangle::recognizeRectangle(tempImg, Vector2(x, y), &newRect);
-                rectangles.push_front(newRect);
-                Rectangle(*newRect, BACKGROUND).draw(tempImg);
-            }
-        }
+        drawLine(img, Vector2(span.xStart + offset.x, span.y + offset.y), span.xEnd + offset.x, color, mode, alpha);
     }
+}
 
+// Draws the given spans (sorted by row) in the given color.
+template<class Pixel>
+static void drawSpans(PixelImage<Pixel> &img, const std::vector<Span> &spans, const Pixel &color)
+{
+    for (const Span &span : spans)
+    {
+        img.drawHorizontalLine(Vector2(span.xStart, span.y), span.xEnd, color);
+    }
+}
 
-    arrSize = rectangles.size();
-    auto **shapesArray = new Shape *[arrSize];
-    std::copy(rectangles.begin(), rectangles.end(), shapesArray);
-    return shapesArray;
+// Returns the color of a shape that is of the given pixel value (its 8-bit gray level).
+template<class Pixel>
+static unsigned char toShapeColor(const Pixel &pixel)
+{
+    return PixelKernels<Pixel>::toGray(pixel);
 }
 
-/**
- * Returns an array of pointers to Shapes that contains all rectangles (that are parallel to the x and y axis)
- * and all triangles that are in the rectangles (that are parallel to the x axis).
- * Each rectangle can have either 0 or 1 triangles in them.
- * Shapes can only be in non-zero color.
- * The output array (and all pointers in it) needs to be freed (either manually or with freeShapesArray).
- *
- * @param img The image to scan in.
- * @param arrSize This will be set to the size of the output array.
- * @return an array of pointers to Shapes that contains all rectangles and triangles.
- */
-Shape **Shape::getRectanglesAndTrianglesFromImage(const Image &img, int &arrSize)
+// Returns true if the given pixel is background (all bits zero). Otherwise, returns false.
+template<class Pixel>
+static bool isBackgroundPixel(const Pixel &pixel)
 {
-    std::list<Shape *> shapes;
-    Image tempImg(img);
-    int width = img.getWidth();
-    int height = img.getWidth();
+    return pixel == Pixel();
+}
 
-    for (int y = 0; y < height; ++y)
+// throws ImageDimException if any of the given spans isn't inside a region of the given size.
+static void checkSpansBounds(const std::vector<Span> &spans, int height, int width)
+{
+    for (const Span &span : spans)
     {
-        for (int x = 0; x < width; ++x)
+        if (span.y < 0 || span.y >= height || span.xStart < 0 || span.xEnd >= width)
         {
-            if (tempImg.getPixel(x, y) != BACKGROUND)
-            {
-                Rectangle *newRect;
-                Triangle *newTriangle;
-                if (Rectangle::recognizeRectangleWithTriangle(tempImg, Vector2(x, y), &newRect, &newTriangle))
-                {
-                    // Triangle was found.
-                    shapes.push_back(newTriangle);
-                }
-                shapes.push_front(newRect);
-                Rectangle(*newRect, BACKGROUND).draw(tempImg);
-            }
+            throw ImageDimException();
         }
     }
+}
 
-    arrSize = shapes.size();
-    auto **shapesArray = new Shape *[arrSize];
-    std::copy(shapes.begin(), shapes.end(), shapesArray);
-    return shapesArray;
+/**
+ * Draw's this shape to the given image.
+ *
+ * @param img The image to draw to.
+ */
+void Shape::draw(Image &img) const
+{
+    std::vector<Span> spans;
+    getSpans(spans);
+    drawSpans(img, spans, _color);
 }
 
 /**
- * Draws the given shapes to the given image.
+ * Draw's this shape to the given image in the given color (instead of its own).
  *
  * @param img The image to draw to.
- * @param shapes An array of shape pointers.
- * @param size The size of the shapes array.
+ * @param color The color to draw in.
  */
-void Shape::drawShapesToImage(Image &img, const Shape **shapes, int size)
+template<class Pixel>
+void Shape::draw(PixelImage<Pixel> &img, const Pixel &color) const
 {
-    for (int i = 0; i < size; ++i)
-    {
-        shapes[i]->draw(img);
-    }
+    std::vector<Span> spans;
+    getSpans(spans);
+    drawSpans(img, spans, color);
 }
 
+template void Shape::draw(PixelImage<unsigned char> &img, const unsigned char &color) const;
+
+template void Shape::draw(PixelImage<uint16_t> &img, const uint16_t &color) const;
+
+template void Shape::draw(PixelImage<Rgba8> &img, const Rgba8 &color) const;
+
 /**
- * Frees the memory taken by a dynamically allocated array of dynamically allocated shape pointers.
- * Used to free array output of getRectanglesFromImage and getRectanglesAndTrianglesFromImage.
+ * Draw's this shape to the given image, blending it with the pixels it is drawn over in the given mode.
  *
- * @param shapes An array of pointers to Shapes.
- * @param size The size of the shapes array.
+ * @param img The image to draw to.
+ * @param mode How the shape's color is combined with the pixels (OVERWRITE is the same as draw(img)).
+ * @param alpha The opacity of the shape in ALPHA mode (0 keeps the pixels, 255 replaces them). Ignored otherwise.
  */
-void Shape::freeShapesArray(Shape **shapes, int size)
+void Shape::draw(Image &img, BlendMode mode, unsigned char alpha) const
 {
-    for (int i = 0; i < size; ++i)
+    std::vector<Span> spans;
+    getSpans(spans);
+    drawSpans(img, spans, _color, Vector2(), mode, alpha);
+}
+
+/**
+ * Draw's this shape to the given run-length-encoded image, one row span at a time.
+ *
+ * @param img The image to draw to.
+ */
+void Shape::draw(RleImage &img) const
+{
+    std::vector<Span> spans;
+    getSpans(spans);
+    for (const Span &span : spans)
     {
-        delete shapes[i];
+        img.drawHorizontalLine(Vector2(span.xStart, span.y), span.xEnd, _color);
     }
-    delete[] shapes;
 }
 
 /**
- * Creates a new triangle according to given vertices.
- * Vertices order should be in clockwise order.
+ * Draw's this shape to the given view, in view coordinates.
+ * Throws exception if the shape is out of view bounds (nothing is drawn then).
  *
- * @param a First vertex in clockwise order.
- * @param b Second vertex in clockwise order.
- * @param c Third vertex in clockwise order.
- * @param color The color of the triangle.
+ * @param view The view to draw to.
  */
-Triangle::Triangle(const Vector2 &a, const Vector2 &b, const Vector2 &c, unsigned char color) : Shape(
-        new Vector2[3]{a, b, c}, 3, color)
-{}
+void Shape::draw(ImageView &view) const
+{
+    std::vector<Span> spans;
+    getSpans(spans);
+    checkSpansBounds(spans, view.getHeight(), view.getWidth());
+    drawSpans(view.getImage(), spans, _color, view.getOffset());
+}
 
-// Sets bottomLeft to the bottom-left pixel of the triangle whose top-left pixel is given.
-static void setTriangleBottomLeft(const Image &img, const Vector2 &topLeft, Vector2 &bottomLeft, unsigned char color)
+/**
+ * Draw's this shape to the given view, in view coordinates, blending it with the pixels it is drawn over in the given
+ * mode. Throws exception if the shape is out of view bounds (nothing is drawn then).
+ *
+ * @param view The view to draw to.
+ * @param mode How the shape's color is combined with the pixels (OVERWRITE is the same as draw(view)).
+ * @param alpha The opacity of the shape in ALPHA mode (0 keeps the pixels, 255 replaces them). Ignored otherwise.
+ */
+void Shape::draw(ImageView &view, BlendMode mode, unsigned char alpha) const
 {
-    int x = topLeft.x;
-    int y = topLeft.y;
+    std::vector<Span> spans;
+    getSpans(spans);
+    checkSpansBounds(spans, view.getHeight(), view.getWidth());
+    drawSpans(view.getImage(), spans, _color, view.getOffset(), mode, alpha);
+}
 
-    while (true)
-    {
-        if (img.isPixelValid(x - 1, y + 1) && (img.getPixel(x - 1, y + 1) == color))
-        {
-            // go diagonally left.
-            x--;
-            y++;
-        }
-        else if (img.isPixelValid(x, y + 1) && (img.getPixel(x, y + 1) == color))
-        {
-            // go straight down.
-            y++;
-        }
-        else if (img.isPixelValid(x + 1, y + 1) && (img.getPixel(x + 1, y + 1) == color))
-        {
-            // go diagonally right.
-            x++;
-            y++;
-        }
-        else
-        {
-            // Can't go down anymore.
-            break;
-        }
-    }
+// Returns the largest integer that is not bigger than numerator / denominator (denominator must be positive).
+static int64_t floorDivide(int64_t numerator, int64_t denominator)
+{
+    int64_t quotient = numerator / denominator;
+    return (numerator % denominator != 0 && numerator < 0) ? quotient - 1 : quotient;
+}
 
-    // Now go as left as possible.
-    while (img.isPixelValid(x - 1, y) && (img.getPixel(x - 1, y) == color))
-    {
-        x--;
-    }
+// Half space of the points on the inner side of an edge (same test as isPointInHalfSpace), with its terms worked out
+// once: a point is in it if x * dy <= offset + y * dx. The terms are in 64 bits, as the products of coordinates (up to
+// ShapeListView::MAX_COORDINATE) don't fit in an int.
+struct HalfSpace
+{
+    int64_t dx, dy, offset;
+};
 
-    bottomLeft = Vector2(x, y);
+// Returns the half space created by the two vectors.
+static HalfSpace getHalfSpace(const Vector2 &a, const Vector2 &b)
+{
+    int64_t dx = (int64_t) b.x - a.x;
+    int64_t dy = (int64_t) b.y - a.y;
+    return HalfSpace{dx, dy, a.x * dy - a.y * dx};
 }
 
-// Returns the horizontal length of a triangle starting from leftPoint location.
-static int getTriangleHorizontalLength(const Image &img, const Vector2 &leftPoint, unsigned char color)
+// Shrinks [xStart, xEnd] in row y to the pixels that are in the given half space.
+static void clipSpanToHalfSpace(const HalfSpace &halfSpace, int y, int &xStart, int &xEnd)
 {
-    int x = leftPoint.x;
-    while (img.isPixelValid(x + 1, leftPoint.y) && (img.getPixel(x + 1, leftPoint.y) == color))
+    int64_t bound = halfSpace.offset + y * halfSpace.dx;
+    if (halfSpace.dy > 0)
     {
-        x++;
+        xEnd = (int) std::min((int64_t) xEnd, floorDivide(bound, halfSpace.dy));
+    }
+    else if (halfSpace.dy < 0)
+    {
+        xStart = (int) std::max((int64_t) xStart, -floorDivide(bound, -halfSpace.dy));
+    }
+    else if (bound < 0)
+    {
+        xEnd = xStart - 1;
     }
-    return x - leftPoint.x;
 }
 
 /**
- * Recognizes the Triangle (that is parallel to the x axis) whose top-left corner is the given location
- * and then sets innerTriangle to this triangle.
+ * Appends the spans of pixels covered by this shape (at most one per row, top to bottom) to the given vector.
+ * These are exactly the pixels that draw sets.
  *
- * @param img The image to scan in.
- * @param topLeft The top-left pixel of the triangle.
- * @param innerTriangle This will be set to the new Triangle object.
+ * @param spans The vector to append the spans to.
  */
-void Triangle::recognizeTriangle(const Image &img, const Vector2 &topLeft, Triangle **innerTriangle)
+void Shape::getSpans(std::vector<Span> &spans) const
 {
-    unsigned char color = img.getPixel(topLeft);
-    Vector2 bottomLeft;
-    setTriangleBottomLeft(img, topLeft, bottomLeft, color);
-    int topLength = getTriangleHorizontalLength(img, topLeft, color);
-    int bottomLength = getTriangleHorizontalLength(img, bottomLeft, color);
+    if (_verticesSize == 0)
+    {
+        return;
+    }
 
-    Vector2 first, second, third;
-    if (topLength > bottomLength)
+    int minX, minY, maxX, maxY;
+    setBoundingBox(minX, minY, maxX, maxY, _vertices, _verticesSize);
+
+    // The edges' terms don't depend on the row, so they are worked out once (on the stack for the common shapes).
+    HalfSpace localEdges[LOCAL_VERTICES_SIZE];
+    std::vector<HalfSpace> heapEdges;
+    HalfSpace *edges = localEdges;
+    if (_verticesSize > LOCAL_VERTICES_SIZE)
     {
-        // Triangle has parallel line on the top and single point on the bottom.
-        first = topLeft;
-        second = Vector2(topLeft.x + topLength, topLeft.y);
-        third = Vector2(bottomLeft.x + (bottomLength / 2), topLeft.y); // get middle point (in case of 3+ pixels).
+        heapEdges.resize(_verticesSize);
+        edges = heapEdges.data();
     }
-    else
+    for (int i = 0; i < _verticesSize; ++i)
     {
-        // Triangle has parallel line on the bottom and single point on the top.
-        first = Vector2(topLeft.x + (topLength / 2), topLeft.y); // get middle point (in case of 3+ pixels).
-        second = Vector2(bottomLeft.x + bottomLength, bottomLeft.y);
-        third = bottomLeft;
+        edges[i] = getHalfSpace(_vertices[i], _vertices[(i + 1) % _verticesSize]);
     }
 
-    *innerTriangle = new Triangle(first, second, third, color);
+    for (int y = minY; y <= maxY; ++y)
+    {
+        int xStart = minX;
+        int xEnd = maxX;
+        for (int i = 0; i < _verticesSize && xStart <= xEnd; ++i)
+        {
+            clipSpanToHalfSpace(edges[i], y, xStart, xEnd);
+        }
+
+        if (xStart <= xEnd)
+        {
+            spans.push_back(Span(y, xStart, xEnd));
+        }
+    }
 }
 
 /**
- * Makes this Triangle a copy of the given Triangle with a new given color.
+ * Returns true if all pixels covered by this shape are in an image of the given size (without working out its
+ * spans, so it is cheap for any coordinates). Otherwise, returns false.
  *
- * @param other The Triangle to copy.
- * @param color The color of this shape.
+ * @param height The image height in pixels.
+ * @param width The image width in pixels.
+ * @return true if all pixels covered by this shape are in an image of the given size. Otherwise, returns false.
  */
-Triangle::Triangle(const Triangle &other, unsigned char color) : Shape(other, color)
+bool Shape::isInBounds(int height, int width) const
+{
+    if (_verticesSize == 0)
+    {
+        return true;
+    }
+
+    // The pixels are inside the vertices' bounding box.
+    int minX, minY, maxX, maxY;
+    setBoundingBox(minX, minY, maxX, maxY, _vertices, _verticesSize);
+    return minX >= 0 && minY >= 0 && maxX < width && maxY < height;
+}
+
+/**
+ * Returns the prepared form of this shape, that draws it again and again without redoing its setup.
+ *
+ * @return The prepared form of this shape.
+ */
+PreparedShape Shape::prepare() const
+{
+    return PreparedShape(*this);
+}
+
+// throws ImageDimException if the given integral image isn't of an image of the given image's size.
+static void checkIntegralImage(const Image &img, const IntegralImage &integral)
+{
+    if (integral.getHeight() != img.getHeight() || integral.getWidth() != img.getWidth())
+    {
+        throw ImageDimException();
+    }
+}
+
+// An IntegralImage of an image from before the scan, and the regions of the shapes that the scan erased from it since.
+// The integral image only answers for the pixels that weren't erased, so a region that an erased shape reaches into is
+// looked up in the scanned image instead (and the scan finds the same shapes as with the scanned image as its source).
+// The scan visits the shapes in raster order, so every erased region starts at or above the rows that are asked about,
+// and only the lowest row that the erased regions reach in each column is kept.
+class ErasedIntegralImage
+{
+    const IntegralImage &_integral;
+    const Image &_tempImg;
+    std::vector<int> _erasedBottoms; // The lowest erased row of each column (or -1 if none of it was erased).
+
+public:
+    ErasedIntegralImage(const IntegralImage &integral, const Image &tempImg) :
+            _integral(integral), _tempImg(tempImg), _erasedBottoms(tempImg.getWidth(), -1)
+    {}
+
+    // adds the given region of an erased shape (the scan must not have passed its top row yet).
+    void addErased(const ImageRegion &region)
+    {
+        int xStart = std::max(region.topLeft.x, 0);
+        int xEnd = std::min(region.bottomRight.x, (int) _erasedBottoms.size() - 1);
+        for (int x = xStart; x <= xEnd; ++x)
+        {
+            _erasedBottoms[x] = std::max(_erasedBottoms[x], region.bottomRight.y);
+        }
+    }
+
+    // returns true if an erased shape reaches into the region between the two corners. Otherwise, returns false.
+    // The region must not start above a row that the scan had passed when the shapes were erased.
+    bool isErased(const Vector2 &topLeft, const Vector2 &bottomRight) const
+    {
+        int xStart = std::max(topLeft.x, 0);
+        int xEnd = std::min(bottomRight.x, (int) _erasedBottoms.size() - 1);
+        return xStart <= xEnd && topLeft.y <= *std::max_element(_erasedBottoms.begin() + xStart,
+                                                                  _erasedBottoms.begin() + xEnd + 1);
+    }
+
+    // returns the integral image.
+    const IntegralImage &getIntegral() const
+    {
+        return _integral;
+    }
+
+    // returns the scanned image.
+    const Image &getTempImage() const
+    {
+        return _tempImg;
+    }
+};
+
+// Finds the rectangles, circles and convex polygons of the given image in raster order (and the triangle in each
+// rectangle, if asked to), erasing each one from the image once it was visited. The source (the image itself or an
+// ErasedIntegralImage of it) is asked for the first pixel in each rectangle that isn't of its color.
+// The visitor gets each rectangle, circle or polygon and the triangle in it (or null) as stack objects, and returns
+// false to stop the scan. Returns false if it was stopped.
+template<class ImageT, class SourceT, class Visitor>
+static bool scanRectangles(ImageT &tempImg, SourceT &source, bool withTriangles, Visitor visitor);
+
+// Returns the given vertex moved by the given offset.
+static Vector2 moveVertex(const Vector2 &vertex, const Vector2 &offset)
+{
+    return Vector2(vertex.x + offset.x, vertex.y + offset.y);
+}
+
+// Returns a new copy of the given rectangle, circle or polygon moved by the given offset.
+static Shape *newShapeCopy(const Shape &shape, const Vector2 &offset = Vector2(0, 0))
+{
+    const Vector2 *vertices = shape.getVertices();
+    switch (shape.getType())
+    {
+        case ShapeType::CIRCLE:
+            return new Circle(moveVertex(vertices[0], offset), static_cast<const Circle &>(shape).getRadius(),
+                              shape.getColor());
+        case ShapeType::RECTANGLE:
+            return new Rectangle(moveVertex(vertices[0], offset), moveVertex(vertices[2], offset), shape.getColor());
+        default:
+            break;
+    }
+
+    std::vector<Vector2> moved;
+    for (int i = 0; i < shape.getVerticesSize(); ++i)
+    {
+        moved.push_back(moveVertex(vertices[i], offset));
+    }
+    return new Polygon(moved, shape.getColor());
+}
+
+// Returns a new copy of the given triangle moved by the given offset.
+static Triangle *newTriangleCopy(const Triangle &triangle, const Vector2 &offset)
+{
+    const Vector2 *vertices = triangle.getVertices();
+    return new Triangle(moveVertex(vertices[0], offset), moveVertex(vertices[1], offset),
+                        moveVertex(vertices[2], offset), triangle.getColor());
+}
+
+// Returns all rectangles, circles and polygons (and the triangles in the rectangles, if asked to) in the given image,
+// erasing each one from it once found, moved by the given offset. Rectangles, circles and polygons come last found
+// first, followed by the triangles in the order they were found.
+template<class ImageT, class SourceT>
+static Shape **extractShapes(ImageT &tempImg, SourceT &source, bool withTriangles, int &arrSize,
+                             const Vector2 &offset = Vector2(0, 0))
+{
+    std::vector<Shape *> rectangles, triangles;
+    scanRectangles(tempImg, source, withTriangles, [&](const Shape &rectangle, const Triangle *triangle)
+    {
+        rectangles.push_back(newShapeCopy(rectangle, offset));
+        if (triangle != nullptr)
+        {
+            triangles.push_back(newTriangleCopy(*triangle, offset));
+        }
+        return true;
+    });
+
+    arrSize = (int) (rectangles.size() + triangles.size());
+    auto **shapesArray = new Shape *[arrSize];
+    std::copy(triangles.begin(), triangles.end(), std::reverse_copy(rectangles.begin(), rectangles.end(), shapesArray));
+    return shapesArray;
+}
+
+// Hands the shapes of the given image to the given visitor (a triangle right after the rectangle it is in), erasing
+// each rectangle from the image once found. Returns the number of visited shapes.
+template<class ImageT, class SourceT>
+static int visitShapes(ImageT &tempImg, SourceT &source, bool withTriangles, const ShapeVisitor &visitor)
+{
+    int visited = 0;
+    scanRectangles(tempImg, source, withTriangles, [&](const Shape &rectangle, const Triangle *triangle)
+    {
+        visited++;
+        if (!visitor(rectangle))
+        {
+            return false;
+        }
+        if (triangle == nullptr)
+        {
+            return true;
+        }
+        visited++;
+        return visitor(*triangle);
+    });
+    return visited;
+}
+
+/**
+ * Returns an array of pointers to Shapes that contains all rectangles that are parallel to the x and y axis.
+ * Shapes can only be in non-zero color.
+ * Filled circles and convex polygons (as draw draws them) are recognized too, among the rectangles.
+ * The output array (and all pointers in it) needs to be freed (either manually or with freeShapesArray).
+ *
+ * @param img The image to scan in.
+ * @param arrSize This will be set to the size of the output array.
+ * @return an array of pointers to Shapes that contains all rectangles that are parallel to the x and y axis.
+ */
+Shape **Shape::getRectanglesFromImage(const Image &img, int &arrSize)
+{
+    Image tempImg(img);
+    tempImg.setOccupancyIndex(true);
+    return extractShapes(tempImg, tempImg, false, arrSize);
+}
+
+/**
+ * Returns an array of pointers to Shapes that contains all rectangles (that are parallel to the x and y axis)
+ * and all triangles that are in the rectangles (that are parallel to the x axis).
+ * Each rectangle can have either 0 or 1 triangles in them.
+ * Shapes can only be in non-zero color.
+ * Filled circles and convex polygons (as draw draws them) are recognized too, among the rectangles.
+ * The output array (and all pointers in it) needs to be freed (either manually or with freeShapesArray).
+ *
+ * @param img The image to scan in.
+ * @param arrSize This will be set to the size of the output array.
+ * @return an array of pointers to Shapes that contains all rectangles and triangles.
+ */
+Shape **Shape::getRectanglesAndTrianglesFromImage(const Image &img, int &arrSize)
+{
+    Image tempImg(img);
+    tempImg.setOccupancyIndex(true);
+    return extractShapes(tempImg, tempImg, true, arrSize);
+}
+
+/**
+ * Same as getRectanglesAndTrianglesFromImage, but checks each rectangle for a triangle with O(1) queries of the given
+ * integral image of img, instead of going over the rectangle's pixels (worth it when the integral image is at hand).
+ * A rectangle that shapes found before it reach into is checked on its pixels, so the shapes are the same as without
+ * the integral image, also when they overlap.
+ * Throws exception if the integral image isn't of img's size.
+ * The output array (and all pointers in it) needs to be freed (either manually or with freeShapesArray).
+ *
+ * @param img The image to scan in.
+ * @param integral An integral image of img (img must not have changed since it was built).
+ * @param arrSize This will be set to the size of the output array.
+ * @return an array of pointers to Shapes that contains all rectangles and triangles.
+ */
+Shape **Shape::getRectanglesAndTrianglesFromImage(const Image &img, const IntegralImage &integral, int &arrSize)
+{
+    checkIntegralImage(img, integral);
+    Image tempImg(img);
+    tempImg.setOccupancyIndex(true);
+    ErasedIntegralImage source(integral, tempImg);
+    return extractShapes(tempImg, source, true, arrSize);
+}
+
+// throws ImageDimException if the given pyramid isn't of the given image's size.
+static void checkImagePyramid(const Image &img, const ImagePyramid &pyramid)
+{
+    if (pyramid.getHeight() != img.getHeight() || pyramid.getWidth() != img.getWidth())
+    {
+        throw ImageDimException();
+    }
+}
+
+static std::vector<int> getCircleHalfWidths(int radius);
+
+// Returns the first pixel (in raster order) of the given rectangle, circle or polygon, where the scan finds it.
+static Vector2 getTopLeftPixel(const Shape &shape)
+{
+    if (shape.getType() != ShapeType::CIRCLE)
+    {
+        return shape.getVertices()[0];
+    }
+    const Vector2 &center = shape.getVertices()[0];
+    int radius = static_cast<const Circle &>(shape).getRadius();
+    return Vector2(center.x - getCircleHalfWidths(radius)[radius], center.y - radius);
+}
+
+// Returns the same shapes as extractShapes of a copy of the whole image, by copying and scanning only the shape regions
+// of the given pyramid. Regions hold whole shapes and don't touch, so each one is scanned on its own, and then the
+// shapes are sorted back into the raster order of their top-left pixels that the whole scan would find them in.
+// A background colored "triangle" (a hole in a rectangle) can reach past its region, then the whole image is scanned.
+static Shape **extractShapesByRegion(const Image &img, const ImagePyramid &pyramid, bool withTriangles, int &arrSize)
+{
+    // A found rectangle, circle or polygon, the triangle in it (or null) and its top-left pixel.
+    struct FoundShapes
+    {
+        Shape *shape, *triangle;
+        Vector2 topLeft;
+    };
+
+    checkImagePyramid(img, pyramid);
+    std::vector<FoundShapes> found;
+    bool hasHole = false;
+    for (const ImageRegion &region : pyramid.getShapeRegions())
+    {
+        const Vector2 &offset = region.topLeft;
+        Image tempImg = img.copyRegion(offset, region.bottomRight.y - offset.y + 1,
+                                       region.bottomRight.x - offset.x + 1);
+        tempImg.setOccupancyIndex(true);
+        hasHole = !scanRectangles(tempImg, tempImg, withTriangles, [&](const Shape &rectangle,
+                                                                       const Triangle *triangle)
+        {
+            if (triangle != nullptr && triangle->getColor() == BACKGROUND)
+            {
+                return false;
+            }
+            Shape *movedTriangle = triangle == nullptr ? nullptr : newTriangleCopy(*triangle, offset);
+            found.push_back(FoundShapes{newShapeCopy(rectangle, offset), movedTriangle,
+                                        moveVertex(getTopLeftPixel(rectangle), offset)});
+            return true;
+        });
+        if (hasHole)
+        {
+            break;
+        }
+    }
+
+    if (hasHole)
+    {
+        for (const FoundShapes &shapes : found)
+        {
+            delete shapes.shape;
+            delete shapes.triangle;
+        }
+        Image tempImg(img);
+        tempImg.setOccupancyIndex(true);
+        return extractShapes(tempImg, tempImg, withTriangles, arrSize);
+    }
+
+    std::sort(found.begin(), found.end(), [](const FoundShapes &shapes, const FoundShapes &otherShapes)
+    {
+        return shapes.topLeft.y != otherShapes.topLeft.y ? shapes.topLeft.y < otherShapes.topLeft.y :
+               shapes.topLeft.x < otherShapes.topLeft.x;
+    });
+
+    // Same order as extractShapes: rectangles, circles and polygons last found first, followed by the triangles in the
+    // order they were found.
+    std::vector<Shape *> shapes;
+    for (auto foundIt = found.rbegin(); foundIt != found.rend(); ++foundIt)
+    {
+        shapes.push_back(foundIt->shape);
+    }
+    for (const FoundShapes &foundShapes : found)
+    {
+        if (foundShapes.triangle != nullptr)
+        {
+            shapes.push_back(foundShapes.triangle);
+        }
+    }
+    arrSize = (int) shapes.size();
+    auto **shapesArray = new Shape *[arrSize];
+    std::copy(shapes.begin(), shapes.end(), shapesArray);
+    return shapesArray;
+}
+
+/**
+ * Same as getRectanglesFromImage, but only scans the regions of the given pyramid of img that have shapes in them,
+ * skipping the empty rest of the image (worth it for large images with few shapes). The result is the same.
+ * Throws exception if the pyramid isn't of img's size.
+ * The output array (and all pointers in it) needs to be freed (either manually or with freeShapesArray).
+ *
+ * @param img The image to scan in.
+ * @param pyramid A pyramid of img (img must not have changed since it was built).
+ * @param arrSize This will be set to the size of the output array.
+ * @return an array of pointers to Shapes that contains all rectangles that are parallel to the x and y axis.
+ */
+Shape **Shape::getRectanglesFromImage(const Image &img, const ImagePyramid &pyramid, int &arrSize)
+{
+    return extractShapesByRegion(img, pyramid, false, arrSize);
+}
+
+/**
+ * Same as getRectanglesAndTrianglesFromImage, but only scans the regions of the given pyramid of img that have
+ * shapes in them, skipping the empty rest of the image (worth it for large images with few shapes).
+ * The result is the same.
+ * Throws exception if the pyramid isn't of img's size.
+ * The output array (and all pointers in it) needs to be freed (either manually or with freeShapesArray).
+ *
+ * @param img The image to scan in.
+ * @param pyramid A pyramid of img (img must not have changed since it was built).
+ * @param arrSize This will be set to the size of the output array.
+ * @return an array of pointers to Shapes that contains all rectangles and triangles.
+ */
+Shape **Shape::getRectanglesAndTrianglesFromImage(const Image &img, const ImagePyramid &pyramid, int &arrSize)
+{
+    return extractShapesByRegion(img, pyramid, true, arrSize);
+}
+
+// Returns the shapes of the given region of img (see extractShapes), in img coordinates.
+static Shape **extractShapesInRegion(const Image &img, const ImageRegion &region, bool withTriangles, int &arrSize)
+{
+    const Vector2 &offset = region.topLeft;
+    Image tempImg = img.copyRegion(offset, region.bottomRight.y - offset.y + 1, region.bottomRight.x - offset.x + 1);
+    tempImg.setOccupancyIndex(true);
+    return extractShapes(tempImg, tempImg, withTriangles, arrSize, offset);
+}
+
+/**
+ * Same as getRectanglesFromImage, but scans only the given region of img (shapes are in img coordinates).
+ * Shapes that cross the region's border are cut by it, so the result is only the same as scanning the whole image
+ * for shapes that are entirely inside the region and don't touch the pixels around it.
+ * Throws exception if the region is not inside img.
+ * The output array (and all pointers in it) needs to be freed (either manually or with freeShapesArray).
+ *
+ * @param img The image to scan in.
+ * @param region The region of img to scan.
+ * @param arrSize This will be set to the size of the output array.
+ * @return an array of pointers to Shapes that contains all rectangles that are parallel to the x and y axis.
+ */
+Shape **Shape::getRectanglesFromImage(const Image &img, const ImageRegion &region, int &arrSize)
+{
+    return extractShapesInRegion(img, region, false, arrSize);
+}
+
+/**
+ * Same as getRectanglesAndTrianglesFromImage, but scans only the given region of img (shapes are in img
+ * coordinates). Shapes that cross the region's border are cut by it, so the result is only the same as scanning
+ * the whole image for shapes that are entirely inside the region and don't touch the pixels around it.
+ * Throws exception if the region is not inside img.
+ * The output array (and all pointers in it) needs to be freed (either manually or with freeShapesArray).
+ *
+ * @param img The image to scan in.
+ * @param region The region of img to scan.
+ * @param arrSize This will be set to the size of the output array.
+ * @return an array of pointers to Shapes that contains all rectangles and triangles.
+ */
+Shape **Shape::getRectanglesAndTrianglesFromImage(const Image &img, const ImageRegion &region, int &arrSize)
+{
+    return extractShapesInRegion(img, region, true, arrSize);
+}
+
+/**
+ * Same as getRectanglesFromImage, but scans only the given view (shapes are in view coordinates).
+ * The output array (and all pointers in it) needs to be freed (either manually or with freeShapesArray).
+ *
+ * @param view The view to scan in.
+ * @param arrSize This will be set to the size of the output array.
+ * @return an array of pointers to Shapes that contains all rectangles that are parallel to the x and y axis.
+ */
+Shape **Shape::getRectanglesFromImage(const ImageView &view, int &arrSize)
+{
+    Image tempImg = view.toImage();
+    tempImg.setOccupancyIndex(true);
+    return extractShapes(tempImg, tempImg, false, arrSize);
+}
+
+/**
+ * Same as getRectanglesAndTrianglesFromImage, but scans only the given view (shapes are in view coordinates).
+ * The output array (and all pointers in it) needs to be freed (either manually or with freeShapesArray).
+ *
+ * @param view The view to scan in.
+ * @param arrSize This will be set to the size of the output array.
+ * @return an array of pointers to Shapes that contains all rectangles and triangles.
+ */
+Shape **Shape::getRectanglesAndTrianglesFromImage(const ImageView &view, int &arrSize)
+{
+    Image tempImg = view.toImage();
+    tempImg.setOccupancyIndex(true);
+    return extractShapes(tempImg, tempImg, true, arrSize);
+}
+
+// Returns the shapes of the given image (see extractShapes) and sets colors to the pixel value of each one.
+template<class Pixel>
+static Shape **extractPixelShapes(const PixelImage<Pixel> &img, bool withTriangles, int &arrSize,
+                                  std::vector<Pixel> &colors)
+{
+    PixelImage<Pixel> tempImg(img);
+    Shape **shapes = extractShapes(tempImg, tempImg, withTriangles, arrSize);
+
+    // The first vertex of every recognized shape is one of its pixels.
+    colors.resize(arrSize);
+    for (int i = 0; i < arrSize; ++i)
+    {
+        colors[i] = img.getPixel(shapes[i]->getVertices()[0]);
+    }
+    return shapes;
+}
+
+/**
+ * Same as getRectanglesFromImage, for images of any of the pixel types of PixelKernels.
+ * The shapes' colors are the 8-bit gray levels of their pixels, and their actual pixel values are set in colors.
+ * The output array (and all pointers in it) needs to be freed (either manually or with freeShapesArray).
+ *
+ * @param img The image to scan in.
+ * @param arrSize This will be set to the size of the output array.
+ * @param colors This will be set to the pixel value of each shape in the output array.
+ * @return an array of pointers to Shapes that contains all rectangles that are parallel to the x and y axis.
+ */
+template<class Pixel>
+Shape **Shape::getRectanglesFromImage(const PixelImage<Pixel> &img, int &arrSize, std::vector<Pixel> &colors)
+{
+    return extractPixelShapes(img, false, arrSize, colors);
+}
+
+template Shape **Shape::getRectanglesFromImage(const PixelImage<unsigned char> &img, int &arrSize,
+                                               std::vector<unsigned char> &colors);
+
+template Shape **Shape::getRectanglesFromImage(const PixelImage<uint16_t> &img, int &arrSize,
+                                               std::vector<uint16_t> &colors);
+
+template Shape **Shape::getRectanglesFromImage(const PixelImage<Rgba8> &img, int &arrSize, std::vector<Rgba8> &colors);
+
+/**
+ * Same as getRectanglesAndTrianglesFromImage, for images of any of the pixel types of PixelKernels.
+ * The shapes' colors are the 8-bit gray levels of their pixels, and their actual pixel values are set in colors.
+ * The output array (and all pointers in it) needs to be freed (either manually or with freeShapesArray).
+ *
+ * @param img The image to scan in.
+ * @param arrSize This will be set to the size of the output array.
+ * @param colors This will be set to the pixel value of each shape in the output array.
+ * @return an array of pointers to Shapes that contains all rectangles and triangles.
+ */
+template<class Pixel>
+Shape **Shape::getRectanglesAndTrianglesFromImage(const PixelImage<Pixel> &img, int &arrSize,
+                                                  std::vector<Pixel> &colors)
+{
+    return extractPixelShapes(img, true, arrSize, colors);
+}
+
+template Shape **Shape::getRectanglesAndTrianglesFromImage(const PixelImage<unsigned char> &img, int &arrSize,
+                                                           std::vector<unsigned char> &colors);
+
+template Shape **Shape::getRectanglesAndTrianglesFromImage(const PixelImage<uint16_t> &img, int &arrSize,
+                                                           std::vector<uint16_t> &colors);
+
+template Shape **Shape::getRectanglesAndTrianglesFromImage(const PixelImage<Rgba8> &img, int &arrSize,
+                                                           std::vector<Rgba8> &colors);
+
+/**
+ * Returns an array of pointers to Shapes that contains all rectangles that are parallel to the x and y axis.
+ * Works directly on the runs of the image, so empty stretches cost nothing.
+ * The output array (and all pointers in it) needs to be freed (either manually or with freeShapesArray).
+ *
+ * @param img The run-length-encoded image to scan in.
+ * @param arrSize This will be set to the size of the output array.
+ * @return an array of pointers to Shapes that contains all rectangles that are parallel to the x and y axis.
+ */
+Shape **Shape::getRectanglesFromImage(const RleImage &img, int &arrSize)
+{
+    RleImage tempImg(img);
+    return extractShapes(tempImg, tempImg, false, arrSize);
+}
+
+/**
+ * Returns an array of pointers to Shapes that contains all rectangles (that are parallel to the x and y axis)
+ * and all triangles that are in the rectangles (that are parallel to the x axis).
+ * Works directly on the runs of the image, so empty stretches cost nothing.
+ * The output array (and all pointers in it) needs to be freed (either manually or with freeShapesArray).
+ *
+ * @param img The run-length-encoded image to scan in.
+ * @param arrSize This will be set to the size of the output array.
+ * @return an array of pointers to Shapes that contains all rectangles and triangles.
+ */
+Shape **Shape::getRectanglesAndTrianglesFromImage(const RleImage &img, int &arrSize)
+{
+    RleImage tempImg(img);
+    return extractShapes(tempImg, tempImg, true, arrSize);
+}
+
+/**
+ * Hands each rectangle (that is parallel to the x and y axis) in the given image to the given visitor as soon as
+ * it's found, in raster order of the top-left corners, until the visitor returns false.
+ * Nothing is allocated per shape, so counting or filtering shapes is cheaper than getRectanglesFromImage.
+ *
+ * @param img The image to scan in.
+ * @param visitor Gets each shape (valid during the call only) and returns true to continue or false to stop.
+ * @return The number of shapes that were handed to the visitor.
+ */
+int Shape::visitRectanglesInImage(const Image &img, const ShapeVisitor &visitor)
+{
+    Image tempImg(img);
+    tempImg.setOccupancyIndex(true);
+    return visitShapes(tempImg, tempImg, false, visitor);
+}
+
+/**
+ * Same as visitRectanglesInImage, but also hands over the triangle in each rectangle (if it has one) right after
+ * the rectangle (see getRectanglesAndTrianglesFromImage).
+ *
+ * @param img The image to scan in.
+ * @param visitor Gets each shape (valid during the call only) and returns true to continue or false to stop.
+ * @return The number of shapes that were handed to the visitor.
+ */
+int Shape::visitRectanglesAndTrianglesInImage(const Image &img, const ShapeVisitor &visitor)
+{
+    Image tempImg(img);
+    tempImg.setOccupancyIndex(true);
+    return visitShapes(tempImg, tempImg, true, visitor);
+}
+
+/**
+ * Same as visitRectanglesAndTrianglesInImage, but checks each rectangle for a triangle with O(1) queries of the given
+ * integral image of img (see getRectanglesAndTrianglesFromImage).
+ * Throws exception if the integral image isn't of img's size.
+ *
+ * @param img The image to scan in.
+ * @param integral An integral image of img (img must not have changed since it was built).
+ * @param visitor Gets each shape (valid during the call only) and returns true to continue or false to stop.
+ * @return The number of shapes that were handed to the visitor.
+ */
+int Shape::visitRectanglesAndTrianglesInImage(const Image &img, const IntegralImage &integral,
+                                              const ShapeVisitor &visitor)
+{
+    checkIntegralImage(img, integral);
+    Image tempImg(img);
+    tempImg.setOccupancyIndex(true);
+    ErasedIntegralImage source(integral, tempImg);
+    return visitShapes(tempImg, source, true, visitor);
+}
+
+/**
+ * Same as visitRectanglesInImage, for run-length-encoded images.
+ *
+ * @param img The run-length-encoded image to scan in.
+ * @param visitor Gets each shape (valid during the call only) and returns true to continue or false to stop.
+ * @return The number of shapes that were handed to the visitor.
+ */
+int Shape::visitRectanglesInImage(const RleImage &img, const ShapeVisitor &visitor)
+{
+    RleImage tempImg(img);
+    return visitShapes(tempImg, tempImg, false, visitor);
+}
+
+/**
+ * Same as visitRectanglesAndTrianglesInImage, for run-length-encoded images.
+ *
+ * @param img The run-length-encoded image to scan in.
+ * @param visitor Gets each shape (valid during the call only) and returns true to continue or false to stop.
+ * @return The number of shapes that were handed to the visitor.
+ */
+int Shape::visitRectanglesAndTrianglesInImage(const RleImage &img, const ShapeVisitor &visitor)
+{
+    RleImage tempImg(img);
+    return visitShapes(tempImg, tempImg, true, visitor);
+}
+
+/**
+ * Draws the given shapes to the given image.
+ *
+ * @param img The image to draw to.
+ * @param shapes An array of shape pointers.
+ * @param size The size of the shapes array.
+ */
+void Shape::drawShapesToImage(Image &img, const Shape **shapes, int size)
+{
+    for (int i = 0; i < size; ++i)
+    {
+        shapes[i]->draw(img);
+    }
+}
+
+/**
+ * Draws the given shapes to the given image in order, blending each one with the pixels it is drawn over in the given
+ * mode. Blended shapes don't hide what they are drawn over, so nothing is culled.
+ *
+ * @param img The image to draw to.
+ * @param shapes An array of shape pointers.
+ * @param size The size of the shapes array.
+ * @param mode How the shapes' colors are combined with the pixels (OVERWRITE is the same as not blending).
+ * @param alpha The opacity of the shapes in ALPHA mode (0 keeps the pixels, 255 replaces them). Ignored
+ *              otherwise.
+ */
+void Shape::drawShapesToImage(Image &img, const Shape **shapes, int size, BlendMode mode, unsigned char alpha)
+{
+    for (int i = 0; i < size; ++i)
+    {
+        shapes[i]->draw(img, mode, alpha);
+    }
+}
+
+/**
+ * Draws the given shapes to the given image, optionally skipping (culling) shapes that the shapes after them
+ * cover completely. The result is the same either way.
+ * Throws exception if a shape (culled or not) is out of image bounds (nothing is drawn then).
+ *
+ * @param img The image to draw to.
+ * @param shapes An array of shape pointers.
+ * @param size The size of the shapes array.
+ * @param cullHidden true to skip shapes that are completely covered by later shapes.
+ * @return The number of shapes that were drawn and culled.
+ */
+DrawStats Shape::drawShapesToImage(Image &img, const Shape **shapes, int size, bool cullHidden)
+{
+    DrawStats stats = {0, 0};
+    if (!cullHidden)
+    {
+        drawShapesToImage(img, shapes, size);
+        stats.drawnShapes = size;
+        return stats;
+    }
+
+    // Walk back to front: a shape is hidden if the shapes after it already cover all of its spans. Every shape is
+    // checked against the bounds on the way (before its spans are worked out), hidden or not, so one out of bounds on
+    // either axis throws before anything is drawn. The spans of the visible shapes are kept to draw them with.
+    std::vector<CoveredRanges> coverage(img.getHeight());
+    std::vector<std::vector<Span>> visibleSpans(size);
+    std::vector<Span> spans;
+    for (int i = size - 1; i >= 0; --i)
+    {
+        if (!shapes[i]->isInBounds(img.getHeight(), img.getWidth()))
+        {
+            throw ImageDimException();
+        }
+        spans.clear();
+        shapes[i]->getSpans(spans);
+        bool isHidden = std::all_of(spans.begin(), spans.end(), [&](const Span &span)
+        {
+            return coverage[span.y].contains(span.xStart, span.xEnd);
+        });
+        if (isHidden)
+        {
+            stats.culledShapes++;
+            continue;
+        }
+
+        for (const Span &span : spans)
+        {
+            coverage[span.y].cover(span.xStart, span.xEnd, [](int, int)
+            {});
+        }
+        visibleSpans[i].swap(spans);
+    }
+
+    for (int i = 0; i < size; ++i)
+    {
+        if (!visibleSpans[i].empty())
+        {
+            drawSpans(img, visibleSpans[i], shapes[i]->getColor());
+            stats.drawnShapes++;
+        }
+    }
+    return stats;
+}
+
+/**
+ * Draws the given shapes to the given view, in view coordinates.
+ *
+ * @param view The view to draw to.
+ * @param shapes An array of shape pointers.
+ * @param size The size of the shapes array.
+ */
+void Shape::drawShapesToImage(ImageView &view, const Shape **shapes, int size)
+{
+    for (int i = 0; i < size; ++i)
+    {
+        shapes[i]->draw(view);
+    }
+}
+
+/**
+ * Same as drawShapesToImage, but resolves the overlaps first so every covered pixel is written only once
+ * (see SpanCompositor). Throws exception if a shape is out of image bounds (nothing is drawn then).
+ *
+ * @param img The image to draw to.
+ * @param shapes An array of shape pointers.
+ * @param size The size of the shapes array.
+ */
+void Shape::compositeShapesToImage(Image &img, const Shape **shapes, int size)
+{
+    SpanCompositor compositor(img.getHeight(), img.getWidth());
+    compositor.add(shapes, size);
+    compositor.flush(img);
+}
+
+/**
+ * Redraws the given shapes onto a blank (background) image of the same size and layout as the given image
+ * and compares the result with it.
+ *
+ * @param img The image the shapes were recognized from.
+ * @param shapes An array of shape pointers.
+ * @param size The size of the shapes array.
+ * @return The differences between the given image and the redrawn shapes.
+ */
+ImageDiff Shape::verifyShapes(const Image &img, const Shape **shapes, int size)
+{
+    Image redrawn(img.getHeight(), img.getWidth(), BACKGROUND, img.getLayout());
+    drawShapesToImage(redrawn, shapes, size);
+    return img.compare(redrawn);
+}
+
+/**
+ * Same as getRectanglesFromImage, but also redraws the found shapes and compares them with the scanned image.
+ * The output array (and all pointers in it) needs to be freed (either manually or with freeShapesArray).
+ *
+ * @param img The image to scan in.
+ * @param arrSize This will be set to the size of the output array.
+ * @param diff This will be set to the differences between the scanned image and the redrawn shapes.
+ * @return an array of pointers to Shapes that contains all rectangles that are parallel to the x and y axis.
+ */
+Shape **Shape::getVerifiedRectanglesFromImage(const Image &img, int &arrSize, ImageDiff &diff)
+{
+    Shape **shapes = getRectanglesFromImage(img, arrSize);
+    diff = verifyShapes(img, (const Shape **) shapes, arrSize);
+    return shapes;
+}
+
+/**
+ * Same as getRectanglesAndTrianglesFromImage, but also redraws the found shapes and compares them with the
+ * scanned image.
+ * The output array (and all pointers in it) needs to be freed (either manually or with freeShapesArray).
+ *
+ * @param img The image to scan in.
+ * @param arrSize This will be set to the size of the output array.
+ * @param diff This will be set to the differences between the scanned image and the redrawn shapes.
+ * @return an array of pointers to Shapes that contains all rectangles and triangles.
+ */
+Shape **Shape::getVerifiedRectanglesAndTrianglesFromImage(const Image &img, int &arrSize, ImageDiff &diff)
+{
+    Shape **shapes = getRectanglesAndTrianglesFromImage(img, arrSize);
+    diff = verifyShapes(img, (const Shape **) shapes, arrSize);
+    return shapes;
+}
+
+/**
+ * Frees the memory taken by a dynamically allocated array of dynamically allocated shape pointers.
+ * Used to free array output of getRectanglesFromImage and getRectanglesAndTrianglesFromImage.
+ *
+ * @param shapes An array of pointers to Shapes.
+ * @param size The size of the shapes array.
+ */
+void Shape::freeShapesArray(Shape **shapes, int size)
+{
+    for (int i = 0; i < size; ++i)
+    {
+        delete shapes[i];
+    }
+    delete[] shapes;
+}
+
+/**
+ * Creates a new triangle according to given vertices.
+ * Vertices order should be in clockwise order.
+ *
+ * @param a First vertex in clockwise order.
+ * @param b Second vertex in clockwise order.
+ * @param c Third vertex in clockwise order.
+ * @param color The color of the triangle.
+ */
+Triangle::Triangle(const Vector2 &a, const Vector2 &b, const Vector2 &c, unsigned char color) : Shape(
+        {a, b, c}, color)
+{}
+
+// Sets bottomLeft to the bottom-left pixel of the triangle whose top-left pixel is given.
+template<class ImageT, class Pixel>
+static void setTriangleBottomLeft(const ImageT &img, const Vector2 &topLeft, Vector2 &bottomLeft, const Pixel &color)
+{
+    int x = topLeft.x;
+    int y = topLeft.y;
+
+    while (true)
+    {
+        if (img.isPixelValid(x - 1, y + 1) && (img.getPixel(x - 1, y + 1) == color))
+        {
+            // go diagonally left.
+            x--;
+            y++;
+        }
+        else if (img.isPixelValid(x, y + 1) && (img.getPixel(x, y + 1) == color))
+        {
+            // go straight down.
+            y++;
+        }
+        else if (img.isPixelValid(x + 1, y + 1) && (img.getPixel(x + 1, y + 1) == color))
+        {
+            // go diagonally right.
+            x++;
+            y++;
+        }
+        else
+        {
+            // Can't go down anymore.
+            break;
+        }
+    }
+
+    // Now go as left as possible.
+    while (img.isPixelValid(x - 1, y) && (img.getPixel(x - 1, y) == color))
+    {
+        x--;
+    }
+
+    bottomLeft = Vector2(x, y);
+}
+
+// Returns the horizontal length of a triangle starting from leftPoint location.
+template<class ImageT, class Pixel>
+static int getTriangleHorizontalLength(const ImageT &img, const Vector2 &leftPoint, const Pixel &color)
+{
+    int x = leftPoint.x;
+    while (img.isPixelValid(x + 1, leftPoint.y) && (img.getPixel(x + 1, leftPoint.y) == color))
+    {
+        x++;
+    }
+    return x - leftPoint.x;
+}
+
+// Returns the Triangle (that is parallel to the x axis) whose top-left corner is the given location.
+template<class ImageT>
+static Triangle getTriangleAt(const ImageT &img, const Vector2 &topLeft)
+{
+    auto color = img.getPixel(topLeft);
+    Vector2 bottomLeft;
+    setTriangleBottomLeft(img, topLeft, bottomLeft, color);
+    int topLength = getTriangleHorizontalLength(img, topLeft, color);
+    int bottomLength = getTriangleHorizontalLength(img, bottomLeft, color);
+
+    Vector2 first, second, third;
+    if (topLength > bottomLength)
+    {
+        // Triangle has parallel line on the top and single point on the bottom.
+        first = topLeft;
+        second = Vector2(topLeft.x + topLength, topLeft.y);
+        third = Vector2(bottomLeft.x + (bottomLength / 2), topLeft.y); // get middle point (in case of 3+ pixels).
+    }
+    else
+    {
+        // Triangle has parallel line on the bottom and single point on the top.
+        first = Vector2(topLeft.x + (topLength / 2), topLeft.y); // get middle point (in case of 3+ pixels).
+        second = Vector2(bottomLeft.x + bottomLength, bottomLeft.y);
+        third = bottomLeft;
+    }
+
+    return Triangle(first, second, third, toShapeColor(color));
+}
+
+/**
+ * Recognizes the Triangle (that is parallel to the x axis) whose top-left corner is the given location
+ * and then sets innerTriangle to this triangle.
+ *
+ * @param img The image to scan in.
+ * @param topLeft The top-left pixel of the triangle.
+ * @param innerTriangle This will be set to the new Triangle object.
+ */
+void Triangle::recognizeTriangle(const Image &img, const Vector2 &topLeft, Triangle **innerTriangle)
+{
+    *innerTriangle = new Triangle(getTriangleAt(img, topLeft));
+}
+
+/**
+ * Recognizes the Triangle (that is parallel to the x axis) whose top-left corner is the given location
+ * and then sets innerTriangle to this triangle.
+ *
+ * @param img The run-length-encoded image to scan in.
+ * @param topLeft The top-left pixel of the triangle.
+ * @param innerTriangle This will be set to the new Triangle object.
+ */
+void Triangle::recognizeTriangle(const RleImage &img, const Vector2 &topLeft, Triangle **innerTriangle)
+{
+    *innerTriangle = new Triangle(getTriangleAt(img, topLeft));
+}
+
+/**
+ * Makes this Triangle a copy of the given Triangle with a new given color.
+ *
+ * @param other The Triangle to copy.
+ * @param color The color of this shape.
+ */
+Triangle::Triangle(const Triangle &other, unsigned char color) : Shape(other, color)
+{}
+
+/**
+ * Default ctor for Triangle (can't be drawn)
+ */
+Triangle::Triangle() : Shape()
+{}
+
+/**
+ * Returns the kind of this shape (TRIANGLE).
+ *
+ * @return The kind of this shape.
+ */
+ShapeType Triangle::getType() const
+{
+    return ShapeType::TRIANGLE;
+}
+
+/**
+ * Creates a new Rectangle according to given vertices.
+ *
+ * @param topLeft The top-left pixel of the rectangle.
+ * @param topRight The top-right pixel of the rectangle.
+ * @param bottomRight The bottom-right pixel of the rectangle.
+ * @param bottomLeft The bottom-left pixel of the rectangle.
+ * @param color The color of the rectangle.
+ */
+Rectangle::Rectangle(const Vector2 &topLeft, const Vector2 &topRight, const Vector2 &bottomRight,
+                     const Vector2 &bottomLeft, unsigned char color) : Shape(
+        {topLeft, topRight, bottomRight, bottomLeft}, color)
+{}
+
+/**
+ * Creates a new Rectangle (parallel to the x and y axis) according to given vertices.
+ * (Other new corners are calculated from the given two)
+ *
+ * @param topLeft The top-left pixel of the rectangle.
+ * @param bottomRight The bottom-right pixel of the rectangle.
+ * @param color The color of the rectangle.
+ */
+Rectangle::Rectangle(const Vector2 &topLeft, const Vector2 &bottomRight, unsigned char color) : Rectangle(
+        topLeft, Vector2(bottomRight.x, topLeft.y), bottomRight, Vector2(topLeft.x, bottomRight.y), color)
+{}
+
+// Sets bottomRight to the bottom-right pixel of the rectangle that contains the location start.
+template<class ImageT>
+static void setBottomRightRectangleCorner(const ImageT &img, const Vector2 &start, Vector2 &bottomRight)
+{
+    int x = start.x + 1;
+    int y = start.y + 1;
+
+    while (img.isPixelValid(x, y) && !isBackgroundPixel(img.getPixel(x, y)))
+    {
+        // go diagonally right.
+        x++;
+        y++;
+    }
+
+    if (img.isPixelValid(x - 1, y) && !isBackgroundPixel(img.getPixel(x - 1, y)))
+    {
+        // We need to keep going down.
+        x--; // Fix x because it's out of shape by 1.
+        while (img.isPixelValid(x, ++y) && !isBackgroundPixel(img.getPixel(x, y)));
+        y--; // Fix y because it's out of shape by 1.
+    }
+    else if (img.isPixelValid(x, y - 1) && !isBackgroundPixel(img.getPixel(x, y - 1)))
+    {
+        // We need to keep going right.
+        y--; // Fix y because it's out of shape by 1.
+        while (img.isPixelValid(++x, y) && !isBackgroundPixel(img.getPixel(x, y)));
+        x--; // Fix x because it's out of shape by 1.
+    }
+    else
+    {
+        // Found corner.
+        x--; // Fix x because it's out of shape by 1.
+        y--; // Fix y because it's out of shape by 1.
+    }
+
+    bottomRight = Vector2(x, y);
+}
+
+/**
+ * Recognizes the Rectangle (that is parallel to the x and y axis) whose top-left corner is the given location
+ * and then sets rectangle to this Rectangle.
+ *
+ * @param img The image to scan in.
+ * @param topLeft The top-left pixel of the Rectangle.
+ * @param rectangle This will be set to the new Rectangle object.
+ */
+void Rectangle::recognizeRectangle(const Image &img, const Vector2 &topLeft, Rectangle **rectangle)
+{
+    unsigned char color = img.getPixel(topLeft);
+    Vector2 bottomRight;
+    setBottomRightRectangleCorner(img, topLeft, bottomRight);
+    *rectangle = new Rectangle(topLeft, bottomRight, color);
+}
+
+/**
+ * Recognizes the Rectangle (that is parallel to the x and y axis) whose top-left corner is the given location
+ * and then sets rectangle to this Rectangle.
+ *
+ * @param img The run-length-encoded image to scan in.
+ * @param topLeft The top-left pixel of the Rectangle.
+ * @param rectangle This will be set to the new Rectangle object.
+ */
+void Rectangle::recognizeRectangle(const RleImage &img, const Vector2 &topLeft, Rectangle **rectangle)
+{
+    unsigned char color = img.getPixel(topLeft);
+    Vector2 bottomRight;
+    setBottomRightRectangleCorner(img, topLeft, bottomRight);
+    *rectangle = new Rectangle(topLeft, bottomRight, color);
+}
+
+// Sets found to the first pixel (in raster order) between the two corners that isn't of the given color.
+// Returns true if such a pixel was found. Otherwise, returns false.
+static bool findPixelNotOfColor(const Image &img, const Vector2 &topLeft, const Vector2 &bottomRight,
+                                unsigned char color, Vector2 &found)
+{
+    for (int y = topLeft.y; y <= bottomRight.y; ++y)
+    {
+        // Go over the row one contiguous segment at a time.
+        for (int x = topLeft.x; x <= bottomRight.x;)
+        {
+            int length;
+            const unsigned char *pixels = img.getRowPixels(x, y, length);
+            length = std::min(length, bottomRight.x - x + 1);
+            for (int i = 0; i < length; ++i)
+            {
+                if (pixels[i] != color)
+                {
+                    found = Vector2(x + i, y);
+                    return true;
+                }
+            }
+            x += length;
+        }
+    }
+    return false;
+}
+
+// Sets found to the first pixel (in raster order) between the two corners that isn't of the given color.
+// Returns true if such a pixel was found. Otherwise, returns false.
+static bool findPixelNotOfColor(const RleImage &img, const Vector2 &topLeft, const Vector2 &bottomRight,
+                                unsigned char color, Vector2 &found)
+{
+    for (int y = topLeft.y; y <= bottomRight.y; ++y)
+    {
+        // Walk the runs of the row, looking for a gap or a run of another color.
+        int x = topLeft.x;
+        for (const RleRun &run : img.getRow(y))
+        {
+            if (run.end() < x)
+            {
+                continue;
+            }
+            if (run.start > x || run.color != color)
+            {
+                break;
+            }
+            x = run.end() + 1;
+            if (x > bottomRight.x)
+            {
+                break;
+            }
+        }
+
+        if (x <= bottomRight.x)
+        {
+            found = Vector2(x, y);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Sets found to the first pixel (in raster order) between the two corners that isn't of the given color.
+// Returns true if such a pixel was found. Otherwise, returns false.
+static bool findPixelNotOfColor(const IntegralImage &integral, const Vector2 &topLeft, const Vector2 &bottomRight,
+                                unsigned char color, Vector2 &found)
+{
+    return integral.findPixelNotOfColor(topLeft, bottomRight, color, found);
+}
+
+// Sets found to the first pixel (in raster order) between the two corners that isn't of the given color.
+// Returns true if such a pixel was found. Otherwise, returns false.
+template<class Pixel>
+static bool findPixelNotOfColor(const PixelImage<Pixel> &img, const Vector2 &topLeft, const Vector2 &bottomRight,
+                                const Pixel &color, Vector2 &found);
+
+// Sets found to the first pixel (in raster order) between the two corners of the scanned image that isn't of the given
+// color. Returns true if such a pixel was found. Otherwise, returns false.
+static bool findPixelNotOfColor(const ErasedIntegralImage &source, const Vector2 &topLeft, const Vector2 &bottomRight,
+                                unsigned char color, Vector2 &found)
+{
+    if (source.isErased(topLeft, bottomRight))
+    {
+        return findPixelNotOfColor(source.getTempImage(), topLeft, bottomRight, color, found);
+    }
+    return source.getIntegral().findPixelNotOfColor(topLeft, bottomRight, color, found);
+}
+
+// Sets found to the first pixel (in raster order) between the two corners that isn't of the given color.
+// Returns true if such a pixel was found. Otherwise, returns false.
+template<class Pixel>
+static bool findPixelNotOfColor(const PixelImage<Pixel> &img, const Vector2 &topLeft, const Vector2 &bottomRight,
+                                const Pixel &color, Vector2 &found)
+{
+    for (int y = topLeft.y; y <= bottomRight.y; ++y)
+    {
+        int length;
+        const Pixel *pixels = img.getRowPixels(topLeft.x, y, length);
+        length = std::min(length, bottomRight.x - topLeft.x + 1);
+        int index = PixelKernels<Pixel>::findNotEqual(pixels, length, color);
+        if (index < length)
+        {
+            found = Vector2(topLeft.x + index, y);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Recognizes the Rectangle whose top-left corner is the given location and the Triangle in it (if there is one),
+// asking the given source for the Triangle's top-left pixel.
+template<class ImageT, class SourceT>
+static bool recognizeRectangleWithTriangleAt(const ImageT &img, const SourceT &source, const Vector2 &topLeft,
+                                             Rectangle **rectangle, Triangle **innerTriangle)
+{
+    unsigned char color = img.getPixel(topLeft);
+    Vector2 bottomRight;
+    setBottomRightRectangleCorner(img, topLeft, bottomRight);
+    *rectangle = new Rectangle(topLeft, bottomRight, color);
+
+    Vector2 triangleTopLeft;
+    if (findPixelNotOfColor(source, topLeft, bottomRight, color, triangleTopLeft))
+    {
+        *innerTriangle = new Triangle(getTriangleAt(img, triangleTopLeft));
+        return true;
+    }
+    return false;
+}
+
+/**
+ * Recognizes the Rectangle (that is parallel to the x and y axis) whose top-left corner is the given location
+ * and then sets rectangle to this Rectangle.
+ * Also Recognizes the Triangle (that is parallel to the x axis) if one is in the Rectangle
+ * and then sets innerTriangle to this triangle.
+ * Returns true if Triangle was found. Otherwise, returns false.
+ *
+ * @param img The image to scan in.
+ * @param topLeft The top-left pixel of the Rectangle.
+ * @param rectangle This will be set to the new Rectangle object.
+ * @param innerTriangle This will be set to the new Triangle object (if found in Rectangle).
+ * @return true if Triangle was found. Otherwise, returns false.
+ */
+bool Rectangle::recognizeRectangleWithTriangle(const Image &img, const Vector2 &topLeft, Rectangle **rectangle,
+                                               Triangle **innerTriangle)
+{
+    return recognizeRectangleWithTriangleAt(img, img, topLeft, rectangle, innerTriangle);
+}
+
+/**
+ * Recognizes the Rectangle (that is parallel to the x and y axis) whose top-left corner is the given location
+ * and then sets rectangle to this Rectangle.
+ * Also Recognizes the Triangle (that is parallel to the x axis) if one is in the Rectangle
+ * and then sets innerTriangle to this triangle.
+ * Returns true if Triangle was found. Otherwise, returns false.
+ *
+ * @param img The run-length-encoded image to scan in.
+ * @param topLeft The top-left pixel of the Rectangle.
+ * @param rectangle This will be set to the new Rectangle object.
+ * @param innerTriangle This will be set to the new Triangle object (if found in Rectangle).
+ * @return true if Triangle was found. Otherwise, returns false.
+ */
+bool Rectangle::recognizeRectangleWithTriangle(const RleImage &img, const Vector2 &topLeft, Rectangle **rectangle,
+                                               Triangle **innerTriangle)
+{
+    return recognizeRectangleWithTriangleAt(img, img, topLeft, rectangle, innerTriangle);
+}
+
+/**
+ * Same as recognizeRectangleWithTriangle, but checks the Rectangle for a Triangle with O(1) queries of the given
+ * integral image of img, instead of going over the Rectangle's pixels.
+ * Throws exception if the integral image isn't of img's size.
+ *
+ * @param img The image to scan in.
+ * @param integral An integral image of img (the Rectangle must not have changed since it was built).
+ * @param topLeft The top-left pixel of the Rectangle.
+ * @param rectangle This will be set to the new Rectangle object.
+ * @param innerTriangle This will be set to the new Triangle object (if found in Rectangle).
+ * @return true if Triangle was found. Otherwise, returns false.
+ */
+bool Rectangle::recognizeRectangleWithTriangle(const Image &img, const IntegralImage &integral,
+                                               const Vector2 &topLeft, Rectangle **rectangle,
+                                               Triangle **innerTriangle)
+{
+    checkIntegralImage(img, integral);
+    return recognizeRectangleWithTriangleAt(img, integral, topLeft, rectangle, innerTriangle);
+}
+
+// Returns the x coordinate of the first non-background pixel in row y at or after x, or the image width.
+static int findNextShapePixel(const Image &img, int x, int y)
+{
+    return img.findNextNonBackgroundPixel(x, y);
+}
+
+// Returns the x coordinate of the first non-background pixel in row y at or after x, or the image width.
+template<class Pixel>
+static int findNextShapePixel(const PixelImage<Pixel> &img, int x, int y)
+{
+    return img.findNextNonBackgroundPixel(x, y);
+}
+
+// Returns the x coordinate of the first non-background pixel in row y at or after x, or the image width.
+static int findNextShapePixel(const RleImage &img, int, int y)
+{
+    // Background isn't stored and the found rectangles are erased, so the first run of the row is the next pixel.
+    const std::vector<RleRun> &row = img.getRow(y);
+    return row.empty() ? img.getWidth() : row.front().start;
+}
+
+// Returns the region of the pixels of the given rectangle.
+static ImageRegion getShapeRegion(const Rectangle &rectangle)
+{
+    return ImageRegion{rectangle.getVertices()[0], rectangle.getVertices()[2]};
+}
+
+// Returns the region of the pixels of the given circle.
+static ImageRegion getShapeRegion(const Circle &circle)
+{
+    const Vector2 &center = circle.getVertices()[0];
+    int radius = circle.getRadius();
+    return ImageRegion{Vector2(center.x - radius, center.y - radius), Vector2(center.x + radius, center.y + radius)};
+}
+
+// Returns the region of the pixels of the given polygon.
+static ImageRegion getShapeRegion(const Polygon &polygon)
+{
+    int minX, minY, maxX, maxY;
+    setBoundingBox(minX, minY, maxX, maxY, polygon.getVertices(), polygon.getVerticesSize());
+    return ImageRegion{Vector2(minX, minY), Vector2(maxX, maxY)};
+}
+
+// Tells the given source that the given shape was erased from the scanned image (the image itself already knows).
+template<class SourceT, class ShapeT>
+static void markErased(SourceT &, const ShapeT &)
+{}
+
+// Tells the given source that the given shape was erased from the scanned image.
+template<class ShapeT>
+static void markErased(ErasedIntegralImage &source, const ShapeT &shape)
+{
+    source.addErased(getShapeRegion(shape));
+}
+
+// Sets the pixels of the given rectangle, circle or polygon to background.
+template<class ImageT, class ShapeT>
+static void eraseShape(ImageT &img, const ShapeT &shape)
+{
+    ShapeT(shape, BACKGROUND).draw(img);
+}
+
+// Sets the pixels of the given rectangle, circle or polygon to background.
+template<class Pixel, class ShapeT>
+static void eraseShape(PixelImage<Pixel> &img, const ShapeT &shape)
+{
+    shape.draw(img, Pixel());
+}
+
+// Sets circle to the circle (as Circle::draw draws it) whose top-left pixel is the given location.
+// Returns true if there is such a circle. Otherwise, returns false.
+template<class ImageT>
+static bool findCircleAt(const ImageT &img, const Vector2 &topLeft, Circle &circle);
+
+// Returns the pixels of row y if they are stored contiguously. Otherwise, returns null.
+template<class Pixel>
+static const Pixel *getContiguousRow(const PixelImage<Pixel> &img, int y)
+{
+    int length;
+    const Pixel *row = img.getRowPixels(0, y, length);
+    return length == img.getWidth() ? row : nullptr;
+}
+
+// Returns the pixels of row y if they are stored contiguously. Otherwise, returns null.
+static const unsigned char *getContiguousRow(const RleImage &, int)
+{
+    return nullptr;
+}
+
+// Sets outline to the rows of the blob of the given color whose top-left pixel is the given location: top to bottom,
+// the run of each row from its leftmost to its rightmost pixel of the color that touches the run of the row above.
+template<class ImageT, class Pixel>
+static void traceOutline(const ImageT &img, const Vector2 &topLeft, const Pixel &color, std::vector<Span> &outline)
+{
+    // Each run's ends are found from the ones above by walking out of them (while the color goes on) or in towards
+    // them (until it starts), so only the blob's border is read. The row is in bounds, so only x is checked, and it
+    // is read in place when it is contiguous.
+    int width = img.getWidth();
+    int y = topLeft.y;
+    auto row = getContiguousRow(img, y);
+    auto isOfColor = [&](int x)
+    {
+        return x >= 0 && x < width && (row != nullptr ? row[x] == color : img.getPixel(x, y) == color);
+    };
+
+    outline.clear();
+    int left = topLeft.x, right = topLeft.x;
+    while (isOfColor(right + 1))
+    {
+        right++;
+    }
+    outline.push_back(Span(y, left, right));
+
+    for (y++; y < img.getHeight(); ++y)
+    {
+        row = getContiguousRow(img, y);
+        int newLeft = left - 1;
+        if (isOfColor(newLeft))
+        {
+            while (isOfColor(newLeft - 1))
+            {
+                newLeft--;
+            }
+        }
+        else
+        {
+            newLeft = left;
+            while (newLeft <= right + 1 && !isOfColor(newLeft))
+            {
+                newLeft++;
+            }
+            if (newLeft > right + 1)
+            {
+                return;
+            }
+        }
+
+        int newRight = right + 1;
+        if (isOfColor(newRight))
+        {
+            while (isOfColor(newRight + 1))
+            {
+                newRight++;
+            }
+        }
+        else
+        {
+            newRight = right;
+            while (!isOfColor(newRight))
+            {
+                newRight--;
+            }
+        }
+        left = newLeft;
+        right = newRight;
+        outline.push_back(Span(y, left, right));
+    }
+}
+
+// Returns the cross product of the vectors from origin to a and from origin to b (positive if the turn from a to b
+// is clockwise on the screen).
+static long long getTurn(const Vector2 &origin, const Vector2 &a, const Vector2 &b)
+{
+    return (long long) (a.x - origin.x) * (b.y - origin.y) - (long long) (a.y - origin.y) * (b.x - origin.x);
+}
+
+// Sets hull to the vertices of the convex hull of the ends of the given outline's runs, in clockwise order from the
+// top-left one and without collinear vertices.
+static void getOutlineHull(const std::vector<Span> &outline, std::vector<Vector2> &hull)
+{
+    // Monotone chain: the run ends are already sorted by row and then column, so this is linear. The right side is
+    // walked down, then the left side up, dropping every vertex that doesn't turn clockwise.
+    std::vector<Vector2> points;
+    for (const Span &span : outline)
+    {
+        points.push_back(Vector2(span.xStart, span.y));
+        if (span.xEnd != span.xStart)
+        {
+            points.push_back(Vector2(span.xEnd, span.y));
+        }
+    }
+
+    hull.clear();
+    for (const Vector2 &point : points)
+    {
+        while (hull.size() >= 2 && getTurn(hull[hull.size() - 2], hull.back(), point) <= 0)
+        {
+            hull.pop_back();
+        }
+        hull.push_back(point);
+    }
+    size_t rightSize = hull.size();
+    for (int i = (int) points.size() - 2; i >= 0; --i)
+    {
+        while (hull.size() > rightSize && getTurn(hull[hull.size() - 2], hull.back(), points[i]) <= 0)
+        {
+            hull.pop_back();
+        }
+        hull.push_back(points[i]);
+    }
+    if (hull.size() > 1)
+    {
+        // The left side ends where the right side started.
+        hull.pop_back();
+    }
+}
+
+// Returns true if all runs of the given outline have the same ends, so it is a rectangle that is parallel to the x and
+// y axis. Otherwise, returns false.
+static bool isRectangleOutline(const std::vector<Span> &outline)
+{
+    for (const Span &span : outline)
+    {
+        if (span.xStart != outline.front().xStart || span.xEnd != outline.front().xEnd)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Returns true if the given outline (see traceOutline) lies in the rectangle of the given corners and the rest of the
+// rectangle has no background pixel, so the blob is a rectangle whose border the shapes drawn over it touch.
+// Otherwise, returns false.
+template<class ImageT>
+static bool isCoveredRectangle(const ImageT &img, const std::vector<Span> &outline, const Vector2 &topLeft,
+                               const Vector2 &bottomRight)
+{
+    if ((int) outline.size() > bottomRight.y - topLeft.y + 1)
+    {
+        return false;
+    }
+
+    // Only the pixels that the outline's runs leave out are read (the runs are of the blob's color).
+    auto isCovered = [&](int y, int xStart, int xEnd)
+    {
+        for (int x = xStart; x <= xEnd; ++x)
+        {
+            if (isBackgroundPixel(img.getPixel(x, y)))
+            {
+                return false;
+            }
+        }
+        return true;
+    };
+    for (int y = topLeft.y; y <= bottomRight.y; ++y)
+    {
+        size_t i = (size_t) (y - topLeft.y);
+        if (i >= outline.size())
+        {
+            if (!isCovered(y, topLeft.x, bottomRight.x))
+            {
+                return false;
+            }
+            continue;
+        }
+        const Span &span = outline[i];
+        if (span.xStart < topLeft.x || span.xEnd > bottomRight.x || !isCovered(y, topLeft.x, span.xStart - 1) ||
+            !isCovered(y, span.xEnd + 1, bottomRight.x))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Returns true if the given shape covers exactly the given spans (one per row, top to bottom). Otherwise, returns
+// false.
+static bool isShapeOfSpans(const Shape &shape, const std::vector<Span> &spans)
+{
+    std::vector<Span> shapeSpans;
+    shape.getSpans(shapeSpans);
+    if (shapeSpans.size() != spans.size())
+    {
+        return false;
+    }
+    for (size_t i = 0; i < spans.size(); ++i)
+    {
+        if (shapeSpans[i].y != spans[i].y || shapeSpans[i].xStart != spans[i].xStart ||
+            shapeSpans[i].xEnd != spans[i].xEnd)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Returns true if the blob of the given outline (see traceOutline) is all of the given color and is exactly the
+// pixels that draw sets for the polygon of the given hull. Otherwise, returns false.
+template<class ImageT, class Pixel>
+static bool isPolygonBlob(const ImageT &img, const std::vector<Span> &outline, const std::vector<Vector2> &hull,
+                          const Pixel &color)
+{
+    if (hull.size() < 3 || !isShapeOfSpans(Polygon(hull, BACKGROUND), outline))
+    {
+        return false;
+    }
+
+    Vector2 found;
+    for (const Span &span : outline)
+    {
+        if (findPixelNotOfColor(img, Vector2(span.xStart, span.y), Vector2(span.xEnd, span.y), color, found))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Finds the rectangles, circles and convex polygons of the given image in raster order (and the triangle in each
+// rectangle, if asked to), erasing each one from the image once it was visited. The source (the image itself or an
+// IntegralImage of it from before the scan) is asked for the first pixel in each rectangle that isn't of its color.
+// The visitor gets each rectangle, circle or polygon and the triangle in it (or null) as stack objects, and returns
+// false to stop the scan. Returns false if it was stopped.
+template<class ImageT, class SourceT, class Visitor>
+static bool scanRectangles(ImageT &tempImg, SourceT &source, bool withTriangles, Visitor visitor)
+{
+    int width = tempImg.getWidth();
+    int height = tempImg.getHeight();
+    std::vector<Span> outline;
+    std::vector<Vector2> hull;
+    for (int y = 0; y < height; ++y)
+    {
+        // Jump straight to the next non-background pixel.
+        for (int x = findNextShapePixel(tempImg, 0, y); x < width; x = findNextShapePixel(tempImg, x + 1, y))
+        {
+            // A blob whose outline is a rectangle goes the rectangle way, and so does one that fills a rectangle
+            // together with the shapes drawn over it (a triangle that touches the rectangle's border). Otherwise it
+            // is a circle, a convex polygon or neither (then the rectangle way finds what it always did).
+            Vector2 topLeft(x, y);
+            auto color = tempImg.getPixel(topLeft);
+            Vector2 bottomRight;
+            setBottomRightRectangleCorner(tempImg, topLeft, bottomRight);
+            traceOutline(tempImg, topLeft, color, outline);
+            if (!isRectangleOutline(outline) && !isCoveredRectangle(tempImg, outline, topLeft, bottomRight))
+            {
+                Circle circle;
+                if (findCircleAt(tempImg, topLeft, circle))
+                {
+                    if (!visitor(circle, nullptr))
+                    {
+                        return false;
+                    }
+                    eraseShape(tempImg, circle);
+                    markErased(source, circle);
+                    continue;
+                }
+                getOutlineHull(outline, hull);
+                if (isPolygonBlob(tempImg, outline, hull, color))
+                {
+                    Polygon polygon(hull, toShapeColor(color));
+                    if (!visitor(polygon, nullptr))
+                    {
+                        return false;
+                    }
+                    eraseShape(tempImg, polygon);
+                    markErased(source, polygon);
+                    continue;
+                }
+            }
+
+            Rectangle rectangle(topLeft, bottomRight, toShapeColor(color));
+
+            Vector2 triangleTopLeft;
+            if (withTriangles && findPixelNotOfColor(source, topLeft, bottomRight, color, triangleTopLeft))
+            {
+                Triangle triangle = getTriangleAt(tempImg, triangleTopLeft);
+                if (!visitor(rectangle, &triangle))
+                {
+                    return false;
+                }
+            }
+            else if (!visitor(rectangle, nullptr))
+            {
+                return false;
+            }
+            eraseShape(tempImg, rectangle);
+            markErased(source, rectangle);
+        }
+    }
+    return true;
+}
+
+/**
+ * Makes this Rectangle a copy of the given Rectangle with a new given color.
+ *
+ * @param other The Rectangle to copy.
+ * @param color The color of this shape.
+ */
+Rectangle::Rectangle(const Rectangle &other, unsigned char color) : Shape(other, color)
+{}
+
+/**
+ * Default ctor for rectangle (can't be drawn)
+ */
+Rectangle::Rectangle() : Shape()
 {}
 
-/**
- * Default ctor for Triangle (can't be drawn)
- */
-Triangle::Triangle() : Shape()
-{}
+/**
+ * Returns the kind of this shape (RECTANGLE).
+ *
+ * @return The kind of this shape.
+ */
+ShapeType Rectangle::getType() const
+{
+    return ShapeType::RECTANGLE;
+}
+
+/**
+ * Default ctor for circle (can't be drawn)
+ */
+Circle::Circle() : Shape(), _radius(-1)
+{}
+
+/**
+ * Creates a new circle according the given center point, radius and color.
+ *
+ * @param center 2d vector that has location of center point.
+ * @param radius The circle's radius.
+ * @param color The color of the circle.
+ */
+Circle::Circle(const Vector2 &center, int radius, unsigned char color) : Shape({center}, color),
+                                                                         _radius(radius)
+{}
+
+// Widens the half-width of the rows covered by the current 8 sections of the circle.
+static void setCirclePartHalfWidths(std::vector<int> &halfWidths, const Vector2 &currentPart)
+{
+    int rows = (int) halfWidths.size();
+    if (currentPart.y >= 0 && currentPart.y < rows)
+    {
+        halfWidths[currentPart.y] = std::max(halfWidths[currentPart.y], currentPart.x);
+    }
+    if (currentPart.x >= 0 && currentPart.x < rows)
+    {
+        halfWidths[currentPart.x] = std::max(halfWidths[currentPart.x], currentPart.y);
+    }
+}
+
+// Returns the half-width of each row of a circle of the given radius, by the row's distance from the center row (the
+// widest line of each row in the Bresenham decision sequence).
+static std::vector<int> getCircleHalfWidths(int radius)
+{
+    std::vector<int> halfWidths(radius + 1, -1);
+
+    Vector2 currentPart(0, radius);
+    int decision = 3 - (2 * radius);
+    setCirclePartHalfWidths(halfWidths, currentPart);
+
+    while (currentPart.y >= currentPart.x)
+    {
+        currentPart.x++;
+        if (decision > 0)
+        {
+            currentPart.y--;
+            decision += 4 * (currentPart.x - currentPart.y) + 10;
+        }
+        else
+        {
+            decision += (4 * currentPart.x) + 6;
+        }
+        setCirclePartHalfWidths(halfWidths, currentPart);
+    }
+    return halfWidths;
+}
 
 /**
- * Creates a new Rectangle according to given vertices.
+ * Appends the spans of pixels covered by this circle (one per row, top to bottom) to the given vector.
+ * These are exactly the pixels that draw sets.
  *
- * @param topLeft The top-left pixel of the rectangle.
- * @param topRight The top-right pixel of the rectangle.
- * @param bottomRight The bottom-right pixel of the rectangle.
- * @param bottomLeft The bottom-left pixel of the rectangle.
- * @param color The color of the rectangle.
+ * @param spans The vector to append the spans to.
  */
-Rectangle::Rectangle(const Vector2 &topLeft, const Vector2 &topRight, const Vector2 &bottomRight,
-                     const Vector2 &bottomLeft, unsigned char color) : Shape(
-        new Vector2[4]{topLeft, topRight, bottomRight, bottomLeft}, 4, color)
-{}
+void Circle::getSpans(std::vector<Span> &spans) const
+{
+    if (_radius < 0)
+    {
+        return;
+    }
+
+    const Vector2 &center = getVertices()[0];
+    std::vector<int> halfWidths = getCircleHalfWidths(_radius);
+    for (int dy = -_radius; dy <= _radius; ++dy)
+    {
+        int halfWidth = halfWidths[dy < 0 ? -dy : dy];
+        if (halfWidth >= 0)
+        {
+            spans.push_back(Span(center.y + dy, center.x - halfWidth, center.x + halfWidth));
+        }
+    }
+}
 
 /**
- * Creates a new Rectangle (parallel to the x and y axis) according to given vertices.
- * (Other new corners are calculated from the given two)
+ * Returns true if all pixels covered by this circle are in an image of the given size. Otherwise, returns false.
  *
- * @param topLeft The top-left pixel of the rectangle.
- * @param bottomRight The bottom-right pixel of the rectangle.
- * @param color The color of the rectangle.
+ * @param height The image height in pixels.
+ * @param width The image width in pixels.
+ * @return true if all pixels covered by this circle are in an image of the given size. Otherwise, returns false.
  */
-Rectangle::Rectangle(const Vector2 &topLeft, const Vector2 &bottomRight, unsigned char color) : Rectangle(
-        topLeft, Vector2(bottomRight.x, topLeft.y), bottomRight, Vector2(topLeft.x, bottomRight.y), color)
-{}
+bool Circle::isInBounds(int height, int width) const
+{
+    if (_radius < 0)
+    {
+        return true;
+    }
 
-// Sets bottomRight to the bottom-right pixel of the rectangle that contains the location start.
-static void setBottomRightRectangleCorner(const Image &img, const Vector2 &start, Vector2 &bottomRight)
+    // Worked out in 64 bits, so a far away center with a large radius doesn't wrap around.
+    const Vector2 &center = getVertices()[0];
+    return (long long) center.x - _radius >= 0 && (long long) center.y - _radius >= 0 &&
+           (long long) center.x + _radius < width && (long long) center.y + _radius < height;
+}
+
+// Returns true if the pixels of row y from xStart to xEnd are all of the given color and the pixels right next to
+// them aren't. Otherwise, returns false.
+template<class ImageT, class Pixel>
+static bool isExactRun(const ImageT &img, int y, int xStart, int xEnd, const Pixel &color)
 {
-    int x = start.x + 1;
-    int y = start.y + 1;
+    Vector2 found;
+    return img.isPixelValid(xStart, y) && img.isPixelValid(xEnd, y) &&
+           !(img.isPixelValid(xStart - 1, y) && img.getPixel(xStart - 1, y) == color) &&
+           !(img.isPixelValid(xEnd + 1, y) && img.getPixel(xEnd + 1, y) == color) &&
+           !findPixelNotOfColor(img, Vector2(xStart, y), Vector2(xEnd, y), color, found);
+}
 
-    while (img.isPixelValid(x, y) && img.getPixel(x, y) != BACKGROUND)
+// Sets circle to the circle (as Circle::draw draws it) whose top-left pixel is the given location.
+// Returns true if there is such a circle. Otherwise, returns false.
+template<class ImageT>
+static bool findCircleAt(const ImageT &img, const Vector2 &topLeft, Circle &circle)
+{
+    // The top row of a circle is centered on its column of the vertical diameter, and the length of that column gives
+    // the radius. The blob is then checked row by row against the exact span table of a circle of that radius.
+    auto color = img.getPixel(topLeft);
+    int topEnd = topLeft.x;
+    while (img.isPixelValid(topEnd + 1, topLeft.y) && img.getPixel(topEnd + 1, topLeft.y) == color)
     {
-        // go diagonally right.
-        x++;
-        y++;
+        topEnd++;
     }
-
-    if (img.isPixelValid(x - 1, y) && img.getPixel(x - 1, y) != BACKGROUND)
+    int bottom = topLeft.y;
+    int centerX = topLeft.x + (topEnd - topLeft.x) / 2;
+    while (img.isPixelValid(centerX, bottom + 1) && img.getPixel(centerX, bottom + 1) == color)
     {
-        // We need to keep going down.
-        x--; // Fix x because it's out of shape by 1.
-        while (img.isPixelValid(x, ++y) && img.getPixel(x, y) != BACKGROUND);
-        y--; // Fix y because it's out of shape by 1.
+        bottom++;
     }
-    else if (img.isPixelValid(x, y - 1) && img.getPixel(x, y - 1) != BACKGROUND)
+    if ((topEnd - topLeft.x) % 2 != 0 || (bottom - topLeft.y) % 2 != 0)
     {
-        // We need to keep going right.
-        y--; // Fix y because it's out of shape by 1.
-        while (img.isPixelValid(++x, y) && img.getPixel(x, y) != BACKGROUND);
-        x--; // Fix x because it's out of shape by 1.
+        return false;
     }
-    else
+
+    int radius = (bottom - topLeft.y) / 2;
+    std::vector<int> halfWidths = getCircleHalfWidths(radius);
+    // A circle whose rows are all of the same width is a square, which is recognized as a rectangle.
+    if (halfWidths[radius] != centerX - topLeft.x || halfWidths[radius] == halfWidths[0])
     {
-        // Found corner.
-        x--; // Fix x because it's out of shape by 1.
-        y--; // Fix y because it's out of shape by 1.
+        return false;
     }
 
-    bottomRight = Vector2(x, y);
+    Vector2 center(centerX, topLeft.y + radius);
+    for (int dy = -radius; dy <= radius; ++dy)
+    {
+        int halfWidth = halfWidths[dy < 0 ? -dy : dy];
+        if (!isExactRun(img, center.y + dy, centerX - halfWidth, centerX + halfWidth, color))
+        {
+            return false;
+        }
+    }
+    circle = Circle(center, radius, toShapeColor(color));
+    return true;
 }
 
 /**
- * Recognizes the Rectangle (that is parallel to the x and y axis) whose top-left corner is the given location
- * and then sets rectangle to this Rectangle.
+ * Recognizes the Circle (as draw draws it) whose top-left pixel is the given location
+ * and then sets circle to this Circle.
+ * Returns true if there is such a Circle. Otherwise, returns false (and circle isn't set).
  *
  * @param img The image to scan in.
- * @param topLeft The top-left pixel of the Rectangle.
- * @param rectangle This will be set to the new Rectangle object.
+ * @param topLeft The top-left pixel of the Circle (the first one in raster order).
+ * @param circle This will be set to the new Circle object (if found).
+ * @return true if a Circle was found. Otherwise, returns false.
  */
-void Rectangle::recognizeRectangle(const Image &img, const Vector2 &topLeft, Rectangle **rectangle)
+bool Circle::recognizeCircle(const Image &img, const Vector2 &topLeft, Circle **circle)
 {
-    unsigned char color = img.getPixel(topLeft);
-    Vector2 bottomRight;
-    setBottomRightRectangleCorner(img, topLeft, bottomRight);
-    *rectangle = new Rectangle(topLeft, bottomRight, color);
+    Circle found;
+    if (!findCircleAt(img, topLeft, found))
+    {
+        return false;
+    }
+    *circle = new Circle(found);
+    return true;
 }
 
 /**
- * Recognizes the Rectangle (that is parallel to the x and y axis) whose top-left corner is the given location
- * and then sets rectangle to this Rectangle.
- * Also Recognizes the Triangle (that is parallel to the x axis) if one is in the Rectangle
- * and then sets innerTriangle to this triangle.
- * Returns true if Triangle was found. Otherwise, returns false.
+ * Recognizes the Circle (as draw draws it) whose top-left pixel is the given location
+ * and then sets circle to this Circle.
+ * Returns true if there is such a Circle. Otherwise, returns false (and circle isn't set).
  *
- * @param img The image to scan in.
- * @param topLeft The top-left pixel of the Rectangle.
- * @param rectangle This will be set to the new Rectangle object.
- * @param innerTriangle This will be set to the new Triangle object (if found in Rectangle).
- * @return true if Triangle was found. Otherwise, returns false.
+ * @param img The run-length-encoded image to scan in.
+ * @param topLeft The top-left pixel of the Circle (the first one in raster order).
+ * @param circle This will be set to the new Circle object (if found).
+ * @return true if a Circle was found. Otherwise, returns false.
  */
-bool Rectangle::recognizeRectangleWithTriangle(const Image &img, const Vector2 &topLeft, Rectangle **rectangle,
-                                               Triangle **innerTriangle)
+bool Circle::recognizeCircle(const RleImage &img, const Vector2 &topLeft, Circle **circle)
 {
-    unsigned char color = img.getPixel(topLeft);
-    Vector2 bottomRight;
-    setBottomRightRectangleCorner(img, topLeft, bottomRight);
-    *rectangle = new Rectangle(topLeft, bottomRight, color);
-
-    for (int y = topLeft.y; y <= bottomRight.y; ++y)
+    Circle found;
+    if (!findCircleAt(img, topLeft, found))
     {
-        for (int x = topLeft.x; x <= bottomRight.x; ++x)
-        {
-            if (img.getPixel(x, y) != color)
-            {
-                Triangle::recognizeTriangle(img, Vector2(x, y), innerTriangle);
-                return true;
-            }
-        }
+        return false;
     }
-    return false;
+    *circle = new Circle(found);
+    return true;
 }
 
 /**
- * Makes this Rectangle a copy of the given Rectangle with a new given color.
+ * Makes this Circle a copy of the given Circle with a new given color.
  *
- * @param other The Rectangle to copy.
+ * @param other The Circle to copy.
  * @param color The color of this shape.
  */
-Rectangle::Rectangle(const Rectangle &other, unsigned char color) : Shape(other, color)
+Circle::Circle(const Circle &other, unsigned char color) : Shape(other, color), _radius(other._radius)
 {}
 
 /**
- * Default ctor for rectangle (can't be drawn)
+ * Returns the kind of this shape (CIRCLE).
+ *
+ * @return The kind of this shape.
  */
-Rectangle::Rectangle() : Shape()
+ShapeType Circle::getType() const
+{
+    return ShapeType::CIRCLE;
+}
+
+/**
+ * Returns this circle's radius.
+ *
+ * @return This circle's radius.
+ */
+int Circle::getRadius() const
+{
+    return _radius;
+}
+
+/**
+ * Default ctor for Polygon (can't be drawn)
+ */
+Polygon::Polygon() : Shape()
 {}
 
 /**
- * Default ctor for circle (can't be drawn)
+ * Creates a new convex polygon according to given vertices.
+ * Vertices order should be in clockwise order.
+ *
+ * @param vertices The vertices in clockwise order (at least 3).
+ * @param color The color of the polygon.
  */
-Circle::Circle() : Shape(), _radius(-1)
+Polygon::Polygon(const std::vector<Vector2> &vertices, unsigned char color) : Shape(vertices, color)
 {}
 
 /**
- * Creates a new circle according the given center point, radius and color.
+ * Makes this Polygon a copy of the given Polygon with a new given color.
  *
- * @param center 2d vector that has location of center point.
- * @param radius The circle's radius.
- * @param color The color of the circle.
+ * @param other The Polygon to copy.
+ * @param color The color of this shape.
  */
-Circle::Circle(const Vector2 &center, int radius, unsigned char color) : Shape(new Vector2[1]{center}, 1, color),
-                                                                         _radius(radius)
+Polygon::Polygon(const Polygon &other, unsigned char color) : Shape(other, color)
 {}
 
-// Draws 8 sections of the circle and the lines in-between.
-static void drawCirclePart(Image &img, const Vector2 &center, const Vector2 &currentPart, unsigned char color)
+/**
+ * Returns the kind of this shape (POLYGON).
+ *
+ * @return The kind of this shape.
+ */
+ShapeType Polygon::getType() const
 {
-    // find locations of current 8 eighths of circle.
-    int xLeft = center.x - currentPart.x;
-    int xRight = center.x + currentPart.x;
-    int xDown = center.x - currentPart.y;
-    int xUp = center.x + currentPart.y;
-    int yDown = center.y - currentPart.y;
-    int yUp = center.y + currentPart.y;
-    int yLeft = center.y - currentPart.x;
-    int yRight = center.y + currentPart.x;
+    return ShapeType::POLYGON;
+}
 
-    // Draw the eighths and lines in-between.
-    img.drawHorizontalLine(Vector2(xLeft, yUp), xRight, color);
-    img.drawHorizontalLine(Vector2(xLeft, yDown), xRight, color);
-    img.drawHorizontalLine(Vector2(xDown, yRight), xUp, color);
-    img.drawHorizontalLine(Vector2(xDown, yLeft), xUp, color);
+// Sets polygon to the convex polygon (as draw draws it) whose top-left pixel is the given location.
+// Returns true if there is such a polygon. Otherwise, returns false.
+template<class ImageT>
+static bool findPolygonAt(const ImageT &img, const Vector2 &topLeft, Polygon &polygon)
+{
+    auto color = img.getPixel(topLeft);
+    std::vector<Span> outline;
+    std::vector<Vector2> hull;
+    traceOutline(img, topLeft, color, outline);
+    getOutlineHull(outline, hull);
+    if (!isPolygonBlob(img, outline, hull, color))
+    {
+        return false;
+    }
+    polygon = Polygon(hull, toShapeColor(color));
+    return true;
 }
 
 /**
- * Draw's this circle to the given image.
+ * Recognizes the convex Polygon (as draw draws it) whose top-left pixel is the given location
+ * and then sets polygon to this Polygon, with the fewest vertices that draw the same pixels.
+ * Returns true if there is such a Polygon. Otherwise, returns false (and polygon isn't set).
  *
- * @param img The image to draw to.
+ * @param img The image to scan in.
+ * @param topLeft The top-left pixel of the Polygon (the first one in raster order).
+ * @param polygon This will be set to the new Polygon object (if found).
+ * @return true if a Polygon was found. Otherwise, returns false.
  */
-void Circle::draw(Image &img) const
+bool Polygon::recognizePolygon(const Image &img, const Vector2 &topLeft, Polygon **polygon)
 {
-    if (_radius == -1)
+    Polygon found;
+    if (!findPolygonAt(img, topLeft, found))
     {
-        return;
+        return false;
     }
+    *polygon = new Polygon(found);
+    return true;
+}
 
-    // This function is based on Bresenham's circle drawing algorithm.
-    const Vector2 &center = getVertices()[0];
-    unsigned char color = getColor();
+/**
+ * Recognizes the convex Polygon (as draw draws it) whose top-left pixel is the given location
+ * and then sets polygon to this Polygon, with the fewest vertices that draw the same pixels.
+ * Returns true if there is such a Polygon. Otherwise, returns false (and polygon isn't set).
+ *
+ * @param img The run-length-encoded image to scan in.
+ * @param topLeft The top-left pixel of the Polygon (the first one in raster order).
+ * @param polygon This will be set to the new Polygon object (if found).
+ * @return true if a Polygon was found. Otherwise, returns false.
+ */
+bool Polygon::recognizePolygon(const RleImage &img, const Vector2 &topLeft, Polygon **polygon)
+{
+    Polygon found;
+    if (!findPolygonAt(img, topLeft, found))
+    {
+        return false;
+    }
+    *polygon = new Polygon(found);
+    return true;
+}
 
-    Vector2 currentPart(0, _radius);
-    int decision = 3 - (2 * _radius);
-    drawCirclePart(img, center, currentPart, color);
+/**
+ * Returns a new shape that covers exactly the given spans (the pixels draw sets for it): a rectangle that is
+ * parallel to the x and y axis, a filled circle or a convex polygon (in this order of preference). (dynamic alloc)
+ * Returns nullptr if no such shape covers exactly the given spans.
+ *
+ * @param spans One span per row, top to bottom, of consecutive rows.
+ * @param color The color of the shape.
+ * @return A new shape that covers exactly the given spans, or nullptr.
+ */
+Shape *Shape::createFromSpans(const std::vector<Span> &spans, unsigned char color)
+{
+    if (spans.empty())
+    {
+        return nullptr;
+    }
+    if (isRectangleOutline(spans))
+    {
+        return new Rectangle(Vector2(spans.front().xStart, spans.front().y),
+                             Vector2(spans.front().xEnd, spans.back().y), color);
+    }
 
-    while (currentPart.y >= currentPart.x)
+    // A circle has an odd number of rows, and its top row is centered on its center.
+    const Span &top = spans.front();
+    if (spans.size() % 2 == 1 && (top.xEnd - top.xStart) % 2 == 0)
     {
-        currentPart.x++;
-        if (decision > 0)
+        int radius = (int) spans.size() / 2;
+        Circle circle(Vector2((top.xStart + top.xEnd) / 2, top.y + radius), radius, color);
+        if (isShapeOfSpans(circle, spans))
         {
-            currentPart.y--;
-            decision += 4 * (currentPart.x - currentPart.y) + 10;
+            return new Circle(circle);
         }
-        else
+    }
+
+    std::vector<Vector2> hull;
+    getOutlineHull(spans, hull);
+    if (hull.size() >= 3)
+    {
+        Polygon polygon(hull, color);
+        if (isShapeOfSpans(polygon, spans))
         {
-            decision += (4 * currentPart.x) + 6;
+            return new Polygon(polygon);
         }
-        drawCirclePart(img, center, currentPart, color);
     }
+    return nullptr;
 }
 
 /**
- * Makes this Circle a copy of the given Circle with a new given color.
+ * Prepares the given shape.
  *
- * @param other The Circle to copy.
- * @param color The color of this shape.
+ * @param shape The shape to prepare.
  */
-Circle::Circle(const Circle &other, unsigned char color) : Shape(other, color), _radius(other._radius)
-{}
+PreparedShape::PreparedShape(const Shape &shape) : _color(shape.getColor())
+{
+    shape.getSpans(_spans);
+    _spans.shrink_to_fit();
+    if (!_spans.empty())
+    {
+        _topLeft = Vector2(_spans.front().xStart, _spans.front().y);
+        _bottomRight = Vector2(_spans.front().xEnd, _spans.back().y);
+        for (const Span &span : _spans)
+        {
+            _topLeft.x = std::min(_topLeft.x, span.xStart);
+            _bottomRight.x = std::max(_bottomRight.x, span.xEnd);
+        }
+    }
+}
+
+/**
+ * Returns the shape's color.
+ *
+ * @return The shape's color.
+ */
+unsigned char PreparedShape::getColor() const
+{
+    return _color;
+}
+
+/**
+ * Returns the top-left corner of the shape's bounding box (only meaningful if it has spans).
+ *
+ * @return The top-left corner of the shape's bounding box.
+ */
+const Vector2 &PreparedShape::getTopLeft() const
+{
+    return _topLeft;
+}
+
+/**
+ * Returns the bottom-right corner of the shape's bounding box (only meaningful if it has spans).
+ *
+ * @return The bottom-right corner of the shape's bounding box.
+ */
+const Vector2 &PreparedShape::getBottomRight() const
+{
+    return _bottomRight;
+}
+
+/**
+ * Returns the spans of pixels covered by the shape (at most one per row, top to bottom).
+ *
+ * @return The spans of pixels covered by the shape.
+ */
+const std::vector<Span> &PreparedShape::getSpans() const
+{
+    return _spans;
+}
+
+/**
+ * Returns true if the given pixel is covered by the shape. Otherwise, returns false.
+ *
+ * @param point The pixel to check.
+ * @return true if the given pixel is covered by the shape. Otherwise, returns false.
+ */
+bool PreparedShape::containsPoint(const Vector2 &point) const
+{
+    auto span = std::lower_bound(_spans.begin(), _spans.end(), point.y, [](const Span &current, int y)
+    {
+        return current.y < y;
+    });
+    return span != _spans.end() && span->y == point.y && span->xStart <= point.x && point.x <= span->xEnd;
+}
+
+// throws ImageDimException if the given bounding box isn't inside a region of the given size.
+static void checkBoundingBox(const Vector2 &topLeft, const Vector2 &bottomRight, int height, int width)
+{
+    if (topLeft.x < 0 || topLeft.y < 0 || bottomRight.x >= width || bottomRight.y >= height)
+    {
+        throw ImageDimException();
+    }
+}
+
+/**
+ * Draw's the shape to the given image.
+ * Throws exception if the shape is out of image bounds (nothing is drawn then).
+ *
+ * @param img The image to draw to.
+ */
+void PreparedShape::draw(Image &img) const
+{
+    if (!_spans.empty())
+    {
+        checkBoundingBox(_topLeft, _bottomRight, img.getHeight(), img.getWidth());
+        drawSpans(img, _spans, _color);
+    }
+}
+
+/**
+ * Draw's the shape to the given run-length-encoded image.
+ * Throws exception if the shape is out of image bounds (nothing is drawn then).
+ *
+ * @param img The image to draw to.
+ */
+void PreparedShape::draw(RleImage &img) const
+{
+    if (!_spans.empty())
+    {
+        checkBoundingBox(_topLeft, _bottomRight, img.getHeight(), img.getWidth());
+        for (const Span &span : _spans)
+        {
+            img.drawHorizontalLine(Vector2(span.xStart, span.y), span.xEnd, _color);
+        }
+    }
+}
+
+/**
+ * Draw's the shape to the given view, in view coordinates.
+ * Throws exception if the shape is out of view bounds (nothing is drawn then).
+ *
+ * @param view The view to draw to.
+ */
+void PreparedShape::draw(ImageView &view) const
+{
+    if (!_spans.empty())
+    {
+        checkBoundingBox(_topLeft, _bottomRight, view.getHeight(), view.getWidth());
+        drawSpans(view.getImage(), _spans, _color, view.getOffset());
+    }
+}
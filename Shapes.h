@@ -6,17 +6,80 @@
 #define POLYTEST_SHAPES_H
 
 
+#include <functional>
+#include <initializer_list>
 #include <utility>
+#include <vector>
 #include "Image.h"
+#include "ImageView.h"
+#include "ImagePyramid.h"
+#include "IntegralImage.h"
+#include "PixelImage.h"
+#include "RleImage.h"
+
+/**
+ * Horizontal span of pixels covered by a shape in a single row.
+ */
+struct Span
+{
+    int y, xStart, xEnd;
+
+    /**
+     * Creates a new span with the given parameters.
+     *
+     * @param row The y coordinate of the span.
+     * @param start The first x coordinate of the span.
+     * @param finish The last x coordinate of the span.
+     */
+    Span(int row, int start, int finish) : y(row), xStart(start), xEnd(finish)
+    {}
+};
+
+/**
+ * Statistics of drawing an array of shapes.
+ */
+struct DrawStats
+{
+    int drawnShapes; // Number of shapes that were drawn.
+    int culledShapes; // Number of shapes that were skipped because the shapes after them cover them completely.
+};
+
+/**
+ * Kind of a shape (values are stable, they are used in serialized shape lists).
+ */
+enum class ShapeType : unsigned char
+{
+    POLYGON = 0,
+    TRIANGLE = 1,
+    RECTANGLE = 2,
+    CIRCLE = 3
+};
+
+class Shape;
+
+class PreparedShape;
+
+/**
+ * Callback of the visiting recognizers (see Shape::visitRectanglesInImage): gets each recognized shape, which is
+ * only valid during the call, and returns true to continue the scan or false to stop it.
+ */
+typedef std::function<bool(const Shape &shape)> ShapeVisitor;
 
 /**
  * Represents 2d shape.
  */
 class Shape
 {
+    // Shapes with up to this many vertices keep them inside the object instead of on the heap.
+    static const int LOCAL_VERTICES_SIZE = 4;
+
     Vector2 *_vertices;
     int _verticesSize;
     unsigned char _color;
+    Vector2 _localVertices[LOCAL_VERTICES_SIZE];
+
+    // Copies the given vertices to this shape (to the local storage if they fit).
+    void _setVertices(const Vector2 *vertices, int verticesSize);
 
     // Returns true if given point is in this shape. Otherwise, returns false.
     bool _isPointInShape(const Vector2 &point) const;
@@ -36,6 +99,37 @@ protected:
      */
     Shape(Vector2 *vertices, int verticesSize, unsigned char color);
 
+    /**
+     * Creates a new Shape of the given color that has a copy of the given vertices.
+     *
+     * @param vertices The vertices of the shape.
+     * @param color The color of the shape (1 byte grayscale).
+     */
+    Shape(std::initializer_list<Vector2> vertices, unsigned char color);
+
+    /**
+     * Creates a new Shape of the given color that has a copy of the given vertices.
+     *
+     * @param vertices The vertices of the shape.
+     * @param color The color of the shape (1 byte grayscale).
+     */
+    Shape(const std::vector<Vector2> &vertices, unsigned char color);
+
+    /**
+     * Copy ctor for shape.
+     *
+     * @param other The shape to copy.
+     */
+    Shape(const Shape &other);
+
+    /**
+     * Assign this shape to be a copy of the given one.
+     *
+     * @param other The shape to copy.
+     * @return This shape after the copy procedure.
+     */
+    Shape &operator=(const Shape &other);
+
     /**
      * Makes this shape a copy of the given shape with a new given color.
      *
@@ -44,6 +138,7 @@ protected:
      */
     Shape(const Shape &other, unsigned char color);
 
+public:
     /**
      * Returns this shape's array of vertices.
      *
@@ -51,6 +146,13 @@ protected:
      */
     const Vector2 *getVertices() const;
 
+    /**
+     * Returns the size of this shape's array of vertices.
+     *
+     * @return The size of this shape's array of vertices.
+     */
+    int getVerticesSize() const;
+
     /**
      * Return's this shape's color.
      *
@@ -58,7 +160,13 @@ protected:
      */
     unsigned char getColor() const;
 
-public:
+    /**
+     * Returns the kind of this shape.
+     *
+     * @return The kind of this shape.
+     */
+    virtual ShapeType getType() const;
+
     /**
      * Destructs this shape.
      */
@@ -71,9 +179,79 @@ public:
      */
     virtual void draw(Image &img) const;
 
+    /**
+     * Draw's this shape to the given run-length-encoded image, one row span at a time.
+     *
+     * @param img The image to draw to.
+     */
+    void draw(RleImage &img) const;
+
+    /**
+     * Draw's this shape to the given view, in view coordinates.
+     * Throws exception if the shape is out of view bounds (nothing is drawn then).
+     *
+     * @param view The view to draw to.
+     */
+    void draw(ImageView &view) const;
+
+    /**
+     * Draw's this shape to the given image in the given color (instead of its own).
+     * Supports the pixel types of PixelKernels.
+     *
+     * @param img The image to draw to.
+     * @param color The color to draw in.
+     */
+    template<class Pixel>
+    void draw(PixelImage<Pixel> &img, const Pixel &color) const;
+
+    /**
+     * Draw's this shape to the given image, blending it with the pixels it is drawn over in the given mode.
+     *
+     * @param img The image to draw to.
+     * @param mode How the shape's color is combined with the pixels (OVERWRITE is the same as draw(img)).
+     * @param alpha The opacity of the shape in ALPHA mode (0 keeps the pixels, 255 replaces them). Ignored otherwise.
+     */
+    void draw(Image &img, BlendMode mode, unsigned char alpha = 255) const;
+
+    /**
+     * Draw's this shape to the given view, in view coordinates, blending it with the pixels it is drawn over in the
+     * given mode. Throws exception if the shape is out of view bounds (nothing is drawn then).
+     *
+     * @param view The view to draw to.
+     * @param mode How the shape's color is combined with the pixels (OVERWRITE is the same as draw(view)).
+     * @param alpha The opacity of the shape in ALPHA mode (0 keeps the pixels, 255 replaces them). Ignored otherwise.
+     */
+    void draw(ImageView &view, BlendMode mode, unsigned char alpha = 255) const;
+
+    /**
+     * Appends the spans of pixels covered by this shape (at most one per row, top to bottom) to the given vector.
+     * These are exactly the pixels that draw sets.
+     *
+     * @param spans The vector to append the spans to.
+     */
+    virtual void getSpans(std::vector<Span> &spans) const;
+
+    /**
+     * Returns true if all pixels covered by this shape are in an image of the given size (without working out its
+     * spans, so it is cheap for any coordinates). Otherwise, returns false.
+     *
+     * @param height The image height in pixels.
+     * @param width The image width in pixels.
+     * @return true if all pixels covered by this shape are in an image of the given size. Otherwise, returns false.
+     */
+    virtual bool isInBounds(int height, int width) const;
+
+    /**
+     * Returns the prepared form of this shape, that draws it again and again without redoing its setup.
+     *
+     * @return The prepared form of this shape.
+     */
+    PreparedShape prepare() const;
+
     /**
      * Returns an array of pointers to Shapes that contains all rectangles that are parallel to the x and y axis.
      * Shapes can only be in non-zero color.
+     * Filled circles and convex polygons (as draw draws them) are recognized too, among the rectangles.
      * The output array (and all pointers in it) needs to be freed (either manually or with freeShapesArray).
      *
      * @param img The image to scan in.
@@ -82,11 +260,33 @@ public:
      */
     static Shape **getRectanglesFromImage(const Image &img, int &arrSize);
 
+    /**
+     * Returns an array of pointers to Shapes that contains all rectangles that are parallel to the x and y axis.
+     * Works directly on the runs of the image, so empty stretches cost nothing.
+     * The output array (and all pointers in it) needs to be freed (either manually or with freeShapesArray).
+     *
+     * @param img The run-length-encoded image to scan in.
+     * @param arrSize This will be set to the size of the output array.
+     * @return an array of pointers to Shapes that contains all rectangles that are parallel to the x and y axis.
+     */
+    static Shape **getRectanglesFromImage(const RleImage &img, int &arrSize);
+
+    /**
+     * Same as getRectanglesFromImage, but scans only the given view (shapes are in view coordinates).
+     * The output array (and all pointers in it) needs to be freed (either manually or with freeShapesArray).
+     *
+     * @param view The view to scan in.
+     * @param arrSize This will be set to the size of the output array.
+     * @return an array of pointers to Shapes that contains all rectangles that are parallel to the x and y axis.
+     */
+    static Shape **getRectanglesFromImage(const ImageView &view, int &arrSize);
+
     /**
      * Returns an array of pointers to Shapes that contains all rectangles (that are parallel to the x and y axis)
      * and all triangles that are in the rectangles (that are parallel to the x axis).
      * Each rectangle can have either 0 or 1 triangles in them.
      * Shapes can only be in non-zero color.
+     * Filled circles and convex polygons (as draw draws them) are recognized too, among the rectangles.
      * The output array (and all pointers in it) needs to be freed (either manually or with freeShapesArray).
      *
      * @param img The image to scan in.
@@ -95,6 +295,178 @@ public:
      */
     static Shape **getRectanglesAndTrianglesFromImage(const Image &img, int &arrSize);
 
+    /**
+     * Returns an array of pointers to Shapes that contains all rectangles (that are parallel to the x and y axis)
+     * and all triangles that are in the rectangles (that are parallel to the x axis).
+     * Works directly on the runs of the image, so empty stretches cost nothing.
+     * The output array (and all pointers in it) needs to be freed (either manually or with freeShapesArray).
+     *
+     * @param img The run-length-encoded image to scan in.
+     * @param arrSize This will be set to the size of the output array.
+     * @return an array of pointers to Shapes that contains all rectangles and triangles.
+     */
+    static Shape **getRectanglesAndTrianglesFromImage(const RleImage &img, int &arrSize);
+
+    /**
+     * Same as getRectanglesAndTrianglesFromImage, but checks each rectangle for a triangle with O(1) queries of the
+     * given integral image of img, instead of going over the rectangle's pixels (worth it when the integral image is
+     * at hand).
+     * A rectangle that shapes found before it reach into is checked on its pixels, so the shapes are the same as
+     * without the integral image, also when they overlap.
+     * Throws exception if the integral image isn't of img's size.
+     * The output array (and all pointers in it) needs to be freed (either manually or with freeShapesArray).
+     *
+     * @param img The image to scan in.
+     * @param integral An integral image of img (img must not have changed since it was built).
+     * @param arrSize This will be set to the size of the output array.
+     * @return an array of pointers to Shapes that contains all rectangles and triangles.
+     */
+    static Shape **getRectanglesAndTrianglesFromImage(const Image &img, const IntegralImage &integral, int &arrSize);
+
+    /**
+     * Same as getRectanglesFromImage, but only scans the regions of the given pyramid of img that have shapes in them,
+     * skipping the empty rest of the image (worth it for large images with few shapes). The result is the same.
+     * Throws exception if the pyramid isn't of img's size.
+     * The output array (and all pointers in it) needs to be freed (either manually or with freeShapesArray).
+     *
+     * @param img The image to scan in.
+     * @param pyramid A pyramid of img (img must not have changed since it was built).
+     * @param arrSize This will be set to the size of the output array.
+     * @return an array of pointers to Shapes that contains all rectangles that are parallel to the x and y axis.
+     */
+    static Shape **getRectanglesFromImage(const Image &img, const ImagePyramid &pyramid, int &arrSize);
+
+    /**
+     * Same as getRectanglesAndTrianglesFromImage, but only scans the regions of the given pyramid of img that have
+     * shapes in them, skipping the empty rest of the image (worth it for large images with few shapes).
+     * The result is the same.
+     * Throws exception if the pyramid isn't of img's size.
+     * The output array (and all pointers in it) needs to be freed (either manually or with freeShapesArray).
+     *
+     * @param img The image to scan in.
+     * @param pyramid A pyramid of img (img must not have changed since it was built).
+     * @param arrSize This will be set to the size of the output array.
+     * @return an array of pointers to Shapes that contains all rectangles and triangles.
+     */
+    static Shape **getRectanglesAndTrianglesFromImage(const Image &img, const ImagePyramid &pyramid, int &arrSize);
+
+    /**
+     * Same as getRectanglesFromImage, but scans only the given region of img (shapes are in img coordinates).
+     * Shapes that cross the region's border are cut by it, so the result is only the same as scanning the whole image
+     * for shapes that are entirely inside the region and don't touch the pixels around it.
+     * Throws exception if the region is not inside img.
+     * The output array (and all pointers in it) needs to be freed (either manually or with freeShapesArray).
+     *
+     * @param img The image to scan in.
+     * @param region The region of img to scan.
+     * @param arrSize This will be set to the size of the output array.
+     * @return an array of pointers to Shapes that contains all rectangles that are parallel to the x and y axis.
+     */
+    static Shape **getRectanglesFromImage(const Image &img, const ImageRegion &region, int &arrSize);
+
+    /**
+     * Same as getRectanglesAndTrianglesFromImage, but scans only the given region of img (shapes are in img
+     * coordinates). Shapes that cross the region's border are cut by it, so the result is only the same as scanning
+     * the whole image for shapes that are entirely inside the region and don't touch the pixels around it.
+     * Throws exception if the region is not inside img.
+     * The output array (and all pointers in it) needs to be freed (either manually or with freeShapesArray).
+     *
+     * @param img The image to scan in.
+     * @param region The region of img to scan.
+     * @param arrSize This will be set to the size of the output array.
+     * @return an array of pointers to Shapes that contains all rectangles and triangles.
+     */
+    static Shape **getRectanglesAndTrianglesFromImage(const Image &img, const ImageRegion &region, int &arrSize);
+
+    /**
+     * Same as getRectanglesAndTrianglesFromImage, but scans only the given view (shapes are in view coordinates).
+     * The output array (and all pointers in it) needs to be freed (either manually or with freeShapesArray).
+     *
+     * @param view The view to scan in.
+     * @param arrSize This will be set to the size of the output array.
+     * @return an array of pointers to Shapes that contains all rectangles and triangles.
+     */
+    static Shape **getRectanglesAndTrianglesFromImage(const ImageView &view, int &arrSize);
+
+    /**
+     * Same as getRectanglesFromImage, for images of any of the pixel types of PixelKernels.
+     * The shapes' colors are the 8-bit gray levels of their pixels, and their actual pixel values are set in colors.
+     * The output array (and all pointers in it) needs to be freed (either manually or with freeShapesArray).
+     *
+     * @param img The image to scan in.
+     * @param arrSize This will be set to the size of the output array.
+     * @param colors This will be set to the pixel value of each shape in the output array.
+     * @return an array of pointers to Shapes that contains all rectangles that are parallel to the x and y axis.
+     */
+    template<class Pixel>
+    static Shape **getRectanglesFromImage(const PixelImage<Pixel> &img, int &arrSize, std::vector<Pixel> &colors);
+
+    /**
+     * Same as getRectanglesAndTrianglesFromImage, for images of any of the pixel types of PixelKernels.
+     * The shapes' colors are the 8-bit gray levels of their pixels, and their actual pixel values are set in colors.
+     * The output array (and all pointers in it) needs to be freed (either manually or with freeShapesArray).
+     *
+     * @param img The image to scan in.
+     * @param arrSize This will be set to the size of the output array.
+     * @param colors This will be set to the pixel value of each shape in the output array.
+     * @return an array of pointers to Shapes that contains all rectangles and triangles.
+     */
+    template<class Pixel>
+    static Shape **getRectanglesAndTrianglesFromImage(const PixelImage<Pixel> &img, int &arrSize,
+                                                      std::vector<Pixel> &colors);
+
+    /**
+     * Hands each rectangle (that is parallel to the x and y axis) in the given image to the given visitor as soon as
+     * it's found, in raster order of the top-left corners, until the visitor returns false.
+     * Nothing is allocated per shape, so counting or filtering shapes is cheaper than getRectanglesFromImage.
+     *
+     * @param img The image to scan in.
+     * @param visitor Gets each shape (valid during the call only) and returns true to continue or false to stop.
+     * @return The number of shapes that were handed to the visitor.
+     */
+    static int visitRectanglesInImage(const Image &img, const ShapeVisitor &visitor);
+
+    /**
+     * Same as visitRectanglesInImage, but also hands over the triangle in each rectangle (if it has one) right after
+     * the rectangle (see getRectanglesAndTrianglesFromImage).
+     *
+     * @param img The image to scan in.
+     * @param visitor Gets each shape (valid during the call only) and returns true to continue or false to stop.
+     * @return The number of shapes that were handed to the visitor.
+     */
+    static int visitRectanglesAndTrianglesInImage(const Image &img, const ShapeVisitor &visitor);
+
+    /**
+     * Same as visitRectanglesAndTrianglesInImage, but checks each rectangle for a triangle with O(1) queries of the
+     * given integral image of img (see getRectanglesAndTrianglesFromImage).
+     * Throws exception if the integral image isn't of img's size.
+     *
+     * @param img The image to scan in.
+     * @param integral An integral image of img (img must not have changed since it was built).
+     * @param visitor Gets each shape (valid during the call only) and returns true to continue or false to stop.
+     * @return The number of shapes that were handed to the visitor.
+     */
+    static int visitRectanglesAndTrianglesInImage(const Image &img, const IntegralImage &integral,
+                                                  const ShapeVisitor &visitor);
+
+    /**
+     * Same as visitRectanglesInImage, for run-length-encoded images.
+     *
+     * @param img The run-length-encoded image to scan in.
+     * @param visitor Gets each shape (valid during the call only) and returns true to continue or false to stop.
+     * @return The number of shapes that were handed to the visitor.
+     */
+    static int visitRectanglesInImage(const RleImage &img, const ShapeVisitor &visitor);
+
+    /**
+     * Same as visitRectanglesAndTrianglesInImage, for run-length-encoded images.
+     *
+     * @param img The run-length-encoded image to scan in.
+     * @param visitor Gets each shape (valid during the call only) and returns true to continue or false to stop.
+     * @return The number of shapes that were handed to the visitor.
+     */
+    static int visitRectanglesAndTrianglesInImage(const RleImage &img, const ShapeVisitor &visitor);
+
     /**
      * Draws the given shapes to the given image.
      *
@@ -104,6 +476,97 @@ public:
      */
     static void drawShapesToImage(Image &img, const Shape **shapes, int size);
 
+    /**
+     * Draws the given shapes to the given image in order, blending each one with the pixels it is drawn over in the
+     * given mode. Blended shapes don't hide what they are drawn over, so nothing is culled.
+     *
+     * @param img The image to draw to.
+     * @param shapes An array of shape pointers.
+     * @param size The size of the shapes array.
+     * @param mode How the shapes' colors are combined with the pixels (OVERWRITE is the same as not blending).
+     * @param alpha The opacity of the shapes in ALPHA mode (0 keeps the pixels, 255 replaces them). Ignored
+     *              otherwise.
+     */
+    static void drawShapesToImage(Image &img, const Shape **shapes, int size, BlendMode mode,
+                                  unsigned char alpha = 255);
+
+    /**
+     * Draws the given shapes to the given image, optionally skipping (culling) shapes that the shapes after them
+     * cover completely. The result is the same either way.
+     * Throws exception if a shape (culled or not) is out of image bounds (nothing is drawn then).
+     *
+     * @param img The image to draw to.
+     * @param shapes An array of shape pointers.
+     * @param size The size of the shapes array.
+     * @param cullHidden true to skip shapes that are completely covered by later shapes.
+     * @return The number of shapes that were drawn and culled.
+     */
+    static DrawStats drawShapesToImage(Image &img, const Shape **shapes, int size, bool cullHidden);
+
+    /**
+     * Draws the given shapes to the given view, in view coordinates.
+     *
+     * @param view The view to draw to.
+     * @param shapes An array of shape pointers.
+     * @param size The size of the shapes array.
+     */
+    static void drawShapesToImage(ImageView &view, const Shape **shapes, int size);
+
+    /**
+     * Same as drawShapesToImage, but resolves the overlaps first so every covered pixel is written only once
+     * (see SpanCompositor). Throws exception if a shape is out of image bounds (nothing is drawn then).
+     *
+     * @param img The image to draw to.
+     * @param shapes An array of shape pointers.
+     * @param size The size of the shapes array.
+     */
+    static void compositeShapesToImage(Image &img, const Shape **shapes, int size);
+
+    /**
+     * Redraws the given shapes onto a blank (background) image of the same size and layout as the given image
+     * and compares the result with it.
+     *
+     * @param img The image the shapes were recognized from.
+     * @param shapes An array of shape pointers.
+     * @param size The size of the shapes array.
+     * @return The differences between the given image and the redrawn shapes.
+     */
+    static ImageDiff verifyShapes(const Image &img, const Shape **shapes, int size);
+
+    /**
+     * Same as getRectanglesFromImage, but also redraws the found shapes and compares them with the scanned image.
+     * The output array (and all pointers in it) needs to be freed (either manually or with freeShapesArray).
+     *
+     * @param img The image to scan in.
+     * @param arrSize This will be set to the size of the output array.
+     * @param diff This will be set to the differences between the scanned image and the redrawn shapes.
+     * @return an array of pointers to Shapes that contains all rectangles that are parallel to the x and y axis.
+     */
+    static Shape **getVerifiedRectanglesFromImage(const Image &img, int &arrSize, ImageDiff &diff);
+
+    /**
+     * Same as getRectanglesAndTrianglesFromImage, but also redraws the found shapes and compares them with the
+     * scanned image.
+     * The output array (and all pointers in it) needs to be freed (either manually or with freeShapesArray).
+     *
+     * @param img The image to scan in.
+     * @param arrSize This will be set to the size of the output array.
+     * @param diff This will be set to the differences between the scanned image and the redrawn shapes.
+     * @return an array of pointers to Shapes that contains all rectangles and triangles.
+     */
+    static Shape **getVerifiedRectanglesAndTrianglesFromImage(const Image &img, int &arrSize, ImageDiff &diff);
+
+    /**
+     * Returns a new shape that covers exactly the given spans (the pixels draw sets for it): a rectangle that is
+     * parallel to the x and y axis, a filled circle or a convex polygon (in this order of preference). (dynamic alloc)
+     * Returns nullptr if no such shape covers exactly the given spans.
+     *
+     * @param spans One span per row, top to bottom, of consecutive rows.
+     * @param color The color of the shape.
+     * @return A new shape that covers exactly the given spans, or nullptr.
+     */
+    static Shape *createFromSpans(const std::vector<Span> &spans, unsigned char color);
+
     /**
      * Frees the memory taken by a dynamically allocated array of dynamically allocated shape pointers.
      * Used to free array output of getRectanglesFromImage and getRectanglesAndTrianglesFromImage.
@@ -144,6 +607,13 @@ public:
      */
     Triangle(const Triangle &other, unsigned char color);
 
+    /**
+     * Returns the kind of this shape (TRIANGLE).
+     *
+     * @return The kind of this shape.
+     */
+    ShapeType getType() const override;
+
     /**
      * Recognizes the Triangle (that is parallel to the x axis) whose top-left corner is the given location
      * and then sets *innerTriangle to this triangle. (dynamic alloc)
@@ -153,6 +623,16 @@ public:
      * @param innerTriangle This de-referenced will be set to the new Triangle object. (dynamic alloc)
      */
     static void recognizeTriangle(const Image &img, const Vector2 &topLeft, Triangle **innerTriangle);
+
+    /**
+     * Recognizes the Triangle (that is parallel to the x axis) whose top-left corner is the given location
+     * and then sets *innerTriangle to this triangle. (dynamic alloc)
+     *
+     * @param img The run-length-encoded image to scan in.
+     * @param topLeft The top-left pixel of the triangle.
+     * @param innerTriangle This de-referenced will be set to the new Triangle object. (dynamic alloc)
+     */
+    static void recognizeTriangle(const RleImage &img, const Vector2 &topLeft, Triangle **innerTriangle);
 };
 
 /**
@@ -196,6 +676,13 @@ public:
      */
     Rectangle(const Rectangle &other, unsigned char color);
 
+    /**
+     * Returns the kind of this shape (RECTANGLE).
+     *
+     * @return The kind of this shape.
+     */
+    ShapeType getType() const override;
+
     /**
      * Recognizes the Rectangle (that is parallel to the x and y axis) whose top-left corner is the given location
      * and then sets rectangle to this Rectangle.
@@ -206,6 +693,16 @@ public:
      */
     static void recognizeRectangle(const Image &img, const Vector2 &topLeft, Rectangle **rectangle);
 
+    /**
+     * Recognizes the Rectangle (that is parallel to the x and y axis) whose top-left corner is the given location
+     * and then sets rectangle to this Rectangle.
+     *
+     * @param img The run-length-encoded image to scan in.
+     * @param topLeft The top-left pixel of the Rectangle.
+     * @param rectangle This de-referenced will be set to the new Rectangle object. (dynamic alloc)
+     */
+    static void recognizeRectangle(const RleImage &img, const Vector2 &topLeft, Rectangle **rectangle);
+
     /**
      * Recognizes the Rectangle (that is parallel to the x and y axis) whose top-left corner is the given location
      * and then sets *rectangle to this Rectangle. (dynamic alloc)
@@ -222,6 +719,38 @@ public:
     static bool recognizeRectangleWithTriangle(const Image &img, const Vector2 &topLeft, Rectangle **rectangle,
                                                Triangle **innerTriangle);
 
+    /**
+     * Recognizes the Rectangle (that is parallel to the x and y axis) whose top-left corner is the given location
+     * and then sets *rectangle to this Rectangle. (dynamic alloc)
+     * Also Recognizes the Triangle (that is parallel to the x axis) if one is in the Rectangle
+     * and then sets *innerTriangle to this triangle. (dynamic alloc)
+     * Returns true if Triangle was found. Otherwise, returns false.
+     *
+     * @param img The run-length-encoded image to scan in.
+     * @param topLeft The top-left pixel of the Rectangle.
+     * @param rectangle This de-referenced will be set to the new Rectangle object. (dynamic alloc)
+     * @param innerTriangle This de-referenced will be set to the new Triangle object, if in Rectangle. (dynamic alloc)
+     * @return true if Triangle was found. Otherwise, returns false.
+     */
+    static bool recognizeRectangleWithTriangle(const RleImage &img, const Vector2 &topLeft, Rectangle **rectangle,
+                                               Triangle **innerTriangle);
+
+    /**
+     * Same as recognizeRectangleWithTriangle, but checks the Rectangle for a Triangle with O(1) queries of the given
+     * integral image of img, instead of going over the Rectangle's pixels.
+     * Throws exception if the integral image isn't of img's size.
+     *
+     * @param img The image to scan in.
+     * @param integral An integral image of img (the Rectangle must not have changed since it was built).
+     * @param topLeft The top-left pixel of the Rectangle.
+     * @param rectangle This de-referenced will be set to the new Rectangle object. (dynamic alloc)
+     * @param innerTriangle This de-referenced will be set to the new Triangle object, if in Rectangle. (dynamic alloc)
+     * @return true if Triangle was found. Otherwise, returns false.
+     */
+    static bool recognizeRectangleWithTriangle(const Image &img, const IntegralImage &integral,
+                                               const Vector2 &topLeft, Rectangle **rectangle,
+                                               Triangle **innerTriangle);
+
 };
 
 /**
@@ -255,11 +784,199 @@ public:
     Circle(const Circle &other, unsigned char color);
 
     /**
-     * Draw's this circle to the given image.
+     * Returns the kind of this shape (CIRCLE).
+     *
+     * @return The kind of this shape.
+     */
+    ShapeType getType() const override;
+
+    /**
+     * Returns this circle's radius.
+     *
+     * @return This circle's radius.
+     */
+    int getRadius() const;
+
+    /**
+     * Appends the spans of pixels covered by this circle (one per row, top to bottom) to the given vector.
+     * These are exactly the pixels that draw sets.
+     *
+     * @param spans The vector to append the spans to.
+     */
+    void getSpans(std::vector<Span> &spans) const override;
+
+    /**
+     * Returns true if all pixels covered by this circle are in an image of the given size. Otherwise, returns false.
+     *
+     * @param height The image height in pixels.
+     * @param width The image width in pixels.
+     * @return true if all pixels covered by this circle are in an image of the given size. Otherwise, returns false.
+     */
+    bool isInBounds(int height, int width) const override;
+
+    /**
+     * Recognizes the Circle (as draw draws it) whose top-left pixel is the given location
+     * and then sets circle to this Circle.
+     * Returns true if there is such a Circle. Otherwise, returns false (and circle isn't set).
+     *
+     * @param img The image to scan in.
+     * @param topLeft The top-left pixel of the Circle (the first one in raster order).
+     * @param circle This de-referenced will be set to the new Circle object, if found. (dynamic alloc)
+     * @return true if a Circle was found. Otherwise, returns false.
+     */
+    static bool recognizeCircle(const Image &img, const Vector2 &topLeft, Circle **circle);
+
+    /**
+     * Recognizes the Circle (as draw draws it) whose top-left pixel is the given location
+     * and then sets circle to this Circle.
+     * Returns true if there is such a Circle. Otherwise, returns false (and circle isn't set).
+     *
+     * @param img The run-length-encoded image to scan in.
+     * @param topLeft The top-left pixel of the Circle (the first one in raster order).
+     * @param circle This de-referenced will be set to the new Circle object, if found. (dynamic alloc)
+     * @return true if a Circle was found. Otherwise, returns false.
+     */
+    static bool recognizeCircle(const RleImage &img, const Vector2 &topLeft, Circle **circle);
+};
+
+/**
+ * Represents a 2d convex polygon of any number of vertices.
+ */
+class Polygon : public Shape
+{
+public:
+    /**
+     * Default ctor for Polygon (can't be drawn)
+     */
+    Polygon();
+
+    /**
+     * Creates a new convex polygon according to given vertices.
+     * Vertices order should be in clockwise order.
+     *
+     * @param vertices The vertices in clockwise order (at least 3).
+     * @param color The color of the polygon.
+     */
+    Polygon(const std::vector<Vector2> &vertices, unsigned char color);
+
+    /**
+     * Makes this Polygon a copy of the given Polygon with a new given color.
+     *
+     * @param other The Polygon to copy.
+     * @param color The color of this shape.
+     */
+    Polygon(const Polygon &other, unsigned char color);
+
+    /**
+     * Returns the kind of this shape (POLYGON).
+     *
+     * @return The kind of this shape.
+     */
+    ShapeType getType() const override;
+
+    /**
+     * Recognizes the convex Polygon (as draw draws it) whose top-left pixel is the given location
+     * and then sets polygon to this Polygon, with the fewest vertices that draw the same pixels.
+     * Returns true if there is such a Polygon. Otherwise, returns false (and polygon isn't set).
+     *
+     * @param img The image to scan in.
+     * @param topLeft The top-left pixel of the Polygon (the first one in raster order).
+     * @param polygon This de-referenced will be set to the new Polygon object, if found. (dynamic alloc)
+     * @return true if a Polygon was found. Otherwise, returns false.
+     */
+    static bool recognizePolygon(const Image &img, const Vector2 &topLeft, Polygon **polygon);
+
+    /**
+     * Recognizes the convex Polygon (as draw draws it) whose top-left pixel is the given location
+     * and then sets polygon to this Polygon, with the fewest vertices that draw the same pixels.
+     * Returns true if there is such a Polygon. Otherwise, returns false (and polygon isn't set).
+     *
+     * @param img The run-length-encoded image to scan in.
+     * @param topLeft The top-left pixel of the Polygon (the first one in raster order).
+     * @param polygon This de-referenced will be set to the new Polygon object, if found. (dynamic alloc)
+     * @return true if a Polygon was found. Otherwise, returns false.
+     */
+    static bool recognizePolygon(const RleImage &img, const Vector2 &topLeft, Polygon **polygon);
+};
+
+/**
+ * Immutable prepared form of a shape (see Shape::prepare): its bounding box and the table of its row spans are worked
+ * out once, so every draw is just filling the spans. Doesn't refer to the shape it was prepared from, and can be
+ * shared by threads that draw it at the same time (to different images).
+ */
+class PreparedShape
+{
+    unsigned char _color;
+    Vector2 _topLeft, _bottomRight; // Bounding box of the spans (only meaningful if there are any).
+    std::vector<Span> _spans; // At most one per row, top to bottom.
+
+public:
+    /**
+     * Prepares the given shape.
+     *
+     * @param shape The shape to prepare.
+     */
+    explicit PreparedShape(const Shape &shape);
+
+    /**
+     * Returns the shape's color.
+     *
+     * @return The shape's color.
+     */
+    unsigned char getColor() const;
+
+    /**
+     * Returns the top-left corner of the shape's bounding box (only meaningful if it has spans).
+     *
+     * @return The top-left corner of the shape's bounding box.
+     */
+    const Vector2 &getTopLeft() const;
+
+    /**
+     * Returns the bottom-right corner of the shape's bounding box (only meaningful if it has spans).
+     *
+     * @return The bottom-right corner of the shape's bounding box.
+     */
+    const Vector2 &getBottomRight() const;
+
+    /**
+     * Returns the spans of pixels covered by the shape (at most one per row, top to bottom).
+     *
+     * @return The spans of pixels covered by the shape.
+     */
+    const std::vector<Span> &getSpans() const;
+
+    /**
+     * Returns true if the given pixel is covered by the shape. Otherwise, returns false.
+     *
+     * @param point The pixel to check.
+     * @return true if the given pixel is covered by the shape. Otherwise, returns false.
+     */
+    bool containsPoint(const Vector2 &point) const;
+
+    /**
+     * Draw's the shape to the given image.
+     * Throws exception if the shape is out of image bounds (nothing is drawn then).
+     *
+     * @param img The image to draw to.
+     */
+    void draw(Image &img) const;
+
+    /**
+     * Draw's the shape to the given run-length-encoded image.
+     * Throws exception if the shape is out of image bounds (nothing is drawn then).
      *
      * @param img The image to draw to.
      */
-    void draw(Image &img) const override;
+    void draw(RleImage &img) const;
+
+    /**
+     * Draw's the shape to the given view, in view coordinates.
+     * Throws exception if the shape is out of view bounds (nothing is drawn then).
+     *
+     * @param view The view to draw to.
+     */
+    void draw(ImageView &view) const;
 };
 
 #endif //POLYTEST_SHAPES_H
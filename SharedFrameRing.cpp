@@ -0,0 +1,339 @@
+#include <algorithm>
+#include <atomic>
+#include <fcntl.h>
+#include <new>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "SharedFrameRing.h"
+
+
+static const unsigned char MAGIC[4] = {'S', 'F', 'R', 'G'};
+static const int VERSION = 1;
+static const size_t PAGE_SIZE = 4096;
+static const size_t CACHE_LINE_SIZE = 64;
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "The frame ring needs lock-free 64 bit atomics to work across processes.");
+
+/**
+ * Start of the shared memory: the frames' parameters and the ring's counters (each on its own cache line, so the
+ * producer and the consumer don't invalidate each other's line). The frames' pixels follow, page aligned.
+ */
+struct SharedFrameRing::Header
+{
+    unsigned char magic[4];
+    uint16_t version;
+    uint16_t layout;
+    int32_t slotCount, height, width;
+    uint64_t slotSize;
+    alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> published; // Written by the producer only.
+    alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> released; // Written by the consumer only.
+};
+
+// Returns the given size rounded up to whole pages.
+static size_t roundToPages(size_t size)
+{
+    return (size + PAGE_SIZE - 1) / PAGE_SIZE * PAGE_SIZE;
+}
+
+
+// unmaps the ring, closes its file and removes its name if this object created it.
+void SharedFrameRing::_close()
+{
+    _frames.clear();
+    _mapping.reset();
+    if (_fd >= 0)
+    {
+        close(_fd);
+        _fd = -1;
+    }
+    if (!_name.empty())
+    {
+        shm_unlink(_name.c_str());
+        _name.clear();
+    }
+}
+
+// maps the ring of the given shared memory file (creating the header if a frame size is given).
+void SharedFrameRing::_map(int fd, int slotCount, int height, int width, ImageLayout layout)
+{
+    _fd = fd;
+    size_t framesOffset = roundToPages(sizeof(Header));
+    bool isCreating = slotCount > 0;
+    if (isCreating)
+    {
+        _mappingSize = framesOffset + slotCount * roundToPages(Image::getBufferSize(height, width, layout));
+        if (ftruncate(fd, (off_t) _mappingSize) != 0)
+        {
+            throw SharedMemoryException();
+        }
+    }
+    else
+    {
+        struct stat fileStat = {};
+        if (fstat(fd, &fileStat) != 0 || (size_t) fileStat.st_size < framesOffset)
+        {
+            throw SharedMemoryException();
+        }
+        _mappingSize = (size_t) fileStat.st_size;
+    }
+
+    void *address = mmap(nullptr, _mappingSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (address == MAP_FAILED)
+    {
+        throw SharedMemoryException();
+    }
+    size_t mappingSize = _mappingSize;
+    _mapping = std::shared_ptr<void>(address, [mappingSize](void *mapping)
+    {
+        munmap(mapping, mappingSize);
+    });
+
+    if (isCreating)
+    {
+        _header = new(address) Header();
+        _header->version = VERSION;
+        _header->layout = (uint16_t) layout;
+        _header->slotCount = slotCount;
+        _header->height = height;
+        _header->width = width;
+        _header->slotSize = roundToPages(Image::getBufferSize(height, width, layout));
+        _header->published.store(0, std::memory_order_relaxed);
+        _header->released.store(0, std::memory_order_relaxed);
+        // The magic goes in last, so a ring that is opened too early is rejected rather than half read.
+        std::atomic_thread_fence(std::memory_order_release);
+        std::copy(MAGIC, MAGIC + 4, _header->magic);
+    }
+    else
+    {
+        _header = (Header *) address;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (!std::equal(MAGIC, MAGIC + 4, _header->magic) || _header->version != VERSION ||
+            _header->slotCount <= 0 || _header->height < 0 || _header->width < 0 ||
+            _header->slotSize != roundToPages(Image::getBufferSize(_header->height, _header->width,
+                                                                   (ImageLayout) _header->layout)) ||
+            _mappingSize < framesOffset + _header->slotCount * _header->slotSize)
+        {
+            throw SharedMemoryException();
+        }
+    }
+
+    auto frames = (unsigned char *) address + framesOffset;
+    _frames.reserve(_header->slotCount);
+    for (int i = 0; i < _header->slotCount; ++i)
+    {
+        _frames.push_back(Image::adoptBuffer(_header->height, _header->width, (ImageLayout) _header->layout,
+                                             frames + i * _header->slotSize, _mapping));
+    }
+}
+
+/**
+ * Creates a new ring of the given number of frames of the given parameters.
+ * If a name is given the ring is a POSIX shared memory object that other processes can open by name (it is
+ * removed when this object is destructed), otherwise it's an anonymous memory file that is shared by passing
+ * getFd() to a child process. Throws SharedMemoryException if the shared memory can't be created.
+ *
+ * @param name The name of the shared memory object (starting with '/'), or null for an anonymous one.
+ * @param slotCount The number of frames in the ring.
+ * @param height The frames height in pixels.
+ * @param width The frames width in pixels.
+ * @param layout The memory layout of the frames' pixels - defaults to ROW_MAJOR.
+ */
+SharedFrameRing::SharedFrameRing(const char *name, int slotCount, int height, int width, ImageLayout layout) :
+        _mappingSize(0), _fd(-1), _header(nullptr)
+{
+    if (slotCount <= 0 || height < 0 || width < 0)
+    {
+        throw SharedMemoryException();
+    }
+
+    int fd;
+    if (name != nullptr)
+    {
+        fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+        if (fd >= 0)
+        {
+            _name = name;
+        }
+    }
+    else
+    {
+#ifdef MFD_CLOEXEC
+        fd = memfd_create("polytest-frame-ring", 0);
+#else
+        fd = -1;
+#endif
+    }
+    if (fd < 0)
+    {
+        throw SharedMemoryException();
+    }
+
+    try
+    {
+        _map(fd, slotCount, height, width, layout);
+    }
+    catch (const SharedMemoryException &)
+    {
+        _close();
+        throw;
+    }
+}
+
+/**
+ * Opens the ring that was created with the given name.
+ * Throws SharedMemoryException if there is no such ring.
+ *
+ * @param name The name of the shared memory object.
+ */
+SharedFrameRing::SharedFrameRing(const char *name) : _mappingSize(0), _fd(-1), _header(nullptr)
+{
+    int fd = shm_open(name, O_RDWR, 0);
+    if (fd < 0)
+    {
+        throw SharedMemoryException();
+    }
+
+    try
+    {
+        _map(fd, 0, 0, 0, ImageLayout::ROW_MAJOR);
+    }
+    catch (const SharedMemoryException &)
+    {
+        _close();
+        throw;
+    }
+}
+
+/**
+ * Opens the ring of the given shared memory file descriptor (see getFd).
+ * Throws SharedMemoryException if it isn't a ring.
+ *
+ * @param fd The file descriptor (is duplicated, the caller keeps ownership).
+ */
+SharedFrameRing::SharedFrameRing(int fd) : _mappingSize(0), _fd(-1), _header(nullptr)
+{
+    int ownFd = dup(fd);
+    if (ownFd < 0)
+    {
+        throw SharedMemoryException();
+    }
+
+    try
+    {
+        _map(ownFd, 0, 0, 0, ImageLayout::ROW_MAJOR);
+    }
+    catch (const SharedMemoryException &)
+    {
+        _close();
+        throw;
+    }
+}
+
+/**
+ * Unmaps the ring (and removes its name if this object created it).
+ * Frames that were copied out of the ring stay valid.
+ */
+SharedFrameRing::~SharedFrameRing()
+{
+    _close();
+}
+
+/**
+ * Returns the file descriptor of the shared memory (can be inherited by a child process).
+ *
+ * @return The file descriptor of the shared memory.
+ */
+int SharedFrameRing::getFd() const
+{
+    return _fd;
+}
+
+/**
+ * Returns the number of frames in the ring.
+ *
+ * @return The number of frames in the ring.
+ */
+int SharedFrameRing::getSlotCount() const
+{
+    return _header->slotCount;
+}
+
+/**
+ * Returns the frames' height.
+ *
+ * @return The frames' height.
+ */
+int SharedFrameRing::getHeight() const
+{
+    return _header->height;
+}
+
+/**
+ * Returns the frames' width.
+ *
+ * @return The frames' width.
+ */
+int SharedFrameRing::getWidth() const
+{
+    return _header->width;
+}
+
+/**
+ * Producer side: returns the next free frame to draw into, or null if the consumer hasn't released any.
+ * The frame keeps the content it had when it was last used.
+ *
+ * @return The next free frame to draw into, or null if the ring is full.
+ */
+Image *SharedFrameRing::beginWrite()
+{
+    uint64_t published = _header->published.load(std::memory_order_relaxed);
+    uint64_t released = _header->released.load(std::memory_order_acquire);
+    if (published - released >= (uint64_t) _header->slotCount)
+    {
+        return nullptr;
+    }
+    return &_frames[published % _header->slotCount];
+}
+
+/**
+ * Producer side: publishes the frame returned by the last beginWrite to the consumer.
+ */
+void SharedFrameRing::endWrite()
+{
+    _header->published.fetch_add(1, std::memory_order_release);
+}
+
+/**
+ * Consumer side: returns the oldest published frame, or null if there is none.
+ *
+ * @return The oldest published frame, or null if the ring is empty.
+ */
+const Image *SharedFrameRing::beginRead()
+{
+    uint64_t released = _header->released.load(std::memory_order_relaxed);
+    uint64_t published = _header->published.load(std::memory_order_acquire);
+    if (released == published)
+    {
+        return nullptr;
+    }
+    return &_frames[released % _header->slotCount];
+}
+
+/**
+ * Consumer side: releases the frame returned by the last beginRead back to the producer.
+ */
+void SharedFrameRing::endRead()
+{
+    _header->released.fetch_add(1, std::memory_order_release);
+}
+
+/**
+ * Returns the number of frames that were published so far.
+ *
+ * @return The number of frames that were published so far.
+ */
+uint64_t SharedFrameRing::getPublishedCount() const
+{
+    return _header->published.load(std::memory_order_acquire);
+}
@@ -0,0 +1,159 @@
+//
+// Created by jacko on 30/10/2020.
+//
+
+#ifndef POLYTEST_SHAREDFRAMERING_H
+#define POLYTEST_SHAREDFRAMERING_H
+
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Image.h"
+
+
+#define ERROR_SHARED_MEMORY "ERROR: Couldn't create, open or map the shared frame ring."
+
+
+/**
+ * Exception for problems creating, opening or mapping shared frame rings.
+ */
+class SharedMemoryException : public std::exception
+{
+public:
+    const char *what() const noexcept override
+    {
+        return ERROR_SHARED_MEMORY;
+    }
+};
+
+/**
+ * Ring of image frames in shared memory, passed from a single producer process to a single consumer process
+ * without copying or locking. Each side maps the same memory and gets images whose pixels live in it.
+ *
+ * The producer fills a free frame between beginWrite and endWrite, the consumer reads the oldest published frame
+ * between beginRead and endRead. Each side must be used by one thread only.
+ */
+class SharedFrameRing
+{
+    struct Header;
+
+    std::shared_ptr<void> _mapping;
+    size_t _mappingSize;
+    int _fd;
+    std::string _name; // Name of the shared memory object this side created (unlinked on destruction), or empty.
+    Header *_header;
+    std::vector<Image> _frames;
+
+    // maps the ring of the given shared memory file (creating the header if a frame size is given).
+    void _map(int fd, int slotCount, int height, int width, ImageLayout layout);
+
+    // unmaps the ring, closes its file and removes its name if this object created it.
+    void _close();
+
+public:
+    /**
+     * Creates a new ring of the given number of frames of the given parameters.
+     * If a name is given the ring is a POSIX shared memory object that other processes can open by name (it is
+     * removed when this object is destructed), otherwise it's an anonymous memory file that is shared by passing
+     * getFd() to a child process. Throws SharedMemoryException if the shared memory can't be created.
+     *
+     * @param name The name of the shared memory object (starting with '/'), or null for an anonymous one.
+     * @param slotCount The number of frames in the ring.
+     * @param height The frames height in pixels.
+     * @param width The frames width in pixels.
+     * @param layout The memory layout of the frames' pixels - defaults to ROW_MAJOR.
+     */
+    SharedFrameRing(const char *name, int slotCount, int height, int width,
+                    ImageLayout layout = ImageLayout::ROW_MAJOR);
+
+    /**
+     * Opens the ring that was created with the given name.
+     * Throws SharedMemoryException if there is no such ring.
+     *
+     * @param name The name of the shared memory object.
+     */
+    explicit SharedFrameRing(const char *name);
+
+    /**
+     * Opens the ring of the given shared memory file descriptor (see getFd).
+     * Throws SharedMemoryException if it isn't a ring.
+     *
+     * @param fd The file descriptor (is duplicated, the caller keeps ownership).
+     */
+    explicit SharedFrameRing(int fd);
+
+    SharedFrameRing(const SharedFrameRing &) = delete;
+
+    SharedFrameRing &operator=(const SharedFrameRing &) = delete;
+
+    /**
+     * Unmaps the ring (and removes its name if this object created it).
+     * Frames that were copied out of the ring stay valid.
+     */
+    ~SharedFrameRing();
+
+    /**
+     * Returns the file descriptor of the shared memory (can be inherited by a child process).
+     *
+     * @return The file descriptor of the shared memory.
+     */
+    int getFd() const;
+
+    /**
+     * Returns the number of frames in the ring.
+     *
+     * @return The number of frames in the ring.
+     */
+    int getSlotCount() const;
+
+    /**
+     * Returns the frames' height.
+     *
+     * @return The frames' height.
+     */
+    int getHeight() const;
+
+    /**
+     * Returns the frames' width.
+     *
+     * @return The frames' width.
+     */
+    int getWidth() const;
+
+    /**
+     * Producer side: returns the next free frame to draw into, or null if the consumer hasn't released any.
+     * The frame keeps the content it had when it was last used.
+     *
+     * @return The next free frame to draw into, or null if the ring is full.
+     */
+    Image *beginWrite();
+
+    /**
+     * Producer side: publishes the frame returned by the last beginWrite to the consumer.
+     */
+    void endWrite();
+
+    /**
+     * Consumer side: returns the oldest published frame, or null if there is none.
+     *
+     * @return The oldest published frame, or null if the ring is empty.
+     */
+    const Image *beginRead();
+
+    /**
+     * Consumer side: releases the frame returned by the last beginRead back to the producer.
+     */
+    void endRead();
+
+    /**
+     * Returns the number of frames that were published so far.
+     *
+     * @return The number of frames that were published so far.
+     */
+    uint64_t getPublishedCount() const;
+};
+
+
+#endif //POLYTEST_SHAREDFRAMERING_H
@@ -0,0 +1,137 @@
+#include <algorithm>
+#include "SpanCompositor.h"
+
+
+// writes the given visible segment to the image.
+void SpanCompositor::_writeSegment(Image &img, int y, int xStart, int xEnd, unsigned char color)
+{
+    img.drawHorizontalLine(Vector2(xStart, y), xEnd, color);
+    _writtenPixels += xEnd - xStart + 1;
+}
+
+// resolves the spans of the given row and writes the visible parts to the image.
+void SpanCompositor::_compositeRow(Image &img, int y, const DepthSpan *spans, int count)
+{
+    // Spans are in depth order, so going backwards is front to back: a span only gets the pixels that the spans
+    // in front of it left uncovered, and every pixel is written once.
+    _covered.clear();
+    for (int i = count - 1; i >= 0; --i)
+    {
+        unsigned char color = _colors[spans[i].depth];
+        _covered.cover(spans[i].xStart, spans[i].xEnd, [&](int xStart, int xEnd)
+        {
+            _writeSegment(img, y, xStart, xEnd, color);
+        });
+    }
+}
+
+/**
+ * Creates an empty compositor for images of the given size.
+ *
+ * @param height The image height in pixels.
+ * @param width The image width in pixels.
+ */
+SpanCompositor::SpanCompositor(int height, int width) : _height(height), _width(width), _writtenPixels(0)
+{}
+
+/**
+ * Adds the given shape in front of all shapes that were added so far.
+ * Throws exception if the shape is out of image bounds (it isn't added then).
+ *
+ * @param shape The shape to add.
+ */
+void SpanCompositor::add(const Shape &shape)
+{
+    // Checked before the spans are worked out, so a shape that is far out of bounds costs nothing.
+    if (!shape.isInBounds(_height, _width))
+    {
+        throw ImageDimException();
+    }
+    _shapeSpans.clear();
+    shape.getSpans(_shapeSpans);
+
+    int depth = (int) _colors.size();
+    _colors.push_back(shape.getColor());
+    for (const Span &span : _shapeSpans)
+    {
+        _pending.push_back(DepthSpan{span.y, span.xStart, span.xEnd, depth});
+    }
+}
+
+/**
+ * Adds the given shapes in order (each one in front of the previous ones).
+ * Throws exception if a shape is out of image bounds (the shapes before it stay added).
+ *
+ * @param shapes An array of shape pointers.
+ * @param size The size of the shapes array.
+ */
+void SpanCompositor::add(const Shape **shapes, int size)
+{
+    for (int i = 0; i < size; ++i)
+    {
+        add(*shapes[i]);
+    }
+}
+
+/**
+ * Writes the visible parts of all added shapes to the given image and removes them from the compositor.
+ * Pixels that no shape covers are left as they are.
+ * Throws exception if the image isn't of the compositor's size.
+ *
+ * @param img The image to draw to.
+ */
+void SpanCompositor::flush(Image &img)
+{
+    if (img.getHeight() != _height || img.getWidth() != _width)
+    {
+        throw ImageDimException();
+    }
+
+    // Bucket the spans by row with a stable counting sort, so each row stays in depth order.
+    // _rowEnds[y] ends up as the end of row y in _rowSpans.
+    _rowEnds.assign(_height + 1, 0);
+    for (const DepthSpan &span : _pending)
+    {
+        _rowEnds[span.y + 1]++;
+    }
+    for (int y = 1; y <= _height; ++y)
+    {
+        _rowEnds[y] += _rowEnds[y - 1];
+    }
+    _rowSpans.resize(_pending.size());
+    for (const DepthSpan &span : _pending)
+    {
+        _rowSpans[_rowEnds[span.y]++] = span;
+    }
+
+    _writtenPixels = 0;
+    int rowStart = 0;
+    for (int y = 0; y < _height; ++y)
+    {
+        if (_rowEnds[y] > rowStart)
+        {
+            _compositeRow(img, y, &_rowSpans[rowStart], _rowEnds[y] - rowStart);
+        }
+        rowStart = _rowEnds[y];
+    }
+    clear();
+}
+
+/**
+ * Removes all added shapes without drawing them.
+ */
+void SpanCompositor::clear()
+{
+    _pending.clear();
+    _colors.clear();
+}
+
+/**
+ * Returns the number of pixels that the last flush wrote.
+ *
+ * @return The number of pixels that the last flush wrote.
+ */
+long SpanCompositor::getWrittenPixels() const
+{
+    return _writtenPixels;
+}
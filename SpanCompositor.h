@@ -0,0 +1,175 @@
+//
+// Created by jacko on 30/10/2020.
+//
+
+#ifndef POLYTEST_SPANCOMPOSITOR_H
+#define POLYTEST_SPANCOMPOSITOR_H
+
+
+#include <algorithm>
+#include <vector>
+#include "Shapes.h"
+
+
+/**
+ * Sorted and merged set of covered x ranges of a single row, used to resolve overlapping spans front to back.
+ */
+class CoveredRanges
+{
+    std::vector<std::pair<int, int>> _ranges;
+
+    // Returns the first range that ends at or after x.
+    std::vector<std::pair<int, int>>::const_iterator _findRange(int x) const
+    {
+        return std::lower_bound(_ranges.begin(), _ranges.end(), x, [](const std::pair<int, int> &range, int value)
+        {
+            return range.second < value;
+        });
+    }
+
+public:
+    /**
+     * Removes all covered ranges.
+     */
+    void clear()
+    {
+        _ranges.clear();
+    }
+
+    /**
+     * Returns true if the given range is covered completely. Otherwise, returns false.
+     *
+     * @param xStart The first x coordinate of the range.
+     * @param xEnd The last x coordinate of the range.
+     * @return true if the given range is covered completely. Otherwise, returns false.
+     */
+    bool contains(int xStart, int xEnd) const
+    {
+        auto range = _findRange(xEnd);
+        return range != _ranges.end() && range->first <= xStart;
+    }
+
+    /**
+     * Marks the given range as covered, calling onUncovered(xStart, xEnd) (left to right) for each part of it
+     * that wasn't covered before.
+     *
+     * @param xStart The first x coordinate of the range.
+     * @param xEnd The last x coordinate of the range.
+     * @param onUncovered Called with the first and last x coordinates of each newly covered part.
+     */
+    template<class Callback>
+    void cover(int xStart, int xEnd, Callback onUncovered)
+    {
+        // The ranges that overlap or touch the new one are merged into one range together with it.
+        auto first = _ranges.begin() + (_findRange(xStart - 1) - _ranges.begin());
+        auto last = first;
+        int x = xStart;
+        std::pair<int, int> merged(xStart, xEnd);
+        for (; last != _ranges.end() && last->first <= xEnd + 1; ++last)
+        {
+            if (last->first > x)
+            {
+                onUncovered(x, last->first - 1);
+            }
+            x = std::max(x, last->second + 1);
+            merged.first = std::min(merged.first, last->first);
+            merged.second = std::max(merged.second, last->second);
+        }
+        if (x <= xEnd)
+        {
+            onUncovered(x, xEnd);
+        }
+
+        if (first == last)
+        {
+            _ranges.insert(first, merged);
+        }
+        else
+        {
+            *first = merged;
+            _ranges.erase(first + 1, last);
+        }
+    }
+};
+
+/**
+ * Deferred drawing of shapes: collects the row spans of the added shapes and, when flushed, resolves their
+ * overlaps per row front to back (later shapes are in front) so each covered pixel is written exactly once.
+ * Overlaps are resolved on x ranges rather than pixels, so heavily overlapping scenes write about the image area.
+ * The result is the same as drawing the shapes in the order they were added.
+ * Buffers are kept between flushes, so one compositor can be reused for every frame.
+ */
+class SpanCompositor
+{
+    // A span of an added shape, depth is the index of the shape (bigger is in front).
+    struct DepthSpan
+    {
+        int y, xStart, xEnd;
+        int depth;
+    };
+
+    int _height, _width;
+    std::vector<Span> _shapeSpans; // Spans of the shape that is being added.
+    std::vector<DepthSpan> _pending; // Spans of all added shapes, in the order they were added.
+    std::vector<unsigned char> _colors; // Color of each added shape, by depth.
+    std::vector<int> _rowEnds;
+    std::vector<DepthSpan> _rowSpans; // Pending spans bucketed by row.
+    CoveredRanges _covered; // Covered x ranges of the current row.
+    long _writtenPixels;
+
+    // resolves the spans of the given row and writes the visible parts to the image.
+    void _compositeRow(Image &img, int y, const DepthSpan *spans, int count);
+
+    // writes the given visible segment to the image.
+    void _writeSegment(Image &img, int y, int xStart, int xEnd, unsigned char color);
+
+public:
+    /**
+     * Creates an empty compositor for images of the given size.
+     *
+     * @param height The image height in pixels.
+     * @param width The image width in pixels.
+     */
+    SpanCompositor(int height, int width);
+
+    /**
+     * Adds the given shape in front of all shapes that were added so far.
+     * Throws exception if the shape is out of image bounds (it isn't added then).
+     *
+     * @param shape The shape to add.
+     */
+    void add(const Shape &shape);
+
+    /**
+     * Adds the given shapes in order (each one in front of the previous ones).
+     * Throws exception if a shape is out of image bounds (the shapes before it stay added).
+     *
+     * @param shapes An array of shape pointers.
+     * @param size The size of the shapes array.
+     */
+    void add(const Shape **shapes, int size);
+
+    /**
+     * Writes the visible parts of all added shapes to the given image and removes them from the compositor.
+     * Pixels that no shape covers are left as they are.
+     * Throws exception if the image isn't of the compositor's size.
+     *
+     * @param img The image to draw to.
+     */
+    void flush(Image &img);
+
+    /**
+     * Removes all added shapes without drawing them.
+     */
+    void clear();
+
+    /**
+     * Returns the number of pixels that the last flush wrote.
+     *
+     * @return The number of pixels that the last flush wrote.
+     */
+    long getWrittenPixels() const;
+};
+
+
+#endif //POLYTEST_SPANCOMPOSITOR_H
@@ -0,0 +1,212 @@
+#include <algorithm>
+#include "StampCache.h"
+
+
+// Approximate bookkeeping cost of a cached mask on top of its geometry and spans.
+static const size_t ENTRY_OVERHEAD = 96;
+
+// Hands the values that describe the given shape's geometry relative to its first vertex to the given function.
+template<class Function>
+static void forEachGeometryValue(const Shape &shape, Function function)
+{
+    const Vector2 *vertices = shape.getVertices();
+    function((int) shape.getType());
+    function(shape.getType() == ShapeType::CIRCLE ? static_cast<const Circle &>(shape).getRadius() : -1);
+    function(shape.getVerticesSize());
+    for (int i = 1; i < shape.getVerticesSize(); ++i)
+    {
+        function(vertices[i].x - vertices[0].x);
+        function(vertices[i].y - vertices[0].y);
+    }
+}
+
+// Returns the size in bytes the given cached mask takes.
+static size_t getEntrySize(const std::vector<int> &geometry, const std::vector<Span> &spans)
+{
+    return geometry.size() * sizeof(int) + spans.size() * sizeof(Span) + ENTRY_OVERHEAD;
+}
+
+/**
+ * Creates an empty cache.
+ *
+ * @param memoryBudget The maximal number of bytes the cached masks may take.
+ */
+StampCache::StampCache(size_t memoryBudget) : _memoryBudget(memoryBudget), _memoryUsage(0), _hits(0), _misses(0)
+{}
+
+// Returns the mask of the given shape, rasterizing (and caching) it on a miss.
+const std::vector<Span> &StampCache::_getMask(const Shape &shape)
+{
+    // FNV-1a over the geometry, without building it.
+    uint64_t key = 0xCBF29CE484222325ULL;
+    forEachGeometryValue(shape, [&](int value)
+    {
+        key = (key ^ (uint32_t) value) * 0x100000001B3ULL;
+    });
+
+    auto found = _index.find(key);
+    if (found != _index.end())
+    {
+        const std::vector<int> &geometry = found->second->geometry;
+        size_t i = 0;
+        bool isSame = true;
+        forEachGeometryValue(shape, [&](int value)
+        {
+            isSame = isSame && i < geometry.size() && geometry[i] == value;
+            i++;
+        });
+        if (isSame && i == geometry.size())
+        {
+            _hits++;
+            _entries.splice(_entries.begin(), _entries, found->second);
+            return found->second->spans;
+        }
+
+        // Another geometry with the same hash, it gives way to the new one.
+        _memoryUsage -= getEntrySize(geometry, found->second->spans);
+        _entries.erase(found->second);
+        _index.erase(found);
+    }
+
+    _misses++;
+    Entry entry;
+    entry.key = key;
+    forEachGeometryValue(shape, [&](int value)
+    {
+        entry.geometry.push_back(value);
+    });
+    shape.getSpans(entry.spans);
+    const Vector2 &origin = shape.getVertices()[0];
+    for (Span &span : entry.spans)
+    {
+        span.y -= origin.y;
+        span.xStart -= origin.x;
+        span.xEnd -= origin.x;
+    }
+
+    size_t entrySize = getEntrySize(entry.geometry, entry.spans);
+    if (entrySize > _memoryBudget)
+    {
+        _uncachedSpans = std::move(entry.spans);
+        return _uncachedSpans;
+    }
+    _entries.push_front(std::move(entry));
+    _index[key] = _entries.begin();
+    _memoryUsage += entrySize;
+    _evict();
+    return _entries.front().spans;
+}
+
+// Evicts least recently used masks until the memory usage fits the budget.
+void StampCache::_evict()
+{
+    while (_memoryUsage > _memoryBudget)
+    {
+        Entry &last = _entries.back();
+        _memoryUsage -= getEntrySize(last.geometry, last.spans);
+        _index.erase(last.key);
+        _entries.pop_back();
+    }
+}
+
+/**
+ * Draws the given shape to the given image with its cached mask (parts out of image bounds are clipped).
+ *
+ * @param img The image to draw to.
+ * @param shape The shape to draw.
+ */
+void StampCache::draw(Image &img, const Shape &shape)
+{
+    if (shape.getVerticesSize() == 0)
+    {
+        return;
+    }
+
+    const Vector2 &origin = shape.getVertices()[0];
+    for (const Span &span : _getMask(shape))
+    {
+        int y = origin.y + span.y;
+        int xStart = std::max(origin.x + span.xStart, 0);
+        int xEnd = std::min(origin.x + span.xEnd, img.getWidth() - 1);
+        if (y >= 0 && y < img.getHeight() && xStart <= xEnd)
+        {
+            img.drawHorizontalLine(Vector2(xStart, y), xEnd, shape.getColor());
+        }
+    }
+}
+
+/**
+ * Draws the given shapes in order (see draw).
+ *
+ * @param img The image to draw to.
+ * @param shapes An array of shape pointers.
+ * @param size The size of the shapes array.
+ */
+void StampCache::draw(Image &img, const Shape **shapes, int size)
+{
+    for (int i = 0; i < size; ++i)
+    {
+        draw(img, *shapes[i]);
+    }
+}
+
+/**
+ * Returns the number of draws that used a cached mask.
+ *
+ * @return The number of draws that used a cached mask.
+ */
+size_t StampCache::getHits() const
+{
+    return _hits;
+}
+
+/**
+ * Returns the number of draws that needed to rasterize the shape.
+ *
+ * @return The number of draws that needed to rasterize the shape.
+ */
+size_t StampCache::getMisses() const
+{
+    return _misses;
+}
+
+/**
+ * Returns the fraction of draws that used a cached mask (0 if there were none).
+ *
+ * @return The fraction of draws that used a cached mask.
+ */
+double StampCache::getHitRate() const
+{
+    size_t lookups = _hits + _misses;
+    return lookups == 0 ? 0 : (double) _hits / lookups;
+}
+
+/**
+ * Returns the number of bytes the cached masks take.
+ *
+ * @return The number of bytes the cached masks take.
+ */
+size_t StampCache::getMemoryUsage() const
+{
+    return _memoryUsage;
+}
+
+/**
+ * Returns the number of cached masks.
+ *
+ * @return The number of cached masks.
+ */
+size_t StampCache::getSize() const
+{
+    return _entries.size();
+}
+
+/**
+ * Removes all cached masks (statistics are kept).
+ */
+void StampCache::clear()
+{
+    _entries.clear();
+    _index.clear();
+    _memoryUsage = 0;
+}
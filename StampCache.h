@@ -0,0 +1,113 @@
+//
+// Created by jacko on 30/10/2020.
+//
+
+#ifndef POLYTEST_STAMPCACHE_H
+#define POLYTEST_STAMPCACHE_H
+
+
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+#include <vector>
+#include "Shapes.h"
+
+
+/**
+ * Memoizes the rasterized masks of shapes by their geometry relative to their first vertex, so copies of the same
+ * shape at other positions (in any color) are drawn by stamping the cached mask instead of rasterizing them again.
+ * Masks are kept as row spans, so stamping is one fill per row, clipped to the image.
+ * The least recently used masks are evicted once the configured memory budget is exceeded.
+ * Not thread-safe.
+ */
+class StampCache
+{
+    // A cached mask.
+    struct Entry
+    {
+        uint64_t key;
+        std::vector<int> geometry; // Type, radius and vertices relative to the first one, to tell keys apart.
+        std::vector<Span> spans; // Relative to the first vertex.
+    };
+
+    size_t _memoryBudget;
+    size_t _memoryUsage;
+    size_t _hits, _misses;
+    std::list<Entry> _entries; // Most recently used first.
+    std::unordered_map<uint64_t, std::list<Entry>::iterator> _index;
+    std::vector<Span> _uncachedSpans; // Mask of the last miss that didn't fit the budget.
+
+    // Returns the mask of the given shape, rasterizing (and caching) it on a miss.
+    const std::vector<Span> &_getMask(const Shape &shape);
+
+    // Evicts least recently used masks until the memory usage fits the budget.
+    void _evict();
+
+public:
+    /**
+     * Creates an empty cache.
+     *
+     * @param memoryBudget The maximal number of bytes the cached masks may take.
+     */
+    explicit StampCache(size_t memoryBudget);
+
+    /**
+     * Draws the given shape to the given image with its cached mask (parts out of image bounds are clipped).
+     *
+     * @param img The image to draw to.
+     * @param shape The shape to draw.
+     */
+    void draw(Image &img, const Shape &shape);
+
+    /**
+     * Draws the given shapes in order (see draw).
+     *
+     * @param img The image to draw to.
+     * @param shapes An array of shape pointers.
+     * @param size The size of the shapes array.
+     */
+    void draw(Image &img, const Shape **shapes, int size);
+
+    /**
+     * Returns the number of draws that used a cached mask.
+     *
+     * @return The number of draws that used a cached mask.
+     */
+    size_t getHits() const;
+
+    /**
+     * Returns the number of draws that needed to rasterize the shape.
+     *
+     * @return The number of draws that needed to rasterize the shape.
+     */
+    size_t getMisses() const;
+
+    /**
+     * Returns the fraction of draws that used a cached mask (0 if there were none).
+     *
+     * @return The fraction of draws that used a cached mask.
+     */
+    double getHitRate() const;
+
+    /**
+     * Returns the number of bytes the cached masks take.
+     *
+     * @return The number of bytes the cached masks take.
+     */
+    size_t getMemoryUsage() const;
+
+    /**
+     * Returns the number of cached masks.
+     *
+     * @return The number of cached masks.
+     */
+    size_t getSize() const;
+
+    /**
+     * Removes all cached masks (statistics are kept).
+     */
+    void clear();
+};
+
+
+#endif //POLYTEST_STAMPCACHE_H
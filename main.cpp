@@ -1,9 +1,65 @@
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include "Image.h"
+#include "LoadGenerator.h"
+#include "RecognitionServer.h"
 #include "Shapes.h"
 
 
-int main()
+static RecognitionServer *runningServer = nullptr;
+
+// Stops the running server on SIGINT and SIGTERM.
+static void stopServer(int)
+{
+    runningServer->stop();
+}
+
+// Prints the given latency percentiles.
+static void printLatency(const LatencyHistogram &latency)
+{
+    std::cout << "Latency (us): p50 <= " << latency.getPercentile(50) << ", p90 <= " << latency.getPercentile(90)
+              << ", p99 <= " << latency.getPercentile(99) << std::endl;
+}
+
+// Prints the given server stats.
+static void printStats(const ServerStats &stats)
+{
+    std::cout << "Server: " << stats.requests << " requests (" << stats.failedRequests << " failed) in "
+              << stats.batches << " batches from " << stats.connections << " connections, "
+              << stats.getThroughput() << " requests/s, " << stats.bytesReceived << " bytes in, " << stats.bytesSent
+              << " bytes out" << std::endl;
+    printLatency(stats.latency);
+}
+
+// Serves recognition requests on the given socket until interrupted.
+static int serve(const char *socketPath, int workerCount)
+{
+    RecognitionServer server(socketPath, workerCount);
+    runningServer = &server;
+    std::signal(SIGINT, stopServer);
+    std::signal(SIGTERM, stopServer);
+    std::cout << "Serving on " << socketPath << std::endl;
+    server.run();
+    printStats(server.getStats());
+    return 0;
+}
+
+// Runs the load generator against the server on the given socket.
+static int load(const char *socketPath, int clientCount, int requestsPerClient)
+{
+    RecognitionClient statsClient(socketPath);
+    LoadReport report = LoadGenerator(socketPath, clientCount, requestsPerClient).run();
+    std::cout << "Clients: " << report.requests << " requests (" << report.failedRequests << " failed) in "
+              << report.seconds << " s, " << report.getThroughput() << " requests/s" << std::endl;
+    printLatency(report.latency);
+    printStats(statsClient.getStats());
+    return report.failedRequests == 0 ? 0 : 1;
+}
+
+// Shows recognition on a small example.
+static int demo()
 {
     Rectangle rect1 = Rectangle(Vector2(1, 1), Vector2(3, 2), 70);
     Rectangle rect2 = Rectangle(Vector2(3, 4), Vector2(4, 5), 140);
@@ -20,8 +76,9 @@ int main()
     std::cout << img2 << std::endl << std::endl;
 
     int arrSize1, arrSize2;
-    Shape **shapes1 = Shape::getRectanglesFromImage(img1, arrSize1);
-    Shape **shapes2 = Shape::getRectanglesAndTrianglesFromImage(img2, arrSize2);
+    ImageDiff diff1, diff2;
+    Shape **shapes1 = Shape::getVerifiedRectanglesFromImage(img1, arrSize1, diff1);
+    Shape **shapes2 = Shape::getVerifiedRectanglesAndTrianglesFromImage(img2, arrSize2, diff2);
     Image img1Compare = Image(6, 6);
     Image img2Compare = Image(6, 6);
     Shape::drawShapesToImage(img1Compare, (const Shape **) shapes1, arrSize1);
@@ -31,8 +88,34 @@ int main()
     std::cout << img1Compare << std::endl << std::endl;
     std::cout << img2Compare << std::endl;
 
+    std::cout << "Differing pixels: " << diff1.differentPixels << " " << diff2.differentPixels << std::endl;
+
     Shape::freeShapesArray(shapes1, arrSize1);
     Shape::freeShapesArray(shapes2, arrSize2);
 
-    return 0;
-}
\ No newline at end of file
+    return diff1.isEqual() && diff2.isEqual() ? 0 : 1;
+}
+
+// Usage: PolyTest - runs the example.
+//        PolyTest serve <socket path> [workers] - runs a recognition server until interrupted.
+//        PolyTest load <socket path> [clients] [requests per client] - loads a running server and reports.
+int main(int argc, char **argv)
+{
+    try
+    {
+        if (argc >= 3 && std::strcmp(argv[1], "serve") == 0)
+        {
+            return serve(argv[2], argc >= 4 ? std::atoi(argv[3]) : 0);
+        }
+        if (argc >= 3 && std::strcmp(argv[1], "load") == 0)
+        {
+            return load(argv[2], argc >= 4 ? std::atoi(argv[3]) : 4, argc >= 5 ? std::atoi(argv[4]) : 1000);
+        }
+    }
+    catch (const std::exception &exception)
+    {
+        std::cerr << exception.what() << std::endl;
+        return 1;
+    }
+    return demo();
+}
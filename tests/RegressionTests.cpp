@@ -0,0 +1,1071 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <future>
+#include <cstdio>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#include "../AffineTransform.h"
+#include "../DisplayList.h"
+#include "../Image.h"
+#include "../ImagePool.h"
+#include "../ImagePyramid.h"
+#include "../PixelKernels.h"
+#include "../IntegralImage.h"
+#include "../RecognitionClient.h"
+#include "../RecognitionServer.h"
+#include "../RleImage.h"
+#include "../ShapeList.h"
+#include "../ShapeTracker.h"
+#include "../ShapeTree.h"
+#include "../Shapes.h"
+#include "../SpanCompositor.h"
+
+
+static int failedChecks = 0;
+
+// Counts and reports the failed check of the given condition (and goes on with the test).
+#define CHECK(condition) \
+    do \
+    { \
+        if (!(condition)) \
+        { \
+            std::printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            failedChecks++; \
+        } \
+    } while (false)
+
+// Returns the given shape as text: its kind, color and vertices.
+static std::string describeShape(const Shape &shape)
+{
+    static const char KINDS[] = {'P', 'T', 'R', 'C'};
+    std::ostringstream text;
+    text << KINDS[(int) shape.getType()] << (int) shape.getColor();
+    for (int i = 0; i < shape.getVerticesSize(); ++i)
+    {
+        text << "(" << shape.getVertices()[i].x << "," << shape.getVertices()[i].y << ")";
+    }
+    return text.str();
+}
+
+// Returns the given shapes as sorted text (see describeShape) and frees them.
+static std::vector<std::string> describeShapes(Shape **shapes, int size)
+{
+    std::vector<std::string> texts;
+    for (int i = 0; i < size; ++i)
+    {
+        texts.push_back(describeShape(*shapes[i]));
+    }
+    Shape::freeShapesArray(shapes, size);
+    std::sort(texts.begin(), texts.end());
+    return texts;
+}
+
+// Returns the rectangles (with the triangles in them) of the given image as sorted text, found the way the first
+// recognizer did: a rectangle at each shape pixel in raster order, erased once it was found.
+static std::vector<std::string> recognizeRectanglesOneByOne(const Image &img)
+{
+    Image tempImg(img);
+    std::vector<std::string> texts;
+    for (int y = 0; y < tempImg.getHeight(); ++y)
+    {
+        for (int x = 0; x < tempImg.getWidth(); ++x)
+        {
+            if (tempImg.getPixel(x, y) == 0)
+            {
+                continue;
+            }
+            Rectangle *rectangle = nullptr;
+            Triangle *triangle = nullptr;
+            if (Rectangle::recognizeRectangleWithTriangle(tempImg, Vector2(x, y), &rectangle, &triangle))
+            {
+                texts.push_back(describeShape(*triangle));
+                delete triangle;
+            }
+            texts.push_back(describeShape(*rectangle));
+            Rectangle(rectangle->getVertices()[0], rectangle->getVertices()[2], 0).draw(tempImg);
+            delete rectangle;
+        }
+    }
+    std::sort(texts.begin(), texts.end());
+    return texts;
+}
+
+// A rectangle whose border its triangle touches is still found as the rectangle and its triangle.
+static void testRectangleWithTouchingTriangle()
+{
+    Image small(9, 9);
+    Rectangle(Vector2(6, 6), Vector2(8, 8), 102).draw(small);
+    Triangle(Vector2(6, 7), Vector2(8, 8), Vector2(6, 8), 31).draw(small);
+    int arrSize;
+    Shape **shapes = Shape::getRectanglesFromImage(small, arrSize);
+    std::vector<std::string> found = describeShapes(shapes, arrSize);
+    CHECK(found == std::vector<std::string>({"R102(6,6)(8,6)(8,8)(6,8)"}));
+
+    Image large(28, 28);
+    Rectangle rectangle(Vector2(9, 18), Vector2(27, 22), 208);
+    Triangle triangle(Vector2(18, 18), Vector2(23, 21), Vector2(9, 21), 248);
+    rectangle.draw(large);
+    triangle.draw(large);
+    shapes = Shape::getRectanglesAndTrianglesFromImage(large, arrSize);
+    found = describeShapes(shapes, arrSize);
+    std::vector<std::string> expected = {describeShape(rectangle), describeShape(triangle)};
+    std::sort(expected.begin(), expected.end());
+    CHECK(found == expected);
+}
+
+// Draws a random rectangle to the given (blank) image, and a random triangle somewhere in it that may touch its border.
+// Sets rectangle to the rectangle. Returns true if the triangle was drawn. Otherwise (the rectangle is too small for
+// it), returns false.
+static bool drawRectangleWithTriangle(std::mt19937 &random, Image &img, Rectangle &rectangle)
+{
+    int size = img.getWidth();
+    int x0 = (int) (random() % (size - 3)), y0 = (int) (random() % (size - 3));
+    int x1 = x0 + 2 + (int) (random() % (size - x0 - 2)), y1 = y0 + 2 + (int) (random() % (size - y0 - 2));
+    rectangle = Rectangle(Vector2(x0, y0), Vector2(x1, y1), (unsigned char) (1 + random() % 120));
+    rectangle.draw(img);
+
+    int width = x1 - x0, height = y1 - y0;
+    int half = 1 + (int) (random() % std::max(1, std::min(width / 2, height)));
+    if (2 * half > width || half > height)
+    {
+        return false;
+    }
+    int x = x0 + (int) (random() % (width - 2 * half + 1)), y = y0 + (int) (random() % (height - half + 1));
+    auto color = (unsigned char) (121 + random() % 120);
+    if (random() % 2 == 0)
+    {
+        Triangle(Vector2(x + half, y), Vector2(x + 2 * half, y + half), Vector2(x, y + half), color).draw(img);
+    }
+    else
+    {
+        Triangle(Vector2(x, y), Vector2(x + 2 * half, y), Vector2(x + half, y + half), color).draw(img);
+    }
+    return true;
+}
+
+// The scan finds the same rectangles and triangles as the first recognizer did, wherever the triangle is in its
+// rectangle.
+static void testRectanglesAndTrianglesMatchFirstRecognizer()
+{
+    for (unsigned int seed = 0; seed < 3000; ++seed)
+    {
+        std::mt19937 random(seed);
+        int size = 8 + (int) (random() % 40);
+        Image img(size, size);
+        Rectangle rectangle;
+        drawRectangleWithTriangle(random, img, rectangle);
+
+        int arrSize;
+        Shape **shapes = Shape::getRectanglesAndTrianglesFromImage(img, arrSize);
+        CHECK(describeShapes(shapes, arrSize) == recognizeRectanglesOneByOne(img));
+    }
+}
+
+// Returns true if the given images have the same size and pixels. Otherwise, returns false.
+static bool isSameImage(const Image &img, const Image &otherImage)
+{
+    return img.getHeight() == otherImage.getHeight() && img.getWidth() == otherImage.getWidth() &&
+           img.compare(otherImage).isEqual();
+}
+
+// The tree holds every rectangle and the triangle in it, also when the triangle touches the rectangle's border, and
+// draws the image back.
+static void testShapeTreeOfNestedShapes()
+{
+    for (unsigned int seed = 0; seed < 3000; ++seed)
+    {
+        std::mt19937 random(seed);
+        int size = 8 + (int) (random() % 40);
+        Image img(size, size);
+        Rectangle rectangle;
+        bool hasTriangle = drawRectangleWithTriangle(random, img, rectangle);
+
+        ShapeTree tree(img);
+        Image redrawn(size, size);
+        tree.draw(redrawn);
+        CHECK(isSameImage(img, redrawn));
+
+        // A triangle that covers the rectangle's top-left pixel comes first in raster order, so it can't be a child.
+        if (img.getPixel(rectangle.getVertices()[0]) == rectangle.getColor())
+        {
+            CHECK(tree.getSize() == (hasTriangle ? 2 : 1));
+            CHECK(describeShape(tree.getShape(0)) == describeShape(rectangle));
+            CHECK(!hasTriangle || tree.getParent(1) == 0);
+        }
+    }
+
+    // Rectangles in rectangles, each touching its parent's border, with a triangle in the innermost one.
+    Image img(40, 40);
+    Rectangle(Vector2(2, 2), Vector2(37, 37), 10).draw(img);
+    Rectangle(Vector2(2, 10), Vector2(20, 37), 20).draw(img);
+    Rectangle(Vector2(5, 20), Vector2(20, 30), 30).draw(img);
+    Triangle(Vector2(8, 24), Vector2(11, 27), Vector2(5, 27), 40).draw(img);
+    ShapeTree tree(img);
+    Image redrawn(40, 40);
+    tree.draw(redrawn);
+    CHECK(isSameImage(img, redrawn));
+    CHECK(tree.getSize() == 4);
+    for (int i = 0; i < tree.getSize(); ++i)
+    {
+        CHECK(tree.getDepth(i) == i && tree.getParent(i) == i - 1);
+    }
+}
+
+// The scan with an integral image finds the same shapes as the plain scan, also when the shapes overlap (so the scan
+// erases pixels that the integral image still has).
+static void testIntegralImageScanMatchesPlainScan()
+{
+    for (unsigned int seed = 0; seed < 3000; ++seed)
+    {
+        std::mt19937 random(seed);
+        int size = 8 + (int) (random() % 40);
+        Image img(size, size);
+        int count = 1 + (int) (random() % 4);
+        for (int i = 0; i < count; ++i)
+        {
+            Rectangle rectangle;
+            drawRectangleWithTriangle(random, img, rectangle);
+        }
+
+        int arrSize;
+        Shape **shapes = Shape::getRectanglesAndTrianglesFromImage(img, arrSize);
+        std::vector<std::string> plain = describeShapes(shapes, arrSize);
+        shapes = Shape::getRectanglesAndTrianglesFromImage(img, IntegralImage(img), arrSize);
+        CHECK(describeShapes(shapes, arrSize) == plain);
+
+        std::vector<std::string> visited;
+        Shape::visitRectanglesAndTrianglesInImage(img, IntegralImage(img), [&](const Shape &shape)
+        {
+            visited.push_back(describeShape(shape));
+            return true;
+        });
+        std::sort(visited.begin(), visited.end());
+        CHECK(visited == plain);
+    }
+}
+
+// The pyramid's cells are the OR of their blocks, its shape regions split no touching pixels and miss none, and the
+// scan by region finds the same shapes as the plain scan, on images of any size with few small shapes.
+static void testPyramidMatchesPlainScan()
+{
+    for (unsigned int seed = 0; seed < 500; ++seed)
+    {
+        std::mt19937 random(seed);
+        int height = 1 + (int) (random() % 90), width = 1 + (int) (random() % 90);
+        Image img(height, width);
+        int count = (int) (random() % 8);
+        for (int i = 0; i < count; ++i)
+        {
+            int x = (int) (random() % width), y = (int) (random() % height);
+            int x1 = std::min(width - 1, x + (int) (random() % 16));
+            int y1 = std::min(height - 1, y + (int) (random() % 16));
+            Rectangle(Vector2(x, y), Vector2(x1, y1), (unsigned char) (1 + random() % 120)).draw(img);
+            if (x1 - x >= 4 && y1 - y >= 2)
+            {
+                Triangle(Vector2(x + 2, y + 1), Vector2(x1, y1), Vector2(x, y1), (unsigned char) (121 + random() % 120))
+                        .draw(img);
+            }
+        }
+
+        ImagePyramid pyramid(img);
+        bool isExact = true;
+        for (int level = 0; level < pyramid.getLevelCount(); ++level)
+        {
+            int cellSize = pyramid.getCellSize(level);
+            for (int cellY = 0; cellY < pyramid.getLevelHeight(level); ++cellY)
+            {
+                for (int cellX = 0; cellX < pyramid.getLevelWidth(level); ++cellX)
+                {
+                    unsigned char bits = 0;
+                    for (int y = cellY * cellSize; y < std::min(height, (cellY + 1) * cellSize); ++y)
+                    {
+                        for (int x = cellX * cellSize; x < std::min(width, (cellX + 1) * cellSize); ++x)
+                        {
+                            bits |= img.getPixel(x, y);
+                        }
+                    }
+                    isExact = isExact && pyramid.getCell(level, cellX, cellY) == bits;
+                }
+            }
+        }
+        CHECK(isExact);
+
+        // Every non-zero pixel is in exactly one region, and so are the non-zero pixels around it.
+        std::vector<int> regionOf((size_t) height * width, -1);
+        const std::vector<ImageRegion> &regions = pyramid.getShapeRegions();
+        for (int i = 0; i < (int) regions.size(); ++i)
+        {
+            for (int y = regions[i].topLeft.y; y <= regions[i].bottomRight.y; ++y)
+            {
+                for (int x = regions[i].topLeft.x; x <= regions[i].bottomRight.x; ++x)
+                {
+                    isExact = isExact && regionOf[(size_t) y * width + x] == -1;
+                    regionOf[(size_t) y * width + x] = i;
+                }
+            }
+        }
+        for (int y = 0; y < height; ++y)
+        {
+            for (int x = 0; x < width; ++x)
+            {
+                if (img.getPixel(x, y) == 0)
+                {
+                    continue;
+                }
+                int region = regionOf[(size_t) y * width + x];
+                isExact = isExact && region != -1;
+                for (int aroundY = std::max(0, y - 1); aroundY <= std::min(height - 1, y + 1); ++aroundY)
+                {
+                    for (int aroundX = std::max(0, x - 1); aroundX <= std::min(width - 1, x + 1); ++aroundX)
+                    {
+                        isExact = isExact && (img.getPixel(aroundX, aroundY) == 0 ||
+                                              regionOf[(size_t) aroundY * width + aroundX] == region);
+                    }
+                }
+            }
+        }
+        CHECK(isExact);
+
+        int arrSize;
+        Shape **shapes = Shape::getRectanglesAndTrianglesFromImage(img, arrSize);
+        std::vector<std::string> plain = describeShapes(shapes, arrSize);
+        shapes = Shape::getRectanglesAndTrianglesFromImage(img, pyramid, arrSize);
+        CHECK(describeShapes(shapes, arrSize) == plain);
+        shapes = Shape::getRectanglesFromImage(img, arrSize);
+        plain = describeShapes(shapes, arrSize);
+        shapes = Shape::getRectanglesFromImage(img, pyramid, arrSize);
+        CHECK(describeShapes(shapes, arrSize) == plain);
+    }
+}
+
+// Returns the shapes that the plain scans of the given image (as is and run-length encoded) find, as sorted text, if
+// they agree. Otherwise, returns an empty vector.
+static std::vector<std::string> recognizeInBothImages(const Image &img)
+{
+    int arrSize;
+    Shape **shapes = Shape::getRectanglesAndTrianglesFromImage(img, arrSize);
+    std::vector<std::string> found = describeShapes(shapes, arrSize);
+    shapes = Shape::getRectanglesAndTrianglesFromImage(RleImage(img), arrSize);
+    return describeShapes(shapes, arrSize) == found ? found : std::vector<std::string>();
+}
+
+// A drawn circle of any radius (but 0, a single pixel) is recognized as itself, next to a rectangle and anywhere in
+// the image, also touching its border.
+static void testCircleRoundTrip()
+{
+    for (unsigned int seed = 0; seed < 1000; ++seed)
+    {
+        std::mt19937 random(seed);
+        int radius = 1 + (int) (random() % 40);
+        int size = 2 * radius + 1 + (int) (random() % 30);
+        Circle circle(Vector2(radius + (int) (random() % (size - 2 * radius)),
+                              radius + (int) (random() % (size - 2 * radius))), radius,
+                      (unsigned char) (1 + random() % 255));
+        Image img(size, size + 6);
+        circle.draw(img);
+        Rectangle rectangle(Vector2(size + 2, 0), Vector2(size + 5, (int) (random() % size)), 9);
+        rectangle.draw(img);
+
+        std::vector<std::string> expected = {describeShape(circle), describeShape(rectangle)};
+        std::sort(expected.begin(), expected.end());
+        CHECK(recognizeInBothImages(img) == expected);
+    }
+}
+
+// Returns the convex hull of the given points in clockwise order (on the screen, y down), without collinear vertices.
+static std::vector<Vector2> getClockwiseHull(std::vector<Vector2> points)
+{
+    std::sort(points.begin(), points.end(), [](const Vector2 &point, const Vector2 &otherPoint)
+    {
+        return point.x != otherPoint.x ? point.x < otherPoint.x : point.y < otherPoint.y;
+    });
+    auto turn = [](const Vector2 &a, const Vector2 &b, const Vector2 &c)
+    {
+        return (long long) (b.x - a.x) * (c.y - a.y) - (long long) (b.y - a.y) * (c.x - a.x);
+    };
+    std::vector<Vector2> hull;
+    for (int pass = 0; pass < 2; ++pass)
+    {
+        size_t start = hull.size();
+        for (const Vector2 &point : points)
+        {
+            while (hull.size() >= start + 2 && turn(hull[hull.size() - 2], hull.back(), point) <= 0)
+            {
+                hull.pop_back();
+            }
+            hull.push_back(point);
+        }
+        hull.pop_back();
+        std::reverse(points.begin(), points.end());
+    }
+    return hull;
+}
+
+// Returns true if the given spans (one per row, sorted by row) are of rows in a row, each overlapping the one above
+// it, so they are a single blob. Otherwise (a thin part of the shape broke up), returns false.
+static bool isSingleBlob(const std::vector<Span> &spans)
+{
+    for (size_t i = 1; i < spans.size(); ++i)
+    {
+        if (spans[i].y != spans[i - 1].y + 1 || spans[i].xEnd < spans[i - 1].xStart ||
+            spans[i - 1].xEnd < spans[i].xStart)
+        {
+            return false;
+        }
+    }
+    return !spans.empty();
+}
+
+// A drawn convex polygon that is a single blob is recognized as a single shape of its color that draws the same
+// pixels, by the plain and the run-length scans alike.
+static void testPolygonRoundTrip()
+{
+    int polygons = 0;
+    for (unsigned int seed = 0; seed < 1000; ++seed)
+    {
+        std::mt19937 random(seed);
+        int size = 8 + (int) (random() % 60);
+        std::vector<Vector2> points;
+        int count = 3 + (int) (random() % 8);
+        for (int i = 0; i < count; ++i)
+        {
+            points.push_back(Vector2((int) (random() % size), (int) (random() % size)));
+        }
+        std::vector<Vector2> hull = getClockwiseHull(points);
+        if (hull.size() < 3)
+        {
+            continue;
+        }
+        Polygon polygon(hull, (unsigned char) (1 + random() % 255));
+        std::vector<Span> spans;
+        polygon.getSpans(spans);
+        if (!isSingleBlob(spans))
+        {
+            continue;
+        }
+        Image img(size, size);
+        polygon.draw(img);
+
+        int arrSize;
+        Shape **shapes = Shape::getRectanglesAndTrianglesFromImage(img, arrSize);
+        CHECK(arrSize == 1 && shapes[0]->getColor() == polygon.getColor());
+        Image redrawn(size, size);
+        Shape::drawShapesToImage(redrawn, const_cast<const Shape **>(shapes), arrSize);
+        CHECK(isSameImage(img, redrawn));
+        polygons += arrSize == 1 && shapes[0]->getType() == ShapeType::POLYGON;
+        std::vector<std::string> found = describeShapes(shapes, arrSize);
+        CHECK(recognizeInBothImages(img) == found);
+    }
+    CHECK(polygons > 300);
+}
+
+// A render request with shapes that are far out of the image (or otherwise can't be drawn) fails on its own, and the
+// server keeps answering.
+static void testServerSurvivesMalformedRenders()
+{
+    std::string socketPath = "/tmp/polytest-tests-" + std::to_string(getpid()) + ".sock";
+    RecognitionServer server(socketPath.c_str(), 1);
+    std::thread serverThread(&RecognitionServer::run, &server);
+    {
+        RecognitionClient client(socketPath.c_str());
+        Triangle tall(Vector2(5, -1000000000), Vector2(9, 1000000000), Vector2(0, 1000000000), 10);
+        Circle huge(Vector2(5, 5), 2000000000, 10);
+        Rectangle outside(Vector2(-3, 2), Vector2(4, 6), 10);
+        Circle negative(Vector2(5, 5), -5, 10);
+        const Shape *malformed[] = {&tall, &huge, &outside, &negative};
+        for (const Shape *shape : malformed)
+        {
+            uint32_t id = client.sendRender(10, 10, 0, &shape, 1);
+            RecognitionClient::Response response = client.receive();
+            CHECK(response.getId() == id);
+            CHECK(response.getStatus() == ResponseStatus::BAD_REQUEST);
+        }
+
+        Rectangle inside(Vector2(2, 2), Vector2(4, 6), 10);
+        const Shape *valid = &inside;
+        Image img = client.render(10, 10, 0, &valid, 1);
+        CHECK(img.getPixel(3, 4) == 10 && img.getPixel(5, 4) == 0);
+    }
+    server.stop();
+    serverThread.join();
+}
+
+// Returns true if a view of the list of the given shape throws ShapeFormatException. Otherwise, returns false.
+static bool isRejectedByView(const Shape &shape)
+{
+    const Shape *shapes[] = {&shape};
+    std::vector<unsigned char> buffer;
+    ShapeListView::serialize(shapes, 1, buffer);
+    try
+    {
+        ShapeListView view(buffer.data(), buffer.size());
+        return false;
+    }
+    catch (const ShapeFormatException &)
+    {
+        return true;
+    }
+}
+
+// A shape list view only holds shapes whose coordinates and radii are in range.
+static void testShapeListViewRanges()
+{
+    const int32_t max = ShapeListView::MAX_COORDINATE;
+    CHECK(isRejectedByView(Circle(Vector2(5, 5), -5, 10)));
+    CHECK(isRejectedByView(Circle(Vector2(5, 5), max + 1, 10)));
+    CHECK(isRejectedByView(Triangle(Vector2(0, -max - 1), Vector2(5, 5), Vector2(0, 5), 10)));
+    CHECK(isRejectedByView(Rectangle(Vector2(0, 0), Vector2(max + 1, 5), 10)));
+    CHECK(!isRejectedByView(Circle(Vector2(-max, max), max, 10)));
+    CHECK(!isRejectedByView(Triangle(Vector2(0, -max), Vector2(max, max), Vector2(-max, max), 10)));
+}
+
+// The spans of a shape of a valid list that spans the whole coordinate range are exact (the edge terms don't overflow).
+static void testMaxRangeShapeSpans()
+{
+    const int32_t max = ShapeListView::MAX_COORDINATE;
+    Triangle triangle(Vector2(max, max), Vector2(-max, max), Vector2(0, 0), 10);
+    CHECK(!isRejectedByView(triangle));
+    std::vector<Span> spans;
+    triangle.getSpans(spans);
+    CHECK(spans.size() == (size_t) max + 1);
+    bool isExact = true;
+    for (size_t i = 0; i < spans.size(); ++i)
+    {
+        isExact = isExact && spans[i].y == (int) i && spans[i].xStart == -(int) i && spans[i].xEnd == (int) i;
+    }
+    CHECK(isExact);
+
+    // A flat one, whose edges are long but whose rows are few.
+    Triangle wide(Vector2(max, 0), Vector2(max, 7), Vector2(-max, 7), 10);
+    spans.clear();
+    wide.getSpans(spans);
+    CHECK(spans.size() == 8 && spans.back().xStart == -max && spans.back().xEnd == max);
+}
+
+// Closing a pool takes back the buffers that other (still running) threads keep in their caches.
+static void testPoolCloseFlushesThreadCaches()
+{
+    auto storage = std::make_shared<ImagePoolStorage>(64, false);
+    std::promise<void> released, closed;
+    std::thread releasingThread([&]()
+    {
+        storage->releaseBuffer(storage->acquireBuffer());
+        released.set_value();
+        closed.get_future().wait();
+    });
+    released.get_future().wait();
+    CHECK(storage.use_count() == 2);
+    storage->close();
+    CHECK(storage.use_count() == 1);
+    closed.set_value();
+    releasingThread.join();
+
+    ImagePool pool(16, 16);
+    Image img = pool.acquire(7);
+    CHECK(img.getPixel(15, 15) == 7);
+}
+
+// Returns the shapes of the tracker's current frame as sorted text (see describeShape).
+static std::vector<std::string> describeTrackedShapes(const ShapeTracker &tracker)
+{
+    std::vector<std::string> texts;
+    for (int i = 0; i < tracker.getSize(); ++i)
+    {
+        texts.push_back(describeShape(tracker.getShape(i)));
+    }
+    std::sort(texts.begin(), texts.end());
+    return texts;
+}
+
+// The tracker has the shapes that a scan of the whole frame finds, also when overlapping rectangles leave holes
+// (background colored triangles) that reach out of the scanned regions.
+static void testTrackerMatchesWholeFrameScan()
+{
+    const int size = 300, count = 40;
+    for (unsigned int seed = 0; seed < 4; ++seed)
+    {
+        std::mt19937 random(seed);
+        std::vector<Rectangle> rectangles;
+        for (int i = 0; i < count; ++i)
+        {
+            int x = (int) (random() % (size - 130)), y = (int) (random() % (size - 130));
+            rectangles.push_back(Rectangle(Vector2(x, y), Vector2(x + 10 + (int) (random() % 120),
+                                                                 y + 10 + (int) (random() % 120)),
+                                           (unsigned char) (1 + random() % 255)));
+        }
+
+        // Each frame moves one rectangle a little, so only the regions around it are scanned again.
+        ShapeTracker tracker(true);
+        for (int frameIndex = 0; frameIndex < 100; ++frameIndex)
+        {
+            Rectangle &moved = rectangles[random() % count];
+            const Vector2 *vertices = moved.getVertices();
+            int dx = (int) (random() % 41) - 20, dy = (int) (random() % 41) - 20;
+            dx = std::max(-vertices[0].x, std::min(size - 1 - vertices[2].x, dx));
+            dy = std::max(-vertices[0].y, std::min(size - 1 - vertices[2].y, dy));
+            moved = Rectangle(Vector2(vertices[0].x + dx, vertices[0].y + dy),
+                              Vector2(vertices[2].x + dx, vertices[2].y + dy), moved.getColor());
+
+            Image frame(size, size);
+            for (const Rectangle &rectangle : rectangles)
+            {
+                rectangle.draw(frame);
+            }
+            tracker.update(frame);
+            int arrSize;
+            Shape **shapes = Shape::getRectanglesAndTrianglesFromImage(frame, arrSize);
+            CHECK(describeTrackedShapes(tracker) == describeShapes(shapes, arrSize));
+        }
+    }
+}
+
+// Returns true if the given blend of runs of random pixels, of each start and end (also in the middle of a word),
+// changes only those pixels, to within tolerance of the given reference of each pixel. Otherwise, returns false.
+template<class Blend, class Reference>
+static bool isBlendOfRunsLikeReference(std::mt19937 &random, Blend blend, Reference reference, int tolerance)
+{
+    std::vector<unsigned char> pixels(40), blended;
+    for (int start = 0; start < 16; ++start)
+    {
+        for (int length = 0; start + length <= (int) pixels.size(); ++length)
+        {
+            for (unsigned char &pixel : pixels)
+            {
+                pixel = (unsigned char) random();
+            }
+            blended = pixels;
+            blend(blended.data() + start, length);
+            for (int i = 0; i < (int) pixels.size(); ++i)
+            {
+                bool isInRun = i >= start && i < start + length;
+                if (std::abs(blended[i] - (isInRun ? reference(pixels[i]) : pixels[i])) > (isInRun ? tolerance : 0))
+                {
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+// Returns true if the given blend of a run of every pixel value gives each one within tolerance of the given
+// reference of it. Otherwise, returns false.
+template<class Blend, class Reference>
+static bool isBlendOfEveryPixelLikeReference(Blend blend, Reference reference, int tolerance)
+{
+    unsigned char pixels[256];
+    for (int i = 0; i < 256; ++i)
+    {
+        pixels[i] = (unsigned char) i;
+    }
+    blend(pixels, 256);
+    for (int i = 0; i < 256; ++i)
+    {
+        if (std::abs(pixels[i] - reference(i)) > tolerance)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Returns the exact blend of the given value over the given pixel with the given opacity, rounded.
+static int blendAlphaExactly(int pixel, int value, int alpha)
+{
+    return (int) std::floor(pixel + (value - pixel) * alpha / 255.0 + 0.5);
+}
+
+// The word at a time blend kernels give the pixels of the pixel at a time formulas (alpha within 1 of the exact blend,
+// and exact at opacity 0 and 255) for every pixel, value and opacity, and leave the pixels around the blended run as
+// they were wherever it starts and ends.
+static void testBlendKernelsMatchScalarReference()
+{
+    typedef PixelKernels<unsigned char> Kernels;
+    bool isAddExact = true, isMaxExact = true, isAlphaClose = true;
+    for (int value = 0; value < 256; ++value)
+    {
+        auto color = (unsigned char) value;
+        isAddExact = isAddExact && isBlendOfEveryPixelLikeReference([&](unsigned char *pixels, int length)
+        {
+            Kernels::blendAdd(pixels, length, color);
+        }, [&](int pixel)
+        {
+            return std::min(255, pixel + value);
+        }, 0);
+        isMaxExact = isMaxExact && isBlendOfEveryPixelLikeReference([&](unsigned char *pixels, int length)
+        {
+            Kernels::blendMax(pixels, length, color);
+        }, [&](int pixel)
+        {
+            return std::max(pixel, value);
+        }, 0);
+        for (int alpha = 0; alpha < 256; ++alpha)
+        {
+            isAlphaClose = isAlphaClose && isBlendOfEveryPixelLikeReference([&](unsigned char *pixels, int length)
+            {
+                Kernels::blendAlpha(pixels, length, color, (unsigned char) alpha);
+            }, [&](int pixel)
+            {
+                return blendAlphaExactly(pixel, value, alpha);
+            }, alpha == 0 || alpha == 255 ? 0 : 1);
+        }
+    }
+
+    std::mt19937 random(11);
+    for (int trial = 0; trial < 32; ++trial)
+    {
+        auto color = (unsigned char) random();
+        int alpha = trial < 2 ? 255 * trial : (int) (random() % 256);
+        isAddExact = isAddExact && isBlendOfRunsLikeReference(random, [&](unsigned char *pixels, int length)
+        {
+            Kernels::blendAdd(pixels, length, color);
+        }, [&](int pixel)
+        {
+            return std::min(255, pixel + color);
+        }, 0);
+        isMaxExact = isMaxExact && isBlendOfRunsLikeReference(random, [&](unsigned char *pixels, int length)
+        {
+            Kernels::blendMax(pixels, length, color);
+        }, [&](int pixel)
+        {
+            return std::max(pixel, (int) color);
+        }, 0);
+        isAlphaClose = isAlphaClose && isBlendOfRunsLikeReference(random, [&](unsigned char *pixels, int length)
+        {
+            Kernels::blendAlpha(pixels, length, color, (unsigned char) alpha);
+        }, [&](int pixel)
+        {
+            return blendAlphaExactly(pixel, color, alpha);
+        }, alpha == 0 || alpha == 255 ? 0 : 1);
+    }
+    CHECK(isAddExact);
+    CHECK(isMaxExact);
+    CHECK(isAlphaClose);
+}
+
+// Returns true if drawing the given shapes with culling throws ImageDimException and leaves the image blank.
+// Otherwise, returns false.
+static bool isRejectedByCulling(const Shape *first, const Shape *second)
+{
+    Image img(10, 10);
+    const Shape *shapes[] = {first, second};
+    try
+    {
+        Shape::drawShapesToImage(img, shapes, 2, true);
+        return false;
+    }
+    catch (const ImageDimException &)
+    {
+        return isSameImage(img, Image(10, 10));
+    }
+}
+
+// Culling rejects shapes that are out of the image the same way on both axes, covered or not, before drawing any.
+static void testCullingRejectsOutOfBoundsShapes()
+{
+    Rectangle inside(Vector2(0, 0), Vector2(9, 9), 10);
+    Rectangle left(Vector2(-3, 2), Vector2(4, 6), 20), above(Vector2(2, -3), Vector2(6, 4), 20);
+    Rectangle wide(Vector2(-3, 0), Vector2(12, 9), 30), tall(Vector2(0, -3), Vector2(9, 12), 30);
+    CHECK(isRejectedByCulling(&inside, &left));
+    CHECK(isRejectedByCulling(&inside, &above));
+    CHECK(isRejectedByCulling(&left, &inside));
+    CHECK(isRejectedByCulling(&above, &inside));
+    CHECK(isRejectedByCulling(&left, &wide));
+    CHECK(isRejectedByCulling(&above, &tall));
+}
+
+// Returns a random rectangle, triangle or circle that is inside an image of the given size (freed by the caller).
+static Shape *newRandomShape(std::mt19937 &random, int size)
+{
+    auto color = (unsigned char) (1 + random() % 255);
+    int x = (int) (random() % (size - 1)), y = (int) (random() % (size - 1));
+    int x1 = x + (int) (random() % (size - x)), y1 = y + (int) (random() % (size - y));
+    switch (random() % 3)
+    {
+        case 0:
+            return new Rectangle(Vector2(x, y), Vector2(x1, y1), color);
+        case 1:
+            return new Triangle(Vector2(x, y), Vector2(x1, y1), Vector2((int) (random() % size), y1), color);
+        default:
+        {
+            int radius = std::min(std::min(x, y), std::min(size - 1 - x, size - 1 - y));
+            return new Circle(Vector2(x, y), (int) (random() % (radius + 1)), color);
+        }
+    }
+}
+
+// The compositor writes the same pixels as drawing every shape in order, in both layouts, leaving the pixels that no
+// shape covers as they were and writing each covered pixel once.
+static void testCompositorMatchesPainterOrder()
+{
+    for (unsigned int seed = 0; seed < 1000; ++seed)
+    {
+        std::mt19937 random(seed);
+        int size = 4 + (int) (random() % 60);
+        std::vector<Shape *> shapes;
+        int count = 1 + (int) (random() % 12);
+        for (int i = 0; i < count; ++i)
+        {
+            shapes.push_back(newRandomShape(random, size));
+        }
+
+        const Shape **drawn = const_cast<const Shape **>(shapes.data());
+        Image covered(size, size);
+        Shape::drawShapesToImage(covered, drawn, count);
+        long coveredPixels = 0;
+        for (int y = 0; y < size; ++y)
+        {
+            for (int x = 0; x < size; ++x)
+            {
+                coveredPixels += covered.getPixel(x, y) != 0;
+            }
+        }
+
+        for (ImageLayout layout : {ImageLayout::ROW_MAJOR, ImageLayout::TILED})
+        {
+            Image painted(size, size, 7, layout), composited(size, size, 7, layout);
+            Shape::drawShapesToImage(painted, drawn, count);
+            SpanCompositor compositor(size, size);
+            compositor.add(drawn, count);
+            compositor.flush(composited);
+            CHECK(isSameImage(painted, composited));
+            CHECK(compositor.getWrittenPixels() == coveredPixels);
+        }
+        for (Shape *shape : shapes)
+        {
+            delete shape;
+        }
+    }
+}
+
+// Drawing with culling gives the same image as drawing every shape in order, and culls the covered shapes.
+static void testCullingMatchesPainterOrder()
+{
+    int culledShapes = 0;
+    for (unsigned int seed = 0; seed < 1000; ++seed)
+    {
+        std::mt19937 random(seed);
+        int size = 4 + (int) (random() % 60);
+        std::vector<Shape *> shapes;
+        int count = 1 + (int) (random() % 12);
+        for (int i = 0; i < count; ++i)
+        {
+            shapes.push_back(newRandomShape(random, size));
+        }
+
+        const Shape **drawn = const_cast<const Shape **>(shapes.data());
+        Image painted(size, size), culled(size, size);
+        Shape::drawShapesToImage(painted, drawn, count);
+        DrawStats stats = Shape::drawShapesToImage(culled, drawn, count, true);
+        CHECK(isSameImage(painted, culled));
+        CHECK(stats.drawnShapes + stats.culledShapes == count);
+        culledShapes += stats.culledShapes;
+        for (Shape *shape : shapes)
+        {
+            delete shape;
+        }
+    }
+    CHECK(culledShapes > 0);
+}
+
+// Returns true if the given transform then the other one throws TransformRangeException. Otherwise, returns false.
+static bool isRejectedComposition(const AffineTransform &transform, const AffineTransform &next)
+{
+    try
+    {
+        transform.then(next);
+        return false;
+    }
+    catch (const TransformRangeException &)
+    {
+        return true;
+    }
+}
+
+// Composed transforms move points as applying them one by one does, and those whose offset is out of range are
+// rejected instead of overflowing.
+static void testAffineTransformComposition()
+{
+    AffineTransform far = AffineTransform::translation(1 << 30, -(1 << 30));
+    CHECK(isRejectedComposition(far, AffineTransform::scaling(16384, 16384)));
+    CHECK(isRejectedComposition(far, AffineTransform::translation(1 << 30, 0).then(far)));
+    CHECK(!isRejectedComposition(far, AffineTransform::scaling(-2, 2)));
+
+    AffineTransform composed = AffineTransform::translation(1000, -300).then(AffineTransform::rotation(0.5))
+            .then(AffineTransform::scaling(3, -1.5)).then(AffineTransform::translation(-20, 7));
+    Vector2 point = AffineTransform::translation(-20, 7).apply(AffineTransform::scaling(3, -1.5).apply(
+            AffineTransform::rotation(0.5).apply(AffineTransform::translation(1000, -300).apply(Vector2(40, 25)))));
+    Vector2 composedPoint = composed.apply(Vector2(40, 25));
+    CHECK(std::abs(composedPoint.x - point.x) <= 2 && std::abs(composedPoint.y - point.y) <= 2);
+}
+
+// Returns true if the given action throws TransformRangeException. Otherwise, returns false.
+template<class Action>
+static bool throwsTransformRange(Action action)
+{
+    try
+    {
+        action();
+        return false;
+    }
+    catch (const TransformRangeException &)
+    {
+        return true;
+    }
+}
+
+// Transformed points and radii that don't fit in an int are rejected instead of wrapping, and a batch isn't changed by
+// a transform that takes its shapes out of the coordinate range.
+static void testAffineTransformResultRange()
+{
+    AffineTransform huge = AffineTransform::scaling(30000, 30000);
+    CHECK(throwsTransformRange([&]()
+    {
+        huge.apply(Vector2(1 << 20, 0));
+    }));
+    CHECK(throwsTransformRange([&]()
+    {
+        int32_t xs[] = {0, 1 << 20, 5}, ys[] = {0, 0, 5};
+        huge.apply(xs, ys, xs, ys, 3);
+    }));
+    CHECK(throwsTransformRange([&]()
+    {
+        huge.applyToRadius(1 << 20);
+    }));
+    CHECK(huge.apply(Vector2(3, -2)).x == 90000 && huge.apply(Vector2(3, -2)).y == -60000);
+
+    Rectangle rectangle(Vector2(2, 2), Vector2(6, 5), 10);
+    Circle circle(Vector2(20, 20), 5, 20);
+    const Shape *shapes[] = {&rectangle, &circle};
+    std::vector<unsigned char> buffer;
+    ShapeListView::serialize(shapes, 2, buffer);
+    ShapeBatch batch{ShapeListView(buffer.data(), buffer.size())};
+    CHECK(throwsTransformRange([&]()
+    {
+        batch.transform(AffineTransform::translation(1 << 20, 0));
+    }));
+    CHECK(describeShape(*batch.getShapes()[0]) == describeShape(rectangle));
+    CHECK(describeShape(*batch.getShapes()[1]) == describeShape(circle));
+    batch.transform(AffineTransform::translation(3, 4));
+    CHECK(describeShape(*batch.getShapes()[1]) == "C20(23,24)");
+}
+
+// Returns true if the given serialized display list, with the given 4-byte field of its first command set to the
+// given value, is rejected. Otherwise, returns false.
+static bool isRejectedDisplayList(std::vector<unsigned char> buffer, int field, int32_t value)
+{
+    for (int i = 0; i < 4; ++i)
+    {
+        buffer[16 + 4 * field + i] = (unsigned char) ((uint32_t) value >> (8 * i));
+    }
+    try
+    {
+        DisplayList::deserialize(buffer.data(), buffer.size());
+        return false;
+    }
+    catch (const DisplayListFormatException &)
+    {
+        return true;
+    }
+}
+
+// A serialized display list only holds commands of pixels in range, and a valid one replays as the shapes draw.
+static void testDisplayListRanges()
+{
+    Rectangle rectangle(Vector2(2, 3), Vector2(8, 9), 10);
+    DisplayList list;
+    list.record(rectangle);
+    std::vector<unsigned char> buffer;
+    list.serialize(buffer);
+
+    const int32_t max = ShapeListView::MAX_COORDINATE;
+    CHECK(isRejectedDisplayList(buffer, 1, INT32_MIN));
+    CHECK(isRejectedDisplayList(buffer, 0, -1));
+    CHECK(isRejectedDisplayList(buffer, 0, max + 1));
+    CHECK(isRejectedDisplayList(buffer, 2, max + 1));
+    CHECK(isRejectedDisplayList(buffer, 1, 9));
+    CHECK(!isRejectedDisplayList(buffer, 2, 11));
+
+    DisplayList loaded = DisplayList::deserialize(buffer.data(), buffer.size());
+    loaded.optimize();
+    Image replayed(12, 12), drawn(12, 12);
+    loaded.replay(replayed);
+    rectangle.draw(drawn);
+    CHECK(isSameImage(replayed, drawn));
+}
+
+// An optimized display list replays as drawing every shape in order, also when it is recorded to after optimizing and
+// after a serialization round trip.
+static void testOptimizedDisplayListMatchesPainterOrder()
+{
+    for (unsigned int seed = 0; seed < 1000; ++seed)
+    {
+        std::mt19937 random(seed);
+        int size = 4 + (int) (random() % 60);
+        std::vector<Shape *> shapes;
+        int count = 1 + (int) (random() % 12);
+        for (int i = 0; i < count; ++i)
+        {
+            shapes.push_back(newRandomShape(random, size));
+        }
+
+        const Shape **drawn = const_cast<const Shape **>(shapes.data());
+        int optimizedCount = (int) (random() % (count + 1));
+        DisplayList list;
+        list.record(drawn, optimizedCount);
+        list.optimize();
+        list.record(drawn + optimizedCount, count - optimizedCount);
+        list.optimize();
+
+        std::vector<unsigned char> buffer;
+        list.serialize(buffer);
+        DisplayList loaded = DisplayList::deserialize(buffer.data(), buffer.size());
+        Image painted(size, size, 7), replayed(size, size, 7), loadedReplayed(size, size, 7);
+        Shape::drawShapesToImage(painted, drawn, count);
+        list.replay(replayed);
+        loaded.replay(loadedReplayed);
+        CHECK(isSameImage(painted, replayed));
+        CHECK(isSameImage(painted, loadedReplayed));
+        for (Shape *shape : shapes)
+        {
+            delete shape;
+        }
+    }
+}
+
+int main()
+{
+    testRectangleWithTouchingTriangle();
+    testRectanglesAndTrianglesMatchFirstRecognizer();
+    testShapeTreeOfNestedShapes();
+    testIntegralImageScanMatchesPlainScan();
+    testPyramidMatchesPlainScan();
+    testCircleRoundTrip();
+    testPolygonRoundTrip();
+    testServerSurvivesMalformedRenders();
+    testShapeListViewRanges();
+    testDisplayListRanges();
+    testOptimizedDisplayListMatchesPainterOrder();
+    testMaxRangeShapeSpans();
+    testAffineTransformComposition();
+    testAffineTransformResultRange();
+    testPoolCloseFlushesThreadCaches();
+    testBlendKernelsMatchScalarReference();
+    testCompositorMatchesPainterOrder();
+    testCullingRejectsOutOfBoundsShapes();
+    testCullingMatchesPainterOrder();
+    testTrackerMatchesWholeFrameScan();
+
+    if (failedChecks != 0)
+    {
+        std::printf("%d checks failed\n", failedChecks);
+        return 1;
+    }
+    std::printf("All checks passed\n");
+    return 0;
+}